@@ -31,6 +31,10 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikocpu/array_intrinsic_f64x2_x86.hpp
     $<$<STREQUAL:${ARCHITECTURE_ID},x86>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/array_intrinsic_f64x4_x86.hpp>
     src/hikocpu/array_intrinsic_f64x4_x86.hpp
+    $<$<STREQUAL:${ARCHITECTURE_ID},x86>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/array_intrinsic_i16x8_x86.hpp>
+    src/hikocpu/array_intrinsic_i16x8_x86.hpp
+    $<$<STREQUAL:${ARCHITECTURE_ID},x86>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/array_intrinsic_u8x8_x86.hpp>
+    src/hikocpu/array_intrinsic_u8x8_x86.hpp
     $<$<STREQUAL:${ARCHITECTURE_ID},none>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/cpu_id_generic.hpp>
     src/hikocpu/cpu_id_generic.hpp
     $<$<STREQUAL:${ARCHITECTURE_ID},x86>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/cpu_id_x86.hpp>
@@ -145,15 +149,22 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikogui/char_maps/utf_8.hpp
     src/hikogui/codec/BON8.hpp
     src/hikogui/codec/JSON.hpp
+    src/hikogui/codec/JSON_tape.hpp
     src/hikogui/codec/SHA2.hpp
+    src/hikogui/codec/adler32.hpp
     src/hikogui/codec/base_n.hpp
     src/hikogui/codec/codec.hpp
+    src/hikogui/codec/crc32.hpp
     src/hikogui/codec/datum.hpp
+    src/hikogui/codec/datum_document.hpp
+    src/hikogui/codec/deflate.hpp
     src/hikogui/codec/gzip.hpp
     src/hikogui/codec/huffman.hpp
     src/hikogui/codec/indent.hpp
+    src/hikogui/codec/indexed_datum.hpp
     src/hikogui/codec/inflate.hpp
     src/hikogui/codec/jsonpath.hpp
+    src/hikogui/codec/jsonpath_plan.hpp
     src/hikogui/codec/pickle.hpp
     src/hikogui/codec/png.hpp
     src/hikogui/codec/zlib.hpp
@@ -173,6 +184,8 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikogui/concurrency/subsystem.hpp
     src/hikogui/concurrency/thread.hpp
     src/hikogui/concurrency/thread_intf.hpp
+    $<$<PLATFORM_ID:Linux>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/concurrency/thread_posix_impl.hpp>
+    src/hikogui/concurrency/thread_posix_impl.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/concurrency/thread_win32_impl.hpp>
     src/hikogui/concurrency/thread_win32_impl.hpp
     src/hikogui/concurrency/unfair_mutex.hpp
@@ -187,6 +200,7 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikogui/container/lean_vector.hpp
     src/hikogui/container/polymorphic_optional.hpp
     src/hikogui/container/secure_vector.hpp
+    src/hikogui/container/spsc_fifo.hpp
     src/hikogui/container/stable_set.hpp
     src/hikogui/container/stack.hpp
     src/hikogui/container/undo_stack.hpp
@@ -200,6 +214,7 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/crt/crt_utils_win32_impl.hpp>
     src/hikogui/crt/crt_utils_win32_impl.hpp
     src/hikogui/dispatch/async_task.hpp
+    src/hikogui/dispatch/async_task_impl.hpp
     src/hikogui/dispatch/awaitable.hpp
     src/hikogui/dispatch/awaitable_stop_token_impl.hpp
     src/hikogui/dispatch/awaitable_stop_token_intf.hpp
@@ -207,18 +222,25 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikogui/dispatch/awaitable_timer_intf.hpp
     src/hikogui/dispatch/dispatch.hpp
     src/hikogui/dispatch/function_timer.hpp
+    $<$<PLATFORM_ID:Linux>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/loop_posix_intf.hpp>
+    src/hikogui/dispatch/loop_posix_intf.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/loop_win32_intf.hpp>
     src/hikogui/dispatch/loop_win32_intf.hpp
     src/hikogui/dispatch/notifier.hpp
     src/hikogui/dispatch/progress.hpp
     src/hikogui/dispatch/socket_event.hpp
     src/hikogui/dispatch/socket_event_intf.hpp
+    $<$<PLATFORM_ID:Linux>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/socket_event_posix_impl.hpp>
+    src/hikogui/dispatch/socket_event_posix_impl.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/socket_event_win32_impl.hpp>
     src/hikogui/dispatch/socket_event_win32_impl.hpp
     src/hikogui/dispatch/task.hpp
     src/hikogui/dispatch/task_controller.hpp
+    src/hikogui/dispatch/thread_pool.hpp
     src/hikogui/dispatch/when_any.hpp
     src/hikogui/file/access_mode.hpp
+    src/hikogui/file/async_io.hpp
+    src/hikogui/file/binary_log_file.hpp
     src/hikogui/file/file.hpp
     src/hikogui/file/file_intf.hpp
     $<$<PLATFORM_ID:Linux>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/file/file_posix_impl.hpp>
@@ -230,6 +252,8 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikogui/file/file_view_win32_impl.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/file/file_win32_impl.hpp>
     src/hikogui/file/file_win32_impl.hpp
+    $<$<PLATFORM_ID:Linux>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/file/io_uring_posix.hpp>
+    src/hikogui/file/io_uring_posix.hpp
     src/hikogui/file/resource_view.hpp
     src/hikogui/file/seek_whence.hpp
     src/hikogui/font/elusive_icon.hpp
@@ -380,11 +404,13 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/random/seed_win32_impl.hpp>
     src/hikogui/random/seed_win32_impl.hpp
     src/hikogui/random/xorshift128p.hpp
+    src/hikogui/security/key_hash.hpp
     src/hikogui/security/security.hpp
     src/hikogui/security/security_intf.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/security/security_win32_impl.hpp>
     src/hikogui/security/security_win32_impl.hpp
     src/hikogui/security/sip_hash.hpp
+    src/hikogui/security/wy_hash.hpp
     src/hikogui/settings/os_settings.hpp
     src/hikogui/settings/os_settings_intf.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/settings/os_settings_win32_impl.hpp>
@@ -397,12 +423,15 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikogui/settings/user_settings_intf.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/settings/user_settings_win32_impl.hpp>
     src/hikogui/settings/user_settings_win32_impl.hpp
+    src/hikogui/telemetry/binary_log.hpp
     src/hikogui/telemetry/counters.hpp
     src/hikogui/telemetry/delayed_format.hpp
     src/hikogui/telemetry/format_check.hpp
+    src/hikogui/telemetry/histogram.hpp
     src/hikogui/telemetry/log.hpp
     src/hikogui/telemetry/telemetry.hpp
     src/hikogui/telemetry/trace.hpp
+    src/hikogui/telemetry/trace_recorder.hpp
     src/hikogui/test.hpp
     src/hikogui/text/text.hpp
     src/hikogui/text/text_cursor.hpp
@@ -493,6 +522,8 @@ target_sources(hikogui INTERFACE FILE_SET hikogui_include_files TYPE HEADERS BAS
     src/hikogui/utility/enum_metadata.hpp
     src/hikogui/utility/exception.hpp
     src/hikogui/utility/exception_intf.hpp
+    $<$<PLATFORM_ID:Linux>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/utility/exception_posix_impl.hpp>
+    src/hikogui/utility/exception_posix_impl.hpp
     $<$<PLATFORM_ID:Windows>:${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/utility/exception_win32_impl.hpp>
     src/hikogui/utility/exception_win32_impl.hpp
     src/hikogui/utility/fixed_string.hpp
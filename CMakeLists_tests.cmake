@@ -51,6 +51,7 @@ target_sources(hikogui_htests PRIVATE
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/simd_f32x4_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/simd_f64x2_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/simd_f64x4_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikocpu/simd_i16x8_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/GUI/widget_state_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/algorithm/algorithm_misc_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/algorithm/strings_tests.cpp
@@ -64,21 +65,35 @@ target_sources(hikogui_htests PRIVATE
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/char_maps/utf_32_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/char_maps/utf_8_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/BON8_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/JSON_tape_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/JSON_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/SHA2_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/adler32_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/base_n_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/crc32_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/datum_document_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/datum_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/deflate_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/gzip_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/indexed_datum_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/jsonpath_plan_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/jsonpath_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/codec/png_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/color/color_space_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/concurrency/callback_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/concurrency/unfair_mutex_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/container/expected_optional_tests.cpp
     #${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/container/lean_vector_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/container/polymorphic_optional_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/container/spsc_fifo_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/container/wfree_fifo_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/async_task_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/function_timer_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/loop_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/notifier_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/task_controller_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/dispatch/thread_pool_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/file/async_io_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/file/file_view_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/font/font_char_map_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/font/font_weight_tests.cpp
@@ -115,9 +130,13 @@ target_sources(hikogui_htests PRIVATE
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/random/seed_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/random/xorshift128p_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/security/sip_hash_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/security/wy_hash_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/settings/user_settings_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/telemetry/binary_log_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/telemetry/counters_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/telemetry/format_check_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/telemetry/histogram_tests.cpp
+    ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/telemetry/trace_recorder_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/theme/style_parser_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/unicode/grapheme_tests.cpp
     ${CMAKE_CURRENT_SOURCE_DIR}/src/hikogui/unicode/gstring_tests.cpp
@@ -0,0 +1,41 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "hikogui/hikogui.hpp"
+#include "hikogui/crt.hpp"
+#include <string>
+#include <format>
+#include <iostream>
+#include <filesystem>
+
+int usage()
+{
+    std::cerr << "Usage:\n";
+    std::cerr << "    decode_binary_log <binary log filename>\n" << std::endl;
+    return 2;
+}
+
+int hi_main(int argc, char* argv[])
+{
+    hi_axiom_not_null(argv);
+
+    if (argc != 2) {
+        return usage();
+    }
+    auto log_filename = std::filesystem::path(argv[1]);
+
+    try {
+        auto log_view = hi::file_view(log_filename);
+        for (auto const& entry : hi::read_binary_log(as_bstring_view(log_view))) {
+            std::cout << to_string(entry) << "\n";
+        }
+        std::cout << std::flush;
+
+    } catch (std::exception const& e) {
+        std::cerr << std::format("Could not decode binary log '{}': {}", log_filename.string(), e.what()) << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -699,7 +699,7 @@ struct array_generic {
             a = {};
         } else {
             for (std::size_t i = 0; i != N; ++i) {
-                a[i] = to_value(to_mask(a[0]) << b);
+                a[i] = to_value(to_mask(a[i]) << b);
             }
         }
         return a;
@@ -717,7 +717,7 @@ struct array_generic {
             a = {};
         } else {
             for (std::size_t i = 0; i != N; ++i) {
-                a[i] = to_value(to_mask(a[0]) >> b);
+                a[i] = to_value(to_mask(a[i]) >> b);
             }
         }
         return a;
@@ -736,7 +736,7 @@ struct array_generic {
         }
 
         for (std::size_t i = 0; i != N; ++i) {
-            a[i] = to_value(to_signed_mask(a[0]) >> b);
+            a[i] = to_value(to_signed_mask(a[i]) >> b);
         }
         return a;
     }
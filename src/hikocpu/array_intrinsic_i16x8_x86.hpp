@@ -0,0 +1,218 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "array_intrinsic.hpp"
+#include "macros.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <pmmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+#include <nmmintrin.h>
+#include <immintrin.h>
+
+hi_export_module(hikocpu : array_intrinsic_i16x8);
+
+hi_export namespace hi {
+inline namespace v1 {
+
+#if defined(HI_HAS_SSE2)
+template<>
+struct array_intrinsic<int16_t, 8> {
+    using value_type = int16_t;
+    using register_type = __m128i;
+    using array_type = std::array<int16_t, 8>;
+
+    /** Load an array into a register.
+     */
+    [[nodiscard]] hi_force_inline static register_type L(array_type a) noexcept
+    {
+        return _mm_loadu_si128(reinterpret_cast<__m128i const *>(a.data()));
+    }
+
+    /** Store a register into an array.
+     */
+    [[nodiscard]] hi_force_inline static array_type S(register_type a) noexcept
+    {
+        auto r = array_type{};
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(r.data()), a);
+        return r;
+    }
+
+    /** Zero-extend unsigned bytes to 16 bit integers.
+     */
+    [[nodiscard]] hi_force_inline static array_type convert(std::array<uint8_t, 8> a) noexcept
+    {
+        auto const a_ = _mm_loadl_epi64(reinterpret_cast<__m128i const *>(a.data()));
+        return S(_mm_unpacklo_epi8(a_, _mm_setzero_si128()));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type undefined() noexcept
+    {
+        return S(_mm_undefined_si128());
+    }
+
+    [[nodiscard]] hi_force_inline static array_type set_zero() noexcept
+    {
+        return S(_mm_setzero_si128());
+    }
+
+    [[nodiscard]] hi_force_inline static array_type set_all_ones() noexcept
+    {
+        return S(_mm_cmpeq_epi16(_mm_setzero_si128(), _mm_setzero_si128()));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type set_one() noexcept
+    {
+        return S(_mm_set1_epi16(1));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type broadcast(int16_t a) noexcept
+    {
+        return S(_mm_set1_epi16(a));
+    }
+
+    /** Store a register as a mask-integer.
+     */
+    [[nodiscard]] hi_force_inline static std::size_t get_mask(array_type a) noexcept
+    {
+        // Take the top bit of each odd byte, which are the sign bits of the 16 bit elements.
+        auto const bytes_mask = static_cast<std::size_t>(_mm_movemask_epi8(_mm_packs_epi16(L(a), _mm_setzero_si128())));
+        return bytes_mask & 0xff;
+    }
+
+    [[nodiscard]] hi_force_inline static array_type neg(array_type a) noexcept
+    {
+        return S(_mm_sub_epi16(_mm_setzero_si128(), L(a)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type inv(array_type a) noexcept
+    {
+        return _xor(set_all_ones(), a);
+    }
+
+#if defined(HI_HAS_SSSE3)
+    [[nodiscard]] hi_force_inline static array_type abs(array_type a) noexcept
+    {
+        return S(_mm_abs_epi16(L(a)));
+    }
+#endif
+
+    [[nodiscard]] hi_force_inline static array_type add(array_type a, array_type b) noexcept
+    {
+        return S(_mm_add_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type sub(array_type a, array_type b) noexcept
+    {
+        return S(_mm_sub_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type mul(array_type a, array_type b) noexcept
+    {
+        return S(_mm_mullo_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type eq(array_type a, array_type b) noexcept
+    {
+        return S(_mm_cmpeq_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type ne(array_type a, array_type b) noexcept
+    {
+        return inv(eq(a, b));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type lt(array_type a, array_type b) noexcept
+    {
+        return S(_mm_cmplt_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type gt(array_type a, array_type b) noexcept
+    {
+        return S(_mm_cmpgt_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type le(array_type a, array_type b) noexcept
+    {
+        return inv(gt(a, b));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type ge(array_type a, array_type b) noexcept
+    {
+        return inv(lt(a, b));
+    }
+
+    [[nodiscard]] hi_force_inline static bool test(array_type a, array_type b) noexcept
+    {
+#if defined(HI_HAS_SSE4_1)
+        return static_cast<bool>(_mm_testz_si128(L(a), L(b)));
+#else
+        return _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(L(a), L(b)), _mm_setzero_si128())) == 0xffff;
+#endif
+    }
+
+    [[nodiscard]] hi_force_inline static array_type max(array_type a, array_type b) noexcept
+    {
+        return S(_mm_max_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type min(array_type a, array_type b) noexcept
+    {
+        return S(_mm_min_epi16(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type clamp(array_type v, array_type lo, array_type hi) noexcept
+    {
+        return S(_mm_min_epi16(_mm_max_epi16(L(v), L(lo)), L(hi)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type _or(array_type a, array_type b) noexcept
+    {
+        return S(_mm_or_si128(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type _and(array_type a, array_type b) noexcept
+    {
+        return S(_mm_and_si128(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type _xor(array_type a, array_type b) noexcept
+    {
+        return S(_mm_xor_si128(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type andnot(array_type a, array_type b) noexcept
+    {
+        return S(_mm_andnot_si128(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type sll(array_type a, unsigned int b) noexcept
+    {
+        auto const b_ = _mm_set_epi32(0, 0, 0, b);
+        return S(_mm_sll_epi16(L(a), b_));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type srl(array_type a, unsigned int b) noexcept
+    {
+        auto const b_ = _mm_set_epi32(0, 0, 0, b);
+        return S(_mm_srl_epi16(L(a), b_));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type sra(array_type a, unsigned int b) noexcept
+    {
+        auto const b_ = _mm_set_epi32(0, 0, 0, b);
+        return S(_mm_sra_epi16(L(a), b_));
+    }
+};
+#endif
+
+} // namespace v1
+} // namespace v1
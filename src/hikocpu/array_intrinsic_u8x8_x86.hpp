@@ -0,0 +1,130 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "array_intrinsic.hpp"
+#include "macros.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <array>
+
+#include <xmmintrin.h>
+#include <emmintrin.h>
+#include <pmmintrin.h>
+#include <tmmintrin.h>
+#include <smmintrin.h>
+#include <nmmintrin.h>
+#include <immintrin.h>
+
+hi_export_module(hikocpu : array_intrinsic_u8x8);
+
+hi_export namespace hi {
+inline namespace v1 {
+
+#if defined(HI_HAS_SSE2)
+/** Intrinsics for 8 unsigned bytes.
+ *
+ * The bytes are held in the lower half of a 128 bit register.
+ */
+template<>
+struct array_intrinsic<uint8_t, 8> {
+    using value_type = uint8_t;
+    using register_type = __m128i;
+    using array_type = std::array<uint8_t, 8>;
+
+    /** Load an array into a register.
+     */
+    [[nodiscard]] hi_force_inline static register_type L(array_type a) noexcept
+    {
+        return _mm_loadl_epi64(reinterpret_cast<__m128i const *>(a.data()));
+    }
+
+    /** Store a register into an array.
+     */
+    [[nodiscard]] hi_force_inline static array_type S(register_type a) noexcept
+    {
+        auto r = array_type{};
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(r.data()), a);
+        return r;
+    }
+
+    /** Truncate 16 bit integers to bytes.
+     */
+    [[nodiscard]] hi_force_inline static array_type convert(std::array<int16_t, 8> a) noexcept
+    {
+        auto const a_ = _mm_loadu_si128(reinterpret_cast<__m128i const *>(a.data()));
+        auto const low_bytes = _mm_and_si128(a_, _mm_set1_epi16(0xff));
+        return S(_mm_packus_epi16(low_bytes, low_bytes));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type undefined() noexcept
+    {
+        return S(_mm_undefined_si128());
+    }
+
+    [[nodiscard]] hi_force_inline static array_type set_zero() noexcept
+    {
+        return S(_mm_setzero_si128());
+    }
+
+    [[nodiscard]] hi_force_inline static array_type set_all_ones() noexcept
+    {
+        return S(_mm_cmpeq_epi8(_mm_setzero_si128(), _mm_setzero_si128()));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type broadcast(uint8_t a) noexcept
+    {
+        return S(_mm_set1_epi8(static_cast<char>(a)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type add(array_type a, array_type b) noexcept
+    {
+        return S(_mm_add_epi8(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type sub(array_type a, array_type b) noexcept
+    {
+        return S(_mm_sub_epi8(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type eq(array_type a, array_type b) noexcept
+    {
+        return S(_mm_cmpeq_epi8(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type max(array_type a, array_type b) noexcept
+    {
+        return S(_mm_max_epu8(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type min(array_type a, array_type b) noexcept
+    {
+        return S(_mm_min_epu8(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type _or(array_type a, array_type b) noexcept
+    {
+        return S(_mm_or_si128(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type _and(array_type a, array_type b) noexcept
+    {
+        return S(_mm_and_si128(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type _xor(array_type a, array_type b) noexcept
+    {
+        return S(_mm_xor_si128(L(a), L(b)));
+    }
+
+    [[nodiscard]] hi_force_inline static array_type andnot(array_type a, array_type b) noexcept
+    {
+        return S(_mm_andnot_si128(L(a), L(b)));
+    }
+};
+#endif
+
+} // namespace v1
+} // namespace v1
@@ -0,0 +1,59 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "hikocpu.hpp"
+#include <hikotest/hikotest.hpp>
+
+TEST_SUITE(simd_i16x8_suite)
+{
+
+TEST_CASE(convert_test)
+{
+    auto const bytes = std::array<uint8_t, 8>{0, 1, 127, 128, 200, 254, 255, 3};
+    auto const words = hi::i16x8{bytes};
+    REQUIRE(words == hi::i16x8(0, 1, 127, 128, 200, 254, 255, 3));
+
+    // Conversion back to bytes truncates.
+    auto const truncated = hi::u8x8{hi::i16x8(0, 255, 256, 257, -1, -256, 0x1234, 511)};
+    REQUIRE(truncated == hi::u8x8(0, 255, 0, 1, 255, 0, 0x34, 255));
+}
+
+TEST_CASE(arithmetic_test)
+{
+    auto const a = hi::i16x8(1, -2, 3, -4, 300, -300, 32767, -32768);
+    auto const b = hi::i16x8(5, 6, -7, -8, 255, 255, 1, -1);
+
+    REQUIRE(a + b == hi::i16x8(6, 4, -4, -12, 555, -45, -32768, 32767));
+    REQUIRE(a - b == hi::i16x8(-4, -8, 10, 4, 45, -555, 32766, -32767));
+    REQUIRE(abs(a) == hi::i16x8(1, 2, 3, 4, 300, 300, 32767, -32768));
+    REQUIRE(min(a, b) == hi::i16x8(1, -2, -7, -8, 255, -300, 1, -32768));
+    REQUIRE(max(a, b) == hi::i16x8(5, 6, 3, -4, 300, 255, 32767, -1));
+    REQUIRE(sra(a, 1) == hi::i16x8(0, -1, 1, -2, 150, -150, 16383, -16384));
+    REQUIRE(srl(hi::i16x8(2, 4, 6, 8, 10, 12, 14, -2), 1) == hi::i16x8(1, 2, 3, 4, 5, 6, 7, 32767));
+}
+
+TEST_CASE(compare_test)
+{
+    auto const a = hi::i16x8(1, 2, 3, 4, -1, -2, -3, -4);
+    auto const b = hi::i16x8(4, 3, 3, 1, -4, -2, -1, 0);
+
+    REQUIRE((a < b).mask() == 0b1100'0011);
+    REQUIRE((a > b).mask() == 0b0001'1000);
+    REQUIRE((a == b).mask() == 0b0010'0100);
+    REQUIRE((a <= b).mask() == 0b1110'0111);
+    REQUIRE((a >= b).mask() == 0b0011'1100);
+}
+
+TEST_CASE(u8x8_arithmetic_test)
+{
+    auto const a = hi::u8x8(1, 2, 3, 4, 200, 250, 255, 0);
+    auto const b = hi::u8x8(5, 6, 7, 8, 100, 10, 1, 1);
+
+    REQUIRE(a + b == hi::u8x8(6, 8, 10, 12, 44, 4, 0, 1));
+    REQUIRE(a - b == hi::u8x8(252, 252, 252, 252, 100, 240, 254, 255));
+    REQUIRE(min(a, b) == hi::u8x8(1, 2, 3, 4, 100, 10, 1, 0));
+    REQUIRE(max(a, b) == hi::u8x8(5, 6, 7, 8, 200, 250, 255, 1));
+}
+
+};
@@ -27,53 +27,53 @@ struct simd : std::array<T, N> {
     constexpr simd& operator=(simd&&) noexcept = default;
 
     template<array_generic_convertible_to<value_type>... Args>
-    constexpr simd(Args... args) noexcept requires(sizeof...(Args) == N)
+    hi_force_inline constexpr simd(Args... args) noexcept requires(sizeof...(Args) == N)
         : array_type(generic_type::set(static_cast<value_type>(args)...))
     {
     }
 
     template<array_generic_convertible_to<value_type> Arg>
-    constexpr explicit simd(Arg arg) noexcept : array_type(generic_type::set(static_cast<value_type>(arg)))
+    hi_force_inline constexpr explicit simd(Arg arg) noexcept : array_type(generic_type::set(static_cast<value_type>(arg)))
     {
     }
 
     template<array_generic_convertible_to<value_type> O>
-    constexpr simd(std::array<O, N> a) noexcept : array_type(generic_type::convert(a))
+    hi_force_inline constexpr simd(std::array<O, N> a) noexcept : array_type(generic_type::convert(a))
     {
     }
 
-    [[nodiscard]] constexpr static simd make_undefined() noexcept
+    [[nodiscard]] hi_force_inline constexpr static simd make_undefined() noexcept
     {
         return simd{generic_type::undefined()};
     }
 
-    [[nodiscard]] constexpr static simd make_zero() noexcept
+    [[nodiscard]] hi_force_inline constexpr static simd make_zero() noexcept
     {
         return simd{generic_type::set_zero()};
     }
 
-    [[nodiscard]] constexpr static simd make_one() noexcept
+    [[nodiscard]] hi_force_inline constexpr static simd make_one() noexcept
     {
         return simd{generic_type::set_one()};
     }
 
-    [[nodiscard]] constexpr static simd make_all_ones() noexcept
+    [[nodiscard]] hi_force_inline constexpr static simd make_all_ones() noexcept
     {
         return simd{generic_type::set_all_ones()};
     }
 
     template<array_generic_convertible_to<value_type> Arg>
-    [[nodiscard]] constexpr static simd broadcast(Arg arg) noexcept
+    [[nodiscard]] hi_force_inline constexpr static simd broadcast(Arg arg) noexcept
     {
         return simd{generic_type::broadcast(static_cast<value_type>(arg))};
     }
 
-    [[nodiscard]] constexpr static simd broadcast(array_type arg) noexcept
+    [[nodiscard]] hi_force_inline constexpr static simd broadcast(array_type arg) noexcept
     {
         return simd{generic_type::broadcast(arg)};
     }
 
-    [[nodiscard]] constexpr static simd make_mask(std::size_t mask) noexcept
+    [[nodiscard]] hi_force_inline constexpr static simd make_mask(std::size_t mask) noexcept
     {
         return simd{generic_type::set_mask(mask)};
     }
@@ -193,179 +193,179 @@ struct simd : std::array<T, N> {
         return std::get<2>(*this);
     }
 
-    [[nodiscard]] constexpr friend simd operator-(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator-(array_type a) noexcept
     {
         return simd{generic_type::neg(a)};
     }
 
     template<std::size_t Mask>
-    [[nodiscard]] constexpr friend simd neg_mask(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd neg_mask(array_type a) noexcept
     {
         return simd{generic_type::template neg_mask<Mask>(a)};
     }
 
-    [[nodiscard]] constexpr friend simd operator~(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator~(array_type a) noexcept
     {
         return simd{generic_type::inv(a)};
     }
 
-    [[nodiscard]] constexpr friend simd rcp(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd rcp(array_type a) noexcept
     {
         return simd{generic_type::rcp(a)};
     }
 
-    [[nodiscard]] constexpr friend simd sqrt(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd sqrt(array_type a) noexcept
     {
         return simd{generic_type::sqrt(a)};
     }
 
-    [[nodiscard]] constexpr friend simd rsqrt(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd rsqrt(array_type a) noexcept
     {
         return simd{generic_type::rsqrt(a)};
     }
 
-    [[nodiscard]] constexpr friend simd abs(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd abs(array_type a) noexcept
     {
         return simd{generic_type::abs(a)};
     }
 
-    [[nodiscard]] constexpr friend simd round(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd round(array_type a) noexcept
     {
         return simd{generic_type::round(a)};
     }
 
-    [[nodiscard]] constexpr friend simd floor(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd floor(array_type a) noexcept
     {
         return simd{generic_type::floor(a)};
     }
 
-    [[nodiscard]] constexpr friend simd ceil(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd ceil(array_type a) noexcept
     {
         return simd{generic_type::ceil(a)};
     }
 
-    [[nodiscard]] constexpr friend simd operator+(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator+(array_type a, array_type b) noexcept
     {
         return simd{generic_type::add(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator-(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator-(array_type a, array_type b) noexcept
     {
         return simd{generic_type::sub(a, b)};
     }
 
     template<std::size_t Mask>
-    [[nodiscard]] constexpr friend simd addsub_mask(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd addsub_mask(array_type a, array_type b) noexcept
     {
         return simd{generic_type::template addsub_mask<Mask>(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator*(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator*(array_type a, array_type b) noexcept
     {
         return simd{generic_type::mul(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator/(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator/(array_type a, array_type b) noexcept
     {
         return simd{generic_type::div(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator%(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator%(array_type a, array_type b) noexcept
     {
         return simd{generic_type::mod(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator==(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator==(array_type a, array_type b) noexcept
     {
         return simd{generic_type::eq(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator!=(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator!=(array_type a, array_type b) noexcept
     {
         return simd{generic_type::ne(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator<(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator<(array_type a, array_type b) noexcept
     {
         return simd{generic_type::lt(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator>(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator>(array_type a, array_type b) noexcept
     {
         return simd{generic_type::gt(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator<=(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator<=(array_type a, array_type b) noexcept
     {
         return simd{generic_type::le(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator>=(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator>=(array_type a, array_type b) noexcept
     {
         return simd{generic_type::ge(a, b)};
     }
 
-    [[nodiscard]] constexpr friend bool test(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend bool test(array_type a, array_type b) noexcept
     {
         return generic_type::test(a, b);
     }
 
-    [[nodiscard]] constexpr friend bool equal(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend bool equal(array_type a, array_type b) noexcept
     {
         return generic_type::all_equal(a, b);
     }
 
-    [[nodiscard]] constexpr friend simd max(simd a, simd b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd max(simd a, simd b) noexcept
     {
         return simd{generic_type::max(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd min(simd a, simd b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd min(simd a, simd b) noexcept
     {
         return simd{generic_type::min(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd clamp(simd v, simd lo, simd hi) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd clamp(simd v, simd lo, simd hi) noexcept
     {
         return simd{generic_type::clamp(v, lo, hi)};
     }
 
-    [[nodiscard]] constexpr friend simd operator|(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator|(array_type a, array_type b) noexcept
     {
         return simd{generic_type::_or(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator&(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator&(array_type a, array_type b) noexcept
     {
         return simd{generic_type::_and(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator^(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator^(array_type a, array_type b) noexcept
     {
         return simd{generic_type::_xor(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd sll(array_type a, unsigned int b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd sll(array_type a, unsigned int b) noexcept
     {
         return simd{generic_type::sll(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd sra(array_type a, unsigned int b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd sra(array_type a, unsigned int b) noexcept
     {
         return simd{generic_type::sra(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd srl(array_type a, unsigned int b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd srl(array_type a, unsigned int b) noexcept
     {
         return simd{generic_type::srl(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator<<(array_type a, unsigned int b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator<<(array_type a, unsigned int b) noexcept
     {
         return simd{generic_type::sll(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd operator>>(array_type a, unsigned int b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd operator>>(array_type a, unsigned int b) noexcept
     {
         if constexpr (std::signed_integral<value_type>) {
             return simd{generic_type::sra(a, b)};
@@ -374,70 +374,70 @@ struct simd : std::array<T, N> {
         }
     }
 
-    [[nodiscard]] constexpr friend simd andnot(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd andnot(array_type a, array_type b) noexcept
     {
         return simd{generic_type::andnot(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd hadd(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd hadd(array_type a, array_type b) noexcept
     {
         return simd{generic_type::hadd(a, b)};
     }
 
-    [[nodiscard]] constexpr friend simd hsub(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd hsub(array_type a, array_type b) noexcept
     {
         return simd{generic_type::hsub(a, b)};
     }
 
     template<int... Indices>
-    [[nodiscard]] constexpr friend simd shuffle(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd shuffle(array_type a) noexcept
     {
         return simd{generic_type::template shuffle<Indices...>(a)};
     }
 
     template<std::size_t Mask>
-    [[nodiscard]] constexpr friend simd blend(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd blend(array_type a, array_type b) noexcept
     {
         return simd{generic_type::template blend<Mask>(a, b)};
     }
 
     template<int... Indices>
-    [[nodiscard]] constexpr friend simd swizzle(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd swizzle(array_type a) noexcept
     {
         return simd{generic_type::template swizzle<Indices...>(a)};
     }
 
-    [[nodiscard]] constexpr friend simd sum(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd sum(array_type a) noexcept
     {
         return simd{generic_type::sum(a)};
     }
 
     template<std::size_t Mask>
-    [[nodiscard]] constexpr friend simd dot(array_type a, array_type b) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd dot(array_type a, array_type b) noexcept
     {
         return simd{generic_type::template dot<Mask>(a, b)};
     }
 
     template<std::size_t Mask>
-    [[nodiscard]] constexpr friend simd hypot(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd hypot(array_type a) noexcept
     {
         return simd{generic_type::template hypot<Mask>(a)};
     }
 
     template<std::size_t Mask>
-    [[nodiscard]] constexpr friend simd rhypot(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd rhypot(array_type a) noexcept
     {
         return simd{generic_type::template rhypot<Mask>(a)};
     }
 
     template<std::size_t Mask>
-    [[nodiscard]] constexpr friend simd normalize(array_type a) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend simd normalize(array_type a) noexcept
     {
         return simd{generic_type::template normalize<Mask>(a)};
     }
 
     template<std::derived_from<array_type>... Columns>
-    [[nodiscard]] constexpr friend std::array<simd, N> transpose(Columns... columns) noexcept
+    [[nodiscard]] hi_force_inline constexpr friend std::array<simd, N> transpose(Columns... columns) noexcept
     {
         auto const tmp = generic_type::template transpose<Columns...>(columns...);
         auto r = std::array<simd, N>{};
@@ -447,42 +447,42 @@ struct simd : std::array<T, N> {
         return r;
     }
 
-    constexpr simd& operator+=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator+=(array_type a) noexcept
     {
         return *this = *this + a;
     }
 
-    constexpr simd& operator-=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator-=(array_type a) noexcept
     {
         return *this = *this - a;
     }
 
-    constexpr simd& operator*=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator*=(array_type a) noexcept
     {
         return *this = *this * a;
     }
 
-    constexpr simd& operator/=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator/=(array_type a) noexcept
     {
         return *this = *this / a;
     }
 
-    constexpr simd& operator%=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator%=(array_type a) noexcept
     {
         return *this = *this % a;
     }
 
-    constexpr simd& operator|=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator|=(array_type a) noexcept
     {
         return *this = *this | a;
     }
 
-    constexpr simd& operator&=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator&=(array_type a) noexcept
     {
         return *this = *this & a;
     }
 
-    constexpr simd& operator^=(array_type a) noexcept
+    hi_force_inline constexpr simd& operator^=(array_type a) noexcept
     {
         return *this = *this ^ a;
     }
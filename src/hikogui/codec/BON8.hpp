@@ -8,8 +8,19 @@
 #include "../utility/utility.hpp"
 #include "datum.hpp"
 #include "../macros.hpp"
+#include <array>
+#include <bit>
 #include <cstddef>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <limits>
+#include <map>
+#include <span>
 #include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 hi_export_module(hikogui.codec.BON8);
 
@@ -51,228 +62,347 @@ constexpr auto BON8_code_float_one = uint8_t{0xfd};
 constexpr auto BON8_code_eoc = uint8_t{0xfe};
 constexpr auto BON8_code_eot = uint8_t{0xff};
 
-/** Decode BON8 message from buffer.
- * @param ptr [in,out] Pointer to start of byte-buffer. After the call
- *            ptr will point one beyond the message.
- * @param last Pointer one beyond the end of the message.
- * @return The decoded message.
+/** Count the number of UTF-8-like code units
+ * This does not really decode the character, just calculate the size.
+ *
+ * @param ptr The pointer to the first byte of a UTF-8-like multibyte sequence
+ * @param last The pointer beyond the buffer.
+ * @return When positive: the number of bytes in the UTF-8 character.
+ *         When negative: the number of bytes in the integer.
  */
-[[nodiscard]] datum decode_BON8(cbyteptr& ptr, cbyteptr last);
+[[nodiscard]] inline int BON8_multibyte_count(cbyteptr ptr, cbyteptr last)
+{
+    hi_assert_not_null(ptr);
+    hi_assert_not_null(last);
 
-[[nodiscard]] bstring encode_BON8(datum const& value);
+    auto const c0 = static_cast<uint8_t>(*ptr);
+    auto const count = c0 <= 0xdf ? 2 : c0 <= 0xef ? 3 : 4;
 
-/** BON8 encoder.
+    hi_check(ptr + count <= last, "Incomplete Multi-byte character at end of buffer");
+
+    auto const c1 = static_cast<uint8_t>(*(ptr + 1));
+    return (c1 < 0x80 or c1 > 0xbf) ? -count : count;
+}
+
+[[nodiscard]] inline long long decode_BON8_UTF8_like_int(cbyteptr& ptr, cbyteptr last, int count) noexcept
+{
+    hi_assert_not_null(ptr);
+    hi_assert_not_null(last);
+    hi_assert(count >= 2 && count <= 4);
+    hi_assert(ptr != last);
+    auto const c0 = static_cast<uint8_t>(*(ptr++));
+
+    auto const mask = uint8_t{0b0111'1111} >> count;
+    auto value = static_cast<long long>(c0 & mask);
+    if (count == 2) {
+        // The two byte sequence starts with 0xc2, leaving only 30 entries in the first byte.
+        value -= 2;
+    }
+
+    // The second byte determines the sign, and adds 6 or 7 bits to the number.
+    hi_assert(ptr != last);
+    auto const c1 = static_cast<uint8_t>(*(ptr++));
+    auto const is_positive = c1 <= 0x7f;
+    if (is_positive) {
+        value <<= 7;
+        value |= static_cast<long long>(c1);
+    } else {
+        value <<= 6;
+        value |= static_cast<long long>(c1 & 0b0011'1111);
+    }
+
+    switch (count) {
+    case 4:
+        hi_assert(ptr != last);
+        value <<= 8;
+        value |= static_cast<int>(*(ptr++));
+        [[fallthrough]];
+    case 3:
+        hi_assert(ptr != last);
+        value <<= 8;
+        value |= static_cast<int>(*(ptr++));
+        [[fallthrough]];
+    default:;
+    }
+
+    if (is_positive) {
+        switch (count) {
+        case 2:
+            return value + 40;
+        case 3:
+            return value + 3880;
+        case 4:
+            return value + 528168;
+        default:
+            hi_no_default();
+        }
+
+    } else {
+        switch (count) {
+        case 2:
+            return -(value + 11);
+        case 3:
+            return -(value + 1931);
+        case 4:
+            return -(value + 264075);
+        default:
+            hi_no_default();
+        }
+    }
+}
+
+
+template<typename T>
+concept BON8_vector = requires { typename T::value_type; } and std::same_as<T, std::vector<typename T::value_type>>;
+
+template<typename T>
+concept BON8_map = requires { typename T::mapped_type; } and std::same_as<T, std::map<std::string, typename T::mapped_type>>;
+
+} // namespace detail
+
+/** The tokens returned by the BON8_reader.
  */
-class BON8_encoder {
-    bool open_string;
-    bstring output;
+hi_export enum class BON8_token : uint8_t {
+    /** The root value has been read.
+     */
+    end,
+    null,
+    boolean,
+    integer,
+    real,
+    string,
+    array_begin,
+    array_end,
+    object_begin,
+    object_end
+};
+
+/** Aggregates which are serialized as an array of their data members.
+ *
+ * The data members are found through `number_of_data_members` and `get_data_member()`
+ * from utility/reflection.hpp. For aggregates that are not trivially constructible,
+ * for example with a `std::string` member, `number_of_data_members` must be specialized.
+ */
+hi_export template<typename T>
+concept BON8_aggregate = std::is_class_v<T> and std::is_aggregate_v<T>;
 
+/** BON8 writer.
+ *
+ * The writer encodes values directly into a buffer owned by the caller:
+ *  - A byte string, which is grown as needed. The message is appended to the string,
+ *    so that a string can be cleared and reused for the next message without allocating.
+ *  - A fixed size buffer. When the buffer is full it is passed to the flush function and
+ *    then reused, so that large messages can be streamed in chunks. Without a flush
+ *    function a full buffer throws `std::overflow_error`.
+ *
+ * Arrays and objects may be written incrementally with `begin_array()`/`end_array()` and
+ * `begin_object()`/`end_object()`. `finish()` must be called after the last value.
+ */
+hi_export class BON8_writer {
 public:
-    BON8_encoder() noexcept : open_string(false), output() {}
+    using flush_type = std::function<void(std::span<std::byte const>)>;
 
-    /** Return a byte_string of the encoded object.
+    BON8_writer(BON8_writer const&) = delete;
+    BON8_writer(BON8_writer&&) = delete;
+    BON8_writer& operator=(BON8_writer const&) = delete;
+    BON8_writer& operator=(BON8_writer&&) = delete;
+
+    /** Write a message to the end of a byte string.
+     */
+    explicit BON8_writer(bstring& buffer) noexcept :
+        _string(&buffer), _first(buffer.size()), _ptr(buffer.data() + buffer.size()), _last(_ptr)
+    {
+    }
+
+    /** Write a message into a fixed size buffer.
+     *
+     * @param buffer The buffer to write into.
+     * @param flush A function that is called with the written part of the buffer when
+     *              the buffer is full and by `finish()`. The buffer must be at least 16
+     *              bytes when a flush function is given.
+     */
+    explicit BON8_writer(std::span<std::byte> buffer, flush_type flush = {}) noexcept :
+        _flush(std::move(flush)), _begin(buffer.data()), _ptr(buffer.data()), _last(buffer.data() + buffer.size())
+    {
+        hi_axiom(not _flush or buffer.size() >= 16);
+    }
+
+    /** The number of bytes written to the buffer.
+     *
+     * For a byte string the number of bytes that were appended, for a fixed size
+     * buffer the number of bytes since the last flush.
+     */
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        if (_string != nullptr) {
+            return narrow_cast<std::size_t>(_ptr - _string->data()) - _first;
+        } else {
+            return narrow_cast<std::size_t>(_ptr - _begin);
+        }
+    }
+
+    /** Complete the message.
+     *
+     * Terminates a trailing string. A byte string is truncated to the end of the
+     * message, a fixed size buffer with a flush function is flushed.
      */
-    bstring const& get() noexcept
+    void finish()
     {
-        if (open_string) {
-            output += static_cast<std::byte>(BON8_code_eot);
-            open_string = false;
+        if (_open_string) {
+            emit(detail::BON8_code_eot);
+            _open_string = false;
+        }
+
+        if (_string != nullptr) {
+            _string->resize(narrow_cast<std::size_t>(_ptr - _string->data()));
+            _ptr = _last = _string->data() + _string->size();
+        } else if (_flush) {
+            flush();
         }
-        return output;
     }
 
-    /** And a signed integer.
+    /** Add a signed integer.
      * @param value A signed integer.
      */
-    void add(signed long long value) noexcept
+    void add(signed long long value)
     {
-        open_string = false;
+        using namespace detail;
+
+        _open_string = false;
+
+        // Encode into the buffer directly, the longest encoding is 9 bytes.
+        auto *const p = reserve(9);
+        auto n = 0;
+        auto const put = [&](auto byte) {
+            p[n++] = static_cast<std::byte>(byte);
+        };
 
         if (value < std::numeric_limits<int32_t>::min()) {
-            output += static_cast<std::byte>(BON8_code_int64);
-            for (int i = 0; i != 8; ++i) {
-                output += static_cast<std::byte>(value >> (56 - i * 8));
-            }
+            put(BON8_code_int64);
+            store_be(value, p + n);
+            n += 8;
 
         } else if (value <= -33818507) {
-            output += static_cast<std::byte>(BON8_code_int32);
-            for (int i = 0; i != 4; ++i) {
-                output += static_cast<std::byte>(value >> (24 - i * 8));
-            }
+            put(BON8_code_int32);
+            store_be(narrow_cast<int32_t>(value), p + n);
+            n += 4;
 
         } else if (value <= -264075) {
             value = -(value + 264075);
-            output += static_cast<std::byte>(0xf0 + (value >> 22 & 0x07));
-            output += static_cast<std::byte>(0xc0 + (value >> 16 & 0x3f));
-            output += static_cast<std::byte>(value >> 8);
-            output += static_cast<std::byte>(value);
+            put(0xf0 + (value >> 22 & 0x07));
+            put(0xc0 + (value >> 16 & 0x3f));
+            put(value >> 8);
+            put(value);
 
         } else if (value <= -1931) {
             value = -(value + 1931);
-            output += static_cast<std::byte>(0xe0 + (value >> 14 & 0x0f));
-            output += static_cast<std::byte>(0xc0 + (value >> 8 & 0x3f));
-            output += static_cast<std::byte>(value);
+            put(0xe0 + (value >> 14 & 0x0f));
+            put(0xc0 + (value >> 8 & 0x3f));
+            put(value);
 
         } else if (value <= -11) {
             value = -(value + 11);
-            output += static_cast<std::byte>(0xc2 + (value >> 6 & 0x1f));
-            output += static_cast<std::byte>(0xc0 + (value & 0x3f));
+            put(0xc2 + (value >> 6 & 0x1f));
+            put(0xc0 + (value & 0x3f));
 
         } else if (value <= -1) {
             value = -(value + 1);
-            output += static_cast<std::byte>(BON8_code_negative_s + value);
+            put(BON8_code_negative_s + value);
 
         } else if (value <= 39) {
-            output += static_cast<std::byte>(BON8_code_positive_s + value);
+            put(BON8_code_positive_s + value);
 
         } else if (value <= 3879) {
             value -= 40;
-            output += static_cast<std::byte>(0xc2 + (value >> 7 & 0x1f));
-            output += static_cast<std::byte>(value & 0x7f);
+            put(0xc2 + (value >> 7 & 0x1f));
+            put(value & 0x7f);
 
         } else if (value <= 528167) {
             value -= 3880;
-            output += static_cast<std::byte>(0xe0 + (value >> 15 & 0x0f));
-            output += static_cast<std::byte>(value >> 8 & 0x7f);
-            output += static_cast<std::byte>(value);
+            put(0xe0 + (value >> 15 & 0x0f));
+            put(value >> 8 & 0x7f);
+            put(value);
 
         } else if (value <= 67637031) {
             value -= 528168;
-            output += static_cast<std::byte>(0xf0 + (value >> 23 & 0x17));
-            output += static_cast<std::byte>(value >> 16 & 0x7f);
-            output += static_cast<std::byte>(value >> 8);
-            output += static_cast<std::byte>(value);
+            put(0xf0 + (value >> 23 & 0x07));
+            put(value >> 16 & 0x7f);
+            put(value >> 8);
+            put(value);
 
         } else if (value <= std::numeric_limits<int32_t>::max()) {
-            output += static_cast<std::byte>(BON8_code_int32);
-            for (int i = 0; i != 4; ++i) {
-                output += static_cast<std::byte>(value >> (24 - i * 8));
-            }
+            put(BON8_code_int32);
+            store_be(narrow_cast<int32_t>(value), p + n);
+            n += 4;
 
         } else {
-            output += static_cast<std::byte>(BON8_code_int64);
-            for (int i = 0; i != 8; ++i) {
-                output += static_cast<std::byte>(value >> (56 - i * 8));
-            }
+            put(BON8_code_int64);
+            store_be(value, p + n);
+            n += 8;
         }
-    }
-
-    /** And a unsigned integer.
-     * @param value A unsigned integer.
-     */
-    void add(unsigned long long value) noexcept
-    {
-        return add(narrow_cast<signed long long>(value));
-    }
-
-    /** And a signed integer.
-     * @param value A signed integer.
-     */
-    void add(signed long value) noexcept
-    {
-        return add(narrow_cast<signed long long>(value));
-    }
-
-    /** And a unsigned integer.
-     * @param value A unsigned integer.
-     */
-    void add(unsigned long value) noexcept
-    {
-        return add(narrow_cast<signed long long>(value));
-    }
-
-    /** And a signed integer.
-     * @param value A signed integer.
-     */
-    void add(signed int value) noexcept
-    {
-        return add(narrow_cast<signed long long>(value));
-    }
-
-    /** And a unsigned integer.
-     * @param value A unsigned integer.
-     */
-    void add(unsigned int value) noexcept
-    {
-        return add(narrow_cast<signed long long>(value));
-    }
-
-    /** And a signed integer.
-     * @param value A signed integer.
-     */
-    void add(signed short value) noexcept
-    {
-        return add(narrow_cast<signed long long>(value));
-    }
 
-    /** And a unsigned integer.
-     * @param value A unsigned integer.
-     */
-    void add(unsigned short value) noexcept
-    {
-        return add(narrow_cast<signed long long>(value));
+        _ptr += n;
     }
 
-    /** And a signed integer.
-     * @param value A signed integer.
+    /** Add an integer.
+     * @param value An integer, it must fit in a `long long`.
      */
-    void add(signed char value) noexcept
+    template<numeric_integral T>
+    void add(T value)
     {
-        return add(narrow_cast<signed long long>(value));
+        add(narrow_cast<signed long long>(value));
     }
 
-    /** And a unsigned integer.
-     * @param value A unsigned integer.
+    /** Add an enum as its underlying integer.
+     * @param value The enum value.
      */
-    void add(unsigned char value) noexcept
+    template<typename T>
+        requires std::is_enum_v<T>
+    void add(T value)
     {
-        return add(narrow_cast<signed long long>(value));
+        add(std::to_underlying(value));
     }
 
     /** Add a floating point number.
      * @param value A floating point number.
      */
-    void add(double value) noexcept
+    void add(double value)
     {
-        open_string = false;
+        using namespace detail;
+
+        _open_string = false;
 
         auto const f32 = static_cast<float>(value);
         auto const f32_64 = static_cast<double>(f32);
 
         if (value == -1.0) {
-            output += static_cast<std::byte>(BON8_code_float_min_one);
+            emit(BON8_code_float_min_one);
 
         } else if (value == 0.0 and not std::signbit(value)) {
-            output += static_cast<std::byte>(BON8_code_float_zero);
+            emit(BON8_code_float_zero);
 
         } else if (value == 1.0) {
-            output += static_cast<std::byte>(BON8_code_float_one);
+            emit(BON8_code_float_one);
 
         } else if (f32_64 == value) {
             // After conversion to 32-bit float, precession was not reduced.
-            uint32_t u32;
-            std::memcpy(&u32, &f32, sizeof(u32));
-
-            output += static_cast<std::byte>(BON8_code_binary32);
-            for (int i = 0; i != 4; ++i) {
-                output += static_cast<std::byte>(u32 >> (24 - i * 8));
-            }
+            auto *const p = reserve(5);
+            p[0] = static_cast<std::byte>(BON8_code_binary32);
+            store_be(std::bit_cast<uint32_t>(f32), p + 1);
+            _ptr += 5;
 
         } else {
-            uint64_t u64;
-            std::memcpy(&u64, &value, sizeof(u64));
-
-            output += static_cast<std::byte>(BON8_code_binary64);
-            for (int i = 0; i != 8; ++i) {
-                output += static_cast<std::byte>(u64 >> (56 - i * 8));
-            }
+            auto *const p = reserve(9);
+            p[0] = static_cast<std::byte>(BON8_code_binary64);
+            store_be(std::bit_cast<uint64_t>(value), p + 1);
+            _ptr += 9;
         }
     }
 
     /** Add a floating point number.
      * @param value A floating point number.
      */
-    void add(float value) noexcept
+    void add(float value)
     {
         return add(static_cast<double>(value));
     }
@@ -280,19 +410,18 @@ public:
     /** Add a boolean.
      * @param value A boolean value.
      */
-    void add(bool value) noexcept
+    void add(bool value)
     {
-        open_string = false;
-        output += static_cast<std::byte>(value ? BON8_code_bool_true : BON8_code_bool_false);
+        _open_string = false;
+        emit(value ? detail::BON8_code_bool_true : detail::BON8_code_bool_false);
     }
 
     /** Add a null.
-     * @param value A null pointer.
      */
-    void add(nullptr_t value) noexcept
+    void add(nullptr_t)
     {
-        open_string = false;
-        output += static_cast<std::byte>(BON8_code_null);
+        _open_string = false;
+        emit(detail::BON8_code_null);
     }
 
     /** Add a UTF-8 string.
@@ -300,46 +429,44 @@ public:
      *
      * @param value A UTF-8 string.
      */
-    void add(std::string_view value) noexcept
+    void add(std::string_view value)
     {
-        if (open_string) {
-            output += static_cast<std::byte>(BON8_code_eot);
+        if (_open_string) {
+            emit(detail::BON8_code_eot);
         }
 
         if (value.empty()) {
-            output += static_cast<std::byte>(BON8_code_eot);
-            open_string = false;
-
-        } else {
-            int multi_byte = 0;
-
-            for (auto const _c : value) {
-                auto const c = truncate<uint8_t>(_c);
+            emit(detail::BON8_code_eot);
+            _open_string = false;
+            return;
+        }
 
 #ifndef NDEBUG
-                if (multi_byte == 0) {
-                    if (c >= 0xc2 and c <= 0xdf) {
-                        multi_byte = 1;
-                    } else if (c >= 0xe0 and c <= 0xef) {
-                        multi_byte = 2;
-                    } else if (c >= 0xf0 and c <= 0xf7) {
-                        multi_byte = 3;
-                    } else {
-                        hi_assert(c <= 0x7f);
-                    }
-
+        int multi_byte = 0;
+        for (auto const _c : value) {
+            auto const c = truncate<uint8_t>(_c);
+
+            if (multi_byte == 0) {
+                if (c >= 0xc2 and c <= 0xdf) {
+                    multi_byte = 1;
+                } else if (c >= 0xe0 and c <= 0xef) {
+                    multi_byte = 2;
+                } else if (c >= 0xf0 and c <= 0xf7) {
+                    multi_byte = 3;
                 } else {
-                    hi_assert(c >= 0x80 and c <= 0xbf);
-                    --multi_byte;
+                    hi_assert(c <= 0x7f);
                 }
-#endif
 
-                output += static_cast<std::byte>(c);
+            } else {
+                hi_assert(c >= 0x80 and c <= 0xbf);
+                --multi_byte;
             }
-            hi_assert(multi_byte == 0);
-
-            open_string = true;
         }
+        hi_assert(multi_byte == 0);
+#endif
+
+        emit(std::as_bytes(std::span{value}));
+        _open_string = true;
     }
 
     /** Add a UTF-8 string.
@@ -347,7 +474,7 @@ public:
      *
      * @param value A UTF-8 string.
      */
-    void add(std::string const& value) noexcept
+    void add(std::string const& value)
     {
         add(std::string_view{value});
     }
@@ -357,7 +484,7 @@ public:
      *
      * @param value A UTF-8 string.
      */
-    void add(char const *value) noexcept
+    void add(char const *value)
     {
         add(std::string_view{value});
     }
@@ -365,7 +492,26 @@ public:
     /** Add a datum.
      * @param value A datum.
      */
-    void add(datum const& value);
+    void add(datum const& value)
+    {
+        if (auto s = get_if<std::string>(value)) {
+            add(*s);
+        } else if (auto b = get_if<bool>(value)) {
+            add(*b);
+        } else if (holds_alternative<nullptr_t>(value)) {
+            add(nullptr);
+        } else if (auto i = get_if<long long>(value)) {
+            add(*i);
+        } else if (auto f = get_if<double>(value)) {
+            add(*f);
+        } else if (auto v = get_if<datum::vector_type>(value)) {
+            add(*v);
+        } else if (auto m = get_if<datum::map_type>(value)) {
+            add(*m);
+        } else {
+            throw operation_error("Datum value can not be encoded to BON8");
+        }
+    }
 
     /** Add a vector of values of the same type.
      * @tparam T Type of the values.
@@ -374,404 +520,661 @@ public:
     template<typename T>
     void add(std::vector<T> const& items)
     {
-        open_string = false;
-        if (size(items) <= 4) {
-            output += static_cast<std::byte>(BON8_code_array_count0 + size(items));
-        } else {
-            output += static_cast<std::byte>(BON8_code_array);
-        }
-
+        begin_array(items.size());
         for (auto const& item : items) {
             add(item);
         }
-
-        if (size(items) > 4) {
-            output += static_cast<std::byte>(BON8_code_eoc);
-            open_string = false;
-        }
+        end_array(items.size());
     }
 
     /** Add a map of key/values pairs.
-     * @tparam Key A type convertible to a string_view; a valid UTF-8 string.
+     * @tparam Key A type convertible to a string_view; a valid UTF-8 string, or a datum holding a string.
      * @tparam Value The type of the Value.
      * @param items The map of key/value pairs.
      */
     template<typename Key, typename Value>
     void add(std::map<Key, Value> const& items)
     {
-        using key_type = typename std::remove_cvref_t<decltype(items)>::key_type;
-
-        open_string = false;
-        if (size(items) <= 4) {
-            output += static_cast<std::byte>(BON8_code_object_count0 + size(items));
-        } else {
-            output += static_cast<std::byte>(BON8_code_object);
-        }
-
+        begin_object(items.size());
         for (auto const& item : items) {
-            if (auto *s = get_if<std::string>(item.first)) {
-                add(*s);
+            if constexpr (std::is_same_v<Key, datum>) {
+                if (auto *s = get_if<std::string>(item.first)) {
+                    add(*s);
+                } else {
+                    throw operation_error("BON8 object keys must be strings");
+                }
             } else {
-                throw operation_error("BON8 object keys must be strings");
+                add(std::string_view{item.first});
             }
             add(item.second);
         }
+        end_object(items.size());
+    }
 
-        if (size(items) > 4) {
-            output += static_cast<std::byte>(BON8_code_eoc);
-            open_string = false;
-        }
+    /** Add an aggregate as an array of its data members.
+     * @param value The aggregate.
+     */
+    template<BON8_aggregate T>
+    void add(T const& value)
+    {
+        constexpr auto count = number_of_data_members_v<T>;
+
+        begin_array(count);
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (add(get_data_member<I>(value)), ...);
+        }(std::make_index_sequence<count>{});
+        end_array(count);
     }
-};
 
-void inline BON8_encoder::add(datum const& value)
-{
-    if (auto s = get_if<std::string>(value)) {
-        add(*s);
-    } else if (auto b = get_if<bool>(value)) {
-        add(*b);
-    } else if (holds_alternative<nullptr_t>(value)) {
-        add(nullptr);
-    } else if (auto i = get_if<long long>(value)) {
-        add(*i);
-    } else if (auto f = get_if<double>(value)) {
-        add(*f);
-    } else if (auto v = get_if<datum::vector_type>(value)) {
-        add(*v);
-    } else if (auto m = get_if<datum::map_type>(value)) {
-        add(*m);
-    } else {
-        throw operation_error("Datum value can not be encoded to BON8");
+    /** Start an array of unknown size, it must be closed with `end_array()`.
+     */
+    void begin_array()
+    {
+        _open_string = false;
+        emit(detail::BON8_code_array);
     }
-}
 
-/** Count the number of UTF-8-like code units
- * This does not really decode the character, just calculate the size.
- *
- * @param ptr The pointer to the first byte of a UTF-8-like multibyte sequence
- * @param last The pointer beyond the buffer.
- * @return When positive: the number of bytes in the UTF-8 character.
- *         When negative: the number of bytes in the integer.
- */
-[[nodiscard]] inline int BON8_multibyte_count(cbyteptr ptr, cbyteptr last)
-{
-    hi_assert_not_null(ptr);
-    hi_assert_not_null(last);
+    /** Start an array with a known number of elements.
+     *
+     * @param count The number of elements, the array must be closed with `end_array(count)`.
+     */
+    void begin_array(std::size_t count)
+    {
+        _open_string = false;
+        emit(count <= 4 ? narrow_cast<uint8_t>(detail::BON8_code_array_count0 + count) : detail::BON8_code_array);
+    }
 
-    auto const c0 = static_cast<uint8_t>(*ptr);
-    auto const count = c0 <= 0xdf ? 2 : c0 <= 0xef ? 3 : 4;
+    void end_array()
+    {
+        _open_string = false;
+        emit(detail::BON8_code_eoc);
+    }
 
-    hi_check(ptr + count <= last, "Incomplete Multi-byte character at end of buffer");
+    void end_array(std::size_t count)
+    {
+        if (count > 4) {
+            end_array();
+        }
+    }
 
-    auto const c1 = static_cast<uint8_t>(*(ptr + 1));
-    return (c1 < 0x80 or c1 > 0xbf) ? -count : count;
-}
+    /** Start an object of unknown size, it must be closed with `end_object()`.
+     *
+     * The members are written as a string key followed by the value.
+     */
+    void begin_object()
+    {
+        _open_string = false;
+        emit(detail::BON8_code_object);
+    }
 
-/** Decode a 4, or 8 byte signed integer.
- *
- * @param[in,out] ptr The pointer to the first byte of the integer.
- *                     On return this points beyond the integer.
- * @param last The pointer beyond the buffer.
- * @param count The number of bytes used to encode the integer.
- * @return The integer as a datum.
- */
-[[nodiscard]] inline datum decode_BON8_int(cbyteptr& ptr, cbyteptr last, int count)
-{
-    hi_assert_not_null(ptr);
-    hi_assert_not_null(last);
-    hi_assert(count == 4 || count == 8);
+    /** Start an object with a known number of members.
+     *
+     * @param count The number of members, the object must be closed with `end_object(count)`.
+     */
+    void begin_object(std::size_t count)
+    {
+        _open_string = false;
+        emit(count <= 4 ? narrow_cast<uint8_t>(detail::BON8_code_object_count0 + count) : detail::BON8_code_object);
+    }
 
-    auto u64 = uint64_t{0};
-    for (int i = 0; i != count; ++i) {
-        hi_check(ptr != last, "Incomplete signed integer at end of buffer");
-        u64 <<= 8;
-        u64 |= static_cast<uint64_t>(*(ptr++));
+    void end_object()
+    {
+        _open_string = false;
+        emit(detail::BON8_code_eoc);
     }
 
-    if (count == 4) {
-        auto const u32 = truncate<uint32_t>(u64);
-        auto const i32 = truncate<int32_t>(u32);
-        return datum{i32};
-    } else {
-        auto const i64 = truncate<int64_t>(u64);
-        return datum{i64};
+    void end_object(std::size_t count)
+    {
+        if (count > 4) {
+            end_object();
+        }
     }
-}
 
-[[nodiscard]] inline datum decode_BON8_float(cbyteptr& ptr, cbyteptr last, int count)
-{
-    hi_assert_not_null(ptr);
-    hi_assert_not_null(last);
-    hi_assert(count == 4 || count == 8);
+private:
+    bstring *_string = nullptr;
 
-    auto u64 = uint64_t{0};
-    for (int i = 0; i != count; ++i) {
-        hi_check(ptr != last, "Incomplete signed integer at end of buffer");
-        u64 <<= 8;
-        u64 |= static_cast<uint64_t>(*(ptr++));
-    }
+    /** The offset in the byte string where the message starts.
+     */
+    std::size_t _first = 0;
 
-    if (count == 4) {
-        auto const u32 = truncate<uint32_t>(u64);
-        float f32;
-        std::memcpy(&f32, &u32, sizeof(f32));
-        return datum{f32};
+    flush_type _flush = {};
 
-    } else {
-        double f64;
-        std::memcpy(&f64, &u64, sizeof(f64));
-        return datum{f64};
-    }
-}
+    /** The start of the fixed size buffer.
+     */
+    std::byte *_begin = nullptr;
+    std::byte *_ptr = nullptr;
+    std::byte *_last = nullptr;
 
-[[nodiscard]] inline datum decode_BON8_array(cbyteptr& ptr, cbyteptr last)
-{
-    hi_assert_not_null(ptr);
-    hi_assert_not_null(last);
+    bool _open_string = false;
 
-    auto r = datum::make_vector();
-    auto& vector = get<datum::vector_type>(r);
+    void flush()
+    {
+        if (_ptr != _begin) {
+            _flush(std::span<std::byte const>{_begin, _ptr});
+            _ptr = _begin;
+        }
+    }
+
+    /** Make room for at least @a n bytes, or as much as fits in a fixed size buffer.
+     */
+    hi_no_inline void make_room(std::size_t n)
+    {
+        if (_string != nullptr) {
+            auto const offset = narrow_cast<std::size_t>(_ptr - _string->data());
+            _string->resize(std::max({_string->capacity(), _string->size() * 2, offset + n}));
+            _ptr = _string->data() + offset;
+            _last = _string->data() + _string->size();
 
-    while (ptr != last) {
-        if (*ptr == static_cast<std::byte>(BON8_code_eoc)) {
-            ++ptr;
-            return r;
+        } else if (_flush) {
+            flush();
 
         } else {
-            vector.push_back(decode_BON8(ptr, last));
+            throw std::overflow_error("BON8 message does not fit in the buffer");
         }
     }
-    throw parse_error("Incomplete array at end of buffer");
-}
 
-[[nodiscard]] inline datum decode_BON8_array(cbyteptr& ptr, cbyteptr last, std::size_t count)
-{
-    auto r = datum::make_vector();
-    auto& vector = get<datum::vector_type>(r);
+    /** Reserve room for a small encoding of at most 9 bytes.
+     */
+    [[nodiscard]] std::byte *reserve(std::size_t n)
+    {
+        if (narrow_cast<std::size_t>(_last - _ptr) < n) [[unlikely]] {
+            make_room(n);
+        }
+        return _ptr;
+    }
 
-    while (count--) {
-        vector.push_back(decode_BON8(ptr, last));
+    void emit(uint8_t code)
+    {
+        *reserve(1) = static_cast<std::byte>(code);
+        ++_ptr;
     }
-    return r;
-}
 
-[[nodiscard]] inline datum decode_BON8_object(cbyteptr& ptr, cbyteptr last)
-{
-    hi_assert_not_null(ptr);
-    hi_assert_not_null(last);
+    void emit(std::span<std::byte const> bytes)
+    {
+        while (true) {
+            auto const n = std::min(bytes.size(), narrow_cast<std::size_t>(_last - _ptr));
+            if (n != 0) {
+                std::memcpy(_ptr, bytes.data(), n);
+                _ptr += n;
+                bytes = bytes.subspan(n);
+            }
 
-    auto r = datum::make_map();
-    auto& map = get<datum::map_type>(r);
+            if (bytes.empty()) {
+                return;
+            }
+            make_room(bytes.size());
+        }
+    }
+};
 
-    while (ptr != last) {
-        if (*ptr == static_cast<std::byte>(BON8_code_eoc)) {
-            ++ptr;
-            return r;
+/** BON8 reader.
+ *
+ * The reader decodes a message one token at a time, without building a datum. Strings
+ * are returned as views into the message. After `next()` has returned `array_begin` the
+ * elements follow until `array_end`; after `object_begin` the members follow as a string
+ * key followed by its value until `object_end`.
+ *
+ * @code
+ * auto reader = BON8_reader{buffer};
+ * while (reader.next() != BON8_token::end) {
+ *     if (reader.token() == BON8_token::string) {
+ *         std::print("{}", reader.string());
+ *     }
+ * }
+ * @endcode
+ */
+hi_export class BON8_reader {
+public:
+    /** The maximum nesting depth of arrays and objects.
+     */
+    constexpr static std::size_t max_depth = 64;
 
-        } else {
-            auto key = decode_BON8(ptr, last);
-            hi_check(holds_alternative<std::string>(key), "Key in object is not a string");
+    constexpr BON8_reader(BON8_reader const&) noexcept = default;
+    constexpr BON8_reader& operator=(BON8_reader const&) noexcept = default;
 
-            auto value = decode_BON8(ptr, last);
-            map.emplace(std::move(key), std::move(value));
-        }
+    /** Read a BON8 message.
+     *
+     * @param buffer The message, it must outlive the reader and the strings returned by it.
+     */
+    constexpr explicit BON8_reader(std::span<std::byte const> buffer) noexcept :
+        _first(buffer.data()), _ptr(buffer.data()), _last(buffer.data() + buffer.size())
+    {
     }
-    throw parse_error("Incomplete object at end of buffer");
-}
 
-[[nodiscard]] inline datum decode_BON8_object(cbyteptr& ptr, cbyteptr last, std::size_t count)
-{
-    auto r = datum::make_map();
-    auto& map = get<datum::map_type>(r);
+    /** The current token.
+     */
+    [[nodiscard]] constexpr BON8_token token() const noexcept
+    {
+        return _token;
+    }
 
-    while (count--) {
-        auto key = decode_BON8(ptr, last);
-        hi_check(holds_alternative<std::string>(key), "Key in object is not a string");
+    [[nodiscard]] constexpr bool boolean() const noexcept
+    {
+        hi_axiom(_token == BON8_token::boolean);
+        return _integer != 0;
+    }
 
-        auto value = decode_BON8(ptr, last);
-        map.emplace(std::move(key), std::move(value));
+    [[nodiscard]] constexpr long long integer() const noexcept
+    {
+        hi_axiom(_token == BON8_token::integer);
+        return _integer;
     }
-    return r;
-}
 
-[[nodiscard]] inline long long decode_BON8_UTF8_like_int(cbyteptr& ptr, cbyteptr last, int count) noexcept
-{
-    hi_assert_not_null(ptr);
-    hi_assert_not_null(last);
-    hi_assert(count >= 2 && count <= 4);
-    hi_assert(ptr != last);
-    auto const c0 = static_cast<uint8_t>(*(ptr++));
+    [[nodiscard]] constexpr double real() const noexcept
+    {
+        hi_axiom(_token == BON8_token::real);
+        return _real;
+    }
 
-    auto const mask = uint8_t{0b0111'1111} >> count;
-    auto value = static_cast<long long>(c0 & mask);
-    if (count == 2) {
-        // The two byte sequence starts with 0xc2, leaving only 30 entries in the first byte.
-        value -= 2;
+    /** The current string, a view into the message.
+     */
+    [[nodiscard]] constexpr std::string_view string() const noexcept
+    {
+        hi_axiom(_token == BON8_token::string);
+        return _string;
     }
 
-    // The second byte determines the sign, and adds 6 or 7 bits to the number.
-    hi_assert(ptr != last);
-    auto const c1 = static_cast<uint8_t>(*(ptr++));
-    auto const is_positive = c1 <= 0x7f;
-    if (is_positive) {
-        value <<= 7;
-        value |= static_cast<long long>(c1);
-    } else {
-        value <<= 6;
-        value |= static_cast<long long>(c1 & 0b0011'1111);
+    /** The number of bytes read from the message.
+     */
+    [[nodiscard]] constexpr std::size_t offset() const noexcept
+    {
+        return narrow_cast<std::size_t>(_ptr - _first);
     }
 
-    switch (count) {
-    case 4:
-        hi_assert(ptr != last);
-        value <<= 8;
-        value |= static_cast<int>(*(ptr++));
-        [[fallthrough]];
-    case 3:
-        hi_assert(ptr != last);
-        value <<= 8;
-        value |= static_cast<int>(*(ptr++));
-        [[fallthrough]];
-    default:;
+    /** Read the next token.
+     *
+     * @return The token, `BON8_token::end` after the root value has been read.
+     * @throws parse_error When the message is invalid.
+     */
+    BON8_token next()
+    {
+        if (_depth != 0) {
+            auto& container = _stack[_depth - 1];
+
+            if (container.counted ? container.remaining == 0 : _ptr != _last and *_ptr == std::byte{detail::BON8_code_eoc}) {
+                if (not container.counted) {
+                    ++_ptr;
+                }
+                hi_check(not container.value, "Missing value in object");
+
+                --_depth;
+                return _token = container.object ? BON8_token::object_end : BON8_token::array_end;
+            }
+
+            container.remaining -= container.counted ? 1 : 0;
+            if (container.object) {
+                container.value = not container.value;
+                if (container.value) {
+                    hi_check(read_value() == BON8_token::string, "Key in object is not a string");
+                    return _token;
+                }
+            }
+            return read_value();
+
+        } else if (_token == BON8_token::end and _ptr == _first) {
+            return read_value();
+
+        } else {
+            return _token = BON8_token::end;
+        }
     }
 
-    if (is_positive) {
-        switch (count) {
-        case 2:
-            return value + 40;
-        case 3:
-            return value + 3880;
-        case 4:
-            return value + 528168;
-        default:
-            hi_no_default();
+    /** Skip over the current value.
+     *
+     * When the current token is `array_begin` or `object_begin` the reader skips to
+     * the matching `array_end` or `object_end`.
+     */
+    void skip()
+    {
+        if (_token == BON8_token::array_begin or _token == BON8_token::object_begin) {
+            for (auto const depth = _depth; _depth >= depth;) {
+                next();
+            }
         }
+    }
 
-    } else {
-        switch (count) {
-        case 2:
-            return -(value + 11);
-        case 3:
-            return -(value + 1931);
-        case 4:
-            return -(value + 264075);
+    /** Read the next value.
+     *
+     * @param[out] value The value to read; a bool, number, enum, string, datum,
+     *             `std::vector`, `std::map` with string keys, or an aggregate as
+     *             written by `BON8_writer`.
+     * @throws parse_error When the message is invalid or does not match the type of @a value.
+     */
+    template<typename T>
+    void read(T& value)
+    {
+        next();
+        get(value);
+    }
+
+    /** Read the next value.
+     *
+     * @tparam T The type of the value, see `read(T&)`.
+     * @return The value.
+     * @throws parse_error When the message is invalid or does not match @a T.
+     */
+    template<typename T>
+    [[nodiscard]] T read()
+    {
+        auto r = T{};
+        read(r);
+        return r;
+    }
+
+    /** Convert the current token to a datum.
+     *
+     * For `array_begin` and `object_begin` the complete array or object is read.
+     */
+    [[nodiscard]] datum get_datum()
+    {
+        switch (_token) {
+        case BON8_token::null:
+            return datum{nullptr};
+        case BON8_token::boolean:
+            return datum{boolean()};
+        case BON8_token::integer:
+            return datum{_integer};
+        case BON8_token::real:
+            return datum{_real};
+        case BON8_token::string:
+            return datum{_string};
+        case BON8_token::array_begin:
+            {
+                auto r = datum::vector_type{};
+                while (next() != BON8_token::array_end) {
+                    r.push_back(get_datum());
+                }
+                return datum{std::move(r)};
+            }
+        case BON8_token::object_begin:
+            {
+                auto r = datum::map_type{};
+                while (next() != BON8_token::object_end) {
+                    auto key = datum{_string};
+                    next();
+                    r.emplace(std::move(key), get_datum());
+                }
+                return datum{std::move(r)};
+            }
         default:
-            hi_no_default();
+            throw parse_error("Unexpected end-of-message");
         }
     }
-}
 
-[[nodiscard]] inline datum decode_BON8(cbyteptr& ptr, cbyteptr last)
-{
-    hi_assert_not_null(ptr);
-    hi_assert_not_null(last);
+private:
+    struct container_type {
+        /** The number of elements left in a counted container, for an object
+         * the keys and values are counted separately.
+         */
+        uint8_t remaining = 0;
+        bool counted = false;
+        bool object = false;
+
+        /** The last token read in the object was a key.
+         */
+        bool value = false;
+    };
+
+    cbyteptr _first = nullptr;
+    cbyteptr _ptr = nullptr;
+    cbyteptr _last = nullptr;
+
+    BON8_token _token = BON8_token::end;
+    long long _integer = 0;
+    double _real = 0.0;
+    std::string_view _string = {};
+
+    std::size_t _depth = 0;
+    std::array<container_type, max_depth> _stack = {};
+
+    BON8_token open(bool object, bool counted, std::size_t count)
+    {
+        hi_check(_depth < max_depth, "BON8 message is nested too deeply");
+        _stack[_depth++] = container_type{narrow_cast<uint8_t>(object ? count * 2 : count), counted, object, false};
+        return _token = object ? BON8_token::object_begin : BON8_token::array_begin;
+    }
 
-    std::string str;
+    BON8_token read_string()
+    {
+        auto const first = _ptr;
+        while (_ptr != _last) {
+            // Skip over runs of ASCII characters.
+            while (_last - _ptr >= 8 and (load<uint64_t>(_ptr) & 0x8080'8080'8080'8080) == 0) {
+                _ptr += 8;
+            }
+            if (_ptr == _last) {
+                break;
+            }
 
-    while (ptr != last) {
-        auto const c = static_cast<uint8_t>(*ptr);
+            auto const c = static_cast<uint8_t>(*_ptr);
+            if (c <= 0x7f) {
+                ++_ptr;
 
-        if (c == BON8_code_eot) {
-            // End of string found, return the current string.
-            ++ptr;
-            return datum{str};
+            } else if (c >= 0xc2 and c <= 0xf7) {
+                auto const count = detail::BON8_multibyte_count(_ptr, _last);
+                if (count < 0) {
+                    // An integer follows the string.
+                    break;
+                }
+                _ptr += count;
 
-        } else if (c <= 0x7f) {
-            // ASCII character.
-            str += static_cast<char>(*(ptr++));
-            continue;
+            } else if (c == detail::BON8_code_eot) {
+                _string = std::string_view{reinterpret_cast<char const *>(first), narrow_cast<std::size_t>(_ptr - first)};
+                ++_ptr;
+                return _token = BON8_token::string;
 
-        } else if (c >= 0xc2 && c <= 0xf7) {
-            auto const count = BON8_multibyte_count(ptr, last);
+            } else {
+                // A non-string value follows the string.
+                break;
+            }
+        }
+
+        hi_check(_ptr != _last, "Unexpected end-of-buffer");
+        _string = std::string_view{reinterpret_cast<char const *>(first), narrow_cast<std::size_t>(_ptr - first)};
+        return _token = BON8_token::string;
+    }
+
+    BON8_token read_value()
+    {
+        using namespace detail;
+
+        hi_check(_ptr != _last, "Unexpected end-of-buffer");
+
+        auto const c = static_cast<uint8_t>(*_ptr);
+        if (c <= 0x7f or c == BON8_code_eot) {
+            return read_string();
+
+        } else if (c >= 0xc2 and c <= 0xf7) {
+            auto const count = BON8_multibyte_count(_ptr, _last);
             if (count > 0) {
-                // Multibyte UTF-8 code-point, The count includes the first code-unit.
-                for (int i = 0; i != count; ++i) {
-                    str += static_cast<char>(*(ptr++));
-                }
-                continue;
+                return read_string();
+            }
+            _integer = decode_BON8_UTF8_like_int(_ptr, _last, -count);
+            return _token = BON8_token::integer;
+        }
+
+        ++_ptr;
+        switch (c) {
+        case BON8_code_null:
+            return _token = BON8_token::null;
+        case BON8_code_bool_false:
+        case BON8_code_bool_true:
+            _integer = c == BON8_code_bool_true ? 1 : 0;
+            return _token = BON8_token::boolean;
+        case BON8_code_float_min_one:
+            _real = -1.0;
+            return _token = BON8_token::real;
+        case BON8_code_float_zero:
+            _real = 0.0;
+            return _token = BON8_token::real;
+        case BON8_code_float_one:
+            _real = 1.0;
+            return _token = BON8_token::real;
+        case BON8_code_int32:
+            hi_check(_last - _ptr >= 4, "Incomplete signed integer at end of buffer");
+            _integer = load_be<int32_t>(_ptr);
+            _ptr += 4;
+            return _token = BON8_token::integer;
+        case BON8_code_int64:
+            hi_check(_last - _ptr >= 8, "Incomplete signed integer at end of buffer");
+            _integer = load_be<int64_t>(_ptr);
+            _ptr += 8;
+            return _token = BON8_token::integer;
+        case BON8_code_binary32:
+            hi_check(_last - _ptr >= 4, "Incomplete floating point number at end of buffer");
+            _real = std::bit_cast<float>(load_be<uint32_t>(_ptr));
+            _ptr += 4;
+            return _token = BON8_token::real;
+        case BON8_code_binary64:
+            hi_check(_last - _ptr >= 8, "Incomplete floating point number at end of buffer");
+            _real = std::bit_cast<double>(load_be<uint64_t>(_ptr));
+            _ptr += 8;
+            return _token = BON8_token::real;
+        case BON8_code_array_count0:
+        case BON8_code_array_count1:
+        case BON8_code_array_count2:
+        case BON8_code_array_count3:
+        case BON8_code_array_count4:
+            return open(false, true, c - BON8_code_array_count0);
+        case BON8_code_array:
+            return open(false, false, 0);
+        case BON8_code_object_count0:
+        case BON8_code_object_count1:
+        case BON8_code_object_count2:
+        case BON8_code_object_count3:
+        case BON8_code_object_count4:
+            return open(true, true, c - BON8_code_object_count0);
+        case BON8_code_object:
+            return open(true, false, 0);
+        case BON8_code_eoc:
+            throw parse_error("Unexpected end-of-container");
+        default:
+            // Everything below this, are non-string types.
+            if (c >= BON8_code_positive_s and c <= BON8_code_positive_e) {
+                _integer = c - BON8_code_positive_s;
+                return _token = BON8_token::integer;
 
-            } else if (not str.empty()) {
-                // Multibyte integer found, but first return the current string.
-                return datum{str};
+            } else if (c >= BON8_code_negative_s and c <= BON8_code_negative_e) {
+                _integer = ~truncate<int>(c - BON8_code_negative_s);
+                return _token = BON8_token::integer;
 
             } else {
-                // Multibyte integer, the first code-unit includes part of the integer.
-                return datum{decode_BON8_UTF8_like_int(ptr, last, -count)};
+                throw parse_error(std::format("Invalid BON8 code-unit 0x{:02x}", c));
             }
+        }
+    }
 
-        } else if (not str.empty()) {
-            // This must be a non-string type, but first return the current string.
-            return datum{str};
+    /** Convert the current token to a value.
+     */
+    template<typename T>
+    void get(T& value)
+    {
+        if constexpr (std::is_same_v<T, bool>) {
+            hi_check(_token == BON8_token::boolean, "Expecting a boolean");
+            value = boolean();
+
+        } else if constexpr (numeric_integral<T>) {
+            hi_check(_token == BON8_token::integer, "Expecting an integer");
+            hi_check(can_narrow_cast<T>(_integer), "Integer out of range");
+            value = narrow_cast<T>(_integer);
+
+        } else if constexpr (std::floating_point<T>) {
+            if (_token == BON8_token::integer) {
+                value = static_cast<T>(_integer);
+            } else {
+                hi_check(_token == BON8_token::real, "Expecting a floating point number");
+                value = static_cast<T>(_real);
+            }
 
-        } else {
-            // This is one of the non-string types.
-            ++ptr;
-            switch (c) {
-            case BON8_code_null:
-                return datum{nullptr};
-            case BON8_code_bool_false:
-                return datum{false};
-            case BON8_code_bool_true:
-                return datum{true};
-            case BON8_code_float_min_one:
-                return datum{-1.0f};
-            case BON8_code_float_zero:
-                return datum{0.0f};
-            case BON8_code_float_one:
-                return datum{1.0f};
-            case BON8_code_int32:
-                return decode_BON8_int(ptr, last, 4);
-            case BON8_code_int64:
-                return decode_BON8_int(ptr, last, 8);
-            case BON8_code_binary32:
-                return decode_BON8_float(ptr, last, 4);
-            case BON8_code_binary64:
-                return decode_BON8_float(ptr, last, 8);
-            case BON8_code_array_count0:
-                return datum::make_vector();
-            case BON8_code_array_count1:
-                return decode_BON8_array(ptr, last, 1);
-            case BON8_code_array_count2:
-                return decode_BON8_array(ptr, last, 2);
-            case BON8_code_array_count3:
-                return decode_BON8_array(ptr, last, 3);
-            case BON8_code_array_count4:
-                return decode_BON8_array(ptr, last, 4);
-            case BON8_code_array:
-                return decode_BON8_array(ptr, last);
-            case BON8_code_object_count0:
-                return datum::make_map();
-            case BON8_code_object_count1:
-                return decode_BON8_object(ptr, last, 1);
-            case BON8_code_object_count2:
-                return decode_BON8_object(ptr, last, 2);
-            case BON8_code_object_count3:
-                return decode_BON8_object(ptr, last, 3);
-            case BON8_code_object_count4:
-                return decode_BON8_object(ptr, last, 4);
-            case BON8_code_object:
-                return decode_BON8_object(ptr, last);
-            case BON8_code_eoc:
-                throw parse_error("Unexpected end-of-container");
-            case BON8_code_eot:
-                throw parse_error("Unexpected end-of-text");
-            default:
-                // Everything below this, are non-string types.
-                if (c >= BON8_code_positive_s and c <= BON8_code_positive_e) {
-                    return datum{c - BON8_code_positive_s};
-
-                } else if (c >= BON8_code_negative_s and c <= BON8_code_negative_e) {
-                    return datum{~truncate<int>(c - BON8_code_negative_s)};
+        } else if constexpr (std::is_enum_v<T>) {
+            auto tmp = std::underlying_type_t<T>{};
+            get(tmp);
+            value = static_cast<T>(tmp);
 
-                } else {
-                    hi_no_default();
-                }
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            hi_check(_token == BON8_token::string, "Expecting a string");
+            value = _string;
+
+        } else if constexpr (std::is_same_v<T, datum>) {
+            value = get_datum();
+
+        } else if constexpr (detail::BON8_vector<T>) {
+            hi_check(_token == BON8_token::array_begin, "Expecting an array");
+            value.clear();
+            while (next() != BON8_token::array_end) {
+                get(value.emplace_back());
+            }
+
+        } else if constexpr (detail::BON8_map<T>) {
+            hi_check(_token == BON8_token::object_begin, "Expecting an object");
+            value.clear();
+            while (next() != BON8_token::object_end) {
+                auto& item = value[std::string{_string}];
+                next();
+                get(item);
             }
+
+        } else if constexpr (BON8_aggregate<T>) {
+            hi_check(_token == BON8_token::array_begin, "Expecting an array");
+            [&]<std::size_t... I>(std::index_sequence<I...>) {
+                (read(get_data_member<I>(value)), ...);
+            }(std::make_index_sequence<number_of_data_members_v<T>>{});
+            hi_check(next() == BON8_token::array_end, "Too many members in array");
+
+        } else {
+            hi_static_no_default();
         }
     }
-    throw parse_error("Unexpected end-of-buffer");
+};
+
+namespace detail {
+
+/** Decode BON8 message from buffer.
+ * @param ptr [in,out] Pointer to start of byte-buffer. After the call
+ *            ptr will point one beyond the message.
+ * @param last Pointer one beyond the end of the message.
+ * @return The decoded message.
+ */
+[[nodiscard]] inline datum decode_BON8(cbyteptr& ptr, cbyteptr last)
+{
+    auto reader = BON8_reader{std::span{ptr, last}};
+    reader.next();
+    auto r = reader.get_datum();
+    ptr += reader.offset();
+    return r;
 }
 
+/** BON8 encoder.
+ *
+ * Encodes a message into a byte string owned by the encoder.
+ */
+class BON8_encoder {
+public:
+    BON8_encoder() noexcept : _output(), _writer(_output) {}
+
+    /** Return a byte_string of the encoded object.
+     */
+    bstring const& get()
+    {
+        _writer.finish();
+        return _output;
+    }
+
+    /** Add a value.
+     *
+     * @param value A value that can be written by the BON8_writer.
+     */
+    template<typename T>
+    void add(T const& value)
+    {
+        _writer.add(value);
+    }
+
+private:
+    bstring _output;
+    BON8_writer _writer;
+};
+
 } // namespace detail
 
 /** Decode BON8 message from buffer.
@@ -807,15 +1210,45 @@ hi_export [[nodiscard]] inline datum decode_BON8(bstring_view buffer)
     return detail::decode_BON8(ptr, last);
 }
 
+/** Decode BON8 message from buffer directly into a value.
+ *
+ * @tparam T The type of the value, see `BON8_reader::read()`.
+ * @param buffer A buffer to a BON8 encoded message.
+ * @return The decoded message.
+ * @throws parse_error When the message is invalid or does not match @a T.
+ */
+hi_export template<typename T>
+[[nodiscard]] T decode_BON8(std::span<std::byte const> buffer)
+{
+    auto reader = BON8_reader{buffer};
+    return reader.read<T>();
+}
+
 /** Encode a value to a BON8 message.
  * @param value The data to encode
  * @return The encoded message as a byte_string.
  */
 hi_export [[nodiscard]] inline bstring encode_BON8(datum const& value)
 {
-    auto encoder = detail::BON8_encoder{};
-    encoder.add(value);
-    return encoder.get();
+    auto r = bstring{};
+    auto writer = BON8_writer{r};
+    writer.add(value);
+    writer.finish();
+    return r;
+}
+
+/** Encode a value to a BON8 message.
+ * @param value The value to encode, see `BON8_writer::add()`.
+ * @return The encoded message as a byte_string.
+ */
+hi_export template<typename T>
+[[nodiscard]] bstring encode_BON8(T const& value)
+{
+    auto r = bstring{};
+    auto writer = BON8_writer{r};
+    writer.add(value);
+    writer.finish();
+    return r;
 }
 
 } // namespace hi::inline v1
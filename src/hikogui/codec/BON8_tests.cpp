@@ -5,6 +5,35 @@
 #include "BON8.hpp"
 #include "../utility/utility.hpp"
 #include <hikotest/hikotest.hpp>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace BON8_suite_ns {
+
+enum class color_type : uint8_t { red, green, blue };
+
+struct point_type {
+    int x;
+    float y;
+    color_type color;
+
+    [[nodiscard]] friend bool operator==(point_type const&, point_type const&) noexcept = default;
+};
+
+struct shape_type {
+    std::string name;
+    std::vector<point_type> points;
+    std::map<std::string, int> tags;
+    bool visible;
+
+    [[nodiscard]] friend bool operator==(shape_type const&, shape_type const&) noexcept = default;
+};
+
+} // namespace BON8_suite_ns
+
+template<>
+struct hi::number_of_data_members<BON8_suite_ns::shape_type> : std::integral_constant<size_t, 4> {};
 
 TEST_SUITE(BON8_suite) {
 
@@ -76,4 +105,138 @@ TEST_CASE(decode_negative_integers)
         hi::decode_BON8(hi::to_bstring(0x8d, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00)));
 }
 
+TEST_CASE(writer)
+{
+    auto value = hi::datum::make_map();
+    value["foo"] = hi::datum::make_vector(1, 2.5, "bar", "baz", hi::datum::make_vector(), nullptr, true);
+    value["long string with more than 8 characters"] = hi::datum{-100000};
+
+    auto const expected = hi::encode_BON8(value);
+
+    // Appending to a byte string with a prefix, the capacity is reused.
+    auto output = hi::to_bstring(0x42);
+    auto writer = hi::BON8_writer{output};
+    writer.add(value);
+    writer.finish();
+    REQUIRE(writer.size() == expected.size());
+    REQUIRE(output.substr(1) == expected);
+
+    // A fixed size buffer that is too small.
+    auto buffer = std::array<std::byte, 16>{};
+    auto small_writer = hi::BON8_writer{buffer};
+    REQUIRE_THROWS(small_writer.add(value), std::overflow_error);
+
+    // The same buffer in chunks.
+    auto chunks = hi::bstring{};
+    auto chunk_count = 0;
+    auto chunked_writer = hi::BON8_writer{buffer, [&](std::span<std::byte const> chunk) {
+                                              chunks.append(chunk.data(), chunk.size());
+                                              ++chunk_count;
+                                          }};
+    chunked_writer.add(value);
+    chunked_writer.finish();
+    REQUIRE(chunks == expected);
+    REQUIRE(chunk_count > 1);
+}
+
+TEST_CASE(writer_incremental)
+{
+    auto output = hi::bstring{};
+    auto writer = hi::BON8_writer{output};
+    writer.begin_array();
+    for (auto i = 0; i != 6; ++i) {
+        writer.add(i);
+    }
+    writer.end_array();
+    writer.begin_object(1);
+    writer.add("a");
+    writer.add("b");
+    writer.end_object(1);
+    writer.finish();
+
+    REQUIRE(output == hi::to_bstring(0x85, 0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0xfe, 0x87, 'a', 0xff, 'b', 0xff));
+}
+
+TEST_CASE(reader)
+{
+    auto value = hi::datum::make_map();
+    value["a"] = hi::datum::make_vector(1, 2.5, "xyz", nullptr);
+    value["b"] = hi::datum{false};
+    auto const message = hi::encode_BON8(value);
+
+    auto reader = hi::BON8_reader{message};
+    REQUIRE(reader.next() == hi::BON8_token::object_begin);
+    REQUIRE(reader.next() == hi::BON8_token::string);
+    REQUIRE(reader.string() == "a");
+    REQUIRE(reader.next() == hi::BON8_token::array_begin);
+    REQUIRE(reader.next() == hi::BON8_token::integer);
+    REQUIRE(reader.integer() == 1);
+    REQUIRE(reader.next() == hi::BON8_token::real);
+    REQUIRE(reader.real() == 2.5);
+    REQUIRE(reader.next() == hi::BON8_token::string);
+    REQUIRE(reader.string() == "xyz");
+    REQUIRE(reader.next() == hi::BON8_token::null);
+    REQUIRE(reader.next() == hi::BON8_token::array_end);
+    REQUIRE(reader.next() == hi::BON8_token::string);
+    REQUIRE(reader.string() == "b");
+    REQUIRE(reader.next() == hi::BON8_token::boolean);
+    REQUIRE(reader.boolean() == false);
+    REQUIRE(reader.next() == hi::BON8_token::object_end);
+    REQUIRE(reader.next() == hi::BON8_token::end);
+    REQUIRE(reader.offset() == message.size());
+
+    // Skip over the array.
+    reader = hi::BON8_reader{message};
+    REQUIRE(reader.next() == hi::BON8_token::object_begin);
+    REQUIRE(reader.next() == hi::BON8_token::string);
+    REQUIRE(reader.next() == hi::BON8_token::array_begin);
+    reader.skip();
+    REQUIRE(reader.token() == hi::BON8_token::array_end);
+    REQUIRE(reader.next() == hi::BON8_token::string);
+    REQUIRE(reader.string() == "b");
+}
+
+TEST_CASE(reader_invalid)
+{
+    auto const message = hi::to_bstring(0x87, 0x90, 0x91);
+    auto reader = hi::BON8_reader{message};
+    REQUIRE(reader.next() == hi::BON8_token::object_begin);
+    REQUIRE_THROWS(reader.next(), hi::parse_error);
+
+    REQUIRE_THROWS(hi::decode_BON8(hi::to_bstring(0x85, 0x90)), hi::parse_error);
+    REQUIRE_THROWS(hi::decode_BON8(hi::to_bstring(0x8b, 'a', 0xfe)), hi::parse_error);
+    REQUIRE_THROWS(hi::decode_BON8(hi::to_bstring(0x81, 'a')), hi::parse_error);
+    REQUIRE_THROWS(hi::decode_BON8(hi::to_bstring(0xfe)), hi::parse_error);
+    REQUIRE_THROWS(hi::decode_BON8(hi::bstring(100, std::byte{0x81})), hi::parse_error);
+}
+
+TEST_CASE(reflection)
+{
+    using namespace BON8_suite_ns;
+
+    auto const point = point_type{3, 0.5f, color_type::blue};
+    REQUIRE(hi::encode_BON8(point) == hi::to_bstring(0x83, 0x93, 0x8e, 0x3f, 0x00, 0x00, 0x00, 0x92));
+    REQUIRE(hi::decode_BON8<point_type>(hi::encode_BON8(point)) == point);
+
+    auto shape = shape_type{};
+    shape.name = "triangle";
+    shape.points = {point, point_type{-1, 1.0f, color_type::red}, point_type{100000, 2.0f, color_type::green}};
+    shape.tags["layer"] = 2;
+    shape.tags["z"] = -5;
+    shape.visible = true;
+
+    auto const message = hi::encode_BON8(shape);
+    REQUIRE(hi::decode_BON8<shape_type>(message) == shape);
+
+    // A reflected struct is an array of its members.
+    auto const value = hi::decode_BON8(message);
+    REQUIRE(value.size() == 4);
+    REQUIRE(value[0] == hi::datum{"triangle"});
+
+    REQUIRE_THROWS(hi::decode_BON8<point_type>(hi::encode_BON8(hi::datum::make_vector(1, 2))), hi::parse_error);
+    REQUIRE_THROWS(hi::decode_BON8<point_type>(hi::encode_BON8(hi::datum::make_vector(1, 2, 3, 4))), hi::parse_error);
+    REQUIRE_THROWS(hi::decode_BON8<point_type>(hi::encode_BON8(hi::datum::make_vector("1", 2, 3))), hi::parse_error);
+    REQUIRE_THROWS(hi::decode_BON8<int8_t>(hi::encode_BON8(hi::datum{200})), hi::parse_error);
+}
+
 }; // TEST_SUITE(BON8_suite)
@@ -10,6 +10,7 @@
 #include "../algorithm/algorithm.hpp"
 #include "datum.hpp"
 #include "indent.hpp"
+#include "JSON_tape.hpp"
 #include "../macros.hpp"
 #include <string>
 #include <string_view>
@@ -21,6 +22,31 @@ hi_export_module(hikogui.codec.JSON);
 hi_export namespace hi::inline v1 {
 namespace detail {
 
+/** Parse a string token, decoding its escape sequences.
+ *
+ * The lexer keeps the escape sequences of a string verbatim, they are
+ * decoded here the same way as the tape parser does.
+ */
+template<std::input_iterator It, std::sentinel_for<It> ItEnd>
+[[nodiscard]] constexpr std::string json_parse_string(It& it, ItEnd last, std::string_view path)
+{
+    auto const text = static_cast<std::string>(*it);
+
+    auto r = std::string{};
+    r.reserve(text.size());
+    for (auto i = std::size_t{0}; i != text.size();) {
+        if (text[i] != '\\') {
+            r += text[i++];
+
+        } else if (i + 1 == text.size() or not json_parse_escape(text, i, r)) {
+            throw parse_error(std::format("{}: Invalid escape sequence in string.", token_location(it, last, path)));
+        }
+    }
+
+    ++it;
+    return r;
+}
+
 template<std::input_iterator It, std::sentinel_for<It> ItEnd>
 [[nodiscard]] constexpr std::optional<datum> json_parse_value(It &it, ItEnd last, std::string_view path);
 
@@ -92,7 +118,7 @@ template<std::input_iterator It, std::sentinel_for<It> ItEnd>
                 throw parse_error(std::format("{}: Expecting ',', found {}.", token_location(it, last, path), *it));
             }
 
-            auto name = static_cast<std::string>(*it++);
+            auto name = json_parse_string(it, last, path);
 
             if ((*it == ':')) {
                 ++it;
@@ -130,7 +156,7 @@ template<std::input_iterator It, std::sentinel_for<It> ItEnd>
     hi_assert(it != last);
 
     if (*it == token::dstr) {
-        return datum{static_cast<std::string>(*it++)};
+        return datum{json_parse_string(it, last, path)};
 
     } else if (*it == token::integer) {
         return datum{static_cast<long long>(*it++)};
@@ -204,11 +230,23 @@ hi_export template<std::input_iterator It, std::sentinel_for<It> ItEnd>
 }
 
 /** Parse a JSON string.
+ *
+ * The text is first parsed by the SIMD accelerated `json_tape`. If that fails the
+ * text is parsed again by the lexer based parser, which reports the location of
+ * any errors.
+ *
  * @param text The text to parse.
  * @return A datum representing the parsed object.
  */
 hi_export [[nodiscard]] constexpr datum parse_JSON(std::string_view text, std::string_view path = std::string_view{"<none>"})
 {
+    if (not std::is_constant_evaluated()) {
+        auto tape = json_tape{};
+        if (tape.parse(text)) {
+            return tape.to_datum();
+        }
+    }
+
     return parse_JSON(text.cbegin(), text.cend(), path);
 }
 
@@ -0,0 +1,1009 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file codec/JSON_tape.hpp Fast JSON parser.
+ *
+ * The parser works in two passes, in the style of simdjson:
+ *  1. The text is classified 64 bytes at a time using SIMD instructions, producing
+ *     bit masks of quotes, escapes, structural characters and white space. From these
+ *     masks the strings are found without branching, and the index of each structural
+ *     character, string and number is recorded.
+ *  2. The indices are walked with a small state machine that validates the grammar
+ *     and builds a flat tape of entries.
+ */
+
+#pragma once
+
+#include "datum.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <hikocpu/hikocpu.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <array>
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <optional>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+
+#if HI_HAS_X86
+#include <immintrin.h>
+#endif
+
+hi_export_module(hikogui.codec.JSON_tape);
+
+hi_export namespace hi { inline namespace v1 {
+namespace detail {
+
+/** Bit masks of the characters in a 64 byte block of JSON text.
+ *
+ * Bit @a i of each mask belongs to byte @a i of the block.
+ */
+struct json_block_masks {
+    uint64_t quote = 0;
+    uint64_t backslash = 0;
+    uint64_t slash = 0;
+
+    /** The characters '{', '}', '[', ']', ':' and ','.
+     */
+    uint64_t structural = 0;
+    uint64_t white_space = 0;
+    uint64_t line_feed = 0;
+};
+
+[[nodiscard]] constexpr json_block_masks json_classify_block_generic(char const *ptr) noexcept
+{
+    auto r = json_block_masks{};
+    for (auto i = 0; i != 64; ++i) {
+        auto const bit = uint64_t{1} << i;
+        switch (ptr[i]) {
+        case '"':
+            r.quote |= bit;
+            break;
+        case '\\':
+            r.backslash |= bit;
+            break;
+        case '/':
+            r.slash |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            r.structural |= bit;
+            break;
+        case '\n':
+            r.line_feed |= bit;
+            r.white_space |= bit;
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+            r.white_space |= bit;
+            break;
+        default:;
+        }
+    }
+    return r;
+}
+
+constexpr void json_classify_generic(char const *ptr, std::span<json_block_masks> r) noexcept
+{
+    for (auto& masks : r) {
+        masks = json_classify_block_generic(ptr);
+        ptr += 64;
+    }
+}
+
+#if HI_HAS_X86
+hi_target("sse,sse2")
+[[nodiscard]] hi_force_inline inline uint64_t json_match_sse2(__m128i v, char c) noexcept
+{
+    return static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(c)))));
+}
+
+hi_target("sse,sse2")
+[[nodiscard]] hi_force_inline inline json_block_masks json_classify_block_sse2(char const *ptr) noexcept
+{
+    auto r = json_block_masks{};
+    for (auto i = 0; i != 64; i += 16) {
+        auto const v = _mm_loadu_si128(reinterpret_cast<__m128i const *>(ptr + i));
+        // Setting bit 5 maps '[' and ']' onto '{' and '}'.
+        auto const v_lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+
+        r.quote |= json_match_sse2(v, '"') << i;
+        r.backslash |= json_match_sse2(v, '\\') << i;
+        r.slash |= json_match_sse2(v, '/') << i;
+        r.structural |= (json_match_sse2(v_lower, '{') | json_match_sse2(v_lower, '}') | json_match_sse2(v, ':') |
+                         json_match_sse2(v, ','))
+            << i;
+        auto const line_feed = json_match_sse2(v, '\n');
+        r.line_feed |= line_feed << i;
+        r.white_space |= (json_match_sse2(v, ' ') | json_match_sse2(v, '\t') | json_match_sse2(v, '\r') | line_feed) << i;
+    }
+    return r;
+}
+
+hi_target("sse,sse2")
+inline void json_classify_sse2(char const *ptr, std::span<json_block_masks> r) noexcept
+{
+    for (auto& masks : r) {
+        masks = json_classify_block_sse2(ptr);
+        ptr += 64;
+    }
+}
+
+hi_target("sse,sse2,avx,avx2")
+[[nodiscard]] hi_force_inline inline uint64_t json_match_avx2(__m256i v, char c) noexcept
+{
+    return static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(c)))));
+}
+
+hi_target("sse,sse2,avx,avx2")
+[[nodiscard]] hi_force_inline inline json_block_masks json_classify_block_avx2(char const *ptr) noexcept
+{
+    auto r = json_block_masks{};
+    for (auto i = 0; i != 64; i += 32) {
+        auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(ptr + i));
+        // Setting bit 5 maps '[' and ']' onto '{' and '}'.
+        auto const v_lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+
+        r.quote |= json_match_avx2(v, '"') << i;
+        r.backslash |= json_match_avx2(v, '\\') << i;
+        r.slash |= json_match_avx2(v, '/') << i;
+        r.structural |= (json_match_avx2(v_lower, '{') | json_match_avx2(v_lower, '}') | json_match_avx2(v, ':') |
+                         json_match_avx2(v, ','))
+            << i;
+        auto const line_feed = json_match_avx2(v, '\n');
+        r.line_feed |= line_feed << i;
+        r.white_space |= (json_match_avx2(v, ' ') | json_match_avx2(v, '\t') | json_match_avx2(v, '\r') | line_feed) << i;
+    }
+    return r;
+}
+
+hi_target("sse,sse2,avx,avx2")
+inline void json_classify_avx2(char const *ptr, std::span<json_block_masks> r) noexcept
+{
+    for (auto& masks : r) {
+        masks = json_classify_block_avx2(ptr);
+        ptr += 64;
+    }
+}
+#endif
+
+/** Classify the characters of consecutive 64 byte blocks.
+ *
+ * @param ptr A pointer to the text, at least `r.size() * 64` bytes.
+ * @param[out] r The masks of each block.
+ */
+inline void json_classify(char const *ptr, std::span<json_block_masks> r) noexcept
+{
+#if HI_HAS_X86
+    if (has_avx2()) {
+        return json_classify_avx2(ptr, r);
+    } else if (has_sse2()) {
+        return json_classify_sse2(ptr, r);
+    }
+#endif
+    return json_classify_generic(ptr, r);
+}
+
+/** The state carried from one block to the next.
+ */
+struct json_scan_state {
+    /** All ones when the previous block ended inside a string.
+     */
+    uint64_t in_string = 0;
+
+    /** One when the first character of the next block is escaped.
+     */
+    uint64_t escaped = 0;
+
+    /** One when the previous block ended inside a number or literal.
+     */
+    uint64_t in_scalar = 0;
+
+    /** The previous block ended inside a line comment.
+     */
+    bool in_comment = false;
+};
+
+/** Find the characters escaped by a backslash.
+ *
+ * A backslash escapes the next character, unless the backslash is itself escaped.
+ * The odd length runs of backslashes are found with a carry propagating addition.
+ *
+ * @param backslash The mask of the backslashes in a block.
+ * @param[in,out] escaped The carry; one if the first character of the block is
+ *                escaped, afterwards one if the first character of the next block is.
+ * @return The mask of escaped characters.
+ */
+[[nodiscard]] constexpr uint64_t json_find_escaped(uint64_t backslash, uint64_t& escaped) noexcept
+{
+    constexpr auto even_bits = uint64_t{0x5555'5555'5555'5555};
+
+    backslash &= ~escaped;
+    auto const follows_escape = (backslash << 1) | escaped;
+    auto const odd_sequence_starts = backslash & ~even_bits & ~follows_escape;
+    auto const sequences_starting_on_even_bits = odd_sequence_starts + backslash;
+    escaped = sequences_starting_on_even_bits < backslash ? 1 : 0;
+    return (even_bits ^ (sequences_starting_on_even_bits << 1)) & follows_escape;
+}
+
+/** Calculate the running exclusive-or of the bits from low to high.
+ */
+[[nodiscard]] constexpr uint64_t json_prefix_xor(uint64_t x) noexcept
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/** Find the start of each token in a block from its masks.
+ *
+ * @param masks The masks of the block.
+ * @param[in,out] state The state carried between blocks.
+ * @param[out] r The mask of structural characters, opening quotes and the first
+ *             character of numbers and literals.
+ * @retval false The block has a single slash or a comment that starts in the last
+ *               byte, use `json_scan_block_scalar()` instead.
+ */
+[[nodiscard]] constexpr bool json_scan_block(json_block_masks const& masks, json_scan_state& state, uint64_t& r) noexcept
+{
+    auto escaped = state.escaped;
+    auto const quote = masks.quote & ~json_find_escaped(masks.backslash, escaped);
+
+    // A comment continued from the previous block ends at the first line-feed.
+    auto comment = uint64_t{0};
+    if (state.in_comment) {
+        auto const end = masks.line_feed & (0 - masks.line_feed);
+        comment = end - 1;
+    }
+
+    // The opening quote and the characters of a string are inside the string, the closing quote is not.
+    auto in_string = json_prefix_xor(quote & ~comment) ^ state.in_string;
+
+    // Each comment hides the quotes after it, so the strings are found again after each comment.
+    while (auto const slash = masks.slash & ~in_string & ~comment) {
+        auto const start = slash & (0 - slash);
+        if ((masks.slash & (start << 1)) == 0) {
+            return false;
+        }
+
+        auto const line_feed = masks.line_feed & (0 - (start << 1));
+        comment |= (line_feed & (0 - line_feed)) - start;
+        in_string = json_prefix_xor(quote & ~comment) ^ state.in_string;
+    }
+
+    auto const scalar = ~(masks.structural | masks.white_space | quote | in_string | comment);
+    r = (masks.structural & ~(in_string | comment)) | (quote & in_string) | (scalar & ~((scalar << 1) | state.in_scalar));
+
+    state.in_string = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+    state.escaped = escaped;
+    state.in_scalar = scalar >> 63;
+    state.in_comment = (comment >> 63) != 0;
+    return true;
+}
+
+/** Find the start of each token in a block one character at a time.
+ *
+ * This handles the corner cases of comments which `json_scan_block()` does not.
+ *
+ * @param text The complete text.
+ * @param offset The offset of the block in @a text.
+ * @param[in,out] state The state carried between blocks.
+ * @param[out] r The mask of structural characters, opening quotes and the first
+ *             character of numbers and literals.
+ * @retval false The text is not valid JSON.
+ */
+[[nodiscard]] constexpr bool
+json_scan_block_scalar(std::string_view text, std::size_t offset, json_scan_state& state, uint64_t& r) noexcept
+{
+    auto in_string = state.in_string != 0;
+    auto escaped = state.escaped != 0;
+    auto in_scalar = state.in_scalar != 0;
+    auto in_comment = state.in_comment;
+
+    r = 0;
+    auto const last = std::min(offset + 64, text.size());
+    for (auto i = offset; i != last; ++i) {
+        auto const c = text[i];
+        auto const bit = uint64_t{1} << (i - offset);
+
+        if (in_comment) {
+            in_comment = c != '\n';
+
+        } else if (in_string) {
+            if (escaped) {
+                escaped = false;
+            } else if (c == '\\') {
+                escaped = true;
+            } else if (c == '"') {
+                in_string = false;
+            }
+
+        } else {
+            switch (c) {
+            case '"':
+                r |= bit;
+                in_string = true;
+                in_scalar = false;
+                break;
+            case '{':
+            case '}':
+            case '[':
+            case ']':
+            case ':':
+            case ',':
+                r |= bit;
+                in_scalar = false;
+                break;
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\r':
+                in_scalar = false;
+                break;
+            case '/':
+                if (i + 1 == text.size() or text[i + 1] != '/') {
+                    return false;
+                }
+                in_comment = true;
+                in_scalar = false;
+                break;
+            case '\\':
+                return false;
+            default:
+                if (not in_scalar) {
+                    r |= bit;
+                }
+                in_scalar = true;
+            }
+        }
+    }
+
+    state.in_string = in_string ? ~uint64_t{0} : 0;
+    state.escaped = escaped ? 1 : 0;
+    state.in_scalar = in_scalar ? 1 : 0;
+    state.in_comment = in_comment;
+    return true;
+}
+
+/** Scan a block and append the indices of its tokens.
+ *
+ * @param text The complete text.
+ * @param offset The offset of the block in @a text.
+ * @param masks The masks of the block.
+ * @param[in,out] state The state carried between blocks.
+ * @param[out] r The indices, with room for at least 64 more beyond @a size.
+ * @param[in,out] size The number of indices in @a r.
+ * @retval false The text is not valid JSON.
+ */
+[[nodiscard]] constexpr bool json_scan_emit(
+    std::string_view text,
+    std::size_t offset,
+    json_block_masks const& masks,
+    json_scan_state& state,
+    uint32_t *hi_restrict r,
+    std::size_t& size) noexcept
+{
+    auto bits = uint64_t{};
+    if (not json_scan_block(masks, state, bits) and not json_scan_block_scalar(text, offset, state, bits)) {
+        return false;
+    }
+
+    // Write the indices four at a time, the indices past the end are overwritten by the next block.
+    auto const count = std::popcount(bits);
+    r += size;
+    for (auto i = 0; i < count; i += 4) {
+        r[i] = narrow_cast<uint32_t>(offset + std::countr_zero(bits));
+        bits &= bits - 1;
+        r[i + 1] = narrow_cast<uint32_t>(offset + std::countr_zero(bits));
+        bits &= bits - 1;
+        r[i + 2] = narrow_cast<uint32_t>(offset + std::countr_zero(bits));
+        bits &= bits - 1;
+        r[i + 3] = narrow_cast<uint32_t>(offset + std::countr_zero(bits));
+        bits &= bits - 1;
+    }
+    size += count;
+    return true;
+}
+
+/** Find the start of each token in JSON text.
+ *
+ * @param text The JSON text.
+ * @param[out] r The index of each structural character, opening quote and the
+ *             first character of each number and literal.
+ * @retval false The text is not valid JSON.
+ */
+[[nodiscard]] inline bool json_scan(std::string_view text, std::vector<uint32_t>& r)
+{
+    if (text.size() >= std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    auto state = json_scan_state{};
+    auto masks = std::array<json_block_masks, 64>{};
+    auto size = 0_uz;
+
+    auto const nr_blocks = text.size() / 64;
+    auto offset = 0_uz;
+    for (auto block = 0_uz; block < nr_blocks; block += masks.size()) {
+        auto const chunk = std::span{masks.data(), std::min(masks.size(), nr_blocks - block)};
+        json_classify(text.data() + offset, chunk);
+
+        if (r.size() < size + chunk.size() * 64) {
+            r.resize(size + chunk.size() * 64);
+        }
+        for (auto const& block_masks : chunk) {
+            if (not json_scan_emit(text, offset, block_masks, state, r.data(), size)) {
+                return false;
+            }
+            offset += 64;
+        }
+    }
+
+    if (offset != text.size()) {
+        // Pad the last block with white space.
+        auto buffer = std::array<char, 64>{};
+        std::fill(buffer.begin(), buffer.end(), ' ');
+        std::copy(text.begin() + offset, text.end(), buffer.begin());
+
+        r.resize(size + 64);
+        if (not json_scan_emit(text, offset, json_classify_block_generic(buffer.data()), state, r.data(), size)) {
+            return false;
+        }
+    }
+
+    r.resize(size);
+    return state.in_string == 0;
+}
+
+[[nodiscard]] constexpr bool json_is_digit(char c) noexcept
+{
+    return c >= '0' and c <= '9';
+}
+
+/** Check if a number or literal ends at @a i.
+ */
+[[nodiscard]] constexpr bool json_is_scalar_end(std::string_view text, std::size_t i) noexcept
+{
+    if (i == text.size()) {
+        return true;
+    }
+
+    switch (text[i]) {
+    case '{':
+    case '}':
+    case '[':
+    case ']':
+    case ':':
+    case ',':
+    case '"':
+    case '/':
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+        return true;
+    default:
+        return false;
+    }
+}
+
+[[nodiscard]] constexpr std::optional<char32_t> json_parse_hex4(std::string_view text, std::size_t i) noexcept
+{
+    if (i + 4 > text.size()) {
+        return std::nullopt;
+    }
+
+    auto r = char32_t{0};
+    for (auto const c : text.substr(i, 4)) {
+        r <<= 4;
+        if (c >= '0' and c <= '9') {
+            r |= c - '0';
+        } else if (c >= 'a' and c <= 'f') {
+            r |= c - 'a' + 10;
+        } else if (c >= 'A' and c <= 'F') {
+            r |= c - 'A' + 10;
+        } else {
+            return std::nullopt;
+        }
+    }
+    return r;
+}
+
+/** Decode an escape sequence.
+ *
+ * @param text The JSON text.
+ * @param[in,out] i The index of the backslash, afterwards the index after the escape sequence.
+ * @param[out] r The string to append the UTF-8 encoded character to.
+ * @retval false Invalid escape sequence.
+ */
+[[nodiscard]] constexpr bool json_parse_escape(std::string_view text, std::size_t& i, std::string& r)
+{
+    // The string is known to end in a quote, so the character after the backslash exists.
+    auto const c = text[i + 1];
+    i += 2;
+
+    switch (c) {
+    case '"':
+    case '\\':
+    case '/':
+        r += c;
+        return true;
+    case 'b':
+        r += '\b';
+        return true;
+    case 'f':
+        r += '\f';
+        return true;
+    case 'n':
+        r += '\n';
+        return true;
+    case 'r':
+        r += '\r';
+        return true;
+    case 't':
+        r += '\t';
+        return true;
+    case 'u':
+        break;
+    default:
+        return false;
+    }
+
+    auto code_point = json_parse_hex4(text, i);
+    if (not code_point or (*code_point >= 0xdc00 and *code_point <= 0xdfff)) {
+        return false;
+    }
+    i += 4;
+
+    if (*code_point >= 0xd800 and *code_point <= 0xdbff) {
+        // A high surrogate must be followed by an escaped low surrogate.
+        if (i + 2 > text.size() or text[i] != '\\' or text[i + 1] != 'u') {
+            return false;
+        }
+        auto const low_surrogate = json_parse_hex4(text, i + 2);
+        if (not low_surrogate or *low_surrogate < 0xdc00 or *low_surrogate > 0xdfff) {
+            return false;
+        }
+        i += 6;
+        code_point = 0x1'0000 + ((*code_point - 0xd800) << 10) + (*low_surrogate - 0xdc00);
+    }
+
+    if (*code_point < 0x80) {
+        r += char_cast<char>(*code_point);
+    } else if (*code_point < 0x800) {
+        r += char_cast<char>(0xc0 | (*code_point >> 6));
+        r += char_cast<char>(0x80 | (*code_point & 0x3f));
+    } else if (*code_point < 0x1'0000) {
+        r += char_cast<char>(0xe0 | (*code_point >> 12));
+        r += char_cast<char>(0x80 | ((*code_point >> 6) & 0x3f));
+        r += char_cast<char>(0x80 | (*code_point & 0x3f));
+    } else {
+        r += char_cast<char>(0xf0 | (*code_point >> 18));
+        r += char_cast<char>(0x80 | ((*code_point >> 12) & 0x3f));
+        r += char_cast<char>(0x80 | ((*code_point >> 6) & 0x3f));
+        r += char_cast<char>(0x80 | (*code_point & 0x3f));
+    }
+    return true;
+}
+
+} // namespace detail
+
+/** The type of an entry on a JSON tape.
+ */
+hi_export enum class json_tape_type : uint8_t {
+    null,
+    boolean,
+    integer,
+    real,
+    string,
+    array_begin,
+    array_end,
+    object_begin,
+    object_end
+};
+
+/** An entry on a JSON tape.
+ *
+ * The members of an object are stored as a string entry for the key, followed by the
+ * entries of the value.
+ */
+hi_export struct json_tape_entry {
+    json_tape_type type = json_tape_type::null;
+
+    /** The number of elements of an array, the number of members of an object,
+     * or the number of bytes of a string.
+     */
+    uint32_t size = 0;
+
+    /** The value of the entry.
+     *
+     *  - boolean: 0 or 1.
+     *  - integer: the bit pattern of a `long long`.
+     *  - real: the bit pattern of a `double`.
+     *  - string: the offset of the string in the JSON text, or when the string
+     *    contained escape sequences, `decoded_string` or-ed with the offset of the
+     *    decoded string in the tape's string buffer.
+     *  - array_begin, object_begin: the index of the matching end entry.
+     *  - array_end, object_end: the index of the matching begin entry.
+     */
+    uint64_t value = 0;
+
+    /** Flag in the value of a string entry, for a string that is stored in the tape.
+     */
+    constexpr static uint64_t decoded_string = uint64_t{1} << 63;
+};
+
+/** A parsed JSON document stored as a flat array of entries.
+ *
+ * The document is laid out in document order; every value is one entry, arrays and
+ * objects are bracketed by begin and end entries which refer to each other so that
+ * a value can be skipped in constant time. Strings without escape sequences refer
+ * to the JSON text, the strings with decoded escape sequences are stored back to back
+ * in a single buffer.
+ *
+ * Besides standard JSON the tape accepts `//` line comments and trailing commas.
+ *
+ * A tape object may be reused to parse multiple documents, reusing its allocations.
+ */
+hi_export class json_tape {
+public:
+    constexpr json_tape() noexcept = default;
+
+    /** Parse a JSON document.
+     *
+     * @param text The JSON text, it must outlive the use of the strings on the tape.
+     * @retval true The tape contains the document.
+     * @retval false The text is not valid JSON, or it is a number that does not fit
+     *               a `long long` or `double`. The tape is in an unspecified state.
+     */
+    [[nodiscard]] bool parse(std::string_view text)
+    {
+        _text = text;
+        _entries.clear();
+        _strings.clear();
+        _stack.clear();
+
+        if (not detail::json_scan(text, _indices)) {
+            return false;
+        }
+
+        enum class expect : uint8_t { value, value_or_close, key_or_close, colon, comma_or_close };
+
+        auto state = expect::value;
+        for (auto const index : _indices) {
+            auto const c = text[index];
+
+            switch (state) {
+            case expect::value_or_close:
+                if (c == ']') {
+                    close(json_tape_type::array_end);
+                    state = expect::comma_or_close;
+                    break;
+                }
+                ++_entries[_stack.back()].size;
+                [[fallthrough]];
+
+            case expect::value:
+                if (c == '{') {
+                    open(json_tape_type::object_begin);
+                    state = expect::key_or_close;
+                } else if (c == '[') {
+                    open(json_tape_type::array_begin);
+                    state = expect::value_or_close;
+                } else if (c == '"' ? parse_string(text, index) : parse_scalar(text, index)) {
+                    state = expect::comma_or_close;
+                } else {
+                    return false;
+                }
+                break;
+
+            case expect::key_or_close:
+                if (c == '}') {
+                    close(json_tape_type::object_end);
+                    state = expect::comma_or_close;
+                } else if (c == '"') {
+                    ++_entries[_stack.back()].size;
+                    if (not parse_string(text, index)) {
+                        return false;
+                    }
+                    state = expect::colon;
+                } else {
+                    return false;
+                }
+                break;
+
+            case expect::colon:
+                if (c != ':') {
+                    return false;
+                }
+                state = expect::value;
+                break;
+
+            case expect::comma_or_close:
+                if (_stack.empty()) {
+                    // Text after the root value.
+                    return false;
+                }
+
+                if (auto const container = _entries[_stack.back()].type; c == ',') {
+                    state = container == json_tape_type::array_begin ? expect::value_or_close : expect::key_or_close;
+                } else if (c == ']' and container == json_tape_type::array_begin) {
+                    close(json_tape_type::array_end);
+                } else if (c == '}' and container == json_tape_type::object_begin) {
+                    close(json_tape_type::object_end);
+                } else {
+                    return false;
+                }
+                break;
+
+            default:
+                hi_no_default();
+            }
+        }
+
+        return state == expect::comma_or_close and _stack.empty();
+    }
+
+    [[nodiscard]] constexpr bool empty() const noexcept
+    {
+        return _entries.empty();
+    }
+
+    /** The entries of the document.
+     */
+    [[nodiscard]] constexpr std::span<json_tape_entry const> entries() const noexcept
+    {
+        return _entries;
+    }
+
+    /** Get the decoded text of a string entry.
+     */
+    [[nodiscard]] constexpr std::string_view string(json_tape_entry const& entry) const noexcept
+    {
+        hi_axiom(entry.type == json_tape_type::string);
+        if (entry.value & json_tape_entry::decoded_string) {
+            return std::string_view{_strings}.substr(entry.value & ~json_tape_entry::decoded_string, entry.size);
+        } else {
+            return _text.substr(entry.value, entry.size);
+        }
+    }
+
+    /** Convert the document to a datum.
+     */
+    [[nodiscard]] datum to_datum() const
+    {
+        hi_axiom(not empty());
+        auto i = 0_uz;
+        return to_datum(i);
+    }
+
+private:
+    std::string_view _text;
+    std::vector<json_tape_entry> _entries;
+    std::string _strings;
+
+    /** The indices of the tokens found in the first pass.
+     */
+    std::vector<uint32_t> _indices;
+
+    /** The indices of the begin entries of the open arrays and objects.
+     */
+    std::vector<std::size_t> _stack;
+
+    void open(json_tape_type type)
+    {
+        _stack.push_back(_entries.size());
+        _entries.emplace_back(type);
+    }
+
+    void close(json_tape_type type)
+    {
+        auto const begin = _stack.back();
+        _stack.pop_back();
+
+        _entries[begin].value = _entries.size();
+        _entries.emplace_back(type, _entries[begin].size, begin);
+    }
+
+    [[nodiscard]] bool parse_string(std::string_view text, std::size_t i)
+    {
+        // The first pass has checked that the string is terminated.
+        auto const text_offset = ++i;
+        while (text[i] != '"' and text[i] != '\\') {
+            ++i;
+        }
+        if (text[i] == '"') {
+            _entries.emplace_back(json_tape_type::string, narrow_cast<uint32_t>(i - text_offset), text_offset);
+            return true;
+        }
+
+        auto const offset = _strings.size();
+        _strings.append(text.substr(text_offset, i - text_offset));
+        while (true) {
+            if (not detail::json_parse_escape(text, i, _strings)) {
+                return false;
+            }
+
+            auto const first = i;
+            while (text[i] != '"' and text[i] != '\\') {
+                ++i;
+            }
+            _strings.append(text.substr(first, i - first));
+
+            if (text[i] == '"') {
+                break;
+            }
+        }
+
+        _entries.emplace_back(
+            json_tape_type::string, narrow_cast<uint32_t>(_strings.size() - offset), offset | json_tape_entry::decoded_string);
+        return true;
+    }
+
+    [[nodiscard]] bool
+    parse_literal(std::string_view text, std::size_t i, std::string_view literal, json_tape_type type, uint64_t value)
+    {
+        if (text.substr(i, literal.size()) != literal or not detail::json_is_scalar_end(text, i + literal.size())) {
+            return false;
+        }
+        _entries.emplace_back(type, 0, value);
+        return true;
+    }
+
+    [[nodiscard]] bool parse_number(std::string_view text, std::size_t const first)
+    {
+        using detail::json_is_digit;
+
+        auto i = first;
+        auto const negative = text[i] == '-';
+        if (negative) {
+            ++i;
+        }
+
+        if (i == text.size() or not json_is_digit(text[i])) {
+            return false;
+        }
+
+        // A leading zero is not followed by other digits.
+        auto const integer_first = i;
+        if (text[i++] != '0') {
+            while (i != text.size() and json_is_digit(text[i])) {
+                ++i;
+            }
+        }
+        auto const integer_last = i;
+
+        auto is_real = false;
+        if (i != text.size() and text[i] == '.') {
+            is_real = true;
+            if (++i == text.size() or not json_is_digit(text[i])) {
+                return false;
+            }
+            while (i != text.size() and json_is_digit(text[i])) {
+                ++i;
+            }
+        }
+
+        if (i != text.size() and (text[i] == 'e' or text[i] == 'E')) {
+            is_real = true;
+            if (++i != text.size() and (text[i] == '+' or text[i] == '-')) {
+                ++i;
+            }
+            if (i == text.size() or not json_is_digit(text[i])) {
+                return false;
+            }
+            while (i != text.size() and json_is_digit(text[i])) {
+                ++i;
+            }
+        }
+
+        if (not detail::json_is_scalar_end(text, i)) {
+            return false;
+        }
+
+        if (is_real) {
+            auto value = 0.0;
+            auto const [ptr, ec] = std::from_chars(text.data() + first, text.data() + i, value);
+            if (ec != std::errc{}) {
+                return false;
+            }
+            _entries.emplace_back(json_tape_type::real, 0, std::bit_cast<uint64_t>(value));
+
+        } else {
+            constexpr auto max_value = static_cast<uint64_t>(std::numeric_limits<long long>::max());
+
+            auto value = uint64_t{0};
+            for (auto j = integer_first; j != integer_last; ++j) {
+                auto const digit = static_cast<uint64_t>(text[j] - '0');
+                if (value > (max_value - digit) / 10) {
+                    return false;
+                }
+                value = value * 10 + digit;
+            }
+            _entries.emplace_back(json_tape_type::integer, 0, negative ? 0 - value : value);
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool parse_scalar(std::string_view text, std::size_t i)
+    {
+        switch (text[i]) {
+        case 't':
+            return parse_literal(text, i, "true", json_tape_type::boolean, 1);
+        case 'f':
+            return parse_literal(text, i, "false", json_tape_type::boolean, 0);
+        case 'n':
+            return parse_literal(text, i, "null", json_tape_type::null, 0);
+        default:
+            return parse_number(text, i);
+        }
+    }
+
+    [[nodiscard]] datum to_datum(std::size_t& i) const
+    {
+        auto const& entry = _entries[i++];
+
+        switch (entry.type) {
+        case json_tape_type::null:
+            return datum{nullptr};
+
+        case json_tape_type::boolean:
+            return datum{entry.value != 0};
+
+        case json_tape_type::integer:
+            return datum{std::bit_cast<long long>(entry.value)};
+
+        case json_tape_type::real:
+            return datum{std::bit_cast<double>(entry.value)};
+
+        case json_tape_type::string:
+            return datum{string(entry)};
+
+        case json_tape_type::array_begin:
+            {
+                auto r = datum::vector_type{};
+                r.reserve(entry.size);
+                for (auto j = 0_uz; j != entry.size; ++j) {
+                    r.push_back(to_datum(i));
+                }
+                // Skip array_end.
+                ++i;
+                return datum{std::move(r)};
+            }
+
+        case json_tape_type::object_begin:
+            {
+                auto r = datum::map_type{};
+                for (auto j = 0_uz; j != entry.size; ++j) {
+                    auto key = datum{string(_entries[i++])};
+                    // The last of duplicate keys wins.
+                    r.insert_or_assign(std::move(key), to_datum(i));
+                }
+                // Skip object_end.
+                ++i;
+                return datum{std::move(r)};
+            }
+
+        default:
+            hi_no_default();
+        }
+    }
+};
+
+}} // namespace hi::v1
@@ -0,0 +1,211 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "JSON_tape.hpp"
+#include <hikotest/hikotest.hpp>
+#include <random>
+#include <array>
+#include <string>
+#include <vector>
+
+TEST_SUITE(JSON_tape_suite) {
+
+/** Find the tokens one character at a time, as reference for the SIMD scan.
+ */
+static std::vector<uint32_t> scan_scalar(std::string_view text)
+{
+    auto r = std::vector<uint32_t>{};
+    auto state = hi::detail::json_scan_state{};
+    for (auto offset = std::size_t{0}; offset < text.size(); offset += 64) {
+        auto bits = uint64_t{};
+        REQUIRE(hi::detail::json_scan_block_scalar(text, offset, state, bits));
+        for (; bits != 0; bits &= bits - 1) {
+            r.push_back(static_cast<uint32_t>(offset + std::countr_zero(bits)));
+        }
+    }
+    return r;
+}
+
+TEST_CASE(tape)
+{
+    auto tape = hi::json_tape{};
+    REQUIRE(tape.parse(R"({"a": [1, -2.5, true, null], "b": "x"})"));
+
+    auto const entries = tape.entries();
+    REQUIRE(entries.size() == 11);
+    REQUIRE(entries[0].type == hi::json_tape_type::object_begin);
+    REQUIRE(entries[0].size == 2);
+    REQUIRE(entries[0].value == 10);
+    REQUIRE(entries[1].type == hi::json_tape_type::string);
+    REQUIRE(tape.string(entries[1]) == "a");
+    REQUIRE(entries[2].type == hi::json_tape_type::array_begin);
+    REQUIRE(entries[2].size == 4);
+    REQUIRE(entries[2].value == 7);
+    REQUIRE(entries[3].type == hi::json_tape_type::integer);
+    REQUIRE(std::bit_cast<long long>(entries[3].value) == 1);
+    REQUIRE(entries[4].type == hi::json_tape_type::real);
+    REQUIRE(std::bit_cast<double>(entries[4].value) == -2.5);
+    REQUIRE(entries[5].type == hi::json_tape_type::boolean);
+    REQUIRE(entries[5].value == 1);
+    REQUIRE(entries[6].type == hi::json_tape_type::null);
+    REQUIRE(entries[7].type == hi::json_tape_type::array_end);
+    REQUIRE(entries[7].value == 2);
+    REQUIRE(tape.string(entries[8]) == "b");
+    REQUIRE(tape.string(entries[9]) == "x");
+    REQUIRE(entries[10].type == hi::json_tape_type::object_end);
+    REQUIRE(entries[10].value == 0);
+}
+
+TEST_CASE(to_datum)
+{
+    auto expected = hi::datum::make_map();
+    expected["foo"] = hi::datum::make_vector(42, -1.5, false);
+    expected["bar"] = hi::datum::make_map();
+    expected["baz"] = hi::datum{nullptr};
+
+    auto tape = hi::json_tape{};
+    REQUIRE(tape.parse(R"({"foo": [42, -15e-1, false], "bar": {}, "baz": null, "baz": null})"));
+    REQUIRE(tape.to_datum() == expected);
+
+    REQUIRE(tape.parse("-9223372036854775807"));
+    REQUIRE(tape.to_datum() == hi::datum{-9223372036854775807LL});
+}
+
+TEST_CASE(escapes)
+{
+    auto tape = hi::json_tape{};
+    REQUIRE(tape.parse(R"("a\"b\\c\/d\b\f\n\r\t\u00e9\u20ac\ud83d\ude00")"));
+    REQUIRE(tape.string(tape.entries()[0]) == "a\"b\\c/d\b\f\n\r\t\xc3\xa9\xe2\x82\xac\xf0\x9f\x98\x80");
+
+    REQUIRE(not tape.parse(R"("\q")"));
+    REQUIRE(not tape.parse(R"("\u12")"));
+    REQUIRE(not tape.parse(R"("\ud83d")"));
+    REQUIRE(not tape.parse(R"("\ude00")"));
+}
+
+TEST_CASE(comments)
+{
+    auto tape = hi::json_tape{};
+    REQUIRE(tape.parse("// comment [\n[1, // \"comment\n2, // 3,\n] // comment"));
+    REQUIRE(tape.to_datum() == hi::datum::make_vector(1, 2));
+
+    // Comments and strings that cross the boundary between 64 byte blocks.
+    for (auto i = std::size_t{50}; i != 80; ++i) {
+        auto const text = "[" + std::string(i, ' ') + "\"a\\\\\", // \"x\"\n 1 // ]\n]";
+        REQUIRE(tape.parse(text));
+        REQUIRE(tape.to_datum() == hi::datum::make_vector("a\\", 1));
+    }
+
+    REQUIRE(not tape.parse("[1, / comment\n]"));
+    REQUIRE(not tape.parse("[1]/"));
+}
+
+TEST_CASE(invalid)
+{
+    auto tape = hi::json_tape{};
+    REQUIRE(not tape.parse(""));
+    REQUIRE(not tape.parse("  "));
+    REQUIRE(not tape.parse("[1 2]"));
+    REQUIRE(not tape.parse("[1]]"));
+    REQUIRE(not tape.parse("[1"));
+    REQUIRE(not tape.parse("[,]"));
+    REQUIRE(not tape.parse("[1,,]"));
+    REQUIRE(not tape.parse("{,}"));
+    REQUIRE(not tape.parse(R"({"a" 1})"));
+    REQUIRE(not tape.parse(R"({"a": })"));
+    REQUIRE(not tape.parse(R"({"a": 1])"));
+    REQUIRE(not tape.parse(R"({1: 1})"));
+    REQUIRE(not tape.parse(R"("abc)"));
+    REQUIRE(not tape.parse(R"("a"b)"));
+    REQUIRE(not tape.parse("'a'"));
+    REQUIRE(not tape.parse("tru"));
+    REQUIRE(not tape.parse("truex"));
+    REQUIRE(not tape.parse("-"));
+    REQUIRE(not tape.parse("- 1"));
+    REQUIRE(not tape.parse("01"));
+    REQUIRE(not tape.parse("1."));
+    REQUIRE(not tape.parse("1e"));
+    REQUIRE(not tape.parse("1e400"));
+    REQUIRE(not tape.parse("9223372036854775808"));
+    REQUIRE(not tape.parse("\\"));
+}
+
+TEST_CASE(scan_matches_scalar)
+{
+    // Strings with runs of escaped backslashes and quotes, and comments with quotes, so
+    // that the escape, in-string and comment carries cross the boundaries between blocks.
+    auto engine = std::mt19937{42};
+    auto dist = std::uniform_int_distribution{0, 9};
+
+    for (auto i = 0; i != 1000; ++i) {
+        auto text = std::string{"["};
+        for (auto j = 0; j != 40; ++j) {
+            text += '"';
+            for (auto k = dist(engine); k != 0; --k) {
+                switch (dist(engine)) {
+                case 0:
+                case 1:
+                    text += "\\\\";
+                    break;
+                case 2:
+                    text += "\\\"";
+                    break;
+                case 3:
+                    text += "{]:,//";
+                    break;
+                default:
+                    text += 'a';
+                }
+            }
+            text += "\", 1";
+            text += std::string(dist(engine), ' ');
+            text += ',';
+            if (dist(engine) < 3) {
+                text += "// \"a\\\n";
+            }
+        }
+        text += ']';
+
+        auto indices = std::vector<uint32_t>{};
+        REQUIRE(hi::detail::json_scan(text, indices));
+        REQUIRE(indices == scan_scalar(text));
+    }
+}
+
+#if HI_HAS_X86
+TEST_CASE(classify_simd)
+{
+    auto text = std::string{};
+    for (auto i = 0; i != 64 * 4; ++i) {
+        text += static_cast<char>(i);
+    }
+
+    auto expected = std::array<hi::detail::json_block_masks, 2>{};
+    auto result = std::array<hi::detail::json_block_masks, 2>{};
+    auto const equal = [&] {
+        for (auto i = std::size_t{0}; i != expected.size(); ++i) {
+            if (result[i].quote != expected[i].quote or result[i].backslash != expected[i].backslash or
+                result[i].slash != expected[i].slash or result[i].structural != expected[i].structural or
+                result[i].white_space != expected[i].white_space or result[i].line_feed != expected[i].line_feed) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    for (auto i = std::size_t{0}; i != 64 * 2; ++i) {
+        hi::detail::json_classify_generic(text.data() + i, expected);
+
+        hi::detail::json_classify_sse2(text.data() + i, result);
+        REQUIRE(equal());
+
+        if (hi::has_avx2()) {
+            hi::detail::json_classify_avx2(text.data() + i, result);
+            REQUIRE(equal());
+        }
+    }
+}
+#endif
+
+};
@@ -104,4 +104,50 @@ TEST_CASE(ParseTwoItemObject)
     REQUIRE(hi::parse_JSON("{\"foo\": {\"bar\": 42, \"baz\": 43,}}") == expected);
 }
 
+TEST_CASE(ParseComment)
+{
+    auto expected = hi::datum::make_map();
+    expected["foo"] = 42;
+    expected["bar"] = "// not a comment";
+    REQUIRE(
+        hi::parse_JSON("// comment\n"
+                       "{\n"
+                       "    // comment \"with quotes\"\n"
+                       "    \"foo\": 42, // comment\n"
+                       "    \"bar\": \"// not a comment\"\n"
+                       "}") == expected);
+}
+
+TEST_CASE(ParseEscape)
+{
+    auto expected = hi::datum::make_map();
+    expected["foo"] = "a\"b\\c\n\xc3\xa9";
+    REQUIRE(hi::parse_JSON("{\"foo\": \"a\\\"b\\\\c\\n\\u00e9\"}") == expected);
+}
+
+TEST_CASE(ParseLexerFallback)
+{
+    // A space between the minus and the number is only accepted by the lexer based parser.
+    auto expected = hi::datum::make_map();
+    expected["foo"] = -42;
+    REQUIRE(hi::parse_JSON("{\"foo\": - 42}") == expected);
+}
+
+TEST_CASE(ParseLexerFallbackEscape)
+{
+    // Both parsers decode escape sequences in keys and values.
+    auto expected = hi::datum::make_map();
+    expected["foo"] = -42;
+    expected["b\"r"] = "a\"b\\c/\n\xc3\xa9\xf0\x9f\x98\x80";
+    REQUIRE(hi::parse_JSON("{\"foo\": - 42, \"b\\\"r\": \"a\\\"b\\\\c\\/\\n\\u00e9\\ud83d\\ude00\"}") == expected);
+    REQUIRE_THROWS(hi::parse_JSON("{\"foo\": - 42, \"bar\": \"\\x\"}"), hi::parse_error);
+}
+
+TEST_CASE(ParseError)
+{
+    REQUIRE_THROWS(hi::parse_JSON("{\"foo\": [42 43]}"), hi::parse_error);
+    REQUIRE_THROWS(hi::parse_JSON("{\"foo\" 42}"), hi::parse_error);
+    REQUIRE_THROWS(hi::parse_JSON("{\"foo\": 42}}"), hi::parse_error);
+}
+
 };
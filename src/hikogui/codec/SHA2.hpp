@@ -7,13 +7,23 @@
 #include "../container/container.hpp"
 #include "../utility/utility.hpp"
 #include "../macros.hpp"
+#include <hikocpu/hikocpu.hpp>
+#include <algorithm>
 #include <bit>
 #include <array>
+#include <cstddef>
 #include <cstdint>
 #include <span>
 #include <string_view>
 #include <exception>
 #include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if HI_HAS_X86
+#include <immintrin.h>
+#endif
 
 hi_export_module(hikogui.codec.SHA2);
 
@@ -23,6 +33,415 @@ hi_warning_push();
 hi_warning_ignore_msvc(26429);
 
 hi_export namespace hi { inline namespace v1 {
+namespace detail {
+
+/** The round constants of SHA-224 and SHA-256.
+ */
+constexpr auto SHA2_K32 = std::array<uint32_t, 64>{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/** The round constants of SHA-384 and SHA-512.
+ */
+constexpr auto SHA2_K64 = std::array<uint64_t, 80>{
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+    0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+    0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+    0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+    0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+    0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+    0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+    0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+    0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
+
+#if HI_HAS_X86
+/** Four rounds of SHA-256 using the SHA extensions.
+ *
+ * The message schedule is calculated in a sliding window of four registers,
+ * `msg[I % 4]` holds the message words for rounds `I * 4` to `I * 4 + 3`.
+ *
+ * @tparam I The index of the group of four rounds.
+ * @param state0 The a, b, e, f words of the state.
+ * @param state1 The c, d, g, h words of the state.
+ * @param msg The message schedule.
+ */
+template<std::size_t I>
+hi_target("sse,sse2,ssse3,sse4.1,sha")
+hi_force_inline inline void SHA256_rounds_shani(__m128i& state0, __m128i& state1, __m128i (&msg)[4]) noexcept
+{
+    auto m = _mm_add_epi32(msg[I % 4], _mm_loadu_si128(reinterpret_cast<__m128i const *>(SHA2_K32.data() + I * 4)));
+    state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+    if constexpr (I >= 3 and I < 15) {
+        auto const tmp = _mm_alignr_epi8(msg[I % 4], msg[(I + 3) % 4], 4);
+        msg[(I + 1) % 4] = _mm_sha256msg2_epu32(_mm_add_epi32(msg[(I + 1) % 4], tmp), msg[I % 4]);
+    }
+
+    m = _mm_shuffle_epi32(m, 0x0e);
+    state0 = _mm_sha256rnds2_epu32(state0, state1, m);
+    if constexpr (I >= 1 and I < 13) {
+        msg[(I + 3) % 4] = _mm_sha256msg1_epu32(msg[(I + 3) % 4], msg[I % 4]);
+    }
+}
+
+template<std::size_t... I>
+hi_target("sse,sse2,ssse3,sse4.1,sha")
+hi_force_inline inline void SHA256_rounds_shani(__m128i& state0, __m128i& state1, __m128i (&msg)[4], std::index_sequence<I...>) noexcept
+{
+    (SHA256_rounds_shani<I>(state0, state1, msg), ...);
+}
+
+/** Compress blocks of a SHA-256 message using the SHA extensions.
+ *
+ * @param state The state a to h.
+ * @param ptr The start of the first 64 byte block.
+ * @param nr_blocks The number of blocks.
+ */
+hi_target("sse,sse2,ssse3,sse4.1,sha")
+inline void SHA256_compress_shani(std::array<uint32_t, 8>& state, std::byte const *ptr, std::size_t nr_blocks) noexcept
+{
+    auto const byte_swap = _mm_set_epi64x(0x0c0d0e0f'08090a0b, 0x04050607'00010203);
+
+    // The sha256rnds2 instruction wants the state as {a, b, e, f} and {c, d, g, h},
+    // with a and c in the highest lanes.
+    auto tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(state.data())), 0xb1);
+    auto state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<__m128i const *>(state.data() + 4)), 0x1b);
+    auto state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xf0);
+
+    for (; nr_blocks != 0; --nr_blocks, ptr += 64) {
+        auto const abef = state0;
+        auto const cdgh = state1;
+
+        __m128i msg[4];
+        for (auto i = 0; i != 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(ptr) + i), byte_swap);
+        }
+
+        SHA256_rounds_shani(state0, state1, msg, std::make_index_sequence<16>{});
+
+        state0 = _mm_add_epi32(state0, abef);
+        state1 = _mm_add_epi32(state1, cdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1b);
+    state1 = _mm_shuffle_epi32(state1, 0xb1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data()), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(state.data() + 4), state1);
+}
+
+template<typename T>
+hi_target("avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i SHA2_add_avx2(__m256i a, __m256i b) noexcept
+{
+    if constexpr (sizeof(T) == 4) {
+        return _mm256_add_epi32(a, b);
+    } else {
+        return _mm256_add_epi64(a, b);
+    }
+}
+
+template<typename T, int N>
+hi_target("avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i SHA2_shr_avx2(__m256i x) noexcept
+{
+    if constexpr (sizeof(T) == 4) {
+        return _mm256_srli_epi32(x, N);
+    } else {
+        return _mm256_srli_epi64(x, N);
+    }
+}
+
+template<typename T, int N>
+hi_target("avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i SHA2_rotr_avx2(__m256i x) noexcept
+{
+    if constexpr (sizeof(T) == 4) {
+        return _mm256_or_si256(_mm256_srli_epi32(x, N), _mm256_slli_epi32(x, 32 - N));
+    } else {
+        return _mm256_or_si256(_mm256_srli_epi64(x, N), _mm256_slli_epi64(x, 64 - N));
+    }
+}
+
+template<typename T, int A, int B, int C>
+hi_target("avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i SHA2_S_avx2(__m256i x) noexcept
+{
+    return _mm256_xor_si256(_mm256_xor_si256(SHA2_rotr_avx2<T, A>(x), SHA2_rotr_avx2<T, B>(x)), SHA2_rotr_avx2<T, C>(x));
+}
+
+template<typename T, int A, int B, int C>
+hi_target("avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i SHA2_s_avx2(__m256i x) noexcept
+{
+    return _mm256_xor_si256(_mm256_xor_si256(SHA2_rotr_avx2<T, A>(x), SHA2_rotr_avx2<T, B>(x)), SHA2_shr_avx2<T, C>(x));
+}
+
+/** Load 32 bytes of a block as big-endian words.
+ */
+template<typename T>
+hi_target("avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i SHA2_load_avx2(std::byte const *ptr, std::size_t i) noexcept
+{
+    auto const v = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(ptr) + i);
+    if constexpr (sizeof(T) == 4) {
+        return _mm256_shuffle_epi8(
+            v, _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+    } else {
+        return _mm256_shuffle_epi8(
+            v, _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8));
+    }
+}
+
+/** Load a block of each message and transpose it so that each register holds one word of all messages.
+ *
+ * @param[out] W The message words, lane `i` of `W[j]` is word `j` of message `i`.
+ * @param blocks Pointers to the block of each message.
+ */
+template<typename T>
+hi_target("avx,avx2")
+hi_force_inline inline void SHA2_load_avx2(__m256i (&W)[16], std::array<std::byte const *, 32 / sizeof(T)> const& blocks) noexcept
+{
+    if constexpr (sizeof(T) == 4) {
+        // Two 8x8 transposes of 32 bit words.
+        for (auto i = 0_uz; i != 2; ++i) {
+            __m256i row[8];
+            for (auto lane = 0_uz; lane != 8; ++lane) {
+                row[lane] = SHA2_load_avx2<T>(blocks[lane], i);
+            }
+
+            auto const t0 = _mm256_unpacklo_epi32(row[0], row[1]);
+            auto const t1 = _mm256_unpackhi_epi32(row[0], row[1]);
+            auto const t2 = _mm256_unpacklo_epi32(row[2], row[3]);
+            auto const t3 = _mm256_unpackhi_epi32(row[2], row[3]);
+            auto const t4 = _mm256_unpacklo_epi32(row[4], row[5]);
+            auto const t5 = _mm256_unpackhi_epi32(row[4], row[5]);
+            auto const t6 = _mm256_unpacklo_epi32(row[6], row[7]);
+            auto const t7 = _mm256_unpackhi_epi32(row[6], row[7]);
+
+            auto const u0 = _mm256_unpacklo_epi64(t0, t2);
+            auto const u1 = _mm256_unpackhi_epi64(t0, t2);
+            auto const u2 = _mm256_unpacklo_epi64(t1, t3);
+            auto const u3 = _mm256_unpackhi_epi64(t1, t3);
+            auto const u4 = _mm256_unpacklo_epi64(t4, t6);
+            auto const u5 = _mm256_unpackhi_epi64(t4, t6);
+            auto const u6 = _mm256_unpacklo_epi64(t5, t7);
+            auto const u7 = _mm256_unpackhi_epi64(t5, t7);
+
+            W[i * 8 + 0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+            W[i * 8 + 1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+            W[i * 8 + 2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+            W[i * 8 + 3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+            W[i * 8 + 4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+            W[i * 8 + 5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+            W[i * 8 + 6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+            W[i * 8 + 7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+        }
+
+    } else {
+        // Four 4x4 transposes of 64 bit words.
+        for (auto i = 0_uz; i != 4; ++i) {
+            __m256i row[4];
+            for (auto lane = 0_uz; lane != 4; ++lane) {
+                row[lane] = SHA2_load_avx2<T>(blocks[lane], i);
+            }
+
+            auto const t0 = _mm256_unpacklo_epi64(row[0], row[1]);
+            auto const t1 = _mm256_unpackhi_epi64(row[0], row[1]);
+            auto const t2 = _mm256_unpacklo_epi64(row[2], row[3]);
+            auto const t3 = _mm256_unpackhi_epi64(row[2], row[3]);
+
+            W[i * 4 + 0] = _mm256_permute2x128_si256(t0, t2, 0x20);
+            W[i * 4 + 1] = _mm256_permute2x128_si256(t1, t3, 0x20);
+            W[i * 4 + 2] = _mm256_permute2x128_si256(t0, t2, 0x31);
+            W[i * 4 + 3] = _mm256_permute2x128_si256(t1, t3, 0x31);
+        }
+    }
+}
+
+/** Compress a block of 8 SHA-256 or 4 SHA-512 independent messages using AVX2.
+ *
+ * @param state The state of each message, `state[i * lanes + j]` is word `i` of message `j`.
+ * @param blocks Pointers to the block of each message.
+ */
+template<typename T>
+hi_target("avx,avx2")
+inline void SHA2_compress_avx2(std::array<T, 256 / sizeof(T)>& state, std::array<std::byte const *, 32 / sizeof(T)> const& blocks) noexcept
+{
+    constexpr auto lanes = 32 / sizeof(T);
+    constexpr auto nr_rounds = sizeof(T) == 4 ? 64_uz : 80_uz;
+
+    __m256i W[16];
+    SHA2_load_avx2<T>(W, blocks);
+
+    __m256i v[8];
+    for (auto i = 0_uz; i != 8; ++i) {
+        v[i] = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(state.data() + i * lanes));
+    }
+    auto [a, b, c, d, e, f, g, h] = v;
+
+    for (auto i = 0_uz; i != nr_rounds; ++i) {
+        auto K = __m256i{};
+        auto S0 = __m256i{};
+        auto S1 = __m256i{};
+        if constexpr (sizeof(T) == 4) {
+            K = _mm256_set1_epi32(static_cast<int>(SHA2_K32[i]));
+            S0 = SHA2_S_avx2<T, 2, 13, 22>(a);
+            S1 = SHA2_S_avx2<T, 6, 11, 25>(e);
+            if (i >= 16) {
+                auto const s0 = SHA2_s_avx2<T, 7, 18, 3>(W[(i - 15) % 16]);
+                auto const s1 = SHA2_s_avx2<T, 17, 19, 10>(W[(i - 2) % 16]);
+                W[i % 16] = _mm256_add_epi32(_mm256_add_epi32(s1, W[(i - 7) % 16]), _mm256_add_epi32(s0, W[i % 16]));
+            }
+        } else {
+            K = _mm256_set1_epi64x(static_cast<long long>(SHA2_K64[i]));
+            S0 = SHA2_S_avx2<T, 28, 34, 39>(a);
+            S1 = SHA2_S_avx2<T, 14, 18, 41>(e);
+            if (i >= 16) {
+                auto const s0 = SHA2_s_avx2<T, 1, 8, 7>(W[(i - 15) % 16]);
+                auto const s1 = SHA2_s_avx2<T, 19, 61, 6>(W[(i - 2) % 16]);
+                W[i % 16] = _mm256_add_epi64(_mm256_add_epi64(s1, W[(i - 7) % 16]), _mm256_add_epi64(s0, W[i % 16]));
+            }
+        }
+
+        auto const Ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+        auto const Maj = _mm256_xor_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_xor_si256(a, b)));
+        auto const T1 = SHA2_add_avx2<T>(SHA2_add_avx2<T>(SHA2_add_avx2<T>(h, S1), SHA2_add_avx2<T>(Ch, K)), W[i % 16]);
+        auto const T2 = SHA2_add_avx2<T>(S0, Maj);
+
+        h = g;
+        g = f;
+        f = e;
+        e = SHA2_add_avx2<T>(d, T1);
+        d = c;
+        c = b;
+        b = a;
+        a = SHA2_add_avx2<T>(T1, T2);
+    }
+
+    __m256i const r[8] = {a, b, c, d, e, f, g, h};
+    for (auto i = 0_uz; i != 8; ++i) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(state.data() + i * lanes), SHA2_add_avx2<T>(v[i], r[i]));
+    }
+}
+
+/** Hash many independent messages using multi-buffer AVX2.
+ *
+ * Each lane hashes a different message; when a message is finished the next
+ * message is started in the free lane, so messages of different lengths keep
+ * all the lanes busy.
+ *
+ * @param init The initial state of the hash.
+ * @param messages The messages to hash.
+ * @param[out] r The final state of each message.
+ */
+template<typename T>
+inline void SHA2_batch_avx2(std::array<T, 8> const& init, std::span<std::span<std::byte const> const> messages, std::span<std::array<T, 8>> r) noexcept
+{
+    constexpr auto lanes = 32 / sizeof(T);
+    constexpr auto block_size = 16 * sizeof(T);
+    constexpr auto length_size = 2 * sizeof(T);
+
+    hi_axiom(r.size() == messages.size());
+
+    struct lane_type {
+        std::size_t message = 0;
+        bool active = false;
+        std::byte const *ptr = nullptr;
+        std::size_t nr_blocks = 0;
+        std::byte const *tail_ptr = nullptr;
+        std::size_t nr_tail_blocks = 0;
+        std::array<std::byte, 2 * block_size> tail = {};
+    };
+
+    auto state = std::array<T, 8 * lanes>{};
+    auto lane_data = std::array<lane_type, lanes>{};
+    auto blocks = std::array<std::byte const *, lanes>{};
+    auto const zeros = std::array<std::byte, block_size>{};
+    auto next = 0_uz;
+
+    auto const start = [&](std::size_t lane) {
+        auto& l = lane_data[lane];
+        if (next == messages.size()) {
+            l.active = false;
+            return;
+        }
+
+        auto const message = messages[next];
+        l.message = next++;
+        l.active = true;
+        l.ptr = message.data();
+        l.nr_blocks = message.size() / block_size;
+
+        // The padding is done in a copy of the last partial block.
+        auto const rest = message.size() % block_size;
+        l.tail = {};
+        std::copy_n(message.data() + l.nr_blocks * block_size, rest, l.tail.begin());
+        l.tail[rest] = std::byte{0x80};
+        l.tail_ptr = l.tail.data();
+        l.nr_tail_blocks = rest + 1 + length_size <= block_size ? 1 : 2;
+
+        auto const nr_of_bits = uint64_t{message.size()} * 8;
+        auto const tail_end = l.nr_tail_blocks * block_size;
+        for (auto i = 0_uz; i != sizeof(nr_of_bits); ++i) {
+            l.tail[tail_end - 1 - i] = static_cast<std::byte>(nr_of_bits >> i * 8);
+        }
+
+        for (auto i = 0_uz; i != 8; ++i) {
+            state[i * lanes + lane] = init[i];
+        }
+    };
+
+    for (auto lane = 0_uz; lane != lanes; ++lane) {
+        start(lane);
+    }
+
+    while (std::ranges::any_of(lane_data, [](auto const& l) { return l.active; })) {
+        for (auto lane = 0_uz; lane != lanes; ++lane) {
+            auto& l = lane_data[lane];
+            if (not l.active) {
+                blocks[lane] = zeros.data();
+            } else if (l.nr_blocks != 0) {
+                blocks[lane] = l.ptr;
+                l.ptr += block_size;
+                --l.nr_blocks;
+            } else {
+                blocks[lane] = l.tail_ptr;
+                l.tail_ptr += block_size;
+                --l.nr_tail_blocks;
+            }
+        }
+
+        SHA2_compress_avx2<T>(state, blocks);
+
+        for (auto lane = 0_uz; lane != lanes; ++lane) {
+            auto& l = lane_data[lane];
+            if (l.active and l.nr_blocks == 0 and l.nr_tail_blocks == 0) {
+                for (auto i = 0_uz; i != 8; ++i) {
+                    r[l.message][i] = state[i * lanes + lane];
+                }
+                start(lane);
+            }
+        }
+    }
+}
+#endif
+
+} // namespace detail
 
 hi_export template<typename T, std::size_t Bits>
 class SHA2 {
@@ -42,6 +461,16 @@ class SHA2 {
 
         constexpr state_type(T a, T b, T c, T d, T e, T f, T g, T h) noexcept : a(a), b(b), c(c), d(d), e(e), f(f), g(g), h(h) {}
 
+        constexpr explicit state_type(std::array<T, 8> const& v) noexcept :
+            a(v[0]), b(v[1]), c(v[2]), d(v[3]), e(v[4]), f(v[5]), g(v[6]), h(v[7])
+        {
+        }
+
+        [[nodiscard]] constexpr std::array<T, 8> to_array() const noexcept
+        {
+            return {a, b, c, d, e, f, g, h};
+        }
+
         [[nodiscard]] constexpr T get_word(std::size_t i) const noexcept
         {
             switch (i) {
@@ -146,38 +575,10 @@ class SHA2 {
 
     [[nodiscard]] constexpr static T K(std::size_t i) noexcept
     {
-        constexpr std::array<uint32_t, 64> K32 = {
-            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
-            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
-            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
-            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
-            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
-            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
-            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
-            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
-
-        constexpr std::array<uint64_t, 80> K64 = {
-            0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
-            0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
-            0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
-            0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
-            0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
-            0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
-            0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
-            0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
-            0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
-            0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
-            0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
-            0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
-            0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
-            0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
-            0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
-            0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817};
-
         if constexpr (std::is_same_v<T, uint32_t>) {
-            return K32[i];
+            return detail::SHA2_K32[i];
         } else {
-            return K64[i];
+            return detail::SHA2_K64[i];
         }
     }
 
@@ -265,6 +666,30 @@ class SHA2 {
         state += tmp;
     }
 
+    /** Compress whole blocks.
+     *
+     * At runtime SHA-256 uses the SHA extensions when available.
+     */
+    constexpr void add_blocks(cbyteptr ptr, std::size_t nr_blocks) noexcept
+    {
+        if (not std::is_constant_evaluated()) {
+#if HI_HAS_X86
+            if constexpr (std::is_same_v<T, uint32_t>) {
+                if (has_sha() and has_sse4_1()) {
+                    auto tmp = state.to_array();
+                    detail::SHA256_compress_shani(tmp, ptr, nr_blocks);
+                    state = state_type{tmp};
+                    return;
+                }
+            }
+#endif
+        }
+
+        for (; nr_blocks != 0; --nr_blocks, ptr += block_type::size) {
+            add(block_type{ptr});
+        }
+    }
+
     constexpr void add_to_overflow(cbyteptr& ptr, std::byte const *last) noexcept
     {
         hi_axiom_not_null(ptr);
@@ -289,7 +714,7 @@ class SHA2 {
             while (overflow_it != overflow.end()) {
                 *(overflow_it++) = std::byte{0x00};
             }
-            add(block_type{overflow.data()});
+            add_blocks(overflow.data(), 1);
             overflow_it = overflow.begin();
         }
 
@@ -304,10 +729,41 @@ class SHA2 {
             *(overflow_it++) = i < sizeof(nr_of_bits) ? static_cast<std::byte>(nr_of_bits >> i * 8) : std::byte{0x00};
         }
 
-        auto b = block_type{overflow.data()};
-        add(b);
+        add_blocks(overflow.data(), 1);
+    }
+
+    constexpr explicit SHA2(state_type const& state) noexcept : state(state), overflow(), overflow_it(overflow.begin()), size(0) {}
+
+    [[nodiscard]] static std::vector<bstring> batch(SHA2 const& init, std::span<std::span<std::byte const> const> messages)
+    {
+        auto r = std::vector<bstring>{};
+        r.reserve(messages.size());
+
+#if HI_HAS_X86
+        // The SHA extensions hash a single message faster than 8-way AVX2
+        // hashes eight messages.
+        auto const has_sha256 = std::is_same_v<T, uint32_t> and has_sha() and has_sse4_1();
+        if (messages.size() > 1 and not has_sha256 and has_avx2()) {
+            auto states = std::vector<std::array<T, 8>>(messages.size());
+            detail::SHA2_batch_avx2<T>(init.state.to_array(), messages, states);
+            for (auto const& words : states) {
+                r.push_back(state_type{words}.template get_bytes<Bits / 8>());
+            }
+            return r;
+        }
+#endif
+
+        for (auto const& message : messages) {
+            auto tmp = SHA2{init.state};
+            tmp.add(message);
+            r.push_back(tmp.get_bytes());
+        }
+        return r;
     }
 
+    template<typename Hash>
+    friend std::vector<bstring> SHA2_batch(std::span<std::span<std::byte const> const> messages);
+
 public:
     constexpr SHA2(T a, T b, T c, T d, T e, T f, T g, T h) noexcept :
         state(a, b, c, d, e, f, g, h), overflow(), overflow_it(overflow.begin()), size(0)
@@ -322,7 +778,7 @@ public:
             add_to_overflow(ptr, last);
 
             if (overflow_it == overflow.end()) {
-                add(block_type{overflow.data()});
+                add_blocks(overflow.data(), 1);
                 overflow_it = overflow.begin();
 
             } else {
@@ -333,10 +789,9 @@ public:
             }
         }
 
-        while (ptr + block_type::size <= last) {
-            add(block_type{ptr});
-            ptr += block_type::size;
-        }
+        auto const nr_blocks = narrow_cast<std::size_t>(last - ptr) / block_type::size;
+        add_blocks(ptr, nr_blocks);
+        ptr += nr_blocks * block_type::size;
 
         add_to_overflow(ptr, last);
 
@@ -467,6 +922,38 @@ public:
     }
 };
 
+/** Hash many independent messages in one call.
+ *
+ * When the CPU supports it the messages are hashed in parallel, 8 messages at
+ * a time for SHA-224/SHA-256 and 4 messages at a time for the SHA-512 variants.
+ *
+ * @tparam Hash The hash algorithm: `SHA224`, `SHA256`, `SHA384`, `SHA512`, `SHA512_224` or `SHA512_256`.
+ * @param messages The messages to hash.
+ * @return The digest of each message.
+ */
+hi_export template<typename Hash>
+[[nodiscard]] std::vector<bstring> SHA2_batch(std::span<std::span<std::byte const> const> messages)
+{
+    return Hash::batch(Hash{}, messages);
+}
+
+/** Hash many independent messages in one call.
+ *
+ * @tparam Hash The hash algorithm: `SHA224`, `SHA256`, `SHA384`, `SHA512`, `SHA512_224` or `SHA512_256`.
+ * @param messages The messages to hash.
+ * @return The digest of each message.
+ */
+hi_export template<typename Hash>
+[[nodiscard]] std::vector<bstring> SHA2_batch(std::span<bstring const> messages)
+{
+    auto spans = std::vector<std::span<std::byte const>>{};
+    spans.reserve(messages.size());
+    for (auto const& message : messages) {
+        spans.emplace_back(message);
+    }
+    return SHA2_batch<Hash>(spans);
+}
+
 }} // namespace hi::v1
 
 hi_warning_pop();
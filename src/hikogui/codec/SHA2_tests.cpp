@@ -7,6 +7,9 @@
 #include "../utility/utility.hpp"
 #include "../algorithm/algorithm.hpp"
 #include <hikotest/hikotest.hpp>
+#include <array>
+#include <span>
+#include <vector>
 
 TEST_SUITE(SHA2_suite) {
 
@@ -25,6 +28,47 @@ static std::string test_sha2(std::string value)
     return test_sha2<T>(hi::to_bstring(value));
 }
 
+/** Messages of every length up to a few blocks, to hit every padding case.
+ */
+static std::vector<hi::bstring> make_messages()
+{
+    auto r = std::vector<hi::bstring>{};
+    for (std::size_t size = 0; size != 300; ++size) {
+        auto& message = r.emplace_back();
+        for (std::size_t i = 0; i != size; ++i) {
+            message += static_cast<std::byte>(i * 31 + size);
+        }
+    }
+    return r;
+}
+
+template<typename T>
+static hi::bstring to_digest(std::array<T, 8> const& state, std::size_t size)
+{
+    auto r = hi::bstring{};
+    for (std::size_t i = 0; i != size; ++i) {
+        r += static_cast<std::byte>(state[i / sizeof(T)] >> (sizeof(T) - 1 - i % sizeof(T)) * 8);
+    }
+    return r;
+}
+
+template<typename T>
+static bool test_batch()
+{
+    auto const messages = make_messages();
+    auto const digests = hi::SHA2_batch<T>(messages);
+    if (digests.size() != messages.size()) {
+        return false;
+    }
+
+    for (std::size_t i = 0; i != messages.size(); ++i) {
+        if (digests[i] != T{}.add(messages[i]).get_bytes()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 TEST_CASE(empty)
 {
     REQUIRE(test_sha2<hi::SHA224>("") == "d14a028c2a3a2bc9476102bb288234c415a2b01f828ea62ac5b3e42f");
@@ -155,4 +199,79 @@ TEST_CASE(NESSIE512Set1)
         "eb009c5c2c49aa2e4eadb217ad8cc09b");
 }
 
+TEST_CASE(chunks)
+{
+    auto const message = make_messages().back();
+    auto const expected256 = hi::SHA256{}.add(message).get_bytes();
+    auto const expected512 = hi::SHA512{}.add(message).get_bytes();
+
+    for (std::size_t chunk_size = 1; chunk_size != 140; ++chunk_size) {
+        auto h256 = hi::SHA256{};
+        auto h512 = hi::SHA512{};
+        for (std::size_t i = 0; i < message.size(); i += chunk_size) {
+            auto const chunk = hi::bstring_view{message}.substr(i, chunk_size);
+            h256.add(chunk, false);
+            h512.add(chunk, false);
+        }
+        h256.add(hi::bstring{});
+        h512.add(hi::bstring{});
+
+        REQUIRE(h256.get_bytes() == expected256);
+        REQUIRE(h512.get_bytes() == expected512);
+    }
+}
+
+TEST_CASE(batch)
+{
+    REQUIRE(test_batch<hi::SHA224>());
+    REQUIRE(test_batch<hi::SHA256>());
+    REQUIRE(test_batch<hi::SHA384>());
+    REQUIRE(test_batch<hi::SHA512>());
+    REQUIRE(test_batch<hi::SHA512_224>());
+    REQUIRE(test_batch<hi::SHA512_256>());
+
+    REQUIRE(hi::SHA2_batch<hi::SHA256>(std::span<hi::bstring const>{}).empty());
+    auto const abc = std::vector<hi::bstring>{hi::to_bstring("abc")};
+    REQUIRE(
+        hi::to_lower(hi::base16::encode(hi::SHA2_batch<hi::SHA256>(abc).front())) ==
+        "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+}
+
+#if HI_HAS_X86
+TEST_CASE(batch_avx2)
+{
+    if (not hi::has_avx2()) {
+        return;
+    }
+
+    auto const messages = make_messages();
+    auto spans = std::vector<std::span<std::byte const>>{};
+    for (auto const& message : messages) {
+        spans.emplace_back(message);
+    }
+
+    auto const init256 = std::array<uint32_t, 8>{
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    auto states256 = std::vector<std::array<uint32_t, 8>>(messages.size());
+    hi::detail::SHA2_batch_avx2<uint32_t>(init256, spans, states256);
+
+    auto const init512 = std::array<uint64_t, 8>{
+        0x6a09e667f3bcc908,
+        0xbb67ae8584caa73b,
+        0x3c6ef372fe94f82b,
+        0xa54ff53a5f1d36f1,
+        0x510e527fade682d1,
+        0x9b05688c2b3e6c1f,
+        0x1f83d9abfb41bd6b,
+        0x5be0cd19137e2179};
+    auto states512 = std::vector<std::array<uint64_t, 8>>(messages.size());
+    hi::detail::SHA2_batch_avx2<uint64_t>(init512, spans, states512);
+
+    for (std::size_t i = 0; i != messages.size(); ++i) {
+        REQUIRE(to_digest(states256[i], 32) == hi::SHA256{}.add(messages[i]).get_bytes());
+        REQUIRE(to_digest(states512[i], 64) == hi::SHA512{}.add(messages[i]).get_bytes());
+    }
+}
+#endif
+
 }; // TEST_SUITE(SHA2_suite)
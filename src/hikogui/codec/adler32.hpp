@@ -0,0 +1,151 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <hikocpu/hikocpu.hpp>
+#include <span>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if HI_HAS_X86
+#include <immintrin.h>
+#endif
+
+hi_export_module(hikogui.codec.adler32);
+
+hi_export namespace hi { inline namespace v1 {
+namespace detail {
+
+constexpr uint32_t adler32_modulo = 65521;
+
+/** The maximum number of bytes that can be summed before the sums overflow 32 bits.
+ */
+constexpr std::size_t adler32_max_run = 5552;
+
+} // namespace detail
+
+/** Calculate the Adler-32 checksum of a byte string.
+ *
+ * @param bytes The data to calculate the checksum over.
+ * @param adler The checksum of the data preceding @a bytes.
+ * @return The checksum of the preceding data and @a bytes.
+ */
+hi_export [[nodiscard]] constexpr uint32_t adler32_generic(std::span<std::byte const> bytes, uint32_t adler = 1) noexcept
+{
+    auto a = adler & 0xffff;
+    auto b = adler >> 16;
+
+    while (not bytes.empty()) {
+        // Delay the modulo until just before the sums may overflow.
+        auto const n = std::min(bytes.size(), detail::adler32_max_run);
+        for (auto const c : bytes.first(n)) {
+            a += std::to_integer<uint32_t>(c);
+            b += a;
+        }
+        a %= detail::adler32_modulo;
+        b %= detail::adler32_modulo;
+        bytes = bytes.subspan(n);
+    }
+
+    return (b << 16) | a;
+}
+
+#if HI_HAS_X86
+namespace detail {
+
+hi_target("sse,sse2")
+[[nodiscard]] hi_force_inline inline uint32_t adler32_horizontal_sum(__m128i x) noexcept
+{
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0b10'11'00'01));
+    x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0b01'00'11'10));
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(x));
+}
+
+} // namespace detail
+
+/** Calculate the Adler-32 checksum of a byte string using SSSE3.
+ *
+ * 32 bytes are summed at a time. The first sum is calculated with a sum-of-absolute-differences
+ * against zero, the second sum with a multiply-add of the bytes with their weights.
+ *
+ * @param bytes The data to calculate the checksum over.
+ * @param adler The checksum of the data preceding @a bytes.
+ * @return The checksum of the preceding data and @a bytes.
+ */
+hi_target("sse,sse2,ssse3")
+[[nodiscard]] inline uint32_t adler32_ssse3(std::span<std::byte const> bytes, uint32_t adler = 1) noexcept
+{
+    constexpr auto block_size = uint32_t{32};
+
+    auto a = adler & 0xffff;
+    auto b = adler >> 16;
+
+    // The weight of each byte in the second sum, relative to the end of the block.
+    auto const weights1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+    auto const weights2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+    auto const ones = _mm_set1_epi16(1);
+    auto const zero = _mm_setzero_si128();
+
+    while (bytes.size() >= block_size) {
+        // Delay the modulo until just before the sums may overflow.
+        auto const nr_blocks = std::min(bytes.size(), detail::adler32_max_run) / block_size;
+        auto const *ptr = reinterpret_cast<__m128i const *>(bytes.data());
+
+        // The first sum before each block is added to the second sum for each byte in the block.
+        auto a_before_blocks = _mm_setzero_si128();
+        auto a_blocks = _mm_setzero_si128();
+        auto b_blocks = _mm_setzero_si128();
+        for (auto i = 0_uz; i != nr_blocks; ++i) {
+            auto const bytes1 = _mm_loadu_si128(ptr++);
+            auto const bytes2 = _mm_loadu_si128(ptr++);
+
+            a_before_blocks = _mm_add_epi32(a_before_blocks, a_blocks);
+            a_blocks = _mm_add_epi32(a_blocks, _mm_sad_epu8(bytes1, zero));
+            a_blocks = _mm_add_epi32(a_blocks, _mm_sad_epu8(bytes2, zero));
+            b_blocks = _mm_add_epi32(b_blocks, _mm_madd_epi16(_mm_maddubs_epi16(bytes1, weights1), ones));
+            b_blocks = _mm_add_epi32(b_blocks, _mm_madd_epi16(_mm_maddubs_epi16(bytes2, weights2), ones));
+        }
+
+        // The sums may overflow temporarily, but the final sums fit in 32 bits.
+        b += a * narrow_cast<uint32_t>(nr_blocks * block_size);
+        b += detail::adler32_horizontal_sum(a_before_blocks) * block_size;
+        b += detail::adler32_horizontal_sum(b_blocks);
+        a += detail::adler32_horizontal_sum(a_blocks);
+        a %= detail::adler32_modulo;
+        b %= detail::adler32_modulo;
+        bytes = bytes.subspan(nr_blocks * block_size);
+    }
+
+    return adler32_generic(bytes, (b << 16) | a);
+}
+#endif
+
+/** Calculate the Adler-32 checksum of a byte string.
+ *
+ * This is the checksum used by zlib. The fastest implementation
+ * for the current CPU is selected at runtime.
+ *
+ * @param bytes The data to calculate the checksum over.
+ * @param adler The checksum of the data preceding @a bytes, to calculate a checksum in pieces.
+ * @return The checksum of the preceding data and @a bytes.
+ */
+hi_export [[nodiscard]] constexpr uint32_t adler32(std::span<std::byte const> bytes, uint32_t adler = 1) noexcept
+{
+    if (not std::is_constant_evaluated()) {
+#if HI_HAS_X86
+        if (bytes.size() >= 64 and has_ssse3()) {
+            return adler32_ssse3(bytes, adler);
+        }
+#endif
+    }
+
+    return adler32_generic(bytes, adler);
+}
+
+}} // namespace hi::v1
@@ -0,0 +1,83 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "adler32.hpp"
+#include "../container/container.hpp"
+#include <hikotest/hikotest.hpp>
+#include <span>
+
+TEST_SUITE(adler32_suite) {
+
+/** Calculate the Adler-32 one byte at a time with a modulo after each byte, as a reference.
+ */
+[[nodiscard]] static uint32_t adler32_reference(std::span<std::byte const> bytes)
+{
+    auto a = uint32_t{1};
+    auto b = uint32_t{0};
+    for (auto const c : bytes) {
+        a = (a + std::to_integer<uint32_t>(c)) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+TEST_CASE(check_value)
+{
+    REQUIRE(hi::adler32(hi::to_bstring("Wikipedia")) == 0x11e6'0398);
+    REQUIRE(hi::adler32({}) == 1);
+
+    static_assert(hi::adler32_generic({}) == 1);
+}
+
+TEST_CASE(generic)
+{
+    // All bytes 0xff maximizes the sums, to check for overflow.
+    auto const bytes = hi::bstring(20'000, std::byte{0xff});
+    for (auto size : {size_t{0}, size_t{1}, size_t{5551}, size_t{5552}, size_t{5553}, size_t{20'000}}) {
+        auto const span = std::span<std::byte const>{bytes}.first(size);
+        REQUIRE(hi::adler32_generic(span) == adler32_reference(span));
+    }
+}
+
+#if HI_HAS_X86
+TEST_CASE(ssse3)
+{
+    if (not hi::has_ssse3()) {
+        return;
+    }
+
+    auto bytes = hi::bstring{};
+    auto x = uint32_t{1};
+    for (size_t i = 0; i != 1000; ++i) {
+        x = x * 1'103'515'245 + 12'345;
+        bytes.push_back(static_cast<std::byte>(x >> 24));
+    }
+
+    for (size_t offset = 0; offset != 16; ++offset) {
+        for (size_t size = 0; size != bytes.size() - offset; ++size) {
+            auto const span = std::span<std::byte const>{bytes}.subspan(offset, size);
+            REQUIRE(hi::adler32_ssse3(span) == hi::adler32_generic(span));
+        }
+    }
+
+    auto const ones = hi::bstring(20'000, std::byte{0xff});
+    for (auto size : {size_t{5551}, size_t{5552}, size_t{5553}, size_t{20'000}}) {
+        auto const span = std::span<std::byte const>{ones}.first(size);
+        REQUIRE(hi::adler32_ssse3(span) == adler32_reference(span));
+    }
+}
+#endif
+
+TEST_CASE(in_pieces)
+{
+    auto const bytes = hi::bstring(10'000, std::byte{0xa5});
+    auto const expected = hi::adler32(bytes);
+
+    for (auto split : {size_t{0}, size_t{1}, size_t{63}, size_t{64}, size_t{5552}, size_t{9999}}) {
+        auto const span = std::span<std::byte const>{bytes};
+        REQUIRE(hi::adler32(span.subspan(split), hi::adler32(span.first(split))) == expected);
+    }
+}
+
+};
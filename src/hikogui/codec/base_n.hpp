@@ -7,14 +7,22 @@
 #include "../container/container.hpp"
 #include "../utility/utility.hpp"
 #include "../macros.hpp"
+#include <hikocpu/hikocpu.hpp>
 #include <span>
 #include <cstdint>
+#include <cstddef>
 #include <array>
 #include <string>
 #include <string_view>
 #include <bit>
 #include <iterator>
 #include <format>
+#include <algorithm>
+#include <cstring>
+
+#if HI_HAS_X86
+#include <immintrin.h>
+#endif
 
 hi_export_module(hikogui.codec.base_n);
 
@@ -113,6 +121,432 @@ constexpr auto base85_rfc1924_alphabet =
 constexpr auto base85_btoa_alphabet =
     base_n_alphabet{"!\"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\\]^_`abcdefghijklmnopqrstu"};
 
+
+/** Check if the alphabet is "A-Za-z0-9" followed by two other characters.
+ *
+ * This is the layout of base64 and base64url which is handled by the SIMD
+ * encoder and decoder.
+ */
+[[nodiscard]] constexpr bool base64_is_simd_alphabet(base_n_alphabet const& alphabet) noexcept
+{
+    constexpr auto prefix = std::string_view{"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789"};
+
+    if (alphabet.radix != 64) {
+        return false;
+    }
+    for (auto i = 0_uz; i != prefix.size(); ++i) {
+        if (alphabet.char_from_int_table[i] != prefix[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Check if the alphabet is case-insensitive hexadecimal.
+ *
+ * This is the layout of base16 which is handled by the SIMD encoder and decoder.
+ */
+[[nodiscard]] constexpr bool base16_is_simd_alphabet(base_n_alphabet const& alphabet) noexcept
+{
+    constexpr auto digits = std::string_view{"0123456789ABCDEF"};
+
+    if (alphabet.radix != 16 or not alphabet.case_insensitive) {
+        return false;
+    }
+    for (auto i = 0_uz; i != digits.size(); ++i) {
+        if (alphabet.char_from_int_table[i] != digits[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#if HI_HAS_X86
+/** Check which characters are in the range [first, last].
+ *
+ * Characters 0x80-0xff are negative and never in range.
+ */
+hi_target("sse,sse2")
+[[nodiscard]] hi_force_inline inline __m128i base_n_in_range_sse2(__m128i chars, char first, char last) noexcept
+{
+    return _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8(first - 1)), _mm_cmpgt_epi8(_mm_set1_epi8(last + 1), chars));
+}
+
+/** Check which characters are in the range [first, last].
+ *
+ * Characters 0x80-0xff are negative and never in range.
+ */
+hi_target("sse,sse2,avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i base_n_in_range_avx2(__m256i chars, char first, char last) noexcept
+{
+    return _mm256_and_si256(
+        _mm256_cmpgt_epi8(chars, _mm256_set1_epi8(first - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8(last + 1), chars));
+}
+
+/** Convert 3 byte groups into 4 six-bit indices.
+ *
+ * The bytes of each group must have been shuffled into position "1 0 2 1".
+ */
+hi_target("sse,sse2")
+[[nodiscard]] hi_force_inline inline __m128i base64_indices_sse2(__m128i x) noexcept
+{
+    auto const ac = _mm_mulhi_epu16(_mm_and_si128(x, _mm_set1_epi32(0x0fc0'fc00)), _mm_set1_epi32(0x0400'0040));
+    auto const bd = _mm_mullo_epi16(_mm_and_si128(x, _mm_set1_epi32(0x003f'03f0)), _mm_set1_epi32(0x0100'0010));
+    return _mm_or_si128(ac, bd);
+}
+
+/** Convert six-bit indices into characters of a "A-Za-z0-9" alphabet.
+ */
+hi_target("sse,sse2,ssse3")
+[[nodiscard]] hi_force_inline inline __m128i base64_chars_ssse3(__m128i indices, __m128i offsets) noexcept
+{
+    // Select an offset: 0 for a-z, 1-10 for 0-9, 11 and 12 for the last two characters, 13 for A-Z.
+    auto selector = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    selector = _mm_or_si128(selector, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, selector), indices);
+}
+
+hi_target("sse,sse2,ssse3")
+[[nodiscard]] hi_force_inline inline __m128i base64_offsets_ssse3(char c62, char c63) noexcept
+{
+    return _mm_setr_epi8(
+        'a' - 26,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        '0' - 52,
+        static_cast<char>(c62 - 62),
+        static_cast<char>(c63 - 63),
+        'A',
+        0,
+        0);
+}
+
+/** Encode base64, 12 bytes into 16 characters at a time using SSSE3.
+ *
+ * @param src The bytes to encode.
+ * @param size The number of bytes available in @a src.
+ * @param dst The destination for the characters.
+ * @param c62 The character for the value 62.
+ * @param c63 The character for the value 63.
+ * @return The number of bytes that were encoded, a multiple of 3.
+ */
+hi_target("sse,sse2,ssse3")
+[[nodiscard]] inline size_t
+base64_encode_ssse3(std::byte const *src, size_t size, char *dst, char c62, char c63) noexcept
+{
+    auto const offsets = base64_offsets_ssse3(c62, c63);
+    auto const shuffle = _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+    auto const first = src;
+    // 16 bytes are loaded, of which 12 are encoded.
+    for (; size >= 16; src += 12, size -= 12, dst += 16) {
+        auto const bytes = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src)), shuffle);
+        auto const chars = base64_chars_ssse3(base64_indices_sse2(bytes), offsets);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), chars);
+    }
+    return src - first;
+}
+
+/** Encode base64, 24 bytes into 32 characters at a time using AVX2.
+ *
+ * @see base64_encode_ssse3()
+ */
+hi_target("sse,sse2,ssse3,avx,avx2")
+[[nodiscard]] inline size_t
+base64_encode_avx2(std::byte const *src, size_t size, char *dst, char c62, char c63) noexcept
+{
+    auto const offsets = _mm256_broadcastsi128_si256(base64_offsets_ssse3(c62, c63));
+    auto const shuffle = _mm256_setr_epi8(
+        1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+
+    auto const first = src;
+    // Each 128 bit lane loads 16 bytes of which 12 are encoded.
+    for (; size >= 28; src += 24, size -= 24, dst += 32) {
+        auto bytes = _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src)));
+        bytes = _mm256_inserti128_si256(bytes, _mm_loadu_si128(reinterpret_cast<__m128i const *>(src + 12)), 1);
+        bytes = _mm256_shuffle_epi8(bytes, shuffle);
+
+        auto const ac =
+            _mm256_mulhi_epu16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x0fc0'fc00)), _mm256_set1_epi32(0x0400'0040));
+        auto const bd =
+            _mm256_mullo_epi16(_mm256_and_si256(bytes, _mm256_set1_epi32(0x003f'03f0)), _mm256_set1_epi32(0x0100'0010));
+        auto const indices = _mm256_or_si256(ac, bd);
+
+        auto selector = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        selector = _mm256_or_si256(
+            selector, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+        auto const chars = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, selector), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), chars);
+    }
+    return src - first;
+}
+
+/** Convert characters of a "A-Za-z0-9" alphabet into six-bit values.
+ *
+ * @param[out] valid Set to all-ones for each character that is part of the alphabet.
+ * @return The six-bit values.
+ */
+hi_target("sse,sse2")
+[[nodiscard]] hi_force_inline inline __m128i base64_values_sse2(__m128i chars, __m128i c62, __m128i c63, __m128i& valid) noexcept
+{
+    auto const upper = base_n_in_range_sse2(chars, 'A', 'Z');
+    auto const lower = base_n_in_range_sse2(chars, 'a', 'z');
+    auto const digit = base_n_in_range_sse2(chars, '0', '9');
+    auto const is_c62 = _mm_cmpeq_epi8(chars, c62);
+    auto const is_c63 = _mm_cmpeq_epi8(chars, c63);
+    valid = _mm_or_si128(_mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, is_c62)), is_c63);
+
+    auto offset = _mm_and_si128(upper, _mm_set1_epi8(-'A'));
+    offset = _mm_or_si128(offset, _mm_and_si128(lower, _mm_set1_epi8(26 - 'a')));
+    offset = _mm_or_si128(offset, _mm_and_si128(digit, _mm_set1_epi8(52 - '0')));
+    offset = _mm_or_si128(offset, _mm_and_si128(is_c62, _mm_sub_epi8(_mm_set1_epi8(62), c62)));
+    offset = _mm_or_si128(offset, _mm_and_si128(is_c63, _mm_sub_epi8(_mm_set1_epi8(63), c63)));
+    return _mm_add_epi8(chars, offset);
+}
+
+/** Decode base64, 16 characters into 12 bytes at a time using SSSE3.
+ *
+ * Decoding stops at the first group of 16 characters which contains a
+ * character that is not part of the alphabet; like white-space or padding.
+ *
+ * @param src The characters to decode.
+ * @param size The number of characters available in @a src.
+ * @param dst The destination for the bytes.
+ * @param c62 The character for the value 62.
+ * @param c63 The character for the value 63.
+ * @return The number of characters that were decoded, a multiple of 4.
+ */
+hi_target("sse,sse2,ssse3")
+[[nodiscard]] inline size_t
+base64_decode_ssse3(char const *src, size_t size, std::byte *dst, char c62, char c63) noexcept
+{
+    auto const c62_ = _mm_set1_epi8(c62);
+    auto const c63_ = _mm_set1_epi8(c63);
+    auto const shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    auto const first = src;
+    for (; size >= 16; src += 16, size -= 16, dst += 12) {
+        auto valid = _mm_undefined_si128();
+        auto const values = base64_values_sse2(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src)), c62_, c63_, valid);
+        if (_mm_movemask_epi8(valid) != 0xffff) {
+            break;
+        }
+
+        // Merge the four six-bit values into 24 bits, then store the bytes in big-endian order.
+        auto const merged = _mm_madd_epi16(_mm_maddubs_epi16(values, _mm_set1_epi32(0x0140'0140)), _mm_set1_epi32(0x0001'1000));
+        auto const bytes = _mm_shuffle_epi8(merged, shuffle);
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst), bytes);
+        auto const tail = _mm_cvtsi128_si32(_mm_srli_si128(bytes, 8));
+        std::memcpy(dst + 8, &tail, sizeof(tail));
+    }
+    return src - first;
+}
+
+/** Convert characters of a "A-Za-z0-9" alphabet into six-bit values.
+ *
+ * @see base64_values_sse2()
+ */
+hi_target("sse,sse2,avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i
+base64_values_avx2(__m256i chars, __m256i c62, __m256i c63, __m256i& valid) noexcept
+{
+    auto const upper = base_n_in_range_avx2(chars, 'A', 'Z');
+    auto const lower = base_n_in_range_avx2(chars, 'a', 'z');
+    auto const digit = base_n_in_range_avx2(chars, '0', '9');
+    auto const is_c62 = _mm256_cmpeq_epi8(chars, c62);
+    auto const is_c63 = _mm256_cmpeq_epi8(chars, c63);
+    valid = _mm256_or_si256(_mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, is_c62)), is_c63);
+
+    auto offset = _mm256_and_si256(upper, _mm256_set1_epi8(-'A'));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a')));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(is_c62, _mm256_sub_epi8(_mm256_set1_epi8(62), c62)));
+    offset = _mm256_or_si256(offset, _mm256_and_si256(is_c63, _mm256_sub_epi8(_mm256_set1_epi8(63), c63)));
+    return _mm256_add_epi8(chars, offset);
+}
+
+/** Decode base64, 32 characters into 24 bytes at a time using AVX2.
+ *
+ * @see base64_decode_ssse3()
+ */
+hi_target("sse,sse2,ssse3,avx,avx2")
+[[nodiscard]] inline size_t
+base64_decode_avx2(char const *src, size_t size, std::byte *dst, char c62, char c63) noexcept
+{
+    auto const c62_ = _mm256_set1_epi8(c62);
+    auto const c63_ = _mm256_set1_epi8(c63);
+    auto const shuffle = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    auto const first = src;
+    for (; size >= 32; src += 32, size -= 32, dst += 24) {
+        auto valid = _mm256_undefined_si256();
+        auto const values = base64_values_avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(src)), c62_, c63_, valid);
+        if (_mm256_movemask_epi8(valid) != -1) {
+            break;
+        }
+
+        auto const merged =
+            _mm256_madd_epi16(_mm256_maddubs_epi16(values, _mm256_set1_epi32(0x0140'0140)), _mm256_set1_epi32(0x0001'1000));
+        // Each lane holds 12 bytes, move them next to each other.
+        auto const bytes =
+            _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(merged, shuffle), _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm256_castsi256_si128(bytes));
+        _mm_storel_epi64(reinterpret_cast<__m128i *>(dst + 16), _mm256_extracti128_si256(bytes, 1));
+    }
+    return src - first;
+}
+
+/** Encode base16, 16 bytes into 32 characters at a time using SSSE3.
+ *
+ * @param src The bytes to encode.
+ * @param size The number of bytes available in @a src.
+ * @param dst The destination for the characters.
+ * @param digits The 16 characters of the alphabet.
+ * @return The number of bytes that were encoded.
+ */
+hi_target("sse,sse2,ssse3")
+[[nodiscard]] inline size_t base16_encode_ssse3(std::byte const *src, size_t size, char *dst, char const *digits) noexcept
+{
+    auto const digits_ = _mm_loadu_si128(reinterpret_cast<__m128i const *>(digits));
+    auto const mask = _mm_set1_epi8(0x0f);
+
+    auto const first = src;
+    for (; size >= 16; src += 16, size -= 16, dst += 32) {
+        auto const bytes = _mm_loadu_si128(reinterpret_cast<__m128i const *>(src));
+        auto const hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+        auto const lo = _mm_and_si128(bytes, mask);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_shuffle_epi8(digits_, _mm_unpacklo_epi8(hi, lo)));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 16), _mm_shuffle_epi8(digits_, _mm_unpackhi_epi8(hi, lo)));
+    }
+    return src - first;
+}
+
+/** Encode base16, 32 bytes into 64 characters at a time using AVX2.
+ *
+ * @see base16_encode_ssse3()
+ */
+hi_target("sse,sse2,ssse3,avx,avx2")
+[[nodiscard]] inline size_t base16_encode_avx2(std::byte const *src, size_t size, char *dst, char const *digits) noexcept
+{
+    auto const digits_ = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<__m128i const *>(digits)));
+    auto const mask = _mm256_set1_epi8(0x0f);
+
+    auto const first = src;
+    for (; size >= 32; src += 32, size -= 32, dst += 64) {
+        auto const bytes = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(src));
+        auto const hi = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), mask);
+        auto const lo = _mm256_and_si256(bytes, mask);
+        // The unpack works per lane; lo holds bytes 0-7 and 16-23, hi holds bytes 8-15 and 24-31.
+        auto const chars_lo = _mm256_shuffle_epi8(digits_, _mm256_unpacklo_epi8(hi, lo));
+        auto const chars_hi = _mm256_shuffle_epi8(digits_, _mm256_unpackhi_epi8(hi, lo));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute2x128_si256(chars_lo, chars_hi, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 32), _mm256_permute2x128_si256(chars_lo, chars_hi, 0x31));
+    }
+    return src - first;
+}
+
+/** Convert hexadecimal characters into four-bit values.
+ *
+ * @param[out] valid Set to all-ones for each character that is a hexadecimal digit.
+ * @return The four-bit values.
+ */
+hi_target("sse,sse2")
+[[nodiscard]] hi_force_inline inline __m128i base16_values_sse2(__m128i chars, __m128i& valid) noexcept
+{
+    auto const folded = _mm_or_si128(chars, _mm_set1_epi8(0x20));
+    auto const digit = base_n_in_range_sse2(chars, '0', '9');
+    auto const letter = base_n_in_range_sse2(folded, 'a', 'f');
+    valid = _mm_or_si128(digit, letter);
+
+    auto const digit_value = _mm_and_si128(digit, _mm_sub_epi8(chars, _mm_set1_epi8('0')));
+    auto const letter_value = _mm_and_si128(letter, _mm_sub_epi8(folded, _mm_set1_epi8('a' - 10)));
+    return _mm_or_si128(digit_value, letter_value);
+}
+
+/** Decode base16, 32 characters into 16 bytes at a time using SSSE3.
+ *
+ * Decoding stops at the first group of 32 characters which contains a
+ * character that is not a hexadecimal digit.
+ *
+ * @param src The characters to decode.
+ * @param size The number of characters available in @a src.
+ * @param dst The destination for the bytes.
+ * @return The number of characters that were decoded, a multiple of 2.
+ */
+hi_target("sse,sse2,ssse3")
+[[nodiscard]] inline size_t base16_decode_ssse3(char const *src, size_t size, std::byte *dst) noexcept
+{
+    // Multiply the first digit of each pair by 16.
+    auto const weights = _mm_set1_epi16(0x0110);
+
+    auto const first = src;
+    for (; size >= 32; src += 32, size -= 32, dst += 16) {
+        auto valid0 = _mm_undefined_si128();
+        auto valid1 = _mm_undefined_si128();
+        auto const values0 = base16_values_sse2(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src)), valid0);
+        auto const values1 = base16_values_sse2(_mm_loadu_si128(reinterpret_cast<__m128i const *>(src + 16)), valid1);
+        if (_mm_movemask_epi8(_mm_and_si128(valid0, valid1)) != 0xffff) {
+            break;
+        }
+
+        auto const bytes = _mm_packus_epi16(_mm_maddubs_epi16(values0, weights), _mm_maddubs_epi16(values1, weights));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), bytes);
+    }
+    return src - first;
+}
+
+/** Convert hexadecimal characters into four-bit values.
+ *
+ * @see base16_values_sse2()
+ */
+hi_target("sse,sse2,avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i base16_values_avx2(__m256i chars, __m256i& valid) noexcept
+{
+    auto const folded = _mm256_or_si256(chars, _mm256_set1_epi8(0x20));
+    auto const digit = base_n_in_range_avx2(chars, '0', '9');
+    auto const letter = base_n_in_range_avx2(folded, 'a', 'f');
+    valid = _mm256_or_si256(digit, letter);
+
+    auto const digit_value = _mm256_and_si256(digit, _mm256_sub_epi8(chars, _mm256_set1_epi8('0')));
+    auto const letter_value = _mm256_and_si256(letter, _mm256_sub_epi8(folded, _mm256_set1_epi8('a' - 10)));
+    return _mm256_or_si256(digit_value, letter_value);
+}
+
+/** Decode base16, 64 characters into 32 bytes at a time using AVX2.
+ *
+ * @see base16_decode_ssse3()
+ */
+hi_target("sse,sse2,ssse3,avx,avx2")
+[[nodiscard]] inline size_t base16_decode_avx2(char const *src, size_t size, std::byte *dst) noexcept
+{
+    auto const weights = _mm256_set1_epi16(0x0110);
+
+    auto const first = src;
+    for (; size >= 64; src += 64, size -= 64, dst += 32) {
+        auto valid0 = _mm256_undefined_si256();
+        auto valid1 = _mm256_undefined_si256();
+        auto const values0 = base16_values_avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(src)), valid0);
+        auto const values1 = base16_values_avx2(_mm256_loadu_si256(reinterpret_cast<__m256i const *>(src + 32)), valid1);
+        if (_mm256_movemask_epi8(_mm256_and_si256(valid0, valid1)) != -1) {
+            break;
+        }
+
+        // The pack works per lane, reorder the 64 bit parts afterwards.
+        auto const bytes = _mm256_packus_epi16(_mm256_maddubs_epi16(values0, weights), _mm256_maddubs_epi16(values1, weights));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute4x64_epi64(bytes, 0b11'01'10'00));
+    }
+    return src - first;
+}
+#endif
+
 } // namespace detail
 
 template<detail::base_n_alphabet Alphabet, int CharsPerBlock, int BytesPerBlock>
@@ -186,9 +620,13 @@ public:
      * @param bytes A span of bytes to encode.
      * @return The data encoded as a string.
      */
-    constexpr static std::string encode(std::span<std::byte const> bytes) noexcept
+    static std::string encode(std::span<std::byte const> bytes) noexcept
     {
-        return encode(begin(bytes), end(bytes));
+        auto r = std::string{};
+        auto e = encoder{};
+        e.add(bytes, r);
+        e.finish(r);
+        return r;
     }
 
     /** Decodes a UTF-8 string into bytes.
@@ -236,15 +674,247 @@ public:
         return ptr;
     }
 
+    /** Decodes a string into bytes.
+     *
+     * @param str The base-n encoded string; white-space is ignored.
+     * @return The decoded bytes.
+     * @throws parse_error When the string contains invalid characters or
+     *         the last block is incomplete.
+     */
     static bstring decode(std::string_view str)
     {
         auto r = bstring{};
-        auto i = decode(begin(str), end(str), std::back_inserter(r));
-        hi_check(i == end(str), "base-n encoded string not completely decoded");
+        auto d = decoder{};
+        d.add(str, r);
+        d.finish(r);
         return r;
     }
 
+    /** Encode bytes in pieces.
+     *
+     * Large buffers can be encoded in chunks, the output is the same as
+     * when the data was encoded at once.
+     */
+    class encoder {
+    public:
+        /** Encode a chunk of bytes.
+         *
+         * @param bytes The bytes to encode.
+         * @param[out] r The encoded characters are appended to this string.
+         */
+        void add(std::span<std::byte const> bytes, std::string& r) noexcept
+        {
+            auto const *ptr = bytes.data();
+            auto const *const last = ptr + bytes.size();
+
+            // Complete the block started by a previous call.
+            for (; _nr_bytes != 0 and ptr != last; ++ptr) {
+                add_byte(*ptr, r);
+            }
+
+            if constexpr (has_fast_path) {
+                auto const size = narrow_cast<size_t>(last - ptr);
+                auto const offset = r.size();
+                r.resize_and_overwrite(offset + size / bytes_per_block * chars_per_block, [&](char *dst, size_t) {
+                    auto const n = encode_fast(ptr, size, dst + offset);
+                    ptr += n;
+                    return offset + n / bytes_per_block * chars_per_block;
+                });
+            }
+
+            for (; ptr != last; ++ptr) {
+                add_byte(*ptr, r);
+            }
+        }
+
+        /** Encode the last, incomplete, block.
+         *
+         * @param[out] r The encoded characters, including padding, are appended to this string.
+         */
+        void finish(std::string& r) noexcept
+        {
+            if (_nr_bytes != 0) {
+                encode_block(_block, _nr_bytes, std::back_inserter(r));
+                _block = 0;
+                _nr_bytes = 0;
+            }
+        }
+
+    private:
+        long long _block = 0;
+        long long _nr_bytes = 0;
+
+        void add_byte(std::byte byte, std::string& r) noexcept
+        {
+            // Construct a block in big endian.
+            auto const shift = 8 * ((bytes_per_block - 1) - _nr_bytes);
+            _block |= static_cast<long long>(byte) << shift;
+
+            if (++_nr_bytes == bytes_per_block) {
+                encode_block(_block, bytes_per_block, std::back_inserter(r));
+                _block = 0;
+                _nr_bytes = 0;
+            }
+        }
+    };
+
+    /** Decode a string in pieces.
+     *
+     * Large strings can be decoded in chunks, the output is the same as
+     * when the string was decoded at once.
+     */
+    class decoder {
+    public:
+        /** Decode a chunk of characters.
+         *
+         * @param str The characters to decode; white-space is ignored.
+         * @param[out] r The decoded bytes are appended to this byte-string.
+         * @throws parse_error When the string contains invalid characters.
+         */
+        void add(std::string_view str, bstring& r)
+        {
+            auto const *ptr = str.data();
+            auto const *const last = ptr + str.size();
+
+            while (ptr != last) {
+                if constexpr (has_fast_path) {
+                    if (_nr_chars == 0) {
+                        auto const size = narrow_cast<size_t>(last - ptr);
+                        auto const offset = r.size();
+                        r.resize_and_overwrite(offset + size / chars_per_block * bytes_per_block, [&](std::byte *dst, size_t) {
+                            auto const n = decode_fast(ptr, size, dst + offset);
+                            ptr += n;
+                            return offset + n / chars_per_block * bytes_per_block;
+                        });
+                    }
+                }
+
+                // Decode the characters which were rejected by the fast path, like
+                // white-space, up to the next block boundary before trying the fast path again.
+                auto const *const chunk_last = ptr + std::min(last - ptr, std::ptrdiff_t{32});
+                for (; ptr != last and (ptr < chunk_last or _nr_chars != 0); ++ptr) {
+                    add_char(*ptr, r);
+                }
+            }
+        }
+
+        /** Decode the last, incomplete, block.
+         *
+         * @param[out] r The decoded bytes are appended to this byte-string.
+         * @throws parse_error When the number of characters in the last block is invalid.
+         */
+        void finish(bstring& r)
+        {
+            if (_nr_chars != 0) {
+                // pad the block with zeros.
+                for (auto i = _nr_chars; i != chars_per_block; ++i) {
+                    _block *= radix;
+                }
+                decode_block(_block, _nr_chars, std::back_inserter(r));
+                _block = 0;
+                _nr_chars = 0;
+            }
+        }
+
+    private:
+        long long _block = 0;
+        long long _nr_chars = 0;
+
+        void add_char(char c, bstring& r)
+        {
+            auto const digit = int_from_char<long long>(c);
+            if (digit == -1) {
+                // Whitespace is ignored.
+                return;
+            }
+
+            hi_check(digit != -2, "base-n encoded string contains an invalid character");
+            _block *= radix;
+            _block += digit;
+
+            if (++_nr_chars == chars_per_block) {
+                decode_block(_block, chars_per_block, std::back_inserter(r));
+                _block = 0;
+                _nr_chars = 0;
+            }
+        }
+    };
+
 private:
+#if HI_HAS_X86
+    constexpr static bool has_fast_path =
+        detail::base64_is_simd_alphabet(alphabet) or detail::base16_is_simd_alphabet(alphabet);
+#else
+    constexpr static bool has_fast_path = false;
+#endif
+
+    /** Encode whole blocks using the fastest SIMD implementation of the current CPU.
+     *
+     * @param src The bytes to encode.
+     * @param size The number of bytes in @a src.
+     * @param dst The destination for the characters.
+     * @return The number of bytes encoded, a multiple of `bytes_per_block`.
+     */
+    [[nodiscard]] static size_t encode_fast(std::byte const *src, size_t size, char *dst) noexcept
+    {
+        auto n = 0_uz;
+#if HI_HAS_X86
+        if constexpr (detail::base64_is_simd_alphabet(alphabet)) {
+            auto const c62 = alphabet.char_from_int_table[62];
+            auto const c63 = alphabet.char_from_int_table[63];
+            if (has_avx2()) {
+                n = detail::base64_encode_avx2(src, size, dst, c62, c63);
+            }
+            if (has_ssse3()) {
+                n += detail::base64_encode_ssse3(src + n, size - n, dst + n / 3 * 4, c62, c63);
+            }
+
+        } else if constexpr (detail::base16_is_simd_alphabet(alphabet)) {
+            auto const *const digits = alphabet.char_from_int_table.data();
+            if (has_avx2()) {
+                n = detail::base16_encode_avx2(src, size, dst, digits);
+            }
+            if (has_ssse3()) {
+                n += detail::base16_encode_ssse3(src + n, size - n, dst + n * 2, digits);
+            }
+        }
+#endif
+        return n;
+    }
+
+    /** Decode whole blocks using the fastest SIMD implementation of the current CPU.
+     *
+     * @param src The characters to decode.
+     * @param size The number of characters in @a src.
+     * @param dst The destination for the bytes.
+     * @return The number of characters decoded, a multiple of `chars_per_block`.
+     */
+    [[nodiscard]] static size_t decode_fast(char const *src, size_t size, std::byte *dst) noexcept
+    {
+        auto n = 0_uz;
+#if HI_HAS_X86
+        if constexpr (detail::base64_is_simd_alphabet(alphabet)) {
+            auto const c62 = alphabet.char_from_int_table[62];
+            auto const c63 = alphabet.char_from_int_table[63];
+            if (has_avx2()) {
+                n = detail::base64_decode_avx2(src, size, dst, c62, c63);
+            }
+            if (has_ssse3()) {
+                n += detail::base64_decode_ssse3(src + n, size - n, dst + n / 4 * 3, c62, c63);
+            }
+
+        } else if constexpr (detail::base16_is_simd_alphabet(alphabet)) {
+            if (has_avx2()) {
+                n = detail::base16_decode_avx2(src, size, dst);
+            }
+            if (has_ssse3()) {
+                n += detail::base16_decode_ssse3(src + n, size - n, dst + n / 2);
+            }
+        }
+#endif
+        return n;
+    }
+
     template<typename ItOut>
     static void encode_block(long long block, long long nr_bytes, ItOut output) noexcept
     {
@@ -4,7 +4,12 @@
 
 #include "base_n.hpp"
 #include "../container/container.hpp"
+#include "../algorithm/algorithm.hpp"
 #include <hikotest/hikotest.hpp>
+#include <string>
+#include <string_view>
+#include <iterator>
+#include <cstdint>
 
 TEST_SUITE(base_n_suite) {
 
@@ -19,6 +24,15 @@ TEST_CASE(base16_encode)
     REQUIRE(hi::base16::encode(hi::to_bstring("foobar")) == "666F6F626172");
 }
 
+TEST_CASE(base16_decode)
+{
+    REQUIRE(hi::base16::decode("") == hi::to_bstring(""));
+    REQUIRE(hi::base16::decode("66") == hi::to_bstring("f"));
+    REQUIRE(hi::base16::decode("666F6F626172") == hi::to_bstring("foobar"));
+    REQUIRE(hi::base16::decode("666f6F62 6172") == hi::to_bstring("foobar"));
+    REQUIRE_THROWS(hi::base16::decode("666G"), hi::parse_error);
+}
+
 TEST_CASE(base64_encode)
 {
     REQUIRE(hi::base64::encode(hi::to_bstring("")) == "");
@@ -55,4 +69,89 @@ TEST_CASE(base64_decode)
     REQUIRE_THROWS(hi::base64::decode("SGVsbG8g,V29ybGQK"), hi::parse_error);
 }
 
+[[nodiscard]] static hi::bstring make_bytes(size_t size)
+{
+    auto r = hi::bstring{};
+    auto x = uint32_t{1};
+    for (auto i = size_t{0}; i != size; ++i) {
+        x = x * 1'103'515'245 + 12'345;
+        r.push_back(static_cast<std::byte>(x >> 24));
+    }
+    return r;
+}
+
+template<typename Codec>
+static void check_large(bool mixed_case)
+{
+    auto const bytes = make_bytes(1000);
+    for (auto size = size_t{0}; size < bytes.size(); size += 1 + size / 8) {
+        auto const span = std::span<std::byte const>{bytes}.first(size);
+        auto const expected = hi::bstring{span.begin(), span.end()};
+
+        // The fast path must give the same result as the iterator based encoder.
+        auto const str = Codec::encode(span);
+        REQUIRE(str == Codec::encode(span.begin(), span.end()));
+        REQUIRE(Codec::decode(str) == expected);
+
+        auto const lower = hi::to_lower(str);
+        if (mixed_case) {
+            REQUIRE(Codec::decode(lower) == expected);
+        }
+
+        // Line breaks, as in MIME.
+        auto wrapped = std::string{};
+        for (auto i = size_t{0}; i < str.size(); i += 76) {
+            wrapped += str.substr(i, 76);
+            wrapped += "\r\n";
+        }
+        REQUIRE(Codec::decode(wrapped) == expected);
+
+        // An invalid character anywhere in the string.
+        if (not str.empty()) {
+            auto invalid = str;
+            invalid[invalid.size() * 2 / 3] = ',';
+            REQUIRE_THROWS(Codec::decode(invalid), hi::parse_error);
+        }
+    }
+}
+
+TEST_CASE(base16_large)
+{
+    check_large<hi::base16>(true);
+}
+
+TEST_CASE(base64_large)
+{
+    check_large<hi::base64>(false);
+}
+
+TEST_CASE(base64url_large)
+{
+    check_large<hi::base64url>(false);
+}
+
+TEST_CASE(base64_streaming)
+{
+    auto const bytes = make_bytes(1000);
+    auto const expected = hi::base64::encode(bytes);
+
+    for (auto split : {size_t{0}, size_t{1}, size_t{2}, size_t{100}, size_t{511}, size_t{999}}) {
+        auto const span = std::span<std::byte const>{bytes};
+
+        auto str = std::string{};
+        auto encoder = hi::base64::encoder{};
+        encoder.add(span.first(split), str);
+        encoder.add(span.subspan(split), str);
+        encoder.finish(str);
+        REQUIRE(str == expected);
+
+        auto decoded = hi::bstring{};
+        auto decoder = hi::base64::decoder{};
+        decoder.add(std::string_view{expected}.substr(0, split), decoded);
+        decoder.add(std::string_view{expected}.substr(split), decoded);
+        decoder.finish(decoded);
+        REQUIRE(decoded == bytes);
+    }
+}
+
 };
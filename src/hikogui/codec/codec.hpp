@@ -1,15 +1,22 @@
 
 #pragma once
 
+#include "adler32.hpp" // export
 #include "base_n.hpp" // export
 #include "BON8.hpp" // export
+#include "crc32.hpp" // export
 #include "datum.hpp" // export
+#include "datum_document.hpp" // export
+#include "deflate.hpp" // export
 #include "gzip.hpp" // export
 #include "huffman.hpp" // export
 #include "indent.hpp" // export
+#include "indexed_datum.hpp" // export
 #include "inflate.hpp" // export
 #include "JSON.hpp" // export
+#include "JSON_tape.hpp" // export
 #include "jsonpath.hpp" // export
+#include "jsonpath_plan.hpp" // export
 #include "pickle.hpp" // export
 #include "png.hpp" // export
 #include "SHA2.hpp" // export
@@ -0,0 +1,199 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <hikocpu/hikocpu.hpp>
+#include <span>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#if HI_HAS_X86
+#include <immintrin.h>
+#endif
+
+hi_export_module(hikogui.codec.crc32);
+
+hi_export namespace hi { inline namespace v1 {
+namespace detail {
+
+/** The reflected CRC-32 polynomial as used by gzip, png and ethernet.
+ */
+constexpr uint32_t crc32_polynomial = 0xedb8'8320;
+
+/** Tables for calculating the CRC-32 16 bytes at a time.
+ *
+ * `crc32_tables[0]` is the normal byte-wise table. `crc32_tables[i]` is the CRC of
+ * a byte followed by @a i zero bytes.
+ */
+constexpr auto crc32_tables = []() {
+    auto r = std::array<std::array<uint32_t, 256>, 16>{};
+
+    for (auto i = 0_uz; i != 256; ++i) {
+        auto crc = narrow_cast<uint32_t>(i);
+        for (auto j = 0; j != 8; ++j) {
+            crc = (crc >> 1) ^ ((crc & 1) ? crc32_polynomial : 0);
+        }
+        r[0][i] = crc;
+    }
+
+    for (auto i = 0_uz; i != 256; ++i) {
+        for (auto j = 1_uz; j != r.size(); ++j) {
+            r[j][i] = r[0][r[j - 1][i] & 0xff] ^ (r[j - 1][i] >> 8);
+        }
+    }
+
+    return r;
+}();
+
+} // namespace detail
+
+/** Calculate the CRC-32 of a byte string.
+ *
+ * This version handles 16 bytes at a time using slicing-by-16 tables.
+ *
+ * @param bytes The data to calculate the CRC over.
+ * @param crc The CRC of the data preceding @a bytes.
+ * @return The CRC of the preceding data and @a bytes.
+ */
+hi_export [[nodiscard]] constexpr uint32_t crc32_generic(std::span<std::byte const> bytes, uint32_t crc = 0) noexcept
+{
+    auto const& t = detail::crc32_tables;
+
+    auto const byte = [&](std::size_t i) {
+        return std::to_integer<uint32_t>(bytes[i]);
+    };
+
+    crc = ~crc;
+    while (bytes.size() >= 16) {
+        auto const x = crc ^ (byte(0) | (byte(1) << 8) | (byte(2) << 16) | (byte(3) << 24));
+        crc = t[15][x & 0xff] ^ t[14][(x >> 8) & 0xff] ^ t[13][(x >> 16) & 0xff] ^ t[12][x >> 24] ^ t[11][byte(4)] ^
+            t[10][byte(5)] ^ t[9][byte(6)] ^ t[8][byte(7)] ^ t[7][byte(8)] ^ t[6][byte(9)] ^ t[5][byte(10)] ^
+            t[4][byte(11)] ^ t[3][byte(12)] ^ t[2][byte(13)] ^ t[1][byte(14)] ^ t[0][byte(15)];
+        bytes = bytes.subspan(16);
+    }
+
+    for (auto const c : bytes) {
+        crc = t[0][(crc ^ std::to_integer<uint32_t>(c)) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+#if HI_HAS_X86
+namespace detail {
+
+/** Fold a 128 bit remainder over 128 bits of data.
+ *
+ * @param x The remainder to fold.
+ * @param k The folding constants for the distance to @a data.
+ * @param data The data to fold into.
+ * @return The new remainder.
+ */
+hi_target("sse,sse2,pclmul")
+[[nodiscard]] hi_force_inline inline __m128i crc32_fold(__m128i x, __m128i k, __m128i data) noexcept
+{
+    auto const low = _mm_clmulepi64_si128(x, k, 0x00);
+    auto const high = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(low, high), data);
+}
+
+} // namespace detail
+
+/** Calculate the CRC-32 of a byte string using carry-less multiplication.
+ *
+ * Four 128 bit lanes are folded in parallel over 64 bytes at a time, then reduced
+ * with a Barrett reduction. See Intel's "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction".
+ *
+ * @note The SSE4.2 `crc32` instruction is not used, it calculates the CRC-32C
+ *       (Castagnoli) which is a different polynomial from the one used by gzip and png.
+ * @param bytes The data to calculate the CRC over.
+ * @param crc The CRC of the data preceding @a bytes.
+ * @return The CRC of the preceding data and @a bytes.
+ */
+hi_target("sse,sse2,sse4.1,pclmul")
+[[nodiscard]] inline uint32_t crc32_pclmul(std::span<std::byte const> bytes, uint32_t crc = 0) noexcept
+{
+    if (bytes.size() < 64) {
+        return crc32_generic(bytes, crc);
+    }
+
+    // x^(4*128+32) mod P, x^(4*128-32) mod P
+    auto const k1k2 = _mm_set_epi64x(0x01'c6e4'1596, 0x01'5444'2bd4);
+    // x^(128+32) mod P, x^(128-32) mod P
+    auto const k3k4 = _mm_set_epi64x(0x00'ccaa'009e, 0x01'7519'97d0);
+    // x^64 mod P
+    auto const k5 = _mm_set_epi64x(0, 0x01'63cd'6124);
+    // The polynomial P and its Barrett constant mu.
+    auto const poly_mu = _mm_set_epi64x(0x01'f701'1641, 0x01'db71'0641);
+    auto const mask32 = _mm_setr_epi32(-1, 0, -1, 0);
+
+    auto const *ptr = reinterpret_cast<__m128i const *>(bytes.data());
+    auto const nr_blocks = bytes.size() / 16;
+    auto const *const end = ptr + nr_blocks;
+
+    auto x0 = _mm_xor_si128(_mm_loadu_si128(ptr), _mm_cvtsi32_si128(static_cast<int>(~crc)));
+    auto x1 = _mm_loadu_si128(ptr + 1);
+    auto x2 = _mm_loadu_si128(ptr + 2);
+    auto x3 = _mm_loadu_si128(ptr + 3);
+    ptr += 4;
+
+    while (end - ptr >= 4) {
+        x0 = detail::crc32_fold(x0, k1k2, _mm_loadu_si128(ptr));
+        x1 = detail::crc32_fold(x1, k1k2, _mm_loadu_si128(ptr + 1));
+        x2 = detail::crc32_fold(x2, k1k2, _mm_loadu_si128(ptr + 2));
+        x3 = detail::crc32_fold(x3, k1k2, _mm_loadu_si128(ptr + 3));
+        ptr += 4;
+    }
+
+    // Fold the four lanes into one, then fold the rest of the 16 byte blocks.
+    x0 = detail::crc32_fold(x0, k3k4, x1);
+    x0 = detail::crc32_fold(x0, k3k4, x2);
+    x0 = detail::crc32_fold(x0, k3k4, x3);
+    while (ptr != end) {
+        x0 = detail::crc32_fold(x0, k3k4, _mm_loadu_si128(ptr++));
+    }
+
+    // Fold 128 bits to 64 bits.
+    auto t = _mm_clmulepi64_si128(x0, k3k4, 0x10);
+    x0 = _mm_xor_si128(_mm_srli_si128(x0, 8), t);
+    t = _mm_srli_si128(x0, 4);
+    x0 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(x0, mask32), k5, 0x00), t);
+
+    // Barrett reduction to 32 bits.
+    t = _mm_clmulepi64_si128(_mm_and_si128(x0, mask32), poly_mu, 0x10);
+    t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), poly_mu, 0x00);
+    crc = ~static_cast<uint32_t>(_mm_extract_epi32(_mm_xor_si128(x0, t), 1));
+
+    return crc32_generic(bytes.subspan(nr_blocks * 16), crc);
+}
+#endif
+
+/** Calculate the CRC-32 of a byte string.
+ *
+ * This is the CRC-32 used by gzip and png. The fastest implementation
+ * for the current CPU is selected at runtime.
+ *
+ * @param bytes The data to calculate the CRC over.
+ * @param crc The CRC of the data preceding @a bytes, to calculate a CRC in pieces.
+ * @return The CRC of the preceding data and @a bytes.
+ */
+hi_export [[nodiscard]] constexpr uint32_t crc32(std::span<std::byte const> bytes, uint32_t crc = 0) noexcept
+{
+    if (not std::is_constant_evaluated()) {
+#if HI_HAS_X86
+        if (bytes.size() >= 64 and has_pclmul() and has_sse4_1()) {
+            return crc32_pclmul(bytes, crc);
+        }
+#endif
+    }
+
+    return crc32_generic(bytes, crc);
+}
+
+}} // namespace hi::v1
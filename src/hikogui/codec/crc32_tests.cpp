@@ -0,0 +1,84 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "crc32.hpp"
+#include "../container/container.hpp"
+#include <hikotest/hikotest.hpp>
+#include <span>
+
+TEST_SUITE(crc32_suite) {
+
+/** Calculate the CRC-32 one bit at a time, as a reference.
+ */
+[[nodiscard]] static uint32_t crc32_bitwise(std::span<std::byte const> bytes)
+{
+    auto crc = ~uint32_t{0};
+    for (auto const c : bytes) {
+        crc ^= std::to_integer<uint32_t>(c);
+        for (auto i = 0; i != 8; ++i) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xedb8'8320 : 0);
+        }
+    }
+    return ~crc;
+}
+
+[[nodiscard]] static hi::bstring make_bytes(size_t size)
+{
+    auto r = hi::bstring{};
+    auto x = uint32_t{1};
+    for (size_t i = 0; i != size; ++i) {
+        x = x * 1'103'515'245 + 12'345;
+        r.push_back(static_cast<std::byte>(x >> 24));
+    }
+    return r;
+}
+
+TEST_CASE(check_value)
+{
+    auto const check = hi::to_bstring("123456789");
+    REQUIRE(hi::crc32(check) == 0xcbf4'3926);
+    REQUIRE(hi::crc32_generic(check) == 0xcbf4'3926);
+    REQUIRE(hi::crc32({}) == 0);
+
+    static_assert(hi::crc32_generic({}) == 0);
+}
+
+TEST_CASE(generic)
+{
+    auto const bytes = make_bytes(1000);
+    for (size_t size = 0; size != bytes.size(); ++size) {
+        auto const span = std::span<std::byte const>{bytes}.first(size);
+        REQUIRE(hi::crc32_generic(span) == crc32_bitwise(span));
+    }
+}
+
+#if HI_HAS_X86
+TEST_CASE(pclmul)
+{
+    if (not hi::has_pclmul() or not hi::has_sse4_1()) {
+        return;
+    }
+
+    auto const bytes = make_bytes(1000);
+    for (size_t offset = 0; offset != 16; ++offset) {
+        for (size_t size = 0; size != bytes.size() - offset; ++size) {
+            auto const span = std::span<std::byte const>{bytes}.subspan(offset, size);
+            REQUIRE(hi::crc32_pclmul(span) == hi::crc32_generic(span));
+        }
+    }
+}
+#endif
+
+TEST_CASE(in_pieces)
+{
+    auto const bytes = make_bytes(5000);
+    auto const expected = hi::crc32(bytes);
+
+    for (auto split : {size_t{0}, size_t{1}, size_t{63}, size_t{64}, size_t{1000}, size_t{4999}}) {
+        auto const span = std::span<std::byte const>{bytes};
+        REQUIRE(hi::crc32(span.subspan(split), hi::crc32(span.first(split))) == expected);
+    }
+}
+
+};
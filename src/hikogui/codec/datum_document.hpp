@@ -0,0 +1,1027 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "../file/file.hpp"
+#include "../utility/utility.hpp"
+#include "datum.hpp"
+#include "jsonpath.hpp"
+#include "JSON.hpp"
+#include "JSON_tape.hpp"
+#include "BON8.hpp"
+#include "../macros.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+hi_export_module(hikogui.codec.datum_document);
+
+hi_export namespace hi { inline namespace v1 {
+
+/** A read-only document of datum values stored in a single allocation.
+ *
+ * A `datum` allocates each string, vector and map separately, which makes
+ * loading large configuration and theme files dominated by the allocator. A
+ * `datum_document` is built once from a parsed JSON or BON8 document into a single
+ * arena:
+ *  - Each value is a fixed size `node`.
+ *  - The elements of an array are stored contiguously.
+ *  - The members of an object are stored as a flat array of key/value pairs
+ *    sorted by key; looking up a key is a binary search.
+ *  - Strings are interned; each unique string is stored once, after the nodes.
+ *
+ * The nodes have the same read API as a `datum`: `holds_alternative()`, `get()`,
+ * `get_if()`, `operator[]`, `size()` and jsonpath queries through `find()`.
+ * Strings are returned as `std::string_view`.
+ */
+hi_export class datum_document {
+public:
+    class node;
+
+    /** A member of an object; the key is a string node.
+     */
+    using member_type = std::pair<node, node>;
+
+    /** A value in the document.
+     *
+     * Nodes are only valid for the lifetime of the document that contains them.
+     */
+    class node {
+    public:
+        enum class tag_type : uint8_t { null, boolean, integral, floating_point, string, vector, map };
+
+        constexpr node() noexcept = default;
+        constexpr node(node const&) noexcept = default;
+        constexpr node& operator=(node const&) noexcept = default;
+
+        constexpr explicit node(std::nullptr_t) noexcept {}
+
+        constexpr explicit node(bool value) noexcept : _tag(tag_type::boolean)
+        {
+            _value._bool = value;
+        }
+
+        constexpr explicit node(long long value) noexcept : _tag(tag_type::integral)
+        {
+            _value._long_long = value;
+        }
+
+        constexpr explicit node(double value) noexcept : _tag(tag_type::floating_point)
+        {
+            _value._double = value;
+        }
+
+        [[nodiscard]] constexpr tag_type tag() const noexcept
+        {
+            return _tag;
+        }
+
+        [[nodiscard]] constexpr char const* type_name() const noexcept
+        {
+            switch (_tag) {
+            case tag_type::null:
+                return "null";
+            case tag_type::boolean:
+                return "bool";
+            case tag_type::integral:
+                return "int";
+            case tag_type::floating_point:
+                return "float";
+            case tag_type::string:
+                return "string";
+            case tag_type::vector:
+                return "vector";
+            case tag_type::map:
+                return "map";
+            default:
+                hi_no_default();
+            }
+        }
+
+        /** The number of elements of a vector, members of a map or characters of a string.
+         */
+        [[nodiscard]] constexpr std::size_t size() const
+        {
+            switch (_tag) {
+            case tag_type::string:
+                return _value._string.size();
+            case tag_type::vector:
+            case tag_type::map:
+                return _size;
+            default:
+                throw std::domain_error(std::format("Can not evaluate {}.size()", type_name()));
+            }
+        }
+
+        [[nodiscard]] constexpr bool empty() const
+        {
+            return size() == 0;
+        }
+
+        /** The elements of a vector, or an empty span for other types.
+         */
+        [[nodiscard]] constexpr std::span<node const> elements() const noexcept
+        {
+            if (_tag == tag_type::vector) {
+                return {_value._vector, _size};
+            } else {
+                return {};
+            }
+        }
+
+        /** The members of a map sorted by key, or an empty span for other types.
+         */
+        [[nodiscard]] constexpr std::span<member_type const> items() const noexcept
+        {
+            if (_tag == tag_type::map) {
+                return {_value._map, _size};
+            } else {
+                return {};
+            }
+        }
+
+        [[nodiscard]] constexpr node const* begin() const noexcept
+        {
+            return elements().data();
+        }
+
+        [[nodiscard]] constexpr node const* end() const noexcept
+        {
+            auto const tmp = elements();
+            return tmp.data() + tmp.size();
+        }
+
+        /** Check if a map contains a key.
+         */
+        [[nodiscard]] constexpr bool contains(std::string_view key) const noexcept
+        {
+            return find_member(key) != nullptr;
+        }
+
+        /** Get an element of a vector.
+         *
+         * @param index The index of the element, a negative index counts from the end.
+         * @throws std::overflow_error When the index is beyond the bounds of the vector.
+         * @throws std::domain_error When this node is not a vector.
+         */
+        template<numeric_integral T>
+        [[nodiscard]] constexpr node const& operator[](T index) const
+        {
+            if (_tag != tag_type::vector) {
+                throw std::domain_error(std::format("Can not evaluate {}[{}]", type_name(), index));
+            }
+
+            auto index_ = static_cast<long long>(index);
+            if (index_ < 0) {
+                index_ += _size;
+            }
+            if (index_ < 0 or index_ >= _size) {
+                throw std::overflow_error(std::format("Index {} beyond bounds of vector", index));
+            }
+            return _value._vector[index_];
+        }
+
+        /** Get the value of a member of a map.
+         *
+         * @param key The key of the member.
+         * @throws std::overflow_error When the key is not found in the map.
+         * @throws std::domain_error When this node is not a map.
+         */
+        [[nodiscard]] constexpr node const& operator[](std::string_view key) const
+        {
+            if (_tag != tag_type::map) {
+                throw std::domain_error(std::format("Can not evaluate {}[\"{}\"]", type_name(), key));
+            }
+
+            if (auto const* r = find_member(key)) {
+                return *r;
+            }
+            throw std::overflow_error(std::format("Key \"{}\" not found in map", key));
+        }
+
+        [[nodiscard]] constexpr node const& operator[](char const* key) const
+        {
+            return (*this)[std::string_view{key}];
+        }
+
+        template<std::floating_point T>
+        constexpr explicit operator T() const
+        {
+            switch (_tag) {
+            case tag_type::floating_point:
+                return static_cast<T>(_value._double);
+            case tag_type::integral:
+                return static_cast<T>(_value._long_long);
+            case tag_type::boolean:
+                return static_cast<T>(_value._bool);
+            default:
+                throw std::domain_error(std::format("Can't convert {} to floating point", type_name()));
+            }
+        }
+
+        template<numeric_integral T>
+        constexpr explicit operator T() const
+        {
+            long long r = 0;
+            if (_tag == tag_type::integral) {
+                r = _value._long_long;
+            } else if (_tag == tag_type::boolean) {
+                r = _value._bool ? 1 : 0;
+            } else {
+                throw std::domain_error(std::format("Can't convert {} to an integral", type_name()));
+            }
+
+            if (not can_narrow_cast<T>(r)) {
+                throw std::overflow_error(std::format("Can't convert {} to an integral, out of range", r));
+            }
+            return narrow_cast<T>(r);
+        }
+
+        constexpr explicit operator std::string_view() const
+        {
+            if (_tag != tag_type::string) {
+                throw std::domain_error(std::format("Can't convert {} to a string", type_name()));
+            }
+            return _value._string;
+        }
+
+        explicit operator std::string() const
+        {
+            return std::string{static_cast<std::string_view>(*this)};
+        }
+
+        /** Copy the node and its children into a datum.
+         */
+        [[nodiscard]] datum to_datum() const
+        {
+            switch (_tag) {
+            case tag_type::null:
+                return datum{nullptr};
+            case tag_type::boolean:
+                return datum{_value._bool};
+            case tag_type::integral:
+                return datum{_value._long_long};
+            case tag_type::floating_point:
+                return datum{_value._double};
+            case tag_type::string:
+                return datum{_value._string};
+            case tag_type::vector:
+                {
+                    auto r = datum::vector_type{};
+                    r.reserve(_size);
+                    for (auto const& item : elements()) {
+                        r.push_back(item.to_datum());
+                    }
+                    return datum{std::move(r)};
+                }
+            case tag_type::map:
+                {
+                    auto r = datum::map_type{};
+                    for (auto const& [key, value] : items()) {
+                        r.emplace_hint(r.end(), key.to_datum(), value.to_datum());
+                    }
+                    return datum{std::move(r)};
+                }
+            default:
+                hi_no_default();
+            }
+        }
+
+        /** Find all nodes matching a json path.
+         *
+         * @param path The json path to use to find the nodes.
+         * @return Pointers to the nodes found.
+         */
+        [[nodiscard]] std::vector<node const*> find(jsonpath const& path) const noexcept
+        {
+            auto r = std::vector<node const*>{};
+            find(path.cbegin(), path.cend(), r);
+            return r;
+        }
+
+        /** Find a node by path.
+         *
+         * @param path The json path to use to find a node. Path must be singular.
+         * @return A pointer to the node found, or nullptr.
+         */
+        [[nodiscard]] node const* find_one(jsonpath const& path) const noexcept
+        {
+            hi_axiom(path.is_singular());
+            return find_one(path.cbegin(), path.cend());
+        }
+
+        [[nodiscard]] constexpr friend bool operator==(node const& lhs, node const& rhs) noexcept
+        {
+            if (lhs._tag != rhs._tag) {
+                return false;
+            }
+
+            switch (lhs._tag) {
+            case tag_type::null:
+                return true;
+            case tag_type::boolean:
+                return lhs._value._bool == rhs._value._bool;
+            case tag_type::integral:
+                return lhs._value._long_long == rhs._value._long_long;
+            case tag_type::floating_point:
+                return lhs._value._double == rhs._value._double;
+            case tag_type::string:
+                return lhs._value._string == rhs._value._string;
+            case tag_type::vector:
+                return std::ranges::equal(lhs.elements(), rhs.elements());
+            case tag_type::map:
+                return std::ranges::equal(lhs.items(), rhs.items());
+            default:
+                hi_no_default();
+            }
+        }
+
+        /** Check if the stored value is of a specific type.
+         *
+         * @tparam T Type to check, one of: `nullptr_t`, `bool`, `long long`, `double`,
+         *           `std::string`, `std::string_view`, `datum::vector_type`, `datum::map_type`.
+         * @param rhs The node to check the value-type of.
+         * @return True if the value-type matches the template parameter @a T
+         */
+        template<typename T>
+        [[nodiscard]] friend constexpr bool holds_alternative(node const& rhs) noexcept
+        {
+            if constexpr (std::is_same_v<T, double>) {
+                return rhs._tag == tag_type::floating_point;
+            } else if constexpr (std::is_same_v<T, long long>) {
+                return rhs._tag == tag_type::integral;
+            } else if constexpr (std::is_same_v<T, bool>) {
+                return rhs._tag == tag_type::boolean;
+            } else if constexpr (std::is_same_v<T, nullptr_t>) {
+                return rhs._tag == tag_type::null;
+            } else if constexpr (std::is_same_v<T, std::string> or std::is_same_v<T, std::string_view>) {
+                return rhs._tag == tag_type::string;
+            } else if constexpr (std::is_same_v<T, datum::vector_type>) {
+                return rhs._tag == tag_type::vector;
+            } else if constexpr (std::is_same_v<T, datum::map_type>) {
+                return rhs._tag == tag_type::map;
+            } else {
+                hi_static_no_default();
+            }
+        }
+
+        /** Get the value of a node.
+         *
+         * It is undefined behavior if the type does not match the stored value.
+         *
+         * @tparam T Type to get, one of: `bool`, `long long`, `double`, `std::string_view`.
+         * @param rhs The node to get the value from.
+         * @return A reference to the value in the node.
+         */
+        template<typename T>
+        [[nodiscard]] friend constexpr T const& get(node const& rhs) noexcept
+        {
+            hi_axiom(holds_alternative<T>(rhs));
+            if constexpr (std::is_same_v<T, double>) {
+                return rhs._value._double;
+            } else if constexpr (std::is_same_v<T, long long>) {
+                return rhs._value._long_long;
+            } else if constexpr (std::is_same_v<T, bool>) {
+                return rhs._value._bool;
+            } else if constexpr (std::is_same_v<T, std::string_view>) {
+                return rhs._value._string;
+            } else {
+                hi_static_no_default();
+            }
+        }
+
+        /** Get the value of a node.
+         *
+         * @tparam T Type to get, one of: `bool`, `long long`, `double`, `std::string_view`.
+         * @param rhs The node to get the value from.
+         * @return A pointer to the value, or nullptr if the type does not match.
+         */
+        template<typename T>
+        [[nodiscard]] friend constexpr T const* get_if(node const& rhs) noexcept
+        {
+            if (holds_alternative<T>(rhs)) {
+                return &get<T>(rhs);
+            } else {
+                return nullptr;
+            }
+        }
+
+        /** Get the value of a node.
+         *
+         * @tparam T Type to get, one of: `bool`, `long long`, `double`, `std::string_view`.
+         * @param rhs The node to get the value from.
+         * @param path The json-path to the value to extract.
+         * @return A pointer to the value, or nullptr.
+         */
+        template<typename T>
+        [[nodiscard]] friend T const* get_if(node const& rhs, jsonpath const& path) noexcept
+        {
+            if (auto const* value = rhs.find_one(path)) {
+                return get_if<T>(*value);
+            } else {
+                return nullptr;
+            }
+        }
+
+    private:
+        tag_type _tag = tag_type::null;
+
+        /** The number of elements of a vector or members of a map.
+         */
+        uint32_t _size = 0;
+
+        union value_type {
+            bool _bool;
+            long long _long_long;
+            double _double;
+            std::string_view _string;
+            node const* _vector;
+            member_type const* _map;
+
+            constexpr value_type() noexcept : _bool(false) {}
+        };
+
+        value_type _value;
+
+        constexpr explicit node(std::string_view value) noexcept : _tag(tag_type::string)
+        {
+            _value._string = value;
+        }
+
+        constexpr node(node const* elements, std::size_t size) noexcept : _tag(tag_type::vector), _size(narrow_cast<uint32_t>(size))
+        {
+            _value._vector = elements;
+        }
+
+        constexpr node(member_type const* members, std::size_t size) noexcept :
+            _tag(tag_type::map), _size(narrow_cast<uint32_t>(size))
+        {
+            _value._map = members;
+        }
+
+        [[nodiscard]] constexpr node const* find_member(std::string_view key) const noexcept
+        {
+            auto const members = items();
+            auto const it = std::ranges::lower_bound(members, key, std::less{}, [](auto const& item) {
+                return item.first._value._string;
+            });
+
+            if (it != members.end() and it->first._value._string == key) {
+                return std::addressof(it->second);
+            } else {
+                return nullptr;
+            }
+        }
+
+        void find_wildcard(jsonpath::const_iterator it, jsonpath::const_iterator it_end, std::vector<node const*>& r) const noexcept
+        {
+            for (auto const& item : elements()) {
+                item.find(it + 1, it_end, r);
+            }
+            for (auto const& item : items()) {
+                item.second.find(it + 1, it_end, r);
+            }
+        }
+
+        void find_descend(jsonpath::const_iterator it, jsonpath::const_iterator it_end, std::vector<node const*>& r) const noexcept
+        {
+            this->find(it + 1, it_end, r);
+
+            for (auto const& item : elements()) {
+                item.find(it, it_end, r);
+            }
+            for (auto const& item : items()) {
+                item.second.find(it, it_end, r);
+            }
+        }
+
+        void find_indices(
+            jsonpath::indices const& indices,
+            jsonpath::const_iterator it,
+            jsonpath::const_iterator it_end,
+            std::vector<node const*>& r) const noexcept
+        {
+            auto const vector = elements();
+            for (auto const index : indices.filter(vector.size())) {
+                vector[index].find(it + 1, it_end, r);
+            }
+        }
+
+        void find_names(
+            jsonpath::names const& names,
+            jsonpath::const_iterator it,
+            jsonpath::const_iterator it_end,
+            std::vector<node const*>& r) const noexcept
+        {
+            for (auto const& name : names) {
+                if (auto const* value = find_member(name)) {
+                    value->find(it + 1, it_end, r);
+                }
+            }
+        }
+
+        void find_slice(
+            jsonpath::slice const& slice,
+            jsonpath::const_iterator it,
+            jsonpath::const_iterator it_end,
+            std::vector<node const*>& r) const noexcept
+        {
+            if (_tag == tag_type::vector) {
+                auto const vector = elements();
+                auto const first = slice.begin(vector.size());
+                auto const last = slice.end(vector.size());
+
+                for (auto index = first; index != last; index += slice.step) {
+                    if (index >= 0 and index < vector.size()) {
+                        vector[index].find(it + 1, it_end, r);
+                    }
+                }
+            }
+        }
+
+        void find(jsonpath::const_iterator it, jsonpath::const_iterator it_end, std::vector<node const*>& r) const noexcept
+        {
+            if (it == it_end) {
+                r.push_back(this);
+
+            } else if (std::holds_alternative<jsonpath::root>(*it)) {
+                find(it + 1, it_end, r);
+
+            } else if (std::holds_alternative<jsonpath::current>(*it)) {
+                find(it + 1, it_end, r);
+
+            } else if (std::holds_alternative<jsonpath::wildcard>(*it)) {
+                find_wildcard(it, it_end, r);
+
+            } else if (std::holds_alternative<jsonpath::descend>(*it)) {
+                find_descend(it, it_end, r);
+
+            } else if (auto indices = std::get_if<jsonpath::indices>(&*it)) {
+                find_indices(*indices, it, it_end, r);
+
+            } else if (auto names = std::get_if<jsonpath::names>(&*it)) {
+                find_names(*names, it, it_end, r);
+
+            } else if (auto slice = std::get_if<jsonpath::slice>(&*it)) {
+                find_slice(*slice, it, it_end, r);
+
+            } else {
+                hi_no_default();
+            }
+        }
+
+        [[nodiscard]] node const* find_one(jsonpath::const_iterator it, jsonpath::const_iterator it_end) const noexcept
+        {
+            if (it == it_end) {
+                return this;
+
+            } else if (std::holds_alternative<jsonpath::root>(*it)) {
+                return find_one(it + 1, it_end);
+
+            } else if (std::holds_alternative<jsonpath::current>(*it)) {
+                return find_one(it + 1, it_end);
+
+            } else if (auto const* indices = std::get_if<jsonpath::indices>(&*it)) {
+                hi_axiom(indices->size() == 1);
+                auto const vector = elements();
+                auto index = indices->front();
+                if (index < 0) {
+                    index += std::ssize(vector);
+                }
+                if (index < 0 or index >= std::ssize(vector)) {
+                    return nullptr;
+                }
+                return vector[index].find_one(it + 1, it_end);
+
+            } else if (auto const* names = std::get_if<jsonpath::names>(&*it)) {
+                hi_axiom(names->size() == 1);
+                if (auto const* value = find_member(names->front())) {
+                    return value->find_one(it + 1, it_end);
+                }
+                return nullptr;
+
+            } else {
+                hi_no_default();
+            }
+        }
+
+        friend datum_document;
+    };
+
+    static_assert(sizeof(member_type) == 2 * sizeof(node));
+
+    constexpr datum_document() noexcept = default;
+    datum_document(datum_document&&) noexcept = default;
+    datum_document& operator=(datum_document&&) noexcept = default;
+    datum_document(datum_document const&) = delete;
+    datum_document& operator=(datum_document const&) = delete;
+
+    /** Build a document from a JSON tape.
+     *
+     * Duplicate keys in an object are merged, the last value wins.
+     */
+    explicit datum_document(json_tape const& tape)
+    {
+        hi_axiom(not tape.empty());
+
+        auto b = builder{};
+        for (auto const& entry : tape.entries()) {
+            if (entry.type == json_tape_type::array_begin) {
+                b.num_nodes += entry.size;
+            } else if (entry.type == json_tape_type::object_begin) {
+                b.num_nodes += 2 * entry.size;
+            } else if (entry.type == json_tape_type::string) {
+                b.add_string(tape.string(entry));
+            }
+        }
+
+        allocate(b);
+        auto i = 0_uz;
+        _root = b.build(tape, i);
+    }
+
+    /** Build a document from a datum.
+     *
+     * @throws std::domain_error When the datum contains a value that is not a
+     *         null, bool, integer, float, string, vector or map; or a map with a key
+     *         that is not a string.
+     */
+    explicit datum_document(datum const& value)
+    {
+        auto b = builder{};
+        b.measure(value);
+        allocate(b);
+        _root = b.build(value);
+    }
+
+    /** Build a document from a BON8 message.
+     *
+     * The message is read twice, the first pass validates the message and counts
+     * the elements of each array and object; no datum is created.
+     *
+     * Duplicate keys in an object are merged, the last value wins.
+     *
+     * @throws parse_error When the message is not valid BON8.
+     */
+    explicit datum_document(BON8_reader reader)
+    {
+        auto b = builder{};
+        auto sizes = std::vector<std::size_t>{};
+        auto stack = std::vector<std::size_t>{};
+
+        auto first_pass = reader;
+        while (first_pass.next() != BON8_token::end) {
+            auto const token = first_pass.token();
+            if (token == BON8_token::array_end or token == BON8_token::object_end) {
+                stack.pop_back();
+                continue;
+            }
+
+            // The keys and values of an object are both counted.
+            if (not stack.empty()) {
+                ++sizes[stack.back()];
+                ++b.num_nodes;
+            }
+
+            if (token == BON8_token::string) {
+                b.add_string(first_pass.string());
+            } else if (token == BON8_token::array_begin or token == BON8_token::object_begin) {
+                stack.push_back(sizes.size());
+                sizes.push_back(0);
+            }
+        }
+
+        allocate(b);
+        reader.next();
+        auto i = 0_uz;
+        _root = b.build(reader, sizes, i);
+    }
+
+    /** The root node of the document.
+     */
+    [[nodiscard]] constexpr node const& root() const noexcept
+    {
+        return _root;
+    }
+
+    [[nodiscard]] constexpr node const& operator*() const noexcept
+    {
+        return _root;
+    }
+
+    [[nodiscard]] constexpr node const* operator->() const noexcept
+    {
+        return std::addressof(_root);
+    }
+
+    /** The number of bytes in the arena of the document.
+     */
+    [[nodiscard]] constexpr std::size_t capacity() const noexcept
+    {
+        return _capacity;
+    }
+
+private:
+    /** The nodes, followed by the characters of the interned strings.
+     */
+    std::unique_ptr<std::byte[]> _arena;
+    std::size_t _capacity = 0;
+    node _root;
+
+    /** Builds the nodes in two passes; the first pass counts the nodes and collects
+     * the unique strings, the second pass fills in the arena.
+     */
+    struct builder {
+        std::size_t num_nodes = 0;
+        std::size_t num_chars = 0;
+        std::unordered_map<std::string_view, char const*> strings;
+
+        std::byte* next_node = nullptr;
+        char* next_char = nullptr;
+
+        void add_string(std::string_view str)
+        {
+            if (strings.try_emplace(str, nullptr).second) {
+                num_chars += str.size();
+            }
+        }
+
+        [[nodiscard]] node intern(std::string_view str) noexcept
+        {
+            auto const it = strings.find(str);
+            hi_axiom(it != strings.end());
+
+            if (it->second == nullptr) {
+                it->second = next_char;
+                next_char = std::copy_n(str.data(), str.size(), next_char);
+            }
+            return node{std::string_view{it->second, str.size()}};
+        }
+
+        template<typename T>
+        [[nodiscard]] T* allocate(std::size_t size) noexcept
+        {
+            auto* r = reinterpret_cast<T*>(next_node);
+            next_node += size * sizeof(T);
+            return r;
+        }
+
+        /** Sort the members of a map by key, and remove the duplicate keys.
+         *
+         * @return The number of members left.
+         */
+        [[nodiscard]] static std::size_t sort_members(member_type* first, std::size_t size) noexcept
+        {
+            auto const key = [](member_type const& item) {
+                return item.first._value._string;
+            };
+
+            auto const last = first + size;
+            // Objects are often written in sorted order already.
+            if (std::adjacent_find(first, last, [&](auto const& a, auto const& b) {
+                    return key(a) >= key(b);
+                }) == last) {
+                return size;
+            }
+
+            std::stable_sort(first, last, [&](auto const& a, auto const& b) {
+                return key(a) < key(b);
+            });
+
+            // Keep the last of each run of equal keys.
+            auto out = first;
+            for (auto it = first; it != last; ++it) {
+                if (it + 1 == last or key(it[1]) != key(it[0])) {
+                    *out++ = *it;
+                }
+            }
+            return narrow_cast<std::size_t>(out - first);
+        }
+
+        [[nodiscard]] node build(json_tape const& tape, std::size_t& i) noexcept
+        {
+            auto const entries = tape.entries();
+            auto const& entry = entries[i++];
+
+            switch (entry.type) {
+            case json_tape_type::null:
+                return node{nullptr};
+            case json_tape_type::boolean:
+                return node{entry.value != 0};
+            case json_tape_type::integer:
+                return node{std::bit_cast<long long>(entry.value)};
+            case json_tape_type::real:
+                return node{std::bit_cast<double>(entry.value)};
+            case json_tape_type::string:
+                return intern(tape.string(entry));
+            case json_tape_type::array_begin:
+                {
+                    auto* elements = allocate<node>(entry.size);
+                    for (auto j = 0_uz; j != entry.size; ++j) {
+                        std::construct_at(elements + j, build(tape, i));
+                    }
+                    ++i;
+                    return node{elements, entry.size};
+                }
+            case json_tape_type::object_begin:
+                {
+                    auto* members = allocate<member_type>(entry.size);
+                    for (auto j = 0_uz; j != entry.size; ++j) {
+                        auto const key = intern(tape.string(entries[i++]));
+                        std::construct_at(members + j, key, build(tape, i));
+                    }
+                    ++i;
+                    return node{members, sort_members(members, entry.size)};
+                }
+            default:
+                hi_no_default();
+            }
+        }
+
+        void measure(datum const& value)
+        {
+            if (auto const* s = get_if<std::string>(value)) {
+                add_string(*s);
+
+            } else if (auto const* v = get_if<datum::vector_type>(value)) {
+                num_nodes += v->size();
+                for (auto const& item : *v) {
+                    measure(item);
+                }
+
+            } else if (auto const* m = get_if<datum::map_type>(value)) {
+                num_nodes += 2 * m->size();
+                for (auto const& [key, item] : *m) {
+                    if (auto const* key_ = get_if<std::string>(key)) {
+                        add_string(*key_);
+                    } else {
+                        throw std::domain_error(std::format("Can not store a {} map key in a datum_document", key.type_name()));
+                    }
+                    measure(item);
+                }
+
+            } else if (not holds_alternative<nullptr_t>(value) and not holds_alternative<bool>(value) and
+                       not holds_alternative<long long>(value) and not holds_alternative<double>(value)) {
+                throw std::domain_error(std::format("Can not store a {} in a datum_document", value.type_name()));
+            }
+        }
+
+        [[nodiscard]] node build(datum const& value) noexcept
+        {
+            if (auto const* b = get_if<bool>(value)) {
+                return node{*b};
+            } else if (auto const* i = get_if<long long>(value)) {
+                return node{*i};
+            } else if (auto const* f = get_if<double>(value)) {
+                return node{*f};
+            } else if (auto const* s = get_if<std::string>(value)) {
+                return intern(*s);
+
+            } else if (auto const* v = get_if<datum::vector_type>(value)) {
+                auto* elements = allocate<node>(v->size());
+                for (auto j = 0_uz; j != v->size(); ++j) {
+                    std::construct_at(elements + j, build((*v)[j]));
+                }
+                return node{elements, v->size()};
+
+            } else if (auto const* m = get_if<datum::map_type>(value)) {
+                auto* members = allocate<member_type>(m->size());
+                auto j = 0_uz;
+                for (auto const& [key, item] : *m) {
+                    std::construct_at(members + j++, intern(get<std::string>(key)), build(item));
+                }
+                return node{members, sort_members(members, m->size())};
+
+            } else {
+                return node{nullptr};
+            }
+        }
+
+        [[nodiscard]] node build(BON8_reader& reader, std::vector<std::size_t> const& sizes, std::size_t& i)
+        {
+            switch (reader.token()) {
+            case BON8_token::null:
+                return node{nullptr};
+            case BON8_token::boolean:
+                return node{reader.boolean()};
+            case BON8_token::integer:
+                return node{reader.integer()};
+            case BON8_token::real:
+                return node{reader.real()};
+            case BON8_token::string:
+                return intern(reader.string());
+            case BON8_token::array_begin:
+                {
+                    auto const size = sizes[i++];
+                    auto* elements = allocate<node>(size);
+                    for (auto j = 0_uz; j != size; ++j) {
+                        reader.next();
+                        std::construct_at(elements + j, build(reader, sizes, i));
+                    }
+                    reader.next();
+                    return node{elements, size};
+                }
+            case BON8_token::object_begin:
+                {
+                    auto const size = sizes[i++] / 2;
+                    auto* members = allocate<member_type>(size);
+                    for (auto j = 0_uz; j != size; ++j) {
+                        reader.next();
+                        auto const key = intern(reader.string());
+                        reader.next();
+                        std::construct_at(members + j, key, build(reader, sizes, i));
+                    }
+                    reader.next();
+                    return node{members, sort_members(members, size)};
+                }
+            default:
+                hi_no_default();
+            }
+        }
+    };
+
+    void allocate(builder& b)
+    {
+        _capacity = b.num_nodes * sizeof(node) + b.num_chars;
+        _arena = std::make_unique_for_overwrite<std::byte[]>(_capacity);
+        b.next_node = _arena.get();
+        b.next_char = reinterpret_cast<char*>(_arena.get() + b.num_nodes * sizeof(node));
+    }
+};
+
+/** Parse a JSON document into a datum_document.
+ *
+ * @param text The JSON text.
+ * @param path A path to the file being parsed, used in error messages.
+ * @return The document.
+ * @throws parse_error When the text is not valid JSON.
+ */
+hi_export [[nodiscard]] inline datum_document
+parse_JSON_document(std::string_view text, std::string_view path = std::string_view{"<none>"})
+{
+    auto tape = json_tape{};
+    if (tape.parse(text)) {
+        return datum_document{tape};
+    }
+
+    // The lexer based parser accepts a few extensions to JSON and reports errors.
+    return datum_document{parse_JSON(text, path)};
+}
+
+/** Parse a JSON document into a datum_document.
+ *
+ * @param text The JSON text.
+ * @param path A path to the file being parsed, used in error messages.
+ * @return The document.
+ * @throws parse_error When the text is not valid JSON.
+ */
+hi_export [[nodiscard]] inline datum_document
+parse_JSON_document(std::string const& text, std::string_view path = std::string_view{"<none>"})
+{
+    return parse_JSON_document(std::string_view{text}, path);
+}
+
+/** Parse a JSON document into a datum_document.
+ *
+ * @param text The JSON text.
+ * @param path A path to the file being parsed, used in error messages.
+ * @return The document.
+ * @throws parse_error When the text is not valid JSON.
+ */
+hi_export [[nodiscard]] inline datum_document
+parse_JSON_document(char const *text, std::string_view path = std::string_view{"<none>"})
+{
+    return parse_JSON_document(std::string_view{text}, path);
+}
+
+/** Parse a JSON file into a datum_document.
+ *
+ * @param path A path pointing to the file to parse.
+ * @return The document, it does not refer to the file after parsing.
+ * @throws parse_error When the file is not valid JSON.
+ */
+hi_export [[nodiscard]] inline datum_document parse_JSON_document(std::filesystem::path const& path)
+{
+    return parse_JSON_document(as_string_view(file_view(path)), path.string());
+}
+
+/** Decode a BON8 message into a datum_document.
+ *
+ * @param buffer A buffer to a BON8 encoded message.
+ * @return The document.
+ * @throws parse_error When the message is not valid BON8.
+ */
+hi_export [[nodiscard]] inline datum_document decode_BON8_document(std::span<std::byte const> buffer)
+{
+    return datum_document{BON8_reader{buffer}};
+}
+
+}} // namespace hi::v1
@@ -0,0 +1,139 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "datum_document.hpp"
+#include <hikotest/hikotest.hpp>
+#include <string>
+#include <string_view>
+#include <stdexcept>
+
+TEST_SUITE(datum_document_suite) {
+
+TEST_CASE(parse)
+{
+    auto const doc = hi::parse_JSON_document(R"({"foo": [42, -1.5, false, null], "bar": {}, "baz": "x"})");
+    auto const& root = doc.root();
+
+    REQUIRE(holds_alternative<hi::datum::map_type>(root));
+    REQUIRE(root.size() == 3);
+    REQUIRE(root.contains("foo"));
+    REQUIRE(not root.contains("qux"));
+
+    auto const& foo = root["foo"];
+    REQUIRE(holds_alternative<hi::datum::vector_type>(foo));
+    REQUIRE(foo.size() == 4);
+    REQUIRE(get<long long>(foo[0]) == 42);
+    REQUIRE(get<double>(foo[1]) == -1.5);
+    REQUIRE(get<bool>(foo[2]) == false);
+    REQUIRE(holds_alternative<nullptr_t>(foo[-1]));
+    REQUIRE(static_cast<double>(foo[0]) == 42.0);
+    REQUIRE(static_cast<int>(foo[0]) == 42);
+
+    REQUIRE(root["bar"].empty());
+    REQUIRE(holds_alternative<std::string>(root["baz"]));
+    REQUIRE(get<std::string_view>(root["baz"]) == "x");
+    REQUIRE(static_cast<std::string>(root["baz"]) == "x");
+
+    REQUIRE(get_if<long long>(root["baz"]) == nullptr);
+    REQUIRE(*get_if<std::string_view>(root["baz"]) == "x");
+
+    REQUIRE_THROWS(root["qux"], std::overflow_error);
+    REQUIRE_THROWS(foo[4], std::overflow_error);
+    REQUIRE_THROWS(foo[-5], std::overflow_error);
+    REQUIRE_THROWS(foo["qux"], std::domain_error);
+    REQUIRE_THROWS(root[0], std::domain_error);
+    REQUIRE_THROWS(static_cast<double>(root["baz"]), std::domain_error);
+}
+
+TEST_CASE(to_datum)
+{
+    auto expected = hi::datum::make_map();
+    expected["foo"] = hi::datum::make_vector(42, -1.5, false);
+    expected["bar"] = hi::datum::make_map();
+    expected["baz"] = hi::datum{nullptr};
+
+    auto const text = R"({"foo": [42, -15e-1, false], "bar": {}, "baz": null})";
+    REQUIRE(hi::parse_JSON_document(text)->to_datum() == expected);
+    REQUIRE(hi::datum_document{expected}->to_datum() == expected);
+    REQUIRE(hi::datum_document{expected}.root() == hi::parse_JSON_document(text).root());
+}
+
+TEST_CASE(sorted_members)
+{
+    auto const doc = hi::parse_JSON_document(R"({"c": 1, "a": 2, "b": 3, "a": 4})");
+    auto const items = doc->items();
+
+    // Duplicate keys are merged, the last value wins.
+    REQUIRE(items.size() == 3);
+    REQUIRE(get<std::string_view>(items[0].first) == "a");
+    REQUIRE(get<long long>(items[0].second) == 4);
+    REQUIRE(get<std::string_view>(items[1].first) == "b");
+    REQUIRE(get<std::string_view>(items[2].first) == "c");
+    REQUIRE(get<long long>(doc.root()["a"]) == 4);
+}
+
+TEST_CASE(interned_strings)
+{
+    auto const doc = hi::parse_JSON_document(R"([{"name": "x"}, {"name": "xy"}, {"name": "x"}])");
+    auto const& root = doc.root();
+
+    auto const a = get<std::string_view>(root[0]["name"]);
+    auto const b = get<std::string_view>(root[1]["name"]);
+    auto const c = get<std::string_view>(root[2]["name"]);
+    REQUIRE(b == "xy");
+    REQUIRE(a.data() == c.data());
+    REQUIRE(get<std::string_view>(root[0].items()[0].first).data() == get<std::string_view>(root[1].items()[0].first).data());
+
+    // Three maps with one member each, and the strings "name", "x" and "xy".
+    REQUIRE(doc.capacity() == (3 + 3 * 2) * sizeof(hi::datum_document::node) + 7);
+}
+
+TEST_CASE(jsonpath)
+{
+    auto const doc = hi::parse_JSON_document(R"({"a": [{"b": 1}, {"b": 2}, {"c": 3}], "b": 4})");
+    auto const& root = doc.root();
+
+    REQUIRE(*get_if<long long>(root, hi::jsonpath{"$.a[1].b"}) == 2);
+    REQUIRE(*get_if<long long>(root, hi::jsonpath{"$.a[-1].c"}) == 3);
+    REQUIRE(get_if<long long>(root, hi::jsonpath{"$.a[3].c"}) == nullptr);
+    REQUIRE(get_if<long long>(root, hi::jsonpath{"$.d"}) == nullptr);
+
+    auto const descend = root.find(hi::jsonpath{"$..b"});
+    REQUIRE(descend.size() == 3);
+    REQUIRE(get<long long>(*descend[0]) == 4);
+    REQUIRE(get<long long>(*descend[1]) == 1);
+    REQUIRE(get<long long>(*descend[2]) == 2);
+
+    REQUIRE(root.find(hi::jsonpath{"$.a[*]"}).size() == 3);
+    REQUIRE(root.find(hi::jsonpath{"$.a[0,2]"}).size() == 2);
+    REQUIRE(root.find(hi::jsonpath{"$.a[1:]"}).size() == 2);
+    REQUIRE(root.find(hi::jsonpath{"$['a','b']"}).size() == 2);
+}
+
+TEST_CASE(from_datum)
+{
+    auto value = hi::datum::make_map();
+    value[hi::datum{1}] = hi::datum{2};
+    REQUIRE_THROWS(hi::datum_document{value}, std::domain_error);
+
+    auto const doc = hi::datum_document{hi::datum{"foo"}};
+    REQUIRE(get<std::string_view>(doc.root()) == "foo");
+}
+
+TEST_CASE(BON8)
+{
+    auto value = hi::datum::make_map();
+    value["foo"] = hi::datum::make_vector(1, 2.5, "bar");
+    value["baz"] = hi::datum{true};
+
+    auto const doc = hi::decode_BON8_document(hi::encode_BON8(value));
+    REQUIRE(doc->to_datum() == value);
+}
+
+TEST_CASE(invalid)
+{
+    REQUIRE_THROWS(hi::parse_JSON_document("[1, 2"), hi::parse_error);
+}
+
+};
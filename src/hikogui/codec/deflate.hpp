@@ -0,0 +1,715 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "../utility/utility.hpp"
+#include "../container/container.hpp"
+#include "../macros.hpp"
+#include "huffman.hpp"
+#include "inflate.hpp"
+#include <span>
+#include <array>
+#include <vector>
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+hi_export_module(hikogui.codec.deflate);
+
+hi_export namespace hi { inline namespace v1 {
+namespace detail {
+
+/** A LSB-first bit writer for the deflate bit-stream.
+ */
+class deflate_bit_writer {
+public:
+    deflate_bit_writer(bstring& output) noexcept : _output(output) {}
+
+    /** Write bits.
+     *
+     * @param value The bits to write, the first bit in the LSB.
+     * @param length The number of bits to write.
+     */
+    hi_force_inline void put(std::size_t value, std::size_t length) noexcept
+    {
+        hi_axiom(length <= 32);
+        hi_axiom(value < (uint64_t{1} << length));
+
+        _bits |= uint64_t{value} << _nr_bits;
+        _nr_bits += length;
+        if (_nr_bits >= 32) {
+            auto buffer = std::array<std::byte, 4>{};
+            store_le(narrow_cast<uint32_t>(_bits & 0xffff'ffff), buffer.data());
+            _output.append(buffer.data(), buffer.size());
+            _bits >>= 32;
+            _nr_bits -= 32;
+        }
+    }
+
+    /** The number of bits in the bit-buffer, which are not yet written to the output.
+     */
+    [[nodiscard]] std::size_t pending() const noexcept
+    {
+        return _nr_bits;
+    }
+
+    /** Pad with zero bits to the next byte and flush the bit-buffer.
+     */
+    void flush() noexcept
+    {
+        while (_nr_bits > 0) {
+            _output.push_back(static_cast<std::byte>(_bits & 0xff));
+            _bits >>= 8;
+            _nr_bits = _nr_bits > 8 ? _nr_bits - 8 : 0;
+        }
+        _bits = 0;
+    }
+
+    /** Write bytes after flushing the bit-buffer.
+     */
+    void append(std::span<std::byte const> bytes) noexcept
+    {
+        flush();
+        _output.append(bytes.data(), bytes.size());
+    }
+
+private:
+    bstring& _output;
+    uint64_t _bits = 0;
+    std::size_t _nr_bits = 0;
+};
+
+/** Parameters for each compression level.
+ */
+struct deflate_configuration {
+    /** Reduce the search when the previous match is at least this long.
+     */
+    uint16_t good_length;
+
+    /** For lazy matching: do not search for a better match when the current match is at least this long.
+     * For greedy matching: only insert the strings of matches up to this length in the hash-table.
+     */
+    uint16_t lazy_length;
+
+    /** Stop the search when a match of at least this length is found.
+     */
+    uint16_t nice_length;
+
+    /** The maximum number of entries in the hash-chain that are checked.
+     */
+    uint16_t max_chain;
+
+    /** Use lazy matching, the match at the next position is checked before committing to a match.
+     */
+    bool lazy;
+};
+
+// The same parameters as zlib uses for each level.
+constexpr auto deflate_configurations = std::array<deflate_configuration, 10>{
+    deflate_configuration{0, 0, 0, 0, false},
+    deflate_configuration{4, 4, 8, 4, false},
+    deflate_configuration{4, 5, 16, 8, false},
+    deflate_configuration{4, 6, 32, 32, false},
+    deflate_configuration{4, 4, 16, 16, true},
+    deflate_configuration{8, 16, 32, 32, true},
+    deflate_configuration{8, 16, 128, 128, true},
+    deflate_configuration{8, 32, 128, 256, true},
+    deflate_configuration{32, 128, 258, 1024, true},
+    deflate_configuration{32, 258, 258, 4096, true}};
+
+/** A literal, or a length/distance pair, before it is huffman encoded.
+ */
+struct deflate_symbol {
+    /** The literal byte, or the length of the match.
+     */
+    uint16_t literal_or_length;
+
+    /** The distance of the match, or zero for a literal.
+     */
+    uint16_t distance;
+};
+
+/** Get the length-symbol relative to symbol 257 for a match-length.
+ */
+[[nodiscard]] constexpr std::size_t deflate_length_index(std::size_t length) noexcept
+{
+    hi_axiom(length >= 3 and length <= 258);
+    auto const it = std::upper_bound(inflate_length_base.begin(), inflate_length_base.end(), length);
+    return narrow_cast<std::size_t>(std::distance(inflate_length_base.begin(), it)) - 1;
+}
+
+/** Get the distance-symbol for a match-distance.
+ */
+[[nodiscard]] constexpr std::size_t deflate_distance_index(std::size_t distance) noexcept
+{
+    hi_axiom(distance >= 1 and distance <= 32768);
+    auto const it = std::upper_bound(inflate_distance_base.begin(), inflate_distance_base.end(), distance);
+    return narrow_cast<std::size_t>(std::distance(inflate_distance_base.begin(), it)) - 1;
+}
+
+constexpr auto deflate_length_indices = []() {
+    auto r = std::array<uint8_t, 259>{};
+    for (auto length = 3_uz; length != r.size(); ++length) {
+        r[length] = narrow_cast<uint8_t>(deflate_length_index(length));
+    }
+    return r;
+}();
+
+/** Huffman codes for writing, the codes are bit-reversed so that they can be written LSB-first.
+ */
+struct deflate_code_table {
+    std::vector<uint8_t> lengths;
+    std::vector<uint16_t> codes;
+
+    deflate_code_table(std::vector<uint8_t> lengths) : lengths(std::move(lengths)), codes(huffman_codes(this->lengths))
+    {
+        for (auto symbol = 0_uz; symbol != codes.size(); ++symbol) {
+            auto code = codes[symbol];
+            auto reversed = uint16_t{0};
+            for (auto i = 0_uz; i != this->lengths[symbol]; ++i) {
+                reversed = narrow_cast<uint16_t>((reversed << 1) | (code & 1));
+                code >>= 1;
+            }
+            codes[symbol] = reversed;
+        }
+    }
+
+    void put(deflate_bit_writer& writer, std::size_t symbol) const noexcept
+    {
+        hi_axiom(lengths[symbol] != 0);
+        writer.put(codes[symbol], lengths[symbol]);
+    }
+};
+
+inline deflate_code_table const deflate_fixed_literal_codes = []() {
+    auto lengths = std::vector<uint8_t>(288, 0);
+    std::fill(lengths.begin(), lengths.begin() + 144, uint8_t{8});
+    std::fill(lengths.begin() + 144, lengths.begin() + 256, uint8_t{9});
+    std::fill(lengths.begin() + 256, lengths.begin() + 280, uint8_t{7});
+    std::fill(lengths.begin() + 280, lengths.end(), uint8_t{8});
+    return deflate_code_table{std::move(lengths)};
+}();
+
+inline deflate_code_table const deflate_fixed_distance_codes = deflate_code_table{std::vector<uint8_t>(30, 5)};
+
+/** Deflate encoder.
+ *
+ * The encoder finds matches with a hash-chain over the 32 KiB window. For
+ * each block of symbols the encoder selects the smallest encoding of
+ * a dynamic-huffman, fixed-huffman or stored block.
+ */
+class deflate_encoder {
+public:
+    /** The maximum number of symbols in a block.
+     */
+    constexpr static std::size_t max_block_symbols = 0x4000;
+
+    deflate_encoder(std::span<std::byte const> bytes, int level, bstring& output) :
+        _bytes(bytes), _configuration(deflate_configurations[std::clamp(level, 0, 9)]), _writer(output)
+    {
+    }
+
+    void encode()
+    {
+        if (_configuration.max_chain == 0) {
+            encode_stored();
+            return;
+        }
+
+        _head.assign(hash_size, -1);
+        _prev.assign(window_size, -1);
+        _symbols.reserve(max_block_symbols);
+
+        if (_configuration.lazy) {
+            encode_lazy();
+        } else {
+            encode_greedy();
+        }
+        flush_block(true);
+        _writer.flush();
+    }
+
+private:
+    constexpr static std::size_t window_size = 0x8000;
+    constexpr static std::size_t hash_bits = 15;
+    constexpr static std::size_t hash_size = 1_uz << hash_bits;
+    constexpr static std::size_t min_match = 3;
+    constexpr static std::size_t max_match = 258;
+
+    /** Matches of minimum length that are further away than this are not worth encoding.
+     */
+    constexpr static std::size_t too_far = 4096;
+
+    std::span<std::byte const> _bytes;
+    deflate_configuration _configuration;
+    deflate_bit_writer _writer;
+
+    /** The most recent position for each hash.
+     */
+    std::vector<std::ptrdiff_t> _head;
+
+    /** The previous position with the same hash, for each position in the window.
+     */
+    std::vector<std::ptrdiff_t> _prev;
+
+    std::vector<deflate_symbol> _symbols;
+
+    /** The offset in the input of the first byte of the current block.
+     */
+    std::size_t _block_start = 0;
+
+    /** The offset in the input after the last symbol of the current block.
+     */
+    std::size_t _block_end = 0;
+
+    [[nodiscard]] std::size_t hash(std::size_t position) const noexcept
+    {
+        auto const b0 = std::to_integer<std::size_t>(_bytes[position]);
+        auto const b1 = std::to_integer<std::size_t>(_bytes[position + 1]);
+        auto const b2 = std::to_integer<std::size_t>(_bytes[position + 2]);
+        return ((b0 << 10) ^ (b1 << 5) ^ b2) & (hash_size - 1);
+    }
+
+    /** Insert the string at position into the hash-chain.
+     *
+     * @return The previous position with the same hash, or -1.
+     */
+    std::ptrdiff_t insert(std::size_t position) noexcept
+    {
+        if (position + min_match > _bytes.size()) {
+            return -1;
+        }
+
+        auto& head = _head[hash(position)];
+        auto const r = head;
+        _prev[position % window_size] = head;
+        head = narrow_cast<std::ptrdiff_t>(position);
+        return r;
+    }
+
+    /** Get the number of bytes that are equal.
+     */
+    [[nodiscard]] std::size_t match_length(std::size_t a, std::size_t b, std::size_t max_length) const noexcept
+    {
+        auto length = 0_uz;
+        while (length + 8 <= max_length) {
+            auto const x = load_le<uint64_t>(_bytes.data() + a + length) ^ load_le<uint64_t>(_bytes.data() + b + length);
+            if (x != 0) {
+                return length + std::countr_zero(x) / 8;
+            }
+            length += 8;
+        }
+        while (length < max_length and _bytes[a + length] == _bytes[b + length]) {
+            ++length;
+        }
+        return length;
+    }
+
+    /** Find the longest match in the hash-chain.
+     *
+     * @param position The position of the string to match.
+     * @param candidate The first position in the hash-chain.
+     * @param prev_length The length of a previous match, only longer matches are returned.
+     * @param[out] distance The distance of the longest match.
+     * @return The length of the longest match, or a length less than `min_match` when no match was found.
+     */
+    [[nodiscard]] std::size_t longest_match(
+        std::size_t position,
+        std::ptrdiff_t candidate,
+        std::size_t prev_length,
+        std::size_t& distance) const noexcept
+    {
+        auto const max_length = std::min(max_match, _bytes.size() - position);
+        if (max_length < min_match) {
+            return 0;
+        }
+
+        auto chain = _configuration.max_chain;
+        if (prev_length >= _configuration.good_length) {
+            chain >>= 2;
+        }
+
+        auto best_length = std::max(prev_length, min_match - 1);
+        while (candidate >= 0 and chain-- != 0 and best_length < max_length) {
+            auto const c = narrow_cast<std::size_t>(candidate);
+            // At a distance of window_size the entry in _prev was overwritten by the current position.
+            if (position - c >= window_size) {
+                break;
+            }
+
+            // Quickly reject candidates that can not be longer than the current best.
+            if (load_le<uint16_t>(_bytes.data() + c + best_length - 1) ==
+                    load_le<uint16_t>(_bytes.data() + position + best_length - 1) and
+                _bytes[c] == _bytes[position]) {
+                auto const length = match_length(c, position, max_length);
+                if (length > best_length) {
+                    best_length = length;
+                    distance = position - c;
+                    if (length >= _configuration.nice_length or length == max_length) {
+                        break;
+                    }
+                }
+            }
+
+            candidate = _prev[c % window_size];
+        }
+
+        if (best_length == min_match and distance > too_far) {
+            return 0;
+        }
+        return best_length > prev_length ? best_length : 0;
+    }
+
+    void put_literal(std::size_t position)
+    {
+        _symbols.emplace_back(std::to_integer<uint16_t>(_bytes[position]), uint16_t{0});
+        _block_end += 1;
+        if (_symbols.size() == max_block_symbols) {
+            flush_block(false);
+        }
+    }
+
+    void put_match(std::size_t length, std::size_t distance)
+    {
+        _symbols.emplace_back(narrow_cast<uint16_t>(length), narrow_cast<uint16_t>(distance));
+        _block_end += length;
+        if (_symbols.size() == max_block_symbols) {
+            flush_block(false);
+        }
+    }
+
+    void encode_greedy()
+    {
+        auto position = 0_uz;
+        while (position < _bytes.size()) {
+            auto const candidate = insert(position);
+
+            auto distance = 0_uz;
+            auto const length = candidate >= 0 ? longest_match(position, candidate, 0, distance) : 0_uz;
+
+            if (length >= min_match) {
+                put_match(length, distance);
+
+                auto const end = position + length;
+                if (length <= _configuration.lazy_length) {
+                    while (++position < end) {
+                        insert(position);
+                    }
+                }
+                position = end;
+
+            } else {
+                put_literal(position++);
+            }
+        }
+    }
+
+    void encode_lazy()
+    {
+        auto prev_length = 0_uz;
+        auto prev_distance = 0_uz;
+        auto match_available = false;
+
+        auto position = 0_uz;
+        while (position < _bytes.size()) {
+            auto const candidate = insert(position);
+
+            auto distance = 0_uz;
+            auto length = 0_uz;
+            if (candidate >= 0 and prev_length < _configuration.lazy_length) {
+                length = longest_match(position, candidate, prev_length, distance);
+            }
+
+            if (prev_length >= min_match and length <= prev_length) {
+                // The match at the previous position is better.
+                put_match(prev_length, prev_distance);
+
+                auto const end = position - 1 + prev_length;
+                while (++position < end) {
+                    insert(position);
+                }
+                match_available = false;
+                prev_length = 0;
+
+            } else {
+                if (match_available) {
+                    put_literal(position - 1);
+                }
+
+                match_available = true;
+                prev_length = length;
+                prev_distance = distance;
+                ++position;
+            }
+        }
+
+        if (match_available) {
+            put_literal(position - 1);
+        }
+    }
+
+    void encode_stored()
+    {
+        _block_end = _bytes.size();
+        flush_stored_block(true);
+    }
+
+    /** Write the symbols collected so far as a block.
+     *
+     * @param final_block Set the BFINAL bit.
+     */
+    void flush_block(bool final_block)
+    {
+        auto literal_frequencies = std::array<std::size_t, 286>{};
+        auto distance_frequencies = std::array<std::size_t, 30>{};
+        for (auto const& symbol : _symbols) {
+            if (symbol.distance == 0) {
+                ++literal_frequencies[symbol.literal_or_length];
+            } else {
+                ++literal_frequencies[257 + deflate_length_indices[symbol.literal_or_length]];
+                ++distance_frequencies[deflate_distance_index(symbol.distance)];
+            }
+        }
+        ++literal_frequencies[256];
+
+        auto const literal_codes = deflate_code_table{huffman_code_lengths(literal_frequencies, 15)};
+        auto const distance_codes = deflate_code_table{huffman_code_lengths(distance_frequencies, 15)};
+
+        // Encode the code lengths with run-length encoding.
+        auto const nr_literals = std::max(257_uz, last_used(literal_codes.lengths));
+        auto const nr_distances = std::max(1_uz, last_used(distance_codes.lengths));
+
+        auto lengths = std::vector<uint8_t>{};
+        lengths.insert(lengths.end(), literal_codes.lengths.begin(), literal_codes.lengths.begin() + nr_literals);
+        lengths.insert(lengths.end(), distance_codes.lengths.begin(), distance_codes.lengths.begin() + nr_distances);
+        auto const code_length_symbols = run_length_encode(lengths);
+
+        auto code_length_frequencies = std::array<std::size_t, 19>{};
+        for (auto const& symbol : code_length_symbols) {
+            ++code_length_frequencies[symbol.literal_or_length];
+        }
+        auto const code_length_codes = deflate_code_table{huffman_code_lengths(code_length_frequencies, 7)};
+
+        auto nr_code_lengths = inflate_code_length_order.size();
+        while (nr_code_lengths > 4 and code_length_codes.lengths[inflate_code_length_order[nr_code_lengths - 1]] == 0) {
+            --nr_code_lengths;
+        }
+
+        // Calculate the size of each type of block.
+        auto const dynamic_size = 3 + 14 + 3 * nr_code_lengths + code_lengths_size(code_length_symbols, code_length_codes) +
+            symbols_size(literal_frequencies, distance_frequencies, literal_codes, distance_codes);
+        auto const fixed_size =
+            3 + symbols_size(literal_frequencies, distance_frequencies, deflate_fixed_literal_codes, deflate_fixed_distance_codes);
+        auto const stored_size = stored_block_size();
+
+        if (stored_size <= dynamic_size and stored_size <= fixed_size) {
+            flush_stored_block(final_block);
+
+        } else if (fixed_size <= dynamic_size) {
+            _writer.put(final_block ? 1 : 0, 1);
+            _writer.put(1, 2);
+            put_symbols(deflate_fixed_literal_codes, deflate_fixed_distance_codes);
+
+        } else {
+            _writer.put(final_block ? 1 : 0, 1);
+            _writer.put(2, 2);
+            _writer.put(nr_literals - 257, 5);
+            _writer.put(nr_distances - 1, 5);
+            _writer.put(nr_code_lengths - 4, 4);
+            for (auto i = 0_uz; i != nr_code_lengths; ++i) {
+                _writer.put(code_length_codes.lengths[inflate_code_length_order[i]], 3);
+            }
+            for (auto const& symbol : code_length_symbols) {
+                code_length_codes.put(_writer, symbol.literal_or_length);
+                switch (symbol.literal_or_length) {
+                case 16:
+                    _writer.put(symbol.distance, 2);
+                    break;
+                case 17:
+                    _writer.put(symbol.distance, 3);
+                    break;
+                case 18:
+                    _writer.put(symbol.distance, 7);
+                    break;
+                default:;
+                }
+            }
+            put_symbols(literal_codes, distance_codes);
+        }
+
+        _symbols.clear();
+        _block_start = _block_end;
+    }
+
+    /** Write the input of the current block as one or more stored blocks.
+     */
+    void flush_stored_block(bool final_block)
+    {
+        auto bytes = _bytes.subspan(_block_start, _block_end - _block_start);
+        do {
+            auto const n = std::min(bytes.size(), 0xffff_uz);
+            auto const last = n == bytes.size();
+
+            _writer.put(final_block and last ? 1 : 0, 1);
+            _writer.put(0, 2);
+            _writer.flush();
+            _writer.put(n, 16);
+            _writer.put(~n & 0xffff, 16);
+            _writer.append(bytes.first(n));
+
+            bytes = bytes.subspan(n);
+        } while (not bytes.empty());
+
+        _symbols.clear();
+        _block_start = _block_end;
+    }
+
+    [[nodiscard]] std::size_t stored_block_size() const noexcept
+    {
+        auto const size = _block_end - _block_start;
+        auto const nr_blocks = std::max(1_uz, (size + 0xfffe) / 0xffff);
+
+        // The first block header is padded to the next byte, the following headers take a whole byte.
+        auto const first_header_size = ((_writer.pending() + 3 + 7) / 8) * 8 - _writer.pending();
+        return first_header_size + (nr_blocks - 1) * 8 + nr_blocks * 32 + size * 8;
+    }
+
+    [[nodiscard]] static std::size_t symbols_size(
+        std::span<std::size_t const> literal_frequencies,
+        std::span<std::size_t const> distance_frequencies,
+        deflate_code_table const& literal_codes,
+        deflate_code_table const& distance_codes) noexcept
+    {
+        auto r = 0_uz;
+        for (auto symbol = 0_uz; symbol != literal_frequencies.size(); ++symbol) {
+            auto extra = symbol > 256 ? inflate_length_extra[symbol - 257] : 0_uz;
+            r += literal_frequencies[symbol] * (literal_codes.lengths[symbol] + extra);
+        }
+        for (auto symbol = 0_uz; symbol != distance_frequencies.size(); ++symbol) {
+            r += distance_frequencies[symbol] * (distance_codes.lengths[symbol] + inflate_distance_extra[symbol]);
+        }
+        return r;
+    }
+
+    [[nodiscard]] static std::size_t
+    code_lengths_size(std::span<deflate_symbol const> symbols, deflate_code_table const& code_length_codes) noexcept
+    {
+        auto r = 0_uz;
+        for (auto const& symbol : symbols) {
+            r += code_length_codes.lengths[symbol.literal_or_length];
+            r += symbol.literal_or_length == 16 ? 2 : symbol.literal_or_length == 17 ? 3 : symbol.literal_or_length == 18 ? 7 : 0;
+        }
+        return r;
+    }
+
+    [[nodiscard]] static std::size_t last_used(std::span<uint8_t const> lengths) noexcept
+    {
+        auto r = lengths.size();
+        while (r != 0 and lengths[r - 1] == 0) {
+            --r;
+        }
+        return r;
+    }
+
+    /** Run-length encode the code lengths.
+     *
+     * @return A list of code-length symbols, with the value of the extra bits stored in the distance member.
+     */
+    [[nodiscard]] static std::vector<deflate_symbol> run_length_encode(std::span<uint8_t const> lengths)
+    {
+        auto r = std::vector<deflate_symbol>{};
+
+        auto i = 0_uz;
+        while (i != lengths.size()) {
+            auto const length = lengths[i];
+            auto run = 1_uz;
+            while (i + run != lengths.size() and lengths[i + run] == length) {
+                ++run;
+            }
+            i += run;
+
+            if (length == 0) {
+                while (run >= 11) {
+                    auto const n = std::min(run, 138_uz);
+                    r.emplace_back(uint16_t{18}, narrow_cast<uint16_t>(n - 11));
+                    run -= n;
+                }
+                if (run >= 3) {
+                    r.emplace_back(uint16_t{17}, narrow_cast<uint16_t>(run - 3));
+                    run = 0;
+                }
+
+            } else {
+                r.emplace_back(uint16_t{length}, uint16_t{0});
+                --run;
+                while (run >= 3) {
+                    auto const n = std::min(run, 6_uz);
+                    r.emplace_back(uint16_t{16}, narrow_cast<uint16_t>(n - 3));
+                    run -= n;
+                }
+            }
+
+            for (; run != 0; --run) {
+                r.emplace_back(uint16_t{length}, uint16_t{0});
+            }
+        }
+
+        return r;
+    }
+
+    void put_symbols(deflate_code_table const& literal_codes, deflate_code_table const& distance_codes) noexcept
+    {
+        for (auto const& symbol : _symbols) {
+            if (symbol.distance == 0) {
+                literal_codes.put(_writer, symbol.literal_or_length);
+
+            } else {
+                auto const length_index = deflate_length_indices[symbol.literal_or_length];
+                literal_codes.put(_writer, 257 + length_index);
+                _writer.put(symbol.literal_or_length - inflate_length_base[length_index], inflate_length_extra[length_index]);
+
+                auto const distance_index = deflate_distance_index(symbol.distance);
+                distance_codes.put(_writer, distance_index);
+                _writer.put(symbol.distance - inflate_distance_base[distance_index], inflate_distance_extra[distance_index]);
+            }
+        }
+
+        // End-of-block.
+        literal_codes.put(_writer, 256);
+    }
+};
+
+} // namespace detail
+
+/** Compress data using the deflate algorithm.
+ *
+ * @param bytes The data to compress.
+ * @param level The compression level: 0 stores the data uncompressed, 1 is the
+ *              fastest compression, up to 9 for the best compression.
+ * @param[out] output The compressed data is appended to @a output.
+ */
+hi_export inline void deflate(std::span<std::byte const> bytes, int level, bstring& output)
+{
+    hi_axiom(level >= 0 and level <= 9);
+    auto encoder = detail::deflate_encoder(bytes, level, output);
+    encoder.encode();
+}
+
+/** Compress data using the deflate algorithm.
+ *
+ * @param bytes The data to compress.
+ * @param level The compression level: 0 stores the data uncompressed, 1 is the
+ *              fastest compression, up to 9 for the best compression.
+ * @return The compressed data.
+ */
+hi_export [[nodiscard]] inline bstring deflate(std::span<std::byte const> bytes, int level = 6)
+{
+    auto r = bstring{};
+    deflate(bytes, level, r);
+    return r;
+}
+
+}} // namespace hi::v1
@@ -0,0 +1,155 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "deflate.hpp"
+#include "inflate.hpp"
+#include "zlib.hpp"
+#include "gzip.hpp"
+#include "../file/file.hpp"
+#include "../container/container.hpp"
+#include "../path/path.hpp"
+#include "../utility/utility.hpp"
+#include <hikotest/hikotest.hpp>
+
+TEST_SUITE(deflate_suite) {
+
+TEST_CASE(deflate_empty)
+{
+    for (auto level = 0; level <= 9; ++level) {
+        auto const compressed = hi::deflate({}, level);
+
+        size_t offset = 0;
+        auto const decompressed = hi::inflate(compressed, offset);
+        REQUIRE(decompressed.empty());
+        REQUIRE(offset == compressed.size());
+    }
+}
+
+TEST_CASE(deflate_levels)
+{
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test7.bin"};
+    auto const original_bytes = as_bstring_view(original);
+
+    auto prev_size = original_bytes.size() + 1;
+    for (auto level : {0, 1, 6, 9}) {
+        auto const compressed = hi::deflate(original_bytes, level);
+        if (level == 0) {
+            REQUIRE(compressed.size() > original_bytes.size());
+        } else {
+            REQUIRE(compressed.size() < prev_size);
+        }
+        prev_size = compressed.size();
+
+        size_t offset = 0;
+        auto const decompressed = hi::inflate(compressed, offset);
+        REQUIRE(decompressed == original_bytes);
+    }
+}
+
+TEST_CASE(deflate_long_runs)
+{
+    // Runs longer than the maximum match length and larger than a stored block.
+    auto original = hi::bstring(100'000, std::byte{'a'});
+    for (size_t i = 0; i < original.size(); i += 1000) {
+        original[i] = static_cast<std::byte>(i);
+    }
+
+    for (auto level : {0, 1, 4, 9}) {
+        auto const compressed = hi::deflate(original, level);
+
+        size_t offset = 0;
+        auto const decompressed = hi::inflate(compressed, offset);
+        REQUIRE(decompressed == original);
+    }
+}
+
+TEST_CASE(zlib_round_trip)
+{
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test4.bin"};
+    auto const original_bytes = as_bstring_view(original);
+
+    auto const compressed = hi::zlib_compress(original_bytes);
+    auto const decompressed = hi::zlib_decompress(compressed, 0x0100'0000);
+    REQUIRE(decompressed == original_bytes);
+}
+
+TEST_CASE(zlib_corrupt_checksum)
+{
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test4.bin"};
+    auto const original_bytes = as_bstring_view(original);
+
+    auto compressed = hi::zlib_compress(original_bytes);
+    // Corrupt the Adler-32 in the trailer.
+    compressed.back() ^= std::byte{1};
+
+    REQUIRE_THROWS(hi::zlib_decompress(compressed, 0x0100'0000), hi::parse_error);
+    REQUIRE(hi::zlib_decompress(compressed, 0x0100'0000, false) == original_bytes);
+
+    auto decoder = hi::zlib_decoder{};
+    auto output_buffer = hi::bstring(original_bytes.size(), std::byte{0});
+    auto input = std::span<std::byte const>{compressed};
+    auto output = std::span<std::byte>{output_buffer};
+    REQUIRE_THROWS(decoder.decode(input, output), hi::parse_error);
+
+    auto unverified_decoder = hi::zlib_decoder{false};
+    input = std::span<std::byte const>{compressed};
+    output = std::span<std::byte>{output_buffer};
+    REQUIRE(unverified_decoder.decode(input, output));
+    REQUIRE(output_buffer == original_bytes);
+}
+
+TEST_CASE(zlib_trailing_data)
+{
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test4.bin"};
+    auto const original_bytes = as_bstring_view(original);
+
+    auto const trailing = std::string_view{"trailing data after the zlib stream"};
+    auto compressed = hi::zlib_compress(original_bytes);
+    auto const compressed_size = compressed.size();
+    compressed.append(reinterpret_cast<std::byte const *>(trailing.data()), trailing.size());
+
+    REQUIRE(hi::zlib_decompress(compressed, 0x0100'0000) == original_bytes);
+
+    // Feed the decoder one byte at a time and in one go; the trailing data is
+    // returned by unused() followed by the rest of the input.
+    for (auto chunk_size : {std::size_t{1}, compressed.size()}) {
+        auto decoder = hi::zlib_decoder{};
+        auto output_buffer = hi::bstring(original_bytes.size(), std::byte{0});
+        auto output = std::span<std::byte>{output_buffer};
+
+        auto offset = std::size_t{0};
+        auto input = std::span<std::byte const>{};
+        while (true) {
+            if (input.empty()) {
+                auto const n = std::min(chunk_size, compressed.size() - offset);
+                input = std::span<std::byte const>{compressed}.subspan(offset, n);
+                offset += n;
+            }
+            if (decoder.decode(input, output)) {
+                break;
+            }
+        }
+        REQUIRE(output_buffer == original_bytes);
+
+        auto const unused = decoder.unused();
+        auto rest = hi::bstring(unused.begin(), unused.end());
+        rest.append(input.data(), input.size());
+        rest.append(std::span<std::byte const>{compressed}.subspan(offset).data(), compressed.size() - offset);
+        REQUIRE(rest == compressed.substr(compressed_size));
+    }
+}
+
+TEST_CASE(gzip_round_trip)
+{
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test5.bin"};
+    auto const original_bytes = as_bstring_view(original);
+
+    for (auto level : {1, 9}) {
+        auto const compressed = hi::gzip_compress(original_bytes, level);
+        auto const decompressed = hi::gzip_decompress(compressed, 0x0100'0000);
+        REQUIRE(decompressed == original_bytes);
+    }
+}
+
+};
@@ -9,8 +9,12 @@
 #include "../parser/parser.hpp"
 #include "../macros.hpp"
 #include "inflate.hpp"
+#include "deflate.hpp"
+#include "crc32.hpp"
 #include <cstddef>
+#include <array>
 #include <filesystem>
+#include <concepts>
 
 hi_export_module(hikogui.codec.gzip);
 
@@ -27,15 +31,20 @@ struct gzip_member_header {
     uint8_t OS;
 };
 
-[[nodiscard]] inline bstring gzip_decompress_member(std::span<std::byte const> bytes, std::size_t &offset, std::size_t max_size)
+inline void gzip_check_member_header(gzip_member_header const& header)
 {
-    auto const header = make_placement_ptr<gzip_member_header>(bytes, offset);
+    hi_check(header.ID1 == 31, "GZIP Member header ID1 must be 31");
+    hi_check(header.ID2 == 139, "GZIP Member header ID2 must be 139");
+    hi_check(header.CM == 8, "GZIP Member header CM must be 8");
+    hi_check((header.FLG & 0xe0) == 0, "GZIP Member header FLG reserved bits must be 0");
+    hi_check(header.XFL == 2 or header.XFL == 4, "GZIP Member header XFL must be 2 or 4");
+}
 
-    hi_check(header->ID1 == 31, "GZIP Member header ID1 must be 31");
-    hi_check(header->ID2 == 139, "GZIP Member header ID2 must be 139");
-    hi_check(header->CM == 8, "GZIP Member header CM must be 8");
-    hi_check((header->FLG & 0xe0) == 0, "GZIP Member header FLG reserved bits must be 0");
-    hi_check(header->XFL == 2 or header->XFL == 4, "GZIP Member header XFL must be 2 or 4");
+[[nodiscard]] inline bstring
+gzip_decompress_member(std::span<std::byte const> bytes, std::size_t &offset, std::size_t max_size, bool verify_checksum)
+{
+    auto const header = make_placement_ptr<gzip_member_header>(bytes, offset);
+    gzip_check_member_header(*header);
     [[maybe_unused]] auto const FTEXT = to_bool(header->FLG & 1);
     auto const FHCRC = to_bool(header->FLG & 2);
     auto const FEXTRA = to_bool(header->FLG & 4);
@@ -69,24 +78,34 @@ struct gzip_member_header {
 
     auto r = inflate(bytes, offset, max_size);
 
-    [[maybe_unused]] auto CRC32 = **make_placement_ptr<little_uint32_buf_t>(bytes, offset);
-    [[maybe_unused]] auto ISIZE = **make_placement_ptr<little_uint32_buf_t>(bytes, offset);
+    auto const CRC32 = **make_placement_ptr<little_uint32_buf_t>(bytes, offset);
+    auto const ISIZE = **make_placement_ptr<little_uint32_buf_t>(bytes, offset);
 
     hi_check(
         ISIZE == (size(r) & 0xffffffff),
         "GZIP Member header ISIZE must be same as the lower 32 bits of the inflated size.");
+    hi_check(not verify_checksum or CRC32 == crc32(r), "GZIP Member CRC32 checksum failed.");
     return r;
 }
 
 }
 
-hi_export [[nodiscard]] inline bstring gzip_decompress(std::span<std::byte const> bytes, std::size_t max_size)
+/** Decompress a gzip stream.
+ *
+ * @param bytes The gzip stream, which may consist of multiple members.
+ * @param max_size The maximum size of the decompressed data.
+ * @param verify_checksum Check the CRC-32 of the decompressed data of each member.
+ * @return The decompressed data.
+ * @throw parse_error When the gzip data is invalid, or a checksum does not match.
+ */
+hi_export [[nodiscard]] inline bstring
+gzip_decompress(std::span<std::byte const> bytes, std::size_t max_size, bool verify_checksum = true)
 {
     auto r = bstring{};
 
     auto offset = 0_uz;
     while (offset < bytes.size()) {
-        auto member = detail::gzip_decompress_member(bytes, offset, max_size);
+        auto member = detail::gzip_decompress_member(bytes, offset, max_size, verify_checksum);
         max_size -= member.size();
         r.append(member);
     }
@@ -94,9 +113,285 @@ hi_export [[nodiscard]] inline bstring gzip_decompress(std::span<std::byte const
     return r;
 }
 
-hi_export [[nodiscard]] inline bstring gzip_decompress(std::filesystem::path const &path, std::size_t max_size = 0x01000000)
+hi_export [[nodiscard]] inline bstring
+gzip_decompress(std::filesystem::path const &path, std::size_t max_size = 0x01000000, bool verify_checksum = true)
+{
+    return gzip_decompress(as_span<std::byte const>(file_view{path}), max_size, verify_checksum);
+}
+
+/** Compress data into a gzip stream with a single member.
+ *
+ * @param bytes The data to compress.
+ * @param level The compression level: 0 stores the data uncompressed, 1 is the
+ *              fastest compression, up to 9 for the best compression.
+ * @return The gzip stream.
+ */
+hi_export [[nodiscard]] inline bstring gzip_compress(std::span<std::byte const> bytes, int level = 6)
+{
+    hi_axiom(level >= 0 and level <= 9);
+
+    auto r = bstring{};
+    r.reserve(bytes.size() / 2 + 18);
+
+    // ID1, ID2, CM, FLG, MTIME (4), XFL, OS (unknown)
+    auto const XFL = level <= 1 ? 4 : 2;
+    for (auto const c : {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, XFL, 255}) {
+        r.push_back(static_cast<std::byte>(c));
+    }
+
+    deflate(bytes, level, r);
+
+    auto trailer = std::array<std::byte, 8>{};
+    store_le(crc32(bytes), trailer.data());
+    store_le(truncate<uint32_t>(bytes.size()), trailer.data() + 4);
+    r.append(trailer.data(), trailer.size());
+    return r;
+}
+
+/** Compress data into a gzip file.
+ *
+ * @param path The path of the file to write.
+ * @param bytes The data to compress.
+ * @param level The compression level.
+ */
+hi_export inline void gzip_compress(std::filesystem::path const& path, std::span<std::byte const> bytes, int level = 6)
 {
-    return gzip_decompress(as_span<std::byte const>(file_view{path}), max_size);
+    auto f = file(path, access_mode::truncate_or_create_for_write);
+    f.write(gzip_compress(bytes, level));
+}
+
+/** A resumable gzip decoder.
+ *
+ * The decoder is fed with chunks of gzip data and writes the
+ * decompressed data into buffers supplied by the caller.
+ *
+ * A gzip file may consist of multiple members. The decoder returns at
+ * the end of each member; when `decode()` is called again with more input
+ * the decoder continues with the next member.
+ *
+ * @see inflate_decoder
+ */
+hi_export class gzip_decoder {
+public:
+    /** Create a gzip decoder.
+     *
+     * @param verify_checksum Check the CRC-32 of the decompressed data of each member.
+     */
+    explicit gzip_decoder(bool verify_checksum = true) noexcept : _verify_checksum(verify_checksum) {}
+
+    /** Check if the end of a gzip member has been reached.
+     */
+    [[nodiscard]] bool done() const noexcept
+    {
+        return _state == state_type::done;
+    }
+
+    /** Decode a chunk of gzip data.
+     *
+     * @param[in,out] input The gzip data, on return the data that was not consumed.
+     * @param[in,out] output The buffer to write decompressed data to, on return the part
+     *                of the buffer that was not written.
+     * @return true when the end of a gzip member is reached.
+     * @throw parse_error When the gzip data is invalid.
+     */
+    [[nodiscard]] bool decode(std::span<std::byte const>& input, std::span<std::byte>& output)
+    {
+        while (true) {
+            switch (_state) {
+            case state_type::header:
+                if (not fill(input, sizeof(detail::gzip_member_header))) {
+                    return false;
+                }
+
+                {
+                    auto const header = make_placement_ptr<detail::gzip_member_header>(std::span<std::byte const>{_buffer});
+                    detail::gzip_check_member_header(*header);
+                    _flags = header->FLG;
+                }
+                _buffer.clear();
+                _state = state_type::extra_length;
+                break;
+
+            case state_type::extra_length:
+                if (to_bool(_flags & 4)) {
+                    if (not fill(input, sizeof(little_uint16_buf_t))) {
+                        return false;
+                    }
+                    _skip = **make_placement_ptr<little_uint16_buf_t>(std::span<std::byte const>{_buffer});
+                    _buffer.clear();
+                }
+                _state = state_type::extra;
+                break;
+
+            case state_type::extra:
+                {
+                    auto const n = std::min(_skip, input.size());
+                    input = input.subspan(n);
+                    _skip -= n;
+                }
+                if (_skip != 0) {
+                    return false;
+                }
+                _state = state_type::name;
+                break;
+
+            case state_type::name:
+                if (to_bool(_flags & 8) and not skip_string(input)) {
+                    return false;
+                }
+                _state = state_type::comment;
+                break;
+
+            case state_type::comment:
+                if (to_bool(_flags & 16) and not skip_string(input)) {
+                    return false;
+                }
+                _state = state_type::header_crc;
+                break;
+
+            case state_type::header_crc:
+                if (to_bool(_flags & 2)) {
+                    if (not fill(input, sizeof(little_uint16_buf_t))) {
+                        return false;
+                    }
+                    _buffer.clear();
+                }
+                _state = state_type::data;
+                break;
+
+            case state_type::data:
+                {
+                    auto const output_first = output.data();
+                    auto const done = _inflate.decode(input, output);
+                    if (_verify_checksum) {
+                        _crc32 = crc32({output_first, output.data()}, _crc32);
+                    }
+                    if (not done) {
+                        return false;
+                    }
+                }
+
+                _buffer.append(_inflate.unused().data(), _inflate.unused().size());
+                _state = state_type::trailer;
+                break;
+
+            case state_type::trailer:
+                if (not fill(input, 2 * sizeof(little_uint32_buf_t))) {
+                    return false;
+                }
+
+                {
+                    auto offset = 0_uz;
+                    auto const bytes = std::span<std::byte const>{_buffer};
+                    auto const CRC32 = **make_placement_ptr<little_uint32_buf_t>(bytes, offset);
+                    auto const ISIZE = **make_placement_ptr<little_uint32_buf_t>(bytes, offset);
+
+                    hi_check(
+                        ISIZE == (_inflate.size() & 0xffffffff),
+                        "GZIP Member header ISIZE must be same as the lower 32 bits of the inflated size.");
+                    hi_check(not _verify_checksum or CRC32 == _crc32, "GZIP Member CRC32 checksum failed.");
+                }
+                _buffer.clear();
+                _state = state_type::done;
+                return true;
+
+            case state_type::done:
+                if (input.empty()) {
+                    return true;
+                }
+
+                // Start with the next member.
+                _inflate = inflate_decoder{};
+                _flags = 0;
+                _crc32 = 0;
+                _state = state_type::header;
+                break;
+
+            default:
+                hi_no_default();
+            }
+        }
+    }
+
+private:
+    enum class state_type : uint8_t { header, extra_length, extra, name, comment, header_crc, data, trailer, done };
+
+    state_type _state = state_type::header;
+    uint8_t _flags = 0;
+    bool _verify_checksum = true;
+    uint32_t _crc32 = 0;
+    std::size_t _skip = 0;
+    inflate_decoder _inflate;
+
+    /** Buffer to collect the header fields and trailer from multiple chunks.
+     */
+    bstring _buffer;
+
+    [[nodiscard]] bool fill(std::span<std::byte const>& input, std::size_t size)
+    {
+        hi_axiom(_buffer.size() <= size);
+        auto const n = std::min(size - _buffer.size(), input.size());
+        _buffer.append(input.data(), n);
+        input = input.subspan(n);
+        return _buffer.size() == size;
+    }
+
+    /** Skip over a nul-terminated string.
+     *
+     * @return true if the nul-terminator was found.
+     */
+    [[nodiscard]] static bool skip_string(std::span<std::byte const>& input) noexcept
+    {
+        while (not input.empty()) {
+            auto const c = input.front();
+            input = input.subspan(1);
+            if (c == std::byte{0}) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+/** Decompress a gzip file in chunks.
+ *
+ * The file is read in chunks and the decompressed data is passed
+ * in chunks to @a sink, the complete decompressed data is never held in memory.
+ *
+ * @param path The path to the gzip file.
+ * @param sink A function `void(std::span<std::byte const>)` which is called with each chunk of decompressed data.
+ * @param verify_checksum Check the CRC-32 of the decompressed data of each member.
+ * @throw parse_error When the gzip data is invalid, or a checksum does not match.
+ * @throw io_error When the file could not be read.
+ */
+hi_export template<std::invocable<std::span<std::byte const>> Sink>
+void gzip_decompress(std::filesystem::path const& path, Sink&& sink, bool verify_checksum = true)
+{
+    constexpr auto chunk_size = 0x1'0000_uz;
+
+    auto f = file{path};
+    auto decoder = gzip_decoder{verify_checksum};
+    auto input_buffer = bstring(chunk_size, std::byte{0});
+    auto output_buffer = bstring(chunk_size, std::byte{0});
+
+    auto input = std::span<std::byte const>{};
+    while (true) {
+        auto output = std::span{output_buffer};
+        auto const done = decoder.decode(input, output);
+        if (auto const n = output_buffer.size() - output.size()) {
+            sink(std::span<std::byte const>{output_buffer.data(), n});
+        }
+
+        if (input.empty() and (done or not output.empty())) {
+            // The decoder stopped because it needs more input, or there may be another member.
+            auto const n = f.read(input_buffer.data(), input_buffer.size());
+            if (n == 0) {
+                hi_check(done, "GZIP data is truncated");
+                return;
+            }
+            input = std::span{input_buffer.data(), n};
+        }
+    }
 }
 
 }} // namespace hi::inline v1
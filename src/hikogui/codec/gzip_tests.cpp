@@ -3,11 +3,15 @@
 // (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
 
 #include "gzip.hpp"
+#include "zlib.hpp"
 #include "../file/file.hpp"
 #include "../container/container.hpp"
 #include "../path/path.hpp"
 #include "../utility/utility.hpp"
 #include <hikotest/hikotest.hpp>
+#include <algorithm>
+#include <array>
+#include <span>
 
 TEST_SUITE(gzip_suite) {
 
@@ -125,4 +129,131 @@ TEST_CASE(unzip_xargs1)
     }
 }
 
+TEST_CASE(unzip_stream_sum)
+{
+    auto decompressed = hi::bstring{};
+    hi::gzip_decompress(hi::library_test_data_dir() / "gzip_test7.bin.gz", [&](std::span<std::byte const> chunk) {
+        decompressed.append(chunk.data(), chunk.size());
+    });
+
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test7.bin"};
+    auto const original_bytes = as_bstring_view(original);
+
+    REQUIRE(decompressed == original_bytes);
+}
+
+TEST_CASE(unzip_decoder_small_chunks)
+{
+    auto const compressed = hi::file_view{hi::library_test_data_dir() / "gzip_test4.bin.gz"};
+    auto const compressed_bytes = hi::as_span<std::byte const>(compressed);
+
+    auto decoder = hi::gzip_decoder{};
+    auto decompressed = hi::bstring{};
+    auto output_buffer = std::array<std::byte, 7>{};
+
+    // Feed the decoder one byte at a time, with a tiny output buffer.
+    auto done = false;
+    auto input = std::span<std::byte const>{};
+    std::size_t offset = 0;
+    while (true) {
+        auto output = std::span<std::byte>{output_buffer};
+        done = decoder.decode(input, output);
+        decompressed.append(output_buffer.data(), output_buffer.size() - output.size());
+
+        if (input.empty() and (done or not output.empty())) {
+            if (offset == compressed_bytes.size()) {
+                break;
+            }
+            input = compressed_bytes.subspan(offset++, 1);
+        }
+    }
+    REQUIRE(done);
+
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test4.bin"};
+    auto const original_bytes = as_bstring_view(original);
+
+    REQUIRE(decompressed == original_bytes);
+}
+
+
+TEST_CASE(unzip_corrupt_checksum)
+{
+    auto const compressed = hi::file_view{hi::library_test_data_dir() / "gzip_test4.bin.gz"};
+    auto corrupt = hi::bstring{as_bstring_view(compressed)};
+    // Corrupt the CRC32 in the trailer.
+    corrupt[corrupt.size() - 8] ^= std::byte{1};
+
+    REQUIRE_THROWS(hi::gzip_decompress(corrupt, 0x0100'0000), hi::parse_error);
+
+    auto const original = hi::file_view{hi::library_test_data_dir() / "gzip_test4.bin"};
+    auto const original_bytes = as_bstring_view(original);
+    REQUIRE(hi::gzip_decompress(corrupt, 0x0100'0000, false) == original_bytes);
+
+    auto decoder = hi::gzip_decoder{};
+    auto output_buffer = hi::bstring(original_bytes.size(), std::byte{0});
+    auto input = std::span<std::byte const>{corrupt};
+    auto output = std::span<std::byte>{output_buffer};
+    REQUIRE_THROWS(decoder.decode(input, output), hi::parse_error);
+}
+
+TEST_CASE(zlib_decoder_stored_length_mismatch)
+{
+    // A zlib stream with a stored block of "hello"; NLEN is not the one's complement of LEN.
+    constexpr auto compressed = std::array<uint8_t, 16>{
+        0x78, 0x01, 0x01, 0x05, 0x00, 0xfa, 0xfe, 'h', 'e', 'l', 'l', 'o', 0x06, 0x2c, 0x02, 0x15};
+    auto const compressed_bytes = std::as_bytes(std::span{compressed});
+
+    REQUIRE_THROWS(hi::zlib_decompress(compressed_bytes, 0x0100'0000), hi::parse_error);
+
+    auto decoder = hi::zlib_decoder{};
+    auto output_buffer = std::array<std::byte, 16>{};
+    auto input = std::span<std::byte const>{compressed_bytes};
+    auto output = std::span<std::byte>{output_buffer};
+    REQUIRE_THROWS(decoder.decode(input, output), hi::parse_error);
+}
+
+TEST_CASE(zlib_decoder_trailing_data)
+{
+    // "The quick brown fox jumps over the lazy dog. " three times as a zlib stream, followed by "tail".
+    constexpr auto compressed = std::array<uint8_t, 59>{
+        0x78, 0xda, 0x0b, 0xc9, 0x48, 0x55, 0x28, 0x2c, 0xcd, 0x4c, 0xce, 0x56, 0x48, 0x2a, 0xca, 0x2f, 0xcf, 0x53, 0x48, 0xcb,
+        0xaf, 0x50, 0xc8, 0x2a, 0xcd, 0x2d, 0x28, 0x56, 0xc8, 0x2f, 0x4b, 0x2d, 0x52, 0x28, 0x01, 0x4a, 0xe7, 0x24, 0x56, 0x55,
+        0x2a, 0xa4, 0xe4, 0xa7, 0xeb, 0x29, 0x84, 0xd0, 0x4c, 0x31, 0x00, 0xf9, 0x3c, 0x30, 0x76, 't',  'a',  'i',  'l'};
+    auto const compressed_bytes = std::as_bytes(std::span{compressed});
+    auto const stream_size = std::size_t{55};
+
+    // Feed the decoder one byte at a time and in one go; the trailing data is
+    // returned by unused() followed by the rest of the input.
+    for (auto chunk_size : {std::size_t{1}, compressed_bytes.size()}) {
+        auto decoder = hi::zlib_decoder{};
+        auto output_buffer = hi::bstring(135, std::byte{0});
+        auto output = std::span<std::byte>{output_buffer};
+
+        auto offset = std::size_t{0};
+        auto input = std::span<std::byte const>{};
+        while (true) {
+            if (input.empty()) {
+                auto const n = std::min(chunk_size, compressed_bytes.size() - offset);
+                input = compressed_bytes.subspan(offset, n);
+                offset += n;
+            }
+            if (decoder.decode(input, output)) {
+                break;
+            }
+        }
+
+        REQUIRE(output.empty());
+        auto const text = std::string_view{reinterpret_cast<char const *>(output_buffer.data()), output_buffer.size()};
+        REQUIRE(text.substr(90) == "The quick brown fox jumps over the lazy dog. ");
+
+        auto const unused = decoder.unused();
+        auto rest = hi::bstring(unused.begin(), unused.end());
+        rest.append(input.data(), input.size());
+        rest.append(compressed_bytes.subspan(offset).data(), compressed_bytes.size() - offset);
+
+        auto const tail = compressed_bytes.subspan(stream_size);
+        REQUIRE(rest == hi::bstring(tail.begin(), tail.end()));
+    }
+}
+
 };
@@ -8,7 +8,10 @@
 #include "../macros.hpp"
 #include <span>
 #include <vector>
+#include <array>
 #include <algorithm>
+#include <functional>
+#include <cstdint>
 
 hi_export_module(hikogui.codec.huffman);
 
@@ -171,4 +174,344 @@ public:
     }
 };
 
+/** A table driven canonical-huffman decoder.
+ *
+ * The decoder looks up a symbol using multiple bits from the stream at once,
+ * instead of walking a tree one bit at a time.
+ *
+ * The primary table is indexed with the next `primary_bits` bits of the
+ * LSB-first bit-stream. Huffman codes are stored MSB-first in the bit-stream
+ * therefor the codes are bit-reversed when inserted in the table. Codes that
+ * are longer than `primary_bits` are found through a second-level sub-table,
+ * which is indexed by the remaining bits of the code.
+ *
+ * Each entry in the table has the following layout:
+ *  - [15:0] The symbol, or the offset of the sub-table.
+ *  - [19:16] The total length of the code in bits, zero for an invalid code.
+ *  - [23:20] The number of index bits of the sub-table.
+ *  - [24] The entry is a link to a sub-table.
+ */
+hi_export class huffman_table {
+public:
+    /** The maximum number of bits used to index the primary table.
+     */
+    constexpr static std::size_t primary_bits = 10;
+
+    /** The maximum length of a code in bits.
+     */
+    constexpr static std::size_t max_code_length = 15;
+
+    huffman_table() noexcept = default;
+
+    /** Find a symbol in the huffman-table.
+     *
+     * @param bits The next bits from the huffman encoded stream, LSB first.
+     * @param[out] length The number of bits of the code of the symbol,
+     *                    or zero if the bits do not form a code in the table.
+     * @return The decoded symbol.
+     */
+    [[nodiscard]] hi_force_inline std::size_t find(uint64_t bits, std::size_t& length) const noexcept
+    {
+        hi_axiom(not _table.empty());
+
+        auto entry = _table[bits & _primary_mask];
+        if (entry & link_flag) [[unlikely]] {
+            auto const sub_table_mask = (uint64_t{1} << ((entry >> 20) & 0xf)) - 1;
+            entry = _table[(entry & 0xffff) + ((bits >> _primary_bits) & sub_table_mask)];
+        }
+
+        length = (entry >> 16) & 0xf;
+        return entry & 0xffff;
+    }
+
+    /** Get a symbol from the huffman-table.
+     *
+     * @param bits The next bits from the huffman encoded stream, LSB first.
+     *             At least `max_code_length` bits must be valid, or all the
+     *             remaining bits of the stream.
+     * @param[out] length The number of bits of the code of the symbol.
+     * @return The decoded symbol.
+     * @throw parse_error on an invalid code-bit sequence.
+     */
+    [[nodiscard]] hi_force_inline std::size_t get(uint64_t bits, std::size_t& length) const
+    {
+        auto const symbol = find(bits, length);
+        if (length == 0) {
+            throw parse_error("Code not in huffman table.");
+        }
+        return symbol;
+    }
+
+    /** Build a canonical-huffman table from a set of lengths.
+     *
+     * Incomplete codes are allowed, the unused codes will throw when decoded.
+     *
+     * @param lengths The length in bits of the code of each symbol, zero when unused.
+     * @param nr_symbols The number of symbols.
+     * @throw parse_error When the lengths form an over-subscribed code.
+     */
+    [[nodiscard]] static huffman_table from_lengths(uint8_t const *lengths, std::size_t nr_symbols)
+    {
+        hi_assert_not_null(lengths);
+        hi_axiom(nr_symbols <= 0x10000);
+
+        auto count = std::array<uint16_t, max_code_length + 1>{};
+        for (auto symbol = 0_uz; symbol != nr_symbols; ++symbol) {
+            hi_check(lengths[symbol] <= max_code_length, "Huffman code length too large.");
+            ++count[lengths[symbol]];
+        }
+        count[0] = 0;
+
+        auto max_length = 0_uz;
+        auto left = 1;
+        auto next_code = std::array<uint16_t, max_code_length + 1>{};
+        for (auto length = 1_uz; length <= max_code_length; ++length) {
+            left <<= 1;
+            left -= count[length];
+            hi_check(left >= 0, "Huffman code is over-subscribed.");
+
+            next_code[length] = narrow_cast<uint16_t>((next_code[length - 1] + count[length - 1]) << 1);
+            if (count[length] != 0) {
+                max_length = length;
+            }
+        }
+
+        auto r = huffman_table{};
+        r._primary_bits = std::clamp(max_length, 1_uz, primary_bits);
+        r._primary_mask = (uint64_t{1} << r._primary_bits) - 1;
+
+        auto const primary_size = 1_uz << r._primary_bits;
+
+        // Assign the canonical codes; bit reversed, so they can be matched in LSB-first order.
+        auto codes = std::vector<uint16_t>(nr_symbols, 0);
+        auto sub_table_bits = std::vector<uint8_t>(max_length > r._primary_bits ? primary_size : 0, 0);
+        for (auto symbol = 0_uz; symbol != nr_symbols; ++symbol) {
+            if (auto const length = lengths[symbol]) {
+                auto const code = codes[symbol] = reverse_bits(next_code[length]++, length);
+
+                if (length > r._primary_bits) {
+                    auto& bits = sub_table_bits[code & r._primary_mask];
+                    bits = std::max(bits, narrow_cast<uint8_t>(length - r._primary_bits));
+                }
+            }
+        }
+
+        // Layout the sub-tables after the primary table.
+        auto table_size = primary_size;
+        r._table.resize(primary_size, 0);
+        for (auto prefix = 0_uz; prefix != sub_table_bits.size(); ++prefix) {
+            if (auto const bits = sub_table_bits[prefix]) {
+                hi_axiom(table_size <= 0xffff);
+                r._table[prefix] = link_flag | (uint32_t{bits} << 20) | narrow_cast<uint32_t>(table_size);
+                table_size += 1_uz << bits;
+            }
+        }
+        r._table.resize(table_size, 0);
+
+        for (auto symbol = 0_uz; symbol != nr_symbols; ++symbol) {
+            auto const length = lengths[symbol];
+            if (length == 0) {
+                continue;
+            }
+
+            auto const code = codes[symbol];
+            auto const entry = (uint32_t{length} << 16) | narrow_cast<uint32_t>(symbol);
+
+            if (length <= r._primary_bits) {
+                // Fill every entry which has the code as prefix.
+                for (auto i = size_t{code}; i < primary_size; i += 1_uz << length) {
+                    r._table[i] = entry;
+                }
+
+            } else {
+                auto const link = r._table[code & r._primary_mask];
+                auto const sub_table_offset = link & 0xffff;
+                auto const sub_table_size = 1_uz << ((link >> 20) & 0xf);
+                auto const sub_code_length = length - r._primary_bits;
+
+                for (auto i = size_t{code} >> r._primary_bits; i < sub_table_size; i += 1_uz << sub_code_length) {
+                    r._table[sub_table_offset + i] = entry;
+                }
+            }
+        }
+
+        return r;
+    }
+
+    [[nodiscard]] static huffman_table from_lengths(std::vector<uint8_t> const& lengths)
+    {
+        return from_lengths(lengths.data(), lengths.size());
+    }
+
+private:
+    constexpr static uint32_t link_flag = 0x0100'0000;
+
+    /** The primary table followed by the sub-tables.
+     */
+    std::vector<uint32_t> _table = {};
+
+    std::size_t _primary_bits = 0;
+    uint64_t _primary_mask = 0;
+
+    [[nodiscard]] constexpr static uint16_t reverse_bits(uint16_t code, std::size_t length) noexcept
+    {
+        auto r = uint16_t{0};
+        for (auto i = 0_uz; i != length; ++i) {
+            r <<= 1;
+            r |= code & 1;
+            code >>= 1;
+        }
+        return r;
+    }
+};
+
+/** Calculate the lengths of the codes of a length-limited canonical-huffman code.
+ *
+ * The lengths are first calculated for an optimal huffman code, when
+ * a code becomes longer than @a max_length, lengths are redistributed from
+ * the longest codes toward shorter codes until the code fits.
+ *
+ * The resulting code is always complete. When only a single symbol has a
+ * non-zero frequency, a second symbol is given a code of length 1.
+ *
+ * @param frequencies The frequency of each symbol.
+ * @param max_length The maximum length of a code.
+ * @return The length of the code of each symbol, zero for symbols with zero frequency.
+ */
+hi_export [[nodiscard]] inline std::vector<uint8_t> huffman_code_lengths(std::span<std::size_t const> frequencies, std::size_t max_length)
+{
+    hi_axiom(max_length >= 1 and max_length <= 31);
+
+    auto r = std::vector<uint8_t>(frequencies.size(), 0);
+
+    // The symbols that are used, sorted by frequency, ties are ordered by symbol.
+    auto symbols = std::vector<std::size_t>{};
+    for (auto symbol = 0_uz; symbol != frequencies.size(); ++symbol) {
+        if (frequencies[symbol] != 0) {
+            symbols.push_back(symbol);
+        }
+    }
+
+    if (symbols.empty()) {
+        return r;
+
+    } else if (symbols.size() == 1) {
+        hi_axiom(frequencies.size() >= 2);
+        r[symbols.front()] = 1;
+        r[symbols.front() == 0 ? 1 : 0] = 1;
+        return r;
+    }
+
+    std::stable_sort(symbols.begin(), symbols.end(), [&](auto const& a, auto const& b) {
+        return frequencies[a] < frequencies[b];
+    });
+
+    // Build the huffman tree by merging the two least frequent nodes.
+    // The leaves are the first nodes, each merged node is appended.
+    struct node_type {
+        std::size_t frequency;
+        std::size_t index;
+
+        [[nodiscard]] constexpr bool operator>(node_type const& rhs) const noexcept
+        {
+            return frequency == rhs.frequency ? index > rhs.index : frequency > rhs.frequency;
+        }
+    };
+
+    auto queue = std::vector<node_type>{};
+    auto parents = std::vector<std::size_t>(symbols.size() * 2 - 1, 0);
+    for (auto i = 0_uz; i != symbols.size(); ++i) {
+        queue.emplace_back(frequencies[symbols[i]], i);
+    }
+    std::make_heap(queue.begin(), queue.end(), std::greater{});
+
+    for (auto next = symbols.size(); queue.size() > 1; ++next) {
+        std::pop_heap(queue.begin(), queue.end(), std::greater{});
+        auto const a = queue.back();
+        queue.pop_back();
+        std::pop_heap(queue.begin(), queue.end(), std::greater{});
+        auto const b = queue.back();
+        queue.pop_back();
+
+        parents[a.index] = next;
+        parents[b.index] = next;
+        queue.emplace_back(a.frequency + b.frequency, next);
+        std::push_heap(queue.begin(), queue.end(), std::greater{});
+    }
+
+    // The root is the last node; parents always come after their children.
+    auto depths = std::vector<std::size_t>(parents.size(), 0);
+    auto counts = std::vector<std::size_t>(std::max(symbols.size(), max_length) + 1, 0);
+    for (auto i = parents.size() - 1; i-- != 0;) {
+        depths[i] = depths[parents[i]] + 1;
+        if (i < symbols.size()) {
+            ++counts[depths[i]];
+        }
+    }
+
+    // Move the codes that are too long to max_length, then split shorter codes
+    // to restore the Kraft equality.
+    for (auto length = max_length + 1; length < counts.size(); ++length) {
+        counts[max_length] += counts[length];
+        counts[length] = 0;
+    }
+
+    auto total = 0_uz;
+    for (auto length = 1_uz; length <= max_length; ++length) {
+        total += counts[length] << (max_length - length);
+    }
+
+    while (total != (1_uz << max_length)) {
+        hi_axiom(total > (1_uz << max_length));
+        --counts[max_length];
+        for (auto length = max_length - 1; length != 0; --length) {
+            if (counts[length] != 0) {
+                --counts[length];
+                counts[length + 1] += 2;
+                break;
+            }
+        }
+        --total;
+    }
+
+    // The least frequent symbols get the longest codes.
+    auto it = symbols.begin();
+    for (auto length = max_length; length != 0; --length) {
+        for (auto i = 0_uz; i != counts[length]; ++i) {
+            hi_axiom(it != symbols.end());
+            r[*it++] = narrow_cast<uint8_t>(length);
+        }
+    }
+
+    return r;
+}
+
+/** Calculate the codes of a canonical-huffman code.
+ *
+ * @param lengths The length of the code of each symbol.
+ * @return The code of each symbol, MSB first.
+ */
+hi_export [[nodiscard]] inline std::vector<uint16_t> huffman_codes(std::span<uint8_t const> lengths)
+{
+    auto counts = std::array<uint16_t, 17>{};
+    for (auto const length : lengths) {
+        hi_axiom(length <= 16);
+        ++counts[length];
+    }
+    counts[0] = 0;
+
+    auto next_code = std::array<uint16_t, 17>{};
+    for (auto length = 1_uz; length != next_code.size(); ++length) {
+        next_code[length] = narrow_cast<uint16_t>((next_code[length - 1] + counts[length - 1]) << 1);
+    }
+
+    auto r = std::vector<uint16_t>(lengths.size(), 0);
+    for (auto symbol = 0_uz; symbol != lengths.size(); ++symbol) {
+        if (auto const length = lengths[symbol]) {
+            r[symbol] = next_code[length]++;
+        }
+    }
+    return r;
+}
+
 }} // namespace hi::v1
@@ -0,0 +1,192 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "datum.hpp"
+#include "jsonpath_plan.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <cstddef>
+#include <format>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+hi_export_module(hikogui.codec.indexed_datum);
+
+hi_export namespace hi { inline namespace v1 {
+
+/** A datum document with an index of path lookups.
+ *
+ * Singular paths that are looked up through a `jsonpath_plan` are remembered in an
+ * index from the hash of the path to the value, so that repeated lookups of the same
+ * path take constant time. Paths that are not found are remembered as well.
+ *
+ * An entry holds on to the string shared by the copies of the plan, a lookup through
+ * the same plan is recognized by the address of that string; the strings themselves
+ * are only compared when different plans have the same hash.
+ *
+ * The index is only valid as long as the structure of the document does not change,
+ * therefore the document can only be modified through this class:
+ *  - `write()` replaces a leaf value in place and keeps the index, when it needs
+ *    to create, remove or replace a vector or map the index is cleared.
+ *  - `remove()`, assignment and `modify()` clear the index.
+ *
+ * The index is updated by const member functions; like other containers an
+ * `indexed_datum` must be externally synchronized when shared between threads.
+ */
+hi_export class indexed_datum {
+public:
+    indexed_datum() noexcept = default;
+    indexed_datum(indexed_datum const& other) : _value(other._value) {}
+    indexed_datum(indexed_datum&& other) noexcept : _value(std::move(other._value)) {}
+
+    indexed_datum& operator=(indexed_datum const& other)
+    {
+        _value = other._value;
+        invalidate();
+        return *this;
+    }
+
+    indexed_datum& operator=(indexed_datum&& other) noexcept
+    {
+        _value = std::move(other._value);
+        invalidate();
+        other.invalidate();
+        return *this;
+    }
+
+    explicit indexed_datum(datum value) noexcept : _value(std::move(value)) {}
+
+    indexed_datum& operator=(datum value) noexcept
+    {
+        _value = std::move(value);
+        invalidate();
+        return *this;
+    }
+
+    [[nodiscard]] datum const& operator*() const noexcept
+    {
+        return _value;
+    }
+
+    [[nodiscard]] datum const *operator->() const noexcept
+    {
+        return std::addressof(_value);
+    }
+
+    /** The number of paths in the index.
+     */
+    [[nodiscard]] std::size_t index_size() const noexcept
+    {
+        return _index.size();
+    }
+
+    /** Clear the index.
+     */
+    void invalidate() noexcept
+    {
+        _index.clear();
+    }
+
+    /** Get mutable access to the document.
+     *
+     * The index is cleared, the returned reference should not be kept beyond the
+     * modification of the document.
+     */
+    [[nodiscard]] datum& modify() noexcept
+    {
+        invalidate();
+        return _value;
+    }
+
+    /** Find a value by path.
+     *
+     * @param path A singular path.
+     * @return A pointer to the value found, or nullptr.
+     */
+    [[nodiscard]] datum const *find_one(jsonpath_plan const& path) const
+    {
+        return lookup(path);
+    }
+
+    /** Write a value.
+     *
+     * Intermediate maps and vectors are created when needed.
+     *
+     * @param path A singular path.
+     * @param value The new value.
+     * @return true when the document was modified, false if the value was already equal.
+     * @throws std::domain_error When the path could not be created in the document.
+     */
+    bool write(jsonpath_plan const& path, datum value)
+    {
+        if (auto *const v = lookup(path); v != nullptr and is_leaf(*v) and is_leaf(value)) {
+            // Replacing a leaf does not move any other value in the document.
+            if (*v == value) {
+                return false;
+            }
+            *v = std::move(value);
+            return true;
+        }
+
+        invalidate();
+        auto *const v = _value.find_one_or_create(path.path());
+        if (v == nullptr) {
+            throw std::domain_error(std::format("Could not create {} in the document", path));
+        }
+
+        if (*v == value) {
+            return false;
+        }
+        *v = std::move(value);
+        return true;
+    }
+
+    /** Remove a value, and any resulting empty maps and vectors.
+     *
+     * @param path A path to remove.
+     * @return true if one or more values were removed.
+     */
+    bool remove(jsonpath_plan const& path) noexcept
+    {
+        invalidate();
+        return _value.remove(path.path());
+    }
+
+private:
+    struct entry_type {
+        std::shared_ptr<std::string const> path;
+        datum *value;
+    };
+
+    datum _value;
+    mutable std::unordered_multimap<std::size_t, entry_type> _index;
+
+    [[nodiscard]] static bool is_leaf(datum const& value) noexcept
+    {
+        return not holds_alternative<datum::vector_type>(value) and not holds_alternative<datum::map_type>(value);
+    }
+
+    [[nodiscard]] datum *lookup(jsonpath_plan const& path) const
+    {
+        hi_axiom(path.is_singular());
+
+        auto [first, last] = _index.equal_range(path.hash());
+        for (; first != last; ++first) {
+            auto const& entry = first->second;
+            if (entry.path == path.shared_string() or (entry.path and *entry.path == path.string())) {
+                return entry.value;
+            }
+        }
+
+        auto *const r = path.find_one(const_cast<datum&>(_value));
+        _index.emplace(path.hash(), entry_type{path.shared_string(), r});
+        return r;
+    }
+};
+
+}} // namespace hi::v1
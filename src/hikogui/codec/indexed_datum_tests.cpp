@@ -0,0 +1,85 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "indexed_datum.hpp"
+#include "JSON.hpp"
+#include <hikotest/hikotest.hpp>
+
+TEST_SUITE(indexed_datum_suite) {
+
+TEST_CASE(find_one)
+{
+    auto const doc = hi::indexed_datum{hi::parse_JSON(R"({"a": {"b": [1, 2, 3]}, "c": "x"})")};
+    auto const b1 = hi::jsonpath_plan{"$.a.b[1]"};
+    auto const d = hi::jsonpath_plan{"$.d"};
+
+    auto const *const value = doc.find_one(b1);
+    REQUIRE(*value == hi::datum{2});
+    REQUIRE(doc.index_size() == 1);
+
+    // The second lookup comes from the index, also through a copy of the plan.
+    auto const b1_copy = b1;
+    REQUIRE(b1_copy.shared_string() == b1.shared_string());
+    REQUIRE(doc.find_one(b1) == value);
+    REQUIRE(doc.find_one(b1_copy) == value);
+    REQUIRE(doc.find_one(hi::jsonpath_plan{"$['a']['b'][1]"}) == value);
+    REQUIRE(doc.index_size() == 1);
+
+    // Missing paths are indexed too.
+    REQUIRE(doc.find_one(d) == nullptr);
+    REQUIRE(doc.find_one(d) == nullptr);
+    REQUIRE(doc.index_size() == 2);
+}
+
+TEST_CASE(write)
+{
+    auto doc = hi::indexed_datum{hi::parse_JSON(R"({"a": {"b": [1, 2, 3]}, "c": "x"})")};
+    auto const b1 = hi::jsonpath_plan{"$.a.b[1]"};
+    auto const c = hi::jsonpath_plan{"$.c"};
+    auto const d = hi::jsonpath_plan{"$.d.e"};
+
+    auto const *const value = doc.find_one(b1);
+    REQUIRE(doc.find_one(d) == nullptr);
+    REQUIRE(doc.index_size() == 2);
+
+    // Replacing a leaf keeps the index.
+    REQUIRE(doc.write(b1, hi::datum{42}));
+    REQUIRE(not doc.write(b1, hi::datum{42}));
+    REQUIRE(doc.write(c, hi::datum{"y"}));
+    REQUIRE(doc.index_size() == 3);
+    REQUIRE(doc.find_one(b1) == value);
+    REQUIRE(*value == hi::datum{42});
+
+    // Creating a value clears the index.
+    REQUIRE(doc.write(d, hi::datum{true}));
+    REQUIRE(doc.index_size() == 0);
+    REQUIRE(*doc.find_one(d) == hi::datum{true});
+    REQUIRE(*doc.find_one(b1) == hi::datum{42});
+
+    // Replacing a leaf with a container clears the index.
+    REQUIRE(doc.write(c, hi::datum::make_vector(1)));
+    REQUIRE(doc.index_size() == 0);
+    REQUIRE(*doc.find_one(hi::jsonpath_plan{"$.c[0]"}) == hi::datum{1});
+}
+
+TEST_CASE(invalidate)
+{
+    auto doc = hi::indexed_datum{hi::parse_JSON(R"({"a": 1, "b": 2})")};
+    auto const a = hi::jsonpath_plan{"$.a"};
+
+    REQUIRE(doc.find_one(a) != nullptr);
+    REQUIRE(doc.remove(a));
+    REQUIRE(doc.index_size() == 0);
+    REQUIRE(doc.find_one(a) == nullptr);
+
+    doc = hi::parse_JSON(R"({"a": 3})");
+    REQUIRE(doc.index_size() == 0);
+    REQUIRE(*doc.find_one(a) == hi::datum{3});
+
+    doc.modify()["a"] = hi::datum{4};
+    REQUIRE(doc.index_size() == 0);
+    REQUIRE(*doc.find_one(a) == hi::datum{4});
+}
+
+};
@@ -10,178 +10,225 @@
 #include "../macros.hpp"
 #include "huffman.hpp"
 #include <span>
+#include <array>
+#include <vector>
+#include <cstring>
+#include <cstdint>
 
 hi_export_module(hikogui.codec.inflate);
 
 hi_export namespace hi { inline namespace v1 {
 namespace detail {
 
-inline void inflate_copy_block(std::span<std::byte const> bytes, std::size_t& bit_offset, std::size_t max_size, bstring& r)
+/** A LSB-first bit reader for the deflate bit-stream.
+ *
+ * Bits are read from a 64-bit bit-buffer which is refilled with a single
+ * unaligned load, when at least 8 bytes of input are remaining.
+ */
+class inflate_bit_reader {
+public:
+    /** The minimum number of bits available after `refill()`, unless the end of the input was reached.
+     */
+    constexpr static std::size_t refill_bits = 56;
+
+    inflate_bit_reader(std::span<std::byte const> bytes, std::size_t offset) noexcept :
+        _first(bytes.data()), _ptr(bytes.data() + offset), _last(bytes.data() + bytes.size())
+    {
+        hi_axiom(offset <= bytes.size());
+    }
+
+    /** The offset in bits from the start of the input of the next bit to read.
+     */
+    [[nodiscard]] std::size_t bit_offset() const noexcept
+    {
+        return narrow_cast<std::size_t>(_ptr - _first) * 8 - _nr_bits;
+    }
+
+    /** Fill the bit-buffer with at least `refill_bits` bits, or all remaining bits.
+     */
+    hi_force_inline void refill() noexcept
+    {
+        if (_last - _ptr >= 8) [[likely]] {
+            _bits |= load_le<uint64_t>(_ptr) << _nr_bits;
+            _ptr += (63 - _nr_bits) >> 3;
+            _nr_bits |= 56;
+
+        } else {
+            while (_nr_bits <= 56 and _ptr != _last) {
+                _bits |= uint64_t{std::to_integer<uint8_t>(*_ptr++)} << _nr_bits;
+                _nr_bits += 8;
+            }
+        }
+    }
+
+    /** Get the bits in the bit-buffer without consuming them.
+     *
+     * Bits beyond the number of available bits are zero.
+     */
+    [[nodiscard]] hi_force_inline uint64_t peek() const noexcept
+    {
+        return _bits;
+    }
+
+    /** Consume bits from the bit-buffer.
+     *
+     * @param length The number of bits to consume.
+     * @throw parse_error When consuming beyond the end of the input.
+     */
+    hi_force_inline void consume(std::size_t length)
+    {
+        hi_check(length <= _nr_bits, "Input buffer overrun");
+        _bits >>= length;
+        _nr_bits -= length;
+    }
+
+    /** Get and consume bits from the bit-buffer.
+     *
+     * @note `refill()` must have been called to make the bits available.
+     * @param length The number of bits to get.
+     * @return The bits, the first bit in the LSB.
+     * @throw parse_error When reading beyond the end of the input.
+     */
+    [[nodiscard]] hi_force_inline std::size_t get(std::size_t length)
+    {
+        hi_axiom(length <= 32);
+        auto const r = narrow_cast<std::size_t>(_bits & ((uint64_t{1} << length) - 1));
+        consume(length);
+        return r;
+    }
+
+    /** Skip bits to align to the next byte.
+     */
+    void align() noexcept
+    {
+        auto const length = _nr_bits & 7;
+        _bits >>= length;
+        _nr_bits -= length;
+    }
+
+    /** Return the bytes in the bit-buffer to the input and get the current byte offset.
+     *
+     * @pre The reader must be aligned to a byte.
+     * @return The offset of the next byte to read.
+     */
+    [[nodiscard]] std::size_t release() noexcept
+    {
+        hi_axiom(_nr_bits % 8 == 0);
+        _ptr -= _nr_bits / 8;
+        _bits = 0;
+        _nr_bits = 0;
+        return narrow_cast<std::size_t>(_ptr - _first);
+    }
+
+    /** Continue reading at a byte offset.
+     *
+     * @param offset The offset of the byte in the input.
+     */
+    void seek(std::size_t offset) noexcept
+    {
+        _ptr = _first + offset;
+        hi_axiom(_ptr <= _last);
+        _bits = 0;
+        _nr_bits = 0;
+    }
+
+private:
+    std::byte const *_first;
+    std::byte const *_ptr;
+    std::byte const *_last;
+    uint64_t _bits = 0;
+    std::size_t _nr_bits = 0;
+};
+
+/** The base length for each length-symbol 257 to 285.
+ */
+constexpr auto inflate_length_base = std::array<uint16_t, 29>{3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                              31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+
+/** The number of extra bits for each length-symbol 257 to 285.
+ */
+constexpr auto inflate_length_extra =
+    std::array<uint8_t, 29>{0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+
+/** The base distance for each distance-symbol 0 to 29.
+ */
+constexpr auto inflate_distance_base = std::array<uint16_t, 30>{1,   2,   3,   4,   5,   7,    9,    13,   17,   25,
+                                                                33,  49,  65,  97,  129, 193,  257,  385,  513,  769,
+                                                                1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+
+/** The number of extra bits for each distance-symbol 0 to 29.
+ */
+constexpr auto inflate_distance_extra = std::array<uint8_t, 30>{0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+                                                                6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+inline void inflate_copy_block(inflate_bit_reader& reader, std::span<std::byte const> bytes, std::size_t max_size, bstring& r)
 {
-    auto offset = (bit_offset + 7) / 8;
+    reader.align();
+    auto offset = reader.release();
 
     auto LEN = **make_placement_ptr<little_uint16_buf_t>(bytes, offset);
-    [[maybe_unused]] auto NLEN = **make_placement_ptr<little_uint16_buf_t>(bytes, offset);
+    auto NLEN = **make_placement_ptr<little_uint16_buf_t>(bytes, offset);
 
+    hi_check(NLEN == (~LEN & 0xffff), "stored block length does not match its one's complement");
     hi_check((offset + LEN) <= bytes.size(), "input buffer overrun");
     hi_check((r.size() + LEN) <= max_size, "output buffer overrun");
-    r.append(&bytes[offset], LEN);
+    r.append(bytes.data() + offset, LEN);
 
-    bit_offset = offset * 8;
+    reader.seek(offset + LEN);
 }
 
-[[nodiscard]] inline std::size_t
-inflate_decode_length(std::span<std::byte const> bytes, std::size_t& bit_offset, std::size_t symbol)
+/** Decode a length or distance from its symbol.
+ *
+ * @param reader The bit reader to read the extra bits from.
+ * @param symbol The symbol relative to the first length or distance symbol.
+ * @param base The table of base values.
+ * @param extra The table with the number of extra bits.
+ */
+[[nodiscard]] inline std::size_t inflate_decode_extra(
+    inflate_bit_reader& reader,
+    std::size_t symbol,
+    std::span<uint16_t const> base,
+    std::span<uint8_t const> extra)
 {
-    switch (symbol) {
-    case 257:
-        return 3;
-    case 258:
-        return 4;
-    case 259:
-        return 5;
-    case 260:
-        return 6;
-    case 261:
-        return 7;
-    case 262:
-        return 8;
-    case 263:
-        return 9;
-    case 264:
-        return 10;
-    case 265:
-        return get_bits(bytes, bit_offset, 1) + 11;
-    case 266:
-        return get_bits(bytes, bit_offset, 1) + 13;
-    case 267:
-        return get_bits(bytes, bit_offset, 1) + 15;
-    case 268:
-        return get_bits(bytes, bit_offset, 1) + 17;
-    case 269:
-        return get_bits(bytes, bit_offset, 2) + 19;
-    case 270:
-        return get_bits(bytes, bit_offset, 2) + 23;
-    case 271:
-        return get_bits(bytes, bit_offset, 2) + 27;
-    case 272:
-        return get_bits(bytes, bit_offset, 2) + 31;
-    case 273:
-        return get_bits(bytes, bit_offset, 3) + 35;
-    case 274:
-        return get_bits(bytes, bit_offset, 3) + 43;
-    case 275:
-        return get_bits(bytes, bit_offset, 3) + 51;
-    case 276:
-        return get_bits(bytes, bit_offset, 3) + 59;
-    case 277:
-        return get_bits(bytes, bit_offset, 4) + 67;
-    case 278:
-        return get_bits(bytes, bit_offset, 4) + 83;
-    case 279:
-        return get_bits(bytes, bit_offset, 4) + 99;
-    case 280:
-        return get_bits(bytes, bit_offset, 4) + 115;
-    case 281:
-        return get_bits(bytes, bit_offset, 5) + 131;
-    case 282:
-        return get_bits(bytes, bit_offset, 5) + 163;
-    case 283:
-        return get_bits(bytes, bit_offset, 5) + 195;
-    case 284:
-        return get_bits(bytes, bit_offset, 5) + 227;
-    case 285:
-        return 258;
-    default:
-        throw parse_error(std::format("Literal/Length symbol out of range {}", symbol));
-    }
+    hi_axiom(symbol < base.size());
+    return base[symbol] + reader.get(extra[symbol]);
 }
 
-[[nodiscard]] inline std::size_t
-inflate_decode_distance(std::span<std::byte const> bytes, std::size_t& bit_offset, std::size_t symbol)
+/** Copy a match from earlier in the output to the end of the output.
+ *
+ * The source and destination may overlap, in which case the
+ * earlier copied bytes are repeated.
+ */
+inline void inflate_copy_match(std::byte *dst, std::size_t distance, std::size_t length) noexcept
 {
-    switch (symbol) {
-    case 0:
-        return 1;
-    case 1:
-        return 2;
-    case 2:
-        return 3;
-    case 3:
-        return 4;
-    case 4:
-        return get_bits(bytes, bit_offset, 1) + 5;
-    case 5:
-        return get_bits(bytes, bit_offset, 1) + 7;
-    case 6:
-        return get_bits(bytes, bit_offset, 2) + 9;
-    case 7:
-        return get_bits(bytes, bit_offset, 2) + 13;
-    case 8:
-        return get_bits(bytes, bit_offset, 3) + 17;
-    case 9:
-        return get_bits(bytes, bit_offset, 3) + 25;
-    case 10:
-        return get_bits(bytes, bit_offset, 4) + 33;
-    case 11:
-        return get_bits(bytes, bit_offset, 4) + 49;
-    case 12:
-        return get_bits(bytes, bit_offset, 5) + 65;
-    case 13:
-        return get_bits(bytes, bit_offset, 5) + 97;
-    case 14:
-        return get_bits(bytes, bit_offset, 6) + 129;
-    case 15:
-        return get_bits(bytes, bit_offset, 6) + 193;
-    case 16:
-        return get_bits(bytes, bit_offset, 7) + 257;
-    case 17:
-        return get_bits(bytes, bit_offset, 7) + 385;
-    case 18:
-        return get_bits(bytes, bit_offset, 8) + 513;
-    case 19:
-        return get_bits(bytes, bit_offset, 8) + 769;
-    case 20:
-        return get_bits(bytes, bit_offset, 9) + 1025;
-    case 21:
-        return get_bits(bytes, bit_offset, 9) + 1537;
-    case 22:
-        return get_bits(bytes, bit_offset, 10) + 2049;
-    case 23:
-        return get_bits(bytes, bit_offset, 10) + 3073;
-    case 24:
-        return get_bits(bytes, bit_offset, 11) + 4097;
-    case 25:
-        return get_bits(bytes, bit_offset, 11) + 6145;
-    case 26:
-        return get_bits(bytes, bit_offset, 12) + 8193;
-    case 27:
-        return get_bits(bytes, bit_offset, 12) + 12289;
-    case 28:
-        return get_bits(bytes, bit_offset, 13) + 16385;
-    case 29:
-        return get_bits(bytes, bit_offset, 13) + 24577;
-    default:
-        throw parse_error(std::format("Distance symbol out of range {}", symbol));
+    auto src = dst - distance;
+    if (distance >= length) {
+        std::memcpy(dst, src, length);
+    } else {
+        for (auto i = 0_uz; i != length; ++i) {
+            dst[i] = src[i];
+        }
     }
 }
 
 inline void inflate_block(
-    std::span<std::byte const> bytes,
-    std::size_t& bit_offset,
+    inflate_bit_reader& reader,
     std::size_t max_size,
-    huffman_tree<int16_t> const& literal_tree,
-    huffman_tree<int16_t> const& distance_tree,
+    huffman_table const& literal_table,
+    huffman_table const& distance_table,
     bstring& r)
 {
     while (true) {
-        // Test only every get_symbol, the trailer is at least 32 bits (Checksum)
-        // - 15 bits maximum huffman code.
+        // A single refill is enough for a full length/distance pair:
+        // - 15 bits maximum literal/length code.
         // -  5 bits extra length.
-        // -  7 bits rounding up to byte.
-        hi_check(((bit_offset + 27) >> 3) <= bytes.size(), "Input buffer overrun");
+        // - 15 bits maximum distance code.
+        // - 13 bits extra distance.
+        reader.refill();
 
-        auto const literal_symbol = literal_tree.get_symbol(bytes, bit_offset);
+        auto code_length = 0_uz;
+        auto const literal_symbol = literal_table.get(reader.peek(), code_length);
+        reader.consume(code_length);
 
         if (literal_symbol <= 255) {
             hi_check(r.size() < max_size, "Output buffer overrun");
@@ -192,31 +239,25 @@ inline void inflate_block(
             return;
 
         } else {
-            auto const length = inflate_decode_length(bytes, bit_offset, literal_symbol);
+            hi_check(literal_symbol <= 285, "Literal/Length symbol out of range {}", literal_symbol);
+            auto const length = inflate_decode_extra(reader, literal_symbol - 257, inflate_length_base, inflate_length_extra);
             hi_check(r.size() + length <= max_size, "Output buffer overrun");
 
-            // Test only every get_symbol, the trailer is at least 32 bits (Checksum)
-            // - 15 bits maximum huffman code.
-            // -  7 bits rounding up to byte.
-            hi_check(((bit_offset + 22) >> 3) <= bytes.size(), "Input buffer overrun");
-            auto const distance_symbol = distance_tree.get_symbol(bytes, bit_offset);
-
-            // Test only every inflate_decode_distance, the trailer is at least 32 bits (Checksum)
-            // - 13 bits extra length.
-            // -  7 bits rounding up to byte.
-            hi_check(((bit_offset + 20) >> 3) <= bytes.size(), "Input buffer overrun");
-            auto const distance = inflate_decode_distance(bytes, bit_offset, distance_symbol);
+            auto const distance_symbol = distance_table.get(reader.peek(), code_length);
+            reader.consume(code_length);
 
+            hi_check(distance_symbol <= 29, "Distance symbol out of range {}", distance_symbol);
+            auto const distance = inflate_decode_extra(reader, distance_symbol, inflate_distance_base, inflate_distance_extra);
             hi_check(distance <= r.size(), "Distance beyond start of decompressed data");
-            auto src_i = r.size() - distance;
-            for (auto i = 0; i != length; ++i) {
-                r.push_back(r[src_i++]);
-            }
+
+            auto const offset = r.size();
+            r.resize(offset + length);
+            inflate_copy_match(r.data() + offset, distance, length);
         }
     }
 }
 
-inline huffman_tree<int16_t> deflate_fixed_literal_tree = []() {
+inline huffman_table const deflate_fixed_literal_table = []() {
     std::vector<uint8_t> lengths;
 
     for (int i = 0; i <= 143; ++i) {
@@ -232,154 +273,143 @@ inline huffman_tree<int16_t> deflate_fixed_literal_tree = []() {
         lengths.push_back(8);
     }
 
-    return huffman_tree<int16_t>::from_lengths(lengths);
+    return huffman_table::from_lengths(lengths);
 }();
 
-inline huffman_tree<int16_t> deflate_fixed_distance_tree = []() {
+inline huffman_table const deflate_fixed_distance_table = []() {
     std::vector<uint8_t> lengths;
 
     for (int i = 0; i <= 31; ++i) {
         lengths.push_back(5);
     }
 
-    return huffman_tree<int16_t>::from_lengths(lengths);
+    return huffman_table::from_lengths(lengths);
 }();
 
-inline void inflate_fixed_block(std::span<std::byte const> bytes, std::size_t& bit_offset, std::size_t max_size, bstring& r)
+inline void inflate_fixed_block(inflate_bit_reader& reader, std::size_t max_size, bstring& r)
 {
-    inflate_block(bytes, bit_offset, max_size, deflate_fixed_literal_tree, deflate_fixed_distance_tree, r);
+    inflate_block(reader, max_size, deflate_fixed_literal_table, deflate_fixed_distance_table, r);
 }
 
-[[nodiscard]] inline huffman_tree<int16_t>
-inflate_code_lengths(std::span<std::byte const> bytes, std::size_t& bit_offset, std::size_t nr_symbols)
-{
-    // The symbols are in different order in the table.
-    constexpr auto symbols = std::array<int16_t, 19>{16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
-
-    hi_check(((bit_offset + (3 * static_cast<std::size_t>(nr_symbols)) + 7) >> 3) <= bytes.size(), "Input buffer overrun");
+/** The order in which the code-length code lengths are stored.
+ */
+constexpr auto inflate_code_length_order = std::array<uint8_t, 19>{16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
 
-    auto lengths = std::vector<uint8_t>(symbols.size(), 0);
+[[nodiscard]] inline huffman_table inflate_code_lengths(inflate_bit_reader& reader, std::size_t nr_symbols)
+{
+    auto lengths = std::vector<uint8_t>(inflate_code_length_order.size(), 0);
     for (auto i = 0_uz; i != nr_symbols; ++i) {
-        auto const symbol = symbols[i];
-        lengths[symbol] = narrow_cast<uint8_t>(get_bits(bytes, bit_offset, 3));
+        // A refill yields at least 18 code lengths of 3 bits.
+        if (i % 18 == 0) {
+            reader.refill();
+        }
+
+        auto const symbol = inflate_code_length_order[i];
+        lengths[symbol] = narrow_cast<uint8_t>(reader.get(3));
     }
-    return huffman_tree<int16_t>::from_lengths(std::move(lengths));
+    return huffman_table::from_lengths(lengths);
 }
 
-inline std::vector<uint8_t> inflate_lengths(
-    std::span<std::byte const> bytes,
-    std::size_t& bit_offset,
-    std::size_t nr_symbols,
-    huffman_tree<int16_t> const& code_length_tree)
+inline std::vector<uint8_t> inflate_lengths(inflate_bit_reader& reader, std::size_t nr_symbols, huffman_table const& code_length_table)
 {
     auto r = std::vector<uint8_t>{};
     r.reserve(nr_symbols);
 
-    auto prev_length = 0_uz;
+    auto prev_length = uint8_t{0};
     while (r.size() < nr_symbols) {
-        // Test only every get_symbol, the trailer is at least 32 bits (Checksum)
+        // A single refill is enough for:
         // -  7 bits maximum huffman code.
         // -  7 bits extra length.
-        // -  7 bits rounding up to byte.
-        hi_check(((bit_offset + 21) >> 3) <= bytes.size(), "Input buffer overrun");
-        auto const symbol = code_length_tree.get_symbol(bytes, bit_offset);
+        reader.refill();
 
+        auto code_length = 0_uz;
+        auto const symbol = code_length_table.get(reader.peek(), code_length);
+        reader.consume(code_length);
+
+        auto copy_length = 0_uz;
+        auto copy_value = uint8_t{0};
         switch (symbol) {
         case 16:
-            {
-                auto copy_length = get_bits(bytes, bit_offset, 2) + 3;
-                while (copy_length--) {
-                    r.push_back(static_cast<uint8_t>(prev_length));
-                }
-            }
+            copy_length = reader.get(2) + 3;
+            copy_value = prev_length;
             break;
         case 17:
-            {
-                auto copy_length = get_bits(bytes, bit_offset, 3) + 3;
-                while (copy_length--) {
-                    r.push_back(0);
-                }
-            }
+            copy_length = reader.get(3) + 3;
             break;
         case 18:
-            {
-                auto copy_length = get_bits(bytes, bit_offset, 7) + 11;
-                while (copy_length--) {
-                    r.push_back(0);
-                }
-            }
+            copy_length = reader.get(7) + 11;
             break;
         default:
-            r.push_back(static_cast<uint8_t>(prev_length = symbol));
+            copy_length = 1;
+            copy_value = prev_length = narrow_cast<uint8_t>(symbol);
         }
+
+        hi_check(r.size() + copy_length <= nr_symbols, "Code lengths beyond the number of symbols");
+        r.insert(r.end(), copy_length, copy_value);
     }
 
     return r;
 }
 
-inline void inflate_dynamic_block(std::span<std::byte const> bytes, std::size_t& bit_offset, std::size_t max_size, bstring& r)
+inline void inflate_dynamic_block(inflate_bit_reader& reader, std::size_t max_size, bstring& r)
 {
-    // Test all lengths, the trailer is at least 32 bits (Checksum)
-    // - 14 bits lengths
-    // -  7 bits rounding up to byte.
-    hi_check(((bit_offset + 21) >> 3) <= bytes.size(), "Input buffer overrun");
-    auto const HLIT = get_bits(bytes, bit_offset, 5);
-    auto const HDIST = get_bits(bytes, bit_offset, 5);
-    auto const HCLEN = get_bits(bytes, bit_offset, 4);
+    reader.refill();
+    auto const HLIT = reader.get(5);
+    auto const HDIST = reader.get(5);
+    auto const HCLEN = reader.get(4);
 
-    auto const code_length_tree = inflate_code_lengths(bytes, bit_offset, HCLEN + 4);
+    auto const code_length_table = inflate_code_lengths(reader, HCLEN + 4);
 
-    auto const lengths = inflate_lengths(bytes, bit_offset, HLIT + HDIST + 258, code_length_tree);
+    auto const lengths = inflate_lengths(reader, HLIT + HDIST + 258, code_length_table);
     hi_check(lengths[256] != 0, "The end-of-block symbol must be in the table");
 
     auto const lengths_ptr = lengths.data();
     hi_assert_not_null(lengths_ptr);
-    auto const literal_tree = huffman_tree<int16_t>::from_lengths(lengths_ptr, HLIT + 257);
-    auto const distance_tree = huffman_tree<int16_t>::from_lengths(&lengths_ptr[HLIT + 257], HDIST + 1);
+    auto const literal_table = huffman_table::from_lengths(lengths_ptr, HLIT + 257);
+    auto const distance_table = huffman_table::from_lengths(&lengths_ptr[HLIT + 257], HDIST + 1);
 
-    inflate_block(bytes, bit_offset, max_size, literal_tree, distance_tree, r);
+    inflate_block(reader, max_size, literal_table, distance_table, r);
 }
 
 } // namespace detail
 
 /** Inflate compressed data using the deflate algorithm
- * `bytes` should include at least 32 bit of trailer, for the overflow check which
- * will slightly overrun the actual compressed data for performance reasons.
  *
  * - gzip has a CRC32+ISIZE trailer.
- *   Since gzip has no end-of-segment indicator, we need to include the trailer
- *   in the byte array passed to inflate anyway.
  * - zlib has a 32 bit check value.
- *   Since zlib has no end-of-segment indicator, we need to include the trailer
- *   in the byte array passed to inflate anyway.
  * - png IDAT chunks include the full zlib-format, including the 32 bit check value.
+ *
+ * @param bytes The compressed data.
+ * @param[in,out] offset The byte offset of the deflate stream in @a bytes, on return
+ *                the byte offset directly after the deflate stream.
+ * @param max_size The maximum size of the decompressed data.
+ * @return The decompressed data.
+ * @throw parse_error When the compressed data is invalid.
  */
 hi_export [[nodiscard]] inline bstring
 inflate(std::span<std::byte const> bytes, std::size_t& offset, std::size_t max_size = 0x0100'0000)
 {
-    std::size_t bit_offset = offset * 8;
+    auto reader = detail::inflate_bit_reader(bytes, offset);
 
     auto r = bstring{};
+    // A guess of the decompressed size, to reduce reallocations.
+    r.reserve(std::min(max_size, (bytes.size() - offset) * 4));
 
     auto BFINAL = false;
     do {
-        // Test all lengths, the trailer is at least 32 bits (Checksum)
-        // - 3 bits header
-        // - 7 bits rounding up to byte.
-        hi_check(((bit_offset + 10) >> 3) <= bytes.size(), "Input buffer overrun");
-
-        BFINAL = get_bit(bytes, bit_offset);
-        auto const BTYPE = get_bits(bytes, bit_offset, 2);
+        reader.refill();
+        BFINAL = to_bool(reader.get(1));
+        auto const BTYPE = reader.get(2);
 
         switch (BTYPE) {
         case 0:
-            detail::inflate_copy_block(bytes, bit_offset, max_size, r);
+            detail::inflate_copy_block(reader, bytes, max_size, r);
             break;
         case 1:
-            detail::inflate_fixed_block(bytes, bit_offset, max_size, r);
+            detail::inflate_fixed_block(reader, max_size, r);
             break;
         case 2:
-            detail::inflate_dynamic_block(bytes, bit_offset, max_size, r);
+            detail::inflate_dynamic_block(reader, max_size, r);
             break;
         default:
             throw parse_error("Reserved block type");
@@ -387,8 +417,514 @@ inflate(std::span<std::byte const> bytes, std::size_t& offset, std::size_t max_s
 
     } while (!BFINAL);
 
-    offset = (bit_offset + 7) / 8;
+    offset = (reader.bit_offset() + 7) / 8;
     return r;
 }
 
+/** A resumable inflate decoder.
+ *
+ * The decoder is fed with chunks of compressed data and writes the
+ * decompressed data into buffers supplied by the caller. The last 32 KiB of
+ * decompressed data is retained in a sliding window, so that the caller
+ * may reuse or flush its output buffers between calls.
+ *
+ * Example:
+ * ```
+ * auto decoder = inflate_decoder{};
+ * while (not decoder.decode(input, output)) {
+ *     if (output.empty()) {
+ *         // flush the output buffer.
+ *     } else {
+ *         // read more input.
+ *     }
+ * }
+ * ```
+ */
+hi_export class inflate_decoder {
+public:
+    /** The size of the sliding window.
+     */
+    constexpr static std::size_t window_size = 0x8000;
+
+    inflate_decoder() : _window(window_size, std::byte{0}) {}
+
+    /** Check if the end of the deflate stream has been reached.
+     */
+    [[nodiscard]] bool done() const noexcept
+    {
+        return _state == state_type::done;
+    }
+
+    /** The total number of bytes that have been decompressed.
+     */
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return _total;
+    }
+
+    /** Bytes that were read beyond the end of the deflate stream.
+     *
+     * When the decoder is done, it may have read a few bytes from the input
+     * beyond the end of the deflate stream. These bytes belong to the
+     * trailer of the surrounding format, like a check value.
+     */
+    [[nodiscard]] std::span<std::byte const> unused() const noexcept
+    {
+        return {_unused.data(), _nr_unused};
+    }
+
+    /** Decode a chunk of compressed data.
+     *
+     * The decoder stops when the end of the deflate stream is reached,
+     * when all the input is consumed, or when the output is full.
+     *
+     * @param[in,out] input The compressed data, on return the data that was not consumed.
+     * @param[in,out] output The buffer to write decompressed data to, on return the part
+     *                of the buffer that was not written.
+     * @return true when the end of the deflate stream is reached.
+     * @throw parse_error When the compressed data is invalid.
+     */
+    [[nodiscard]] bool decode(std::span<std::byte const>& input, std::span<std::byte>& output)
+    {
+        _output_first = output.data();
+        _output_total = _total;
+
+        auto const r = decode_blocks(input, output);
+
+        update_window({_output_first, output.data()});
+        return r;
+    }
+
+private:
+    enum class state_type : uint8_t {
+        block_header,
+        stored_header,
+        stored_data,
+        dynamic_header,
+        code_length_lengths,
+        code_lengths,
+        codes,
+        match,
+        done
+    };
+
+    state_type _state = state_type::block_header;
+    bool _final_block = false;
+
+    uint64_t _bits = 0;
+    std::size_t _nr_bits = 0;
+
+    /** The sliding window, holding the last 32 KiB of decompressed data.
+     *
+     * The window is only updated at the end of `decode()`, during `decode()`
+     * matches are copied directly from the output buffer when possible.
+     */
+    std::vector<std::byte> _window;
+
+    /** The total number of bytes decompressed.
+     */
+    std::size_t _total = 0;
+
+    /** The start of the output buffer passed to `decode()`.
+     */
+    std::byte *_output_first = nullptr;
+
+    /** The total number of bytes decompressed before `decode()` was called.
+     */
+    std::size_t _output_total = 0;
+
+    std::size_t _stored_remaining = 0;
+
+    std::size_t _nr_literals = 0;
+    std::size_t _nr_distances = 0;
+    std::size_t _nr_code_lengths = 0;
+    std::size_t _index = 0;
+    std::vector<uint8_t> _lengths;
+    uint8_t _prev_length = 0;
+
+    huffman_table _code_length_table;
+    huffman_table _dynamic_literal_table;
+    huffman_table _dynamic_distance_table;
+    huffman_table const *_literal_table = nullptr;
+    huffman_table const *_distance_table = nullptr;
+
+    std::size_t _match_length = 0;
+    std::size_t _match_distance = 0;
+
+    std::array<std::byte, 8> _unused = {};
+    std::size_t _nr_unused = 0;
+
+    [[nodiscard]] bool decode_blocks(std::span<std::byte const>& input, std::span<std::byte>& output)
+    {
+        while (true) {
+            switch (_state) {
+            case state_type::block_header:
+                if (not fill(input, 3)) {
+                    return false;
+                }
+
+                _final_block = to_bool(get(1));
+                switch (get(2)) {
+                case 0:
+                    _state = state_type::stored_header;
+                    break;
+                case 1:
+                    _literal_table = &detail::deflate_fixed_literal_table;
+                    _distance_table = &detail::deflate_fixed_distance_table;
+                    _state = state_type::codes;
+                    break;
+                case 2:
+                    _state = state_type::dynamic_header;
+                    break;
+                default:
+                    throw parse_error("Reserved block type");
+                }
+                break;
+
+            case state_type::stored_header:
+                align();
+                if (not fill(input, 32)) {
+                    return false;
+                }
+
+                _stored_remaining = get(16);
+                if (get(16) != (~_stored_remaining & 0xffff)) {
+                    throw parse_error("Stored block length does not match its one's complement");
+                }
+                _state = state_type::stored_data;
+                break;
+
+            case state_type::stored_data:
+                // First copy the bytes that are already in the bit-buffer.
+                while (_stored_remaining != 0 and _nr_bits != 0) {
+                    if (output.empty()) {
+                        return false;
+                    }
+                    put(output, static_cast<std::byte>(get(8)));
+                    --_stored_remaining;
+                }
+
+                if (_stored_remaining != 0) {
+                    // The bit-buffer may contain bits of bytes that are copied directly from the input.
+                    _bits = 0;
+
+                    auto const n = std::min({_stored_remaining, input.size(), output.size()});
+                    put(output, input.first(n));
+                    input = input.subspan(n);
+                    _stored_remaining -= n;
+
+                    if (_stored_remaining != 0) {
+                        return false;
+                    }
+                }
+
+                end_of_block();
+                break;
+
+            case state_type::dynamic_header:
+                if (not fill(input, 14)) {
+                    return false;
+                }
+
+                _nr_literals = get(5) + 257;
+                _nr_distances = get(5) + 1;
+                _nr_code_lengths = get(4) + 4;
+                _lengths.assign(detail::inflate_code_length_order.size(), 0);
+                _index = 0;
+                _state = state_type::code_length_lengths;
+                break;
+
+            case state_type::code_length_lengths:
+                while (_index != _nr_code_lengths) {
+                    if (not fill(input, 3)) {
+                        return false;
+                    }
+                    _lengths[detail::inflate_code_length_order[_index++]] = narrow_cast<uint8_t>(get(3));
+                }
+
+                _code_length_table = huffman_table::from_lengths(_lengths);
+                _lengths.clear();
+                _prev_length = 0;
+                _state = state_type::code_lengths;
+                break;
+
+            case state_type::code_lengths:
+                if (not decode_code_lengths(input)) {
+                    return false;
+                }
+
+                hi_check(_lengths[256] != 0, "The end-of-block symbol must be in the table");
+                _dynamic_literal_table = huffman_table::from_lengths(_lengths.data(), _nr_literals);
+                _dynamic_distance_table = huffman_table::from_lengths(_lengths.data() + _nr_literals, _nr_distances);
+                _literal_table = &_dynamic_literal_table;
+                _distance_table = &_dynamic_distance_table;
+                _state = state_type::codes;
+                break;
+
+            case state_type::codes:
+                if (not decode_codes(input, output)) {
+                    return false;
+                }
+                break;
+
+            case state_type::match:
+                copy_match(output);
+                if (_match_length != 0) {
+                    return false;
+                }
+                _state = state_type::codes;
+                break;
+
+            case state_type::done:
+                return true;
+
+            default:
+                hi_no_default();
+            }
+        }
+    }
+
+    /** Fill the bit-buffer from the input.
+     *
+     * @param input The input, on return the part of the input that was not consumed.
+     * @param length The number of bits needed.
+     * @return true if at least @a length bits are available.
+     */
+    hi_force_inline bool fill(std::span<std::byte const>& input, std::size_t length = 0) noexcept
+    {
+        if (input.size() >= 8) [[likely]] {
+            _bits |= load_le<uint64_t>(input.data()) << _nr_bits;
+            input = input.subspan((63 - _nr_bits) >> 3);
+            _nr_bits |= 56;
+
+        } else {
+            // Stop before 64 bits, so that a following unaligned load can still shift into the bit-buffer.
+            while (_nr_bits < 56 and not input.empty()) {
+                _bits |= uint64_t{std::to_integer<uint8_t>(input.front())} << _nr_bits;
+                input = input.subspan(1);
+                _nr_bits += 8;
+            }
+        }
+
+        return _nr_bits >= length;
+    }
+
+    hi_force_inline void consume(std::size_t length) noexcept
+    {
+        hi_axiom(length <= _nr_bits);
+        _bits >>= length;
+        _nr_bits -= length;
+    }
+
+    [[nodiscard]] hi_force_inline std::size_t get(std::size_t length) noexcept
+    {
+        auto const r = narrow_cast<std::size_t>(_bits & ((uint64_t{1} << length) - 1));
+        consume(length);
+        return r;
+    }
+
+    void align() noexcept
+    {
+        consume(_nr_bits & 7);
+    }
+
+    /** Find a symbol in a table using the bits in the bit-buffer.
+     *
+     * @param table The huffman table.
+     * @param skip The number of bits in the bit-buffer to skip.
+     * @param[out] length The length of the code.
+     * @return The symbol, or -1 if more input is needed.
+     * @throw parse_error When the bits do not form a code in the table.
+     */
+    [[nodiscard]] hi_force_inline std::ptrdiff_t find(huffman_table const& table, std::size_t skip, std::size_t& length) const
+    {
+        hi_axiom(skip <= _nr_bits);
+
+        auto const symbol = table.find(_bits >> skip, length);
+        if (length == 0 or skip + length > _nr_bits) {
+            // An invalid code may be caused by the missing bits.
+            hi_check(_nr_bits - skip < huffman_table::max_code_length, "Code not in huffman table.");
+            return -1;
+        }
+        return narrow_cast<std::ptrdiff_t>(symbol);
+    }
+
+    void put(std::span<std::byte>& output, std::byte value) noexcept
+    {
+        hi_axiom(not output.empty());
+        output.front() = value;
+        output = output.subspan(1);
+        ++_total;
+    }
+
+    void put(std::span<std::byte>& output, std::span<std::byte const> values) noexcept
+    {
+        hi_axiom(values.size() <= output.size());
+        std::memcpy(output.data(), values.data(), values.size());
+        output = output.subspan(values.size());
+        _total += values.size();
+    }
+
+    void copy_match(std::span<std::byte>& output) noexcept
+    {
+        while (_match_length != 0 and not output.empty()) {
+            auto const src_total = _total - _match_distance;
+
+            auto n = std::min(_match_length, output.size());
+            if (src_total >= _output_total) {
+                // The source was written to the output buffer during this call.
+                detail::inflate_copy_match(output.data(), _match_distance, n);
+
+            } else {
+                // The source is only available in the window.
+                auto const src = src_total % window_size;
+                n = std::min({n, _output_total - src_total, window_size - src});
+                std::memcpy(output.data(), _window.data() + src, n);
+            }
+
+            output = output.subspan(n);
+            _total += n;
+            _match_length -= n;
+        }
+    }
+
+    /** Copy the last 32 KiB of the data written to the output buffer into the window.
+     */
+    void update_window(std::span<std::byte const> written) noexcept
+    {
+        if (written.size() > window_size) {
+            written = written.last(window_size);
+        }
+
+        auto total = _total - written.size();
+        while (not written.empty()) {
+            auto const offset = total % window_size;
+            auto const n = std::min(written.size(), window_size - offset);
+            std::memcpy(_window.data() + offset, written.data(), n);
+            written = written.subspan(n);
+            total += n;
+        }
+    }
+
+    void end_of_block() noexcept
+    {
+        if (not _final_block) {
+            _state = state_type::block_header;
+            return;
+        }
+
+        // Return the whole bytes in the bit-buffer.
+        align();
+        while (_nr_bits != 0) {
+            _unused[_nr_unused++] = static_cast<std::byte>(get(8));
+        }
+        _state = state_type::done;
+    }
+
+    [[nodiscard]] bool decode_code_lengths(std::span<std::byte const>& input)
+    {
+        auto const nr_symbols = _nr_literals + _nr_distances;
+        while (_lengths.size() < nr_symbols) {
+            fill(input);
+
+            auto code_length = 0_uz;
+            auto const symbol = find(_code_length_table, 0, code_length);
+            if (symbol < 0) {
+                return false;
+            }
+
+            auto const extra = symbol == 16 ? 2_uz : symbol == 17 ? 3_uz : symbol == 18 ? 7_uz : 0_uz;
+            if (code_length + extra > _nr_bits) {
+                return false;
+            }
+            consume(code_length);
+
+            auto copy_length = 0_uz;
+            auto copy_value = uint8_t{0};
+            switch (symbol) {
+            case 16:
+                copy_length = get(extra) + 3;
+                copy_value = _prev_length;
+                break;
+            case 17:
+                copy_length = get(extra) + 3;
+                break;
+            case 18:
+                copy_length = get(extra) + 11;
+                break;
+            default:
+                copy_length = 1;
+                copy_value = _prev_length = narrow_cast<uint8_t>(symbol);
+            }
+
+            hi_check(_lengths.size() + copy_length <= nr_symbols, "Code lengths beyond the number of symbols");
+            _lengths.insert(_lengths.end(), copy_length, copy_value);
+        }
+        return true;
+    }
+
+    [[nodiscard]] bool decode_codes(std::span<std::byte const>& input, std::span<std::byte>& output)
+    {
+        hi_axiom_not_null(_literal_table);
+        hi_axiom_not_null(_distance_table);
+
+        while (true) {
+            fill(input);
+
+            auto literal_length = 0_uz;
+            auto const literal_symbol = find(*_literal_table, 0, literal_length);
+            if (literal_symbol < 0) {
+                return false;
+            }
+
+            if (literal_symbol <= 255) {
+                if (output.empty()) {
+                    return false;
+                }
+                consume(literal_length);
+                put(output, static_cast<std::byte>(literal_symbol));
+
+            } else if (literal_symbol == 256) {
+                consume(literal_length);
+                end_of_block();
+                return true;
+
+            } else {
+                hi_check(literal_symbol <= 285, "Literal/Length symbol out of range {}", literal_symbol);
+                auto const length_index = narrow_cast<std::size_t>(literal_symbol - 257);
+                auto const length_extra = detail::inflate_length_extra[length_index];
+                if (literal_length + length_extra > _nr_bits) {
+                    return false;
+                }
+
+                auto distance_length = 0_uz;
+                auto const distance_symbol = find(*_distance_table, literal_length + length_extra, distance_length);
+                if (distance_symbol < 0) {
+                    return false;
+                }
+                hi_check(distance_symbol <= 29, "Distance symbol out of range {}", distance_symbol);
+
+                auto const distance_index = narrow_cast<std::size_t>(distance_symbol);
+                auto const distance_extra = detail::inflate_distance_extra[distance_index];
+                if (literal_length + length_extra + distance_length + distance_extra > _nr_bits) {
+                    return false;
+                }
+
+                // The full length/distance pair is available in the bit-buffer.
+                consume(literal_length);
+                _match_length = detail::inflate_length_base[length_index] + get(length_extra);
+                consume(distance_length);
+                _match_distance = detail::inflate_distance_base[distance_index] + get(distance_extra);
+                hi_check(_match_distance <= _total, "Distance beyond start of decompressed data");
+
+                copy_match(output);
+                if (_match_length != 0) {
+                    _state = state_type::match;
+                    return false;
+                }
+            }
+        }
+    }
+};
+
 }} // namespace hi::v1
@@ -221,6 +221,10 @@ public:
     using iterator = typename container_type::iterator;
     using const_iterator = typename container_type::const_iterator;
 
+    /** An empty path, which matches the root.
+     */
+    constexpr jsonpath() noexcept = default;
+
     template<std::input_iterator It, std::sentinel_for<It> ItEnd>
     [[nodiscard]] constexpr jsonpath(It it, ItEnd last) : _nodes()
     {
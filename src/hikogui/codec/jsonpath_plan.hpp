@@ -0,0 +1,353 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "datum.hpp"
+#include "jsonpath.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <format>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+hi_export_module(hikogui.codec.jsonpath_plan);
+
+hi_export namespace hi { inline namespace v1 {
+
+/** A jsonpath compiled into a query plan.
+ *
+ * The plan is compiled once and can then be executed on many datums:
+ *  - The root and current nodes are removed.
+ *  - Names are converted to datum keys up front, so that a lookup does not allocate.
+ *  - A singular path is executed as a simple loop, without recursion and without
+ *    building a vector of results.
+ *  - The hash of the path is calculated once, to be used as a key in a `indexed_datum`.
+ *  - The string of the path is shared between copies of the plan, so that an
+ *    `indexed_datum` can recognize a plan by the address of its string.
+ */
+hi_export class jsonpath_plan {
+public:
+    constexpr jsonpath_plan() noexcept = default;
+    jsonpath_plan(jsonpath_plan const&) = default;
+    jsonpath_plan(jsonpath_plan&&) noexcept = default;
+    jsonpath_plan& operator=(jsonpath_plan const&) = default;
+    jsonpath_plan& operator=(jsonpath_plan&&) noexcept = default;
+
+    /** Compile a jsonpath.
+     *
+     * @param path The jsonpath to compile.
+     */
+    explicit jsonpath_plan(jsonpath path) :
+        _path(std::move(path)),
+        _string(std::make_shared<std::string const>(to_string(_path))),
+        _hash(std::hash<std::string>{}(*_string))
+    {
+        for (auto const& node : _path) {
+            if (auto const *names = std::get_if<jsonpath::names>(&node)) {
+                if (names->size() == 1) {
+                    _steps.emplace_back(child{datum{names->front()}});
+                } else {
+                    auto keys = children{};
+                    for (auto const& name : *names) {
+                        keys.push_back(datum{name});
+                    }
+                    _steps.emplace_back(std::move(keys));
+                }
+
+            } else if (auto const *indices = std::get_if<jsonpath::indices>(&node)) {
+                if (indices->size() == 1) {
+                    _steps.emplace_back(element{indices->front()});
+                } else {
+                    _steps.emplace_back(*indices);
+                }
+
+            } else if (std::holds_alternative<jsonpath::wildcard>(node)) {
+                _steps.emplace_back(jsonpath::wildcard{});
+
+            } else if (std::holds_alternative<jsonpath::descend>(node)) {
+                _steps.emplace_back(jsonpath::descend{});
+
+            } else if (auto const *slice = std::get_if<jsonpath::slice>(&node)) {
+                _steps.emplace_back(*slice);
+            }
+        }
+
+        _singular = std::ranges::all_of(_steps, [](auto const& step) {
+            return std::holds_alternative<child>(step) or std::holds_alternative<element>(step);
+        });
+    }
+
+    /** Compile a jsonpath.
+     *
+     * @param path The jsonpath to parse and compile.
+     * @throws parse_error When the path can not be parsed.
+     */
+    explicit jsonpath_plan(std::string_view path) : jsonpath_plan(jsonpath{path}) {}
+
+    /** Compile a jsonpath.
+     *
+     * @param path The jsonpath to parse and compile.
+     * @throws parse_error When the path can not be parsed.
+     */
+    explicit jsonpath_plan(char const *path) : jsonpath_plan(std::string_view{path}) {}
+
+    /** The jsonpath which was compiled.
+     */
+    [[nodiscard]] jsonpath const& path() const noexcept
+    {
+        return _path;
+    }
+
+    /** The jsonpath as a string.
+     */
+    [[nodiscard]] std::string const& string() const noexcept
+    {
+        static auto const empty = std::string{};
+        return _string ? *_string : empty;
+    }
+
+    /** The jsonpath as a string, shared by all copies of this plan.
+     *
+     * @return The shared string, or nullptr for an empty plan.
+     */
+    [[nodiscard]] std::shared_ptr<std::string const> const& shared_string() const noexcept
+    {
+        return _string;
+    }
+
+    /** The hash of the jsonpath, calculated at compile time.
+     */
+    [[nodiscard]] std::size_t hash() const noexcept
+    {
+        return _hash;
+    }
+
+    /** The plan will result in zero or one match.
+     */
+    [[nodiscard]] bool is_singular() const noexcept
+    {
+        return _singular;
+    }
+
+    /** Find a value by path.
+     *
+     * Negative indices count from the end of a vector.
+     *
+     * @param root The datum to search.
+     * @return A pointer to the value found, or nullptr.
+     */
+    [[nodiscard]] datum *find_one(datum& root) const noexcept
+    {
+        hi_axiom(is_singular());
+
+        auto *r = std::addressof(root);
+        for (auto const& step : _steps) {
+            if (auto const *c = std::get_if<child>(&step)) {
+                auto *map = get_if<datum::map_type>(*r);
+                if (map == nullptr) {
+                    return nullptr;
+                }
+
+                auto const it = map->find(c->key);
+                if (it == map->end()) {
+                    return nullptr;
+                }
+                r = std::addressof(it->second);
+
+            } else {
+                auto *vector = get_if<datum::vector_type>(*r);
+                if (vector == nullptr) {
+                    return nullptr;
+                }
+
+                auto const size = ssize(*vector);
+                auto index = std::get<element>(step).index;
+                if (index < 0) {
+                    index += size;
+                }
+                if (index < 0 or index >= size) {
+                    return nullptr;
+                }
+                r = std::addressof((*vector)[index]);
+            }
+        }
+        return r;
+    }
+
+    /** Find a value by path.
+     *
+     * Negative indices count from the end of a vector.
+     *
+     * @param root The datum to search.
+     * @return A pointer to the value found, or nullptr.
+     */
+    [[nodiscard]] datum const *find_one(datum const& root) const noexcept
+    {
+        return find_one(const_cast<datum&>(root));
+    }
+
+    /** Find all values matching the path.
+     *
+     * @param root The datum to search.
+     * @param[out] r The values found are appended to this vector; a vector may be
+     *               reused between calls to reduce allocations.
+     */
+    void find(datum& root, std::vector<datum *>& r) const noexcept
+    {
+        find(root, _steps.begin(), r);
+    }
+
+    /** Find all values matching the path.
+     *
+     * @param root The datum to search.
+     * @return A list of pointers to the values found.
+     */
+    [[nodiscard]] std::vector<datum *> find(datum& root) const noexcept
+    {
+        auto r = std::vector<datum *>{};
+        find(root, r);
+        return r;
+    }
+
+    /** Find all values matching the path.
+     *
+     * @param root The datum to search.
+     * @return A list of pointers to the values found.
+     */
+    [[nodiscard]] std::vector<datum const *> find(datum const& root) const noexcept
+    {
+        auto tmp = std::vector<datum *>{};
+        find(const_cast<datum&>(root), tmp);
+        return {tmp.begin(), tmp.end()};
+    }
+
+    [[nodiscard]] friend bool operator==(jsonpath_plan const& lhs, jsonpath_plan const& rhs) noexcept
+    {
+        return lhs._hash == rhs._hash and (lhs._string == rhs._string or lhs.string() == rhs.string());
+    }
+
+    [[nodiscard]] friend std::string to_string(jsonpath_plan const& rhs) noexcept
+    {
+        return rhs.string();
+    }
+
+private:
+    /** A single name; `.name` or `['name']`.
+     */
+    struct child {
+        datum key;
+    };
+
+    /** A list of names; `['a','b']`.
+     */
+    struct children : std::vector<datum> {};
+
+    /** A single index; `[1]`.
+     */
+    struct element {
+        ptrdiff_t index;
+    };
+
+    using step_type = std::variant<child, element, children, jsonpath::indices, jsonpath::wildcard, jsonpath::descend, jsonpath::slice>;
+    using const_iterator = std::vector<step_type>::const_iterator;
+
+    jsonpath _path = {};
+    std::shared_ptr<std::string const> _string = {};
+    std::size_t _hash = 0;
+    bool _singular = true;
+    std::vector<step_type> _steps = {};
+
+    void find_children(datum& value, const_iterator it, std::vector<datum *>& r) const noexcept
+    {
+        if (auto *vector = get_if<datum::vector_type>(value)) {
+            for (auto& item : *vector) {
+                find(item, it, r);
+            }
+
+        } else if (auto *map = get_if<datum::map_type>(value)) {
+            for (auto& item : *map) {
+                find(item.second, it, r);
+            }
+        }
+    }
+
+    void find(datum& value, const_iterator it, std::vector<datum *>& r) const noexcept
+    {
+        if (it == _steps.end()) {
+            r.push_back(std::addressof(value));
+
+        } else if (auto const *c = std::get_if<child>(&*it)) {
+            if (auto *map = get_if<datum::map_type>(value)) {
+                if (auto const jt = map->find(c->key); jt != map->end()) {
+                    find(jt->second, it + 1, r);
+                }
+            }
+
+        } else if (auto const *e = std::get_if<element>(&*it)) {
+            if (auto *vector = get_if<datum::vector_type>(value)) {
+                auto const size = ssize(*vector);
+                auto const index = e->index >= 0 ? e->index : e->index + size;
+                if (index >= 0 and index < size) {
+                    find((*vector)[index], it + 1, r);
+                }
+            }
+
+        } else if (auto const *keys = std::get_if<children>(&*it)) {
+            if (auto *map = get_if<datum::map_type>(value)) {
+                for (auto const& key : *keys) {
+                    if (auto const jt = map->find(key); jt != map->end()) {
+                        find(jt->second, it + 1, r);
+                    }
+                }
+            }
+
+        } else if (auto const *indices = std::get_if<jsonpath::indices>(&*it)) {
+            if (auto *vector = get_if<datum::vector_type>(value)) {
+                for (auto const index : indices->filter(vector->size())) {
+                    find((*vector)[index], it + 1, r);
+                }
+            }
+
+        } else if (std::holds_alternative<jsonpath::wildcard>(*it)) {
+            find_children(value, it + 1, r);
+
+        } else if (std::holds_alternative<jsonpath::descend>(*it)) {
+            find(value, it + 1, r);
+            find_children(value, it, r);
+
+        } else if (auto const *slice = std::get_if<jsonpath::slice>(&*it)) {
+            if (auto *vector = get_if<datum::vector_type>(value)) {
+                auto const first = slice->begin(vector->size());
+                auto const last = slice->end(vector->size());
+
+                for (auto index = first; index != last; index += slice->step) {
+                    if (index >= 0 and index < vector->size()) {
+                        find((*vector)[index], it + 1, r);
+                    }
+                }
+            }
+
+        } else {
+            hi_no_default();
+        }
+    }
+};
+
+}} // namespace hi::v1
+
+// XXX #617 MSVC bug does not handle partial specialization in modules.
+hi_export template<>
+struct std::formatter<hi::jsonpath_plan, char> : std::formatter<std::string, char> {
+    auto format(hi::jsonpath_plan const& t, auto& fc) const
+    {
+        return std::formatter<std::string, char>{}.format(t.string(), fc);
+    }
+};
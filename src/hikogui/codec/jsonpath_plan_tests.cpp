@@ -0,0 +1,111 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "jsonpath_plan.hpp"
+#include "JSON.hpp"
+#include <hikotest/hikotest.hpp>
+#include <string>
+
+TEST_SUITE(jsonpath_plan_suite) {
+
+inline static hi::datum bookstore = hi::parse_JSON(
+    "{\n"
+    "    \"store\" : {\n"
+    "        \"book\" : [\n"
+    "            {\n"
+    "                \"category\" : \"reference\",\n"
+    "                 \"author\" : \"Nigel Rees\",\n"
+    "                 \"title\" : \"Sayings of the Century\",\n"
+    "                 \"price\" : 8.95\n"
+    "            }, {\n"
+    "                 \"category\" : \"fiction\",\n"
+    "                 \"author\" : \"Evelyn Waugh\",\n"
+    "                 \"title\" : \"Sword of Honour\",\n"
+    "                 \"price\" : 12.99\n"
+    "            }, {\n"
+    "                \"category\" : \"fiction\",\n"
+    "                \"author\" : \"Herman Melville\",\n"
+    "                \"title\" : \"Moby Dick\",\n"
+    "                \"isbn\" : \"0-553-21311-3\",\n"
+    "                \"price\" : 8.99\n"
+    "            }, {\n"
+    "                \"category\" : \"fiction\",\n"
+    "                \"author\" : \"J. R. R. Tolkien\",\n"
+    "                \"title\" : \"The Lord of the Rings\",\n"
+    "                \"isbn\" : \"0-395-19395-8\",\n"
+    "                \"price\" : 22.99\n"
+    "            }\n"
+    "        ],\n"
+    "        \"bicycle\" : {\n"
+    "            \"color\" : \"red\",\n"
+    "            \"price\" : 19.95\n"
+    "        }\n"
+    "    }\n"
+    "}\n");
+
+TEST_CASE(find)
+{
+    auto const authors1 = hi::jsonpath_plan{"$.store.book[*].author"}.find(bookstore);
+    REQUIRE(authors1.size() == 4);
+    REQUIRE(*(authors1[0]) == hi::datum{"Nigel Rees"});
+    REQUIRE(*(authors1[3]) == hi::datum{"J. R. R. Tolkien"});
+
+    auto const authors2 = hi::jsonpath_plan{"$..author"}.find(bookstore);
+    REQUIRE(authors2.size() == 4);
+    REQUIRE(*(authors2[1]) == hi::datum{"Evelyn Waugh"});
+    REQUIRE(*(authors2[2]) == hi::datum{"Herman Melville"});
+
+    auto const things = hi::jsonpath_plan{"$.store.*"}.find(bookstore);
+    REQUIRE(things.size() == 2);
+    REQUIRE(things[0]->size() == 2); // attributes of bicycle
+    REQUIRE(things[1]->size() == 4); // list of books
+
+    auto const prices = hi::jsonpath_plan{"$.store..price"}.find(bookstore);
+    REQUIRE(prices.size() == 5);
+    REQUIRE(*(prices[0]) == hi::datum{19.95}); // bicycle first
+    REQUIRE(*(prices[4]) == hi::datum{22.99});
+
+    REQUIRE(hi::jsonpath_plan{"$..book[2]"}.find(bookstore).size() == 1);
+    REQUIRE(hi::jsonpath_plan{"$..book[-1:]"}.find(bookstore).size() == 1);
+    REQUIRE(hi::jsonpath_plan{"$..book[:2]"}.find(bookstore).size() == 2);
+    REQUIRE(hi::jsonpath_plan{"$..book[0,2,7]"}.find(bookstore).size() == 2);
+    REQUIRE(hi::jsonpath_plan{"$.store['bicycle','book','car']"}.find(bookstore).size() == 2);
+    REQUIRE(hi::jsonpath_plan{"$..*"}.find(bookstore).size() == 27);
+}
+
+TEST_CASE(find_one)
+{
+    auto const title = hi::jsonpath_plan{"$.store.book[2].title"};
+    REQUIRE(title.is_singular());
+    REQUIRE(*title.find_one(bookstore) == hi::datum{"Moby Dick"});
+    REQUIRE(*hi::jsonpath_plan{"$.store.book[-1].title"}.find_one(bookstore) == hi::datum{"The Lord of the Rings"});
+    REQUIRE(*hi::jsonpath_plan{"$.store.bicycle.color"}.find_one(bookstore) == hi::datum{"red"});
+
+    REQUIRE(hi::jsonpath_plan{"$.store.book[4].title"}.find_one(bookstore) == nullptr);
+    REQUIRE(hi::jsonpath_plan{"$.store.book[-5].title"}.find_one(bookstore) == nullptr);
+    REQUIRE(hi::jsonpath_plan{"$.store.bicycle[0]"}.find_one(bookstore) == nullptr);
+    REQUIRE(hi::jsonpath_plan{"$.store.bicycle.color.name"}.find_one(bookstore) == nullptr);
+    REQUIRE(hi::jsonpath_plan{"$"}.find_one(bookstore) == &bookstore);
+
+    // A plan can be executed on other documents.
+    auto copy = bookstore;
+    REQUIRE(title.find_one(copy) != title.find_one(bookstore));
+    REQUIRE(*title.find_one(copy) == *title.find_one(bookstore));
+}
+
+TEST_CASE(compile)
+{
+    REQUIRE(not hi::jsonpath_plan{"$..author"}.is_singular());
+    REQUIRE(not hi::jsonpath_plan{"$.store['bicycle','book']"}.is_singular());
+    REQUIRE(not hi::jsonpath_plan{"$.store.book[0,1]"}.is_singular());
+
+    // The same path written differently compiles to the same plan.
+    auto const a = hi::jsonpath_plan{"$.store.book[1]"};
+    auto const b = hi::jsonpath_plan{"$['store']['book'][1]"};
+    REQUIRE(a == b);
+    REQUIRE(a.hash() == b.hash());
+    REQUIRE(a != hi::jsonpath_plan{"$.store.book[2]"});
+}
+
+};
@@ -12,12 +12,19 @@
 #include "../parser/parser.hpp"
 #include "../macros.hpp"
 #include "zlib.hpp"
+#include "crc32.hpp"
 #include <span>
 #include <vector>
 #include <cstddef>
 #include <cstdint>
-#include <numeric>
+#include <array>
+#include <utility>
+#include <cstring>
+#include <algorithm>
+#include <concepts>
 #include <filesystem>
+#include <limits>
+#include <bit>
 #include <memory>
 
 hi_export_module(hikogui.codec.png);
@@ -26,7 +33,14 @@ hi_export namespace hi { inline namespace v1 {
 
 hi_export class png {
 public:
-    [[nodiscard]] png(file_view view) : _view(std::move(view))
+    /** Open a PNG file and read its chunks.
+     *
+     * @param view The PNG file data.
+     * @param verify_checksums Check the CRC-32 of each chunk and the Adler-32 of the image data.
+     *                         Ancillary chunks with an incorrect CRC-32 are ignored.
+     * @throw parse_error When the PNG file is invalid, or a checksum does not match.
+     */
+    [[nodiscard]] png(file_view view, bool verify_checksums = true) : _view(std::move(view)), _verify_checksums(verify_checksums)
     {
         std::size_t offset = 0;
 
@@ -35,7 +49,10 @@ public:
         read_chunks(bytes, offset);
     }
 
-    [[nodiscard]] png(std::filesystem::path const& path) : png(file_view{path}) {}
+    [[nodiscard]] png(std::filesystem::path const& path, bool verify_checksums = true) :
+        png(file_view{path}, verify_checksums)
+    {
+    }
 
     [[nodiscard]] std::size_t width() const noexcept
     {
@@ -49,25 +66,179 @@ public:
 
     void decode_image(pixmap_span<sfloat_rgba16> image) const
     {
-        // There is a filter selection byte in front of every line.
-        auto const image_data_size = _stride * _height;
+        return decode_image(image, [](pixmap_span<sfloat_rgba16 const>) {});
+    }
+
+    /** Decode the image progressively.
+     *
+     * @param image The image to decode into, must be the size of the PNG image.
+     * @param on_progress Called with the part of @a image that was updated. For
+     *                    non-interlaced images this is called after each row, for
+     *                    Adam7 interlaced images this is called with the whole image
+     *                    after each of the seven passes; the pixels of later passes
+     *                    are not written yet.
+     */
+    template<std::invocable<pixmap_span<sfloat_rgba16 const>> ProgressFunc>
+    void decode_image(pixmap_span<sfloat_rgba16> image, ProgressFunc const& on_progress) const
+    {
+        hi_axiom(image.width() == width());
+        hi_axiom(image.height() == height());
+
+        auto decoder = zlib_decoder{_verify_checksums};
+        auto chunk_index = 0_uz;
+        auto input = std::span<std::byte const>{};
 
-        auto image_data = decompress_IDATs(image_data_size);
-        hi_check(ssize(image_data) == image_data_size, "Uncompressed image data has incorrect size.");
+        // There is a filter selection byte in front of every line.
+        // The previous line of the first line is all zeros.
+        auto line_buffer = bstring(_stride, std::byte{0});
+        auto prev_line_buffer = bstring(_stride, std::byte{0});
+
+        auto done = false;
+        if (_interlace_method == 0) {
+            auto line = std::span{line_buffer};
+            auto prev_line = std::span{prev_line_buffer};
+
+            for (auto y = 0; y != _height; ++y) {
+                done = decode_line(decoder, chunk_index, input, line, prev_line);
+
+                auto const image_y = narrow_cast<std::size_t>(_height - y - 1);
+                data_to_image_line(line.subspan(1), image[image_y]);
+                on_progress(std::as_const(image).subimage(0, image_y, image.width(), 1));
+                std::swap(line, prev_line);
+            }
 
-        unfilter_lines(image_data);
+        } else {
+            auto pass_pixels = std::vector<sfloat_rgba16>(width());
+
+            for (auto const& pass : adam7_passes) {
+                // Passes without pixels are not stored in the image data.
+                auto const pass_width = std::max(0, _width - pass.x + pass.dx - 1) / pass.dx;
+                auto const pass_height = std::max(0, _height - pass.y + pass.dy - 1) / pass.dy;
+                if (pass_width == 0 or pass_height == 0) {
+                    continue;
+                }
+
+                // Each pass is filtered on its own, the previous line of the first line is all zeros.
+                auto const pass_stride = narrow_cast<std::size_t>((_bits_per_pixel * pass_width + 7) / 8 + 1);
+                auto line = std::span{line_buffer}.first(pass_stride);
+                auto prev_line = std::span{prev_line_buffer}.first(pass_stride);
+                std::fill(prev_line.begin(), prev_line.end(), std::byte{0});
+
+                auto const pass_row = std::span{pass_pixels}.first(narrow_cast<std::size_t>(pass_width));
+                for (auto pass_y = 0; pass_y != pass_height; ++pass_y) {
+                    done = decode_line(decoder, chunk_index, input, line, prev_line);
+                    data_to_image_line(line.subspan(1), pass_row);
+
+                    auto const image_row = image[narrow_cast<std::size_t>(_height - (pass.y + pass_y * pass.dy) - 1)];
+                    for (auto pass_x = 0; pass_x != pass_width; ++pass_x) {
+                        image_row[narrow_cast<std::size_t>(pass.x + pass_x * pass.dx)] = pass_row[pass_x];
+                    }
+                    std::swap(line, prev_line);
+                }
+
+                on_progress(std::as_const(image));
+            }
+        }
 
-        data_to_image(image_data, image);
+        if (not done) {
+            // Read the zlib trailer, there should not be any image data after the last line.
+            auto overflow = std::array<std::byte, 1>{};
+            auto output = std::span<std::byte>{overflow};
+            hi_check(decompress_IDATs(decoder, chunk_index, input, output), "Uncompressed image data has incorrect size.");
+            hi_check(not output.empty(), "Uncompressed image data has incorrect size.");
+        }
     }
 
-    [[nodiscard]] static pixmap<sfloat_rgba16> load(std::filesystem::path const& path)
+    [[nodiscard]] static pixmap<sfloat_rgba16> load(std::filesystem::path const& path, bool verify_checksums = true)
     {
-        auto const png_data = png(file_view{path});
+        auto const png_data = png(file_view{path}, verify_checksums);
         auto image = pixmap<sfloat_rgba16>{png_data.width(), png_data.height()};
         png_data.decode_image(image);
         return image;
     }
 
+    /** Encode an image as a PNG file.
+     *
+     * The linear-sRGB image with pre-multiplied alpha is stored as 16 bit RGBA in the sRGB color space.
+     * Colors outside the sRGB gamut are clamped.
+     *
+     * @param image The image to encode.
+     * @param level The deflate compression level 0-9.
+     * @return The PNG file data.
+     */
+    [[nodiscard]] static bstring encode(pixmap_span<sfloat_rgba16 const> image, int level = 6)
+    {
+        auto const& transfer_function = linear16_to_gamma16_table();
+
+        return encode_image(image, 16, 6, level, [&](std::span<sfloat_rgba16 const> pixels, std::span<std::byte> bytes) {
+            auto *hi_restrict ptr = bytes.data();
+            for (auto const& pixel : pixels) {
+                auto const pixel_f16 = static_cast<f16x4>(pixel);
+                auto const unclamped_alpha = static_cast<float>(pixel_f16.w());
+                auto const alpha = unclamped_alpha > 0.0f ? std::min(unclamped_alpha, 1.0f) : 0.0f;
+                // PNG stores colors without pre-multiplied alpha.
+                auto const alpha_div = alpha > 0.0f ? 1.0f / alpha : 0.0f;
+
+                for (auto const sample : {pixel_f16.x(), pixel_f16.y(), pixel_f16.z()}) {
+                    auto const linear = half{static_cast<float>(sample) * alpha_div};
+                    store_be(transfer_function[linear.intrinsic()], ptr);
+                    ptr += 2;
+                }
+                store_be(round_cast<uint16_t>(alpha * 65535.0f), ptr);
+                ptr += 2;
+            }
+        });
+    }
+
+    /** Encode an image as a PNG file.
+     *
+     * The sRGB image is stored as 8 bit RGBA, without pre-multiplied alpha.
+     *
+     * @param image The image to encode.
+     * @param level The deflate compression level 0-9.
+     * @return The PNG file data.
+     */
+    [[nodiscard]] static bstring encode(pixmap_span<srgb_abgr8_pack const> image, int level = 6)
+    {
+        return encode_image(image, 8, 6, level, [](std::span<srgb_abgr8_pack const> pixels, std::span<std::byte> bytes) {
+            auto *hi_restrict ptr = bytes.data();
+            for (auto const& pixel : pixels) {
+                // The pack is stored as little-endian R, G, B, A bytes.
+                store_le(std::bit_cast<uint32_t>(pixel), ptr);
+                ptr += 4;
+            }
+        });
+    }
+
+    /** Encode an image as a PNG file.
+     *
+     * The image is stored as 8 bit gray scale in the sRGB color space.
+     *
+     * @param image The image to encode.
+     * @param level The deflate compression level 0-9.
+     * @return The PNG file data.
+     */
+    [[nodiscard]] static bstring encode(pixmap_span<uint8_t const> image, int level = 6)
+    {
+        return encode_image(image, 8, 0, level, [](std::span<uint8_t const> pixels, std::span<std::byte> bytes) {
+            std::memcpy(bytes.data(), pixels.data(), pixels.size());
+        });
+    }
+
+    /** Save an image as a PNG file.
+     *
+     * @param image The image to save.
+     * @param path The path of the file to write.
+     * @param level The deflate compression level 0-9.
+     */
+    template<typename Image>
+    static void save(Image const& image, std::filesystem::path const& path, int level = 6)
+        requires requires { encode(image, level); }
+    {
+        auto f = file(path, access_mode::truncate_or_create_for_write);
+        f.write(encode(image, level));
+    }
+
 private:
     struct PNGHeader {
         uint8_t signature[8];
@@ -107,6 +278,24 @@ private:
         uint8_t rendering_intent;
     };
 
+    /** The position of the first pixel and the distance between pixels of an Adam7 pass.
+     */
+    struct adam7_pass_type {
+        int x;
+        int y;
+        int dx;
+        int dy;
+    };
+
+    constexpr static auto adam7_passes = std::array{
+        adam7_pass_type{0, 0, 8, 8},
+        adam7_pass_type{4, 0, 8, 8},
+        adam7_pass_type{0, 4, 4, 8},
+        adam7_pass_type{2, 0, 4, 4},
+        adam7_pass_type{0, 2, 2, 4},
+        adam7_pass_type{1, 0, 2, 2},
+        adam7_pass_type{0, 1, 1, 2}};
+
     /** Matrix to convert png color values to sRGB.
      * The default are sRGB color primaries and white-point.
      */
@@ -116,6 +305,12 @@ private:
      */
     std::vector<float> _transfer_function;
 
+    /** The colors of a paletted image, converted to linear sRGB with pre-multiplied alpha.
+     *
+     * This always has 256 entries, so that any index in the image data is valid.
+     */
+    std::vector<sfloat_rgba16> _palette;
+
     int _width = 0;
     int _height = 0;
     int _bit_depth = 0;
@@ -127,6 +322,12 @@ private:
     bool _has_alpha;
     bool _is_palletted;
     bool _is_color;
+
+    /** The image has a single color which is fully transparent.
+     */
+    bool _has_transparent_color = false;
+    std::array<uint16_t, 3> _transparent_color = {};
+
     int _samples_per_pixel = 0;
     int _bits_per_pixel = 0;
     int _bytes_per_pixel = 0;
@@ -141,6 +342,8 @@ private:
      */
     file_view _view;
 
+    bool _verify_checksums = true;
+
     static std::string read_string(std::span<std::byte const> bytes)
     {
         std::string r;
@@ -176,16 +379,6 @@ private:
         }
     }
 
-    static uint16_t get_sample(std::span<std::byte const> bytes, ssize_t& offset, bool two_bytes)
-    {
-        uint16_t value = static_cast<uint8_t>(bytes[offset++]);
-        if (two_bytes) {
-            value <<= 8;
-            value |= static_cast<uint8_t>(bytes[offset++]);
-        }
-        return value;
-    }
-
     void read_header(std::span<std::byte const> bytes, std::size_t& offset)
     {
         auto const png_header = make_placement_ptr<PNGHeader>(bytes, offset);
@@ -204,6 +397,8 @@ private:
         auto gAMA_bytes = std::span<std::byte const>{};
         auto iCCP_bytes = std::span<std::byte const>{};
         auto sRGB_bytes = std::span<std::byte const>{};
+        auto PLTE_bytes = std::span<std::byte const>{};
+        auto tRNS_bytes = std::span<std::byte const>{};
         bool has_IEND = false;
 
         while (!has_IEND) {
@@ -212,6 +407,17 @@ private:
             hi_check(length < 0x8000'0000, "Chunk length must be smaller than 2GB");
             hi_check(offset + length + ssizeof(uint32_t) <= bytes.size(), "Chuck extents beyond file.");
 
+            if (_verify_checksums) {
+                auto const type_and_data = bytes.subspan(offset - sizeof(header->type), sizeof(header->type) + length);
+                auto const crc = load_be<uint32_t>(bytes.data() + offset + length);
+                if (crc != crc32(type_and_data)) {
+                    // Corrupt ancillary chunks, with a lower-case first letter, are ignored.
+                    hi_check((header->type[0] & 0x20) != 0, "Chunk CRC failed.");
+                    offset += length + sizeof(uint32_t);
+                    continue;
+                }
+            }
+
             switch (fourcc(header->type)) {
             case fourcc("IDAT"):
                 _idat_chunk_data.push_back(bytes.subspan(offset, length));
@@ -237,6 +443,14 @@ private:
                 sRGB_bytes = bytes.subspan(offset, length);
                 break;
 
+            case fourcc("PLTE"):
+                PLTE_bytes = bytes.subspan(offset, length);
+                break;
+
+            case fourcc("tRNS"):
+                tRNS_bytes = bytes.subspan(offset, length);
+                break;
+
             case fourcc("IEND"):
                 has_IEND = true;
                 break;
@@ -244,9 +458,8 @@ private:
             default:;
             }
 
-            // Skip over the data, and extract the crc32.
-            offset += length;
-            [[maybe_unused]] auto const crc = make_placement_ptr<big_uint32_buf_t>(bytes, offset);
+            // Skip over the data and the crc32.
+            offset += length + sizeof(uint32_t);
         }
 
         hi_check(!IHDR_bytes.empty(), "Missing IHDR chunk.");
@@ -267,6 +480,15 @@ private:
         if (!sRGB_bytes.empty()) {
             read_sRGB(sRGB_bytes);
         }
+
+        // The palette is converted using the color space from the chunks above.
+        if (_is_palletted) {
+            hi_check(!PLTE_bytes.empty(), "Missing PLTE chunk.");
+            read_PLTE(PLTE_bytes, tRNS_bytes);
+
+        } else if (!tRNS_bytes.empty()) {
+            read_tRNS(tRNS_bytes);
+        }
     }
 
     void read_IHDR(std::span<std::byte const> bytes)
@@ -281,18 +503,34 @@ private:
         _filter_method = ihdr->filter_method;
         _interlace_method = ihdr->interlace_method;
 
-        hi_check(_width <= 16384, "PNG width too large.");
-        hi_check(_height <= 16384, "PNG height too large.");
-        hi_check(_bit_depth == 8 || _bit_depth == 16, "PNG only bit depth of 8 or 16 is implemented.");
+        hi_check(_width > 0 and _width <= 16384, "PNG width out of range.");
+        hi_check(_height > 0 and _height <= 16384, "PNG height out of range.");
         hi_check(_compression_method == 0, "Only deflate/inflate compression is allowed.");
         hi_check(_filter_method == 0, "Only adaptive filtering is allowed.");
-        hi_check(_interlace_method == 0, "Only non interlaced PNG are implemented.");
+        hi_check(_interlace_method == 0 or _interlace_method == 1, "Only non interlaced and Adam7 interlaced PNG are allowed.");
 
         _is_palletted = (_color_type & 1) != 0;
         _is_color = (_color_type & 2) != 0;
         _has_alpha = (_color_type & 4) != 0;
-        hi_check((_color_type & 0xf8) == 0, "Invalid color type");
-        hi_check(!_is_palletted, "Paletted images are not supported");
+
+        switch (_color_type) {
+        case 0:
+            hi_check(
+                _bit_depth == 1 or _bit_depth == 2 or _bit_depth == 4 or _bit_depth == 8 or _bit_depth == 16,
+                "Invalid bit depth for gray-scale image.");
+            break;
+        case 3:
+            hi_check(
+                _bit_depth == 1 or _bit_depth == 2 or _bit_depth == 4 or _bit_depth == 8, "Invalid bit depth for paletted image.");
+            break;
+        case 2:
+        case 4:
+        case 6:
+            hi_check(_bit_depth == 8 or _bit_depth == 16, "Invalid bit depth for color or alpha image.");
+            break;
+        default:
+            throw parse_error("Invalid color type");
+        }
 
         if (_is_palletted) {
             _samples_per_pixel = 1;
@@ -359,12 +597,65 @@ private:
         generate_sRGB_transfer_function();
     }
 
+    /** Read the palette and its optional transparency.
+     *
+     * @param bytes The data of the PLTE chunk.
+     * @param tRNS_bytes The data of the tRNS chunk, or empty.
+     */
+    void read_PLTE(std::span<std::byte const> bytes, std::span<std::byte const> tRNS_bytes)
+    {
+        auto const num_colors = bytes.size() / 3;
+        hi_check(bytes.size() % 3 == 0, "PLTE chunk length must be a multiple of 3.");
+        hi_check(num_colors >= 1 and num_colors <= 256, "PLTE chunk must have between 1 and 256 colors.");
+        hi_check(tRNS_bytes.size() <= num_colors, "tRNS chunk has more entries than the palette.");
+
+        _palette.clear();
+        for (auto i = 0_uz; i != num_colors; ++i) {
+            auto const r = std::to_integer<std::size_t>(bytes[i * 3]);
+            auto const g = std::to_integer<std::size_t>(bytes[i * 3 + 1]);
+            auto const b = std::to_integer<std::size_t>(bytes[i * 3 + 2]);
+            // Colors without an entry in tRNS are fully opaque.
+            auto const a = i < tRNS_bytes.size() ? std::to_integer<uint8_t>(tRNS_bytes[i]) : uint8_t{255};
+
+            auto const linear_RGB = f32x4{_transfer_function[r], _transfer_function[g], _transfer_function[b], 1.0f};
+            auto linear_sRGB_color = _color_to_sRGB * linear_RGB;
+
+            // pre-multiply the alpha for use in texture-maps.
+            linear_sRGB_color *= f32x4::broadcast(static_cast<float>(a) * (1.0f / 255.0f));
+            _palette.push_back(linear_sRGB_color);
+        }
+
+        // Indices beyond the palette are invalid, display them as opaque black.
+        _palette.resize(256, f32x4{0.0f, 0.0f, 0.0f, 1.0f});
+    }
+
+    /** Read the single transparent color of a gray-scale or RGB image.
+     */
+    void read_tRNS(std::span<std::byte const> bytes)
+    {
+        if (_has_alpha) {
+            // A tRNS chunk is not allowed for images with an alpha channel.
+            return;
+        }
+
+        auto const num_samples = _is_color ? 3_uz : 1_uz;
+        hi_check(bytes.size() == num_samples * 2, "tRNS chunk has incorrect length.");
+
+        for (auto i = 0_uz; i != num_samples; ++i) {
+            _transparent_color[i] = load_be<uint16_t>(bytes.data() + i * 2);
+        }
+        _has_transparent_color = true;
+    }
+
     void generate_sRGB_transfer_function() noexcept
     {
-        auto const value_range = _bit_depth == 8 ? 256 : 65536;
-        auto const value_range_f = narrow_cast<float>(value_range);
+        // Samples of less than 8 bits, and palette colors, are scaled to 8 bits.
+        auto const value_range = _bit_depth == 16 ? 65536 : 256;
+        // The maximum sample value is 1.0.
+        auto const max_value_f = narrow_cast<float>(value_range - 1);
+        _transfer_function.clear();
         for (int i = 0; i != value_range; ++i) {
-            auto u = narrow_cast<float>(i) / value_range_f;
+            auto u = narrow_cast<float>(i) / max_value_f;
             _transfer_function.push_back(sRGB_gamma_to_linear(u));
         }
     }
@@ -374,170 +665,720 @@ private:
         // SDR brightness is 80 cd/m2. Rec2100/PQ brightness is 10,000 cd/m2.
         constexpr float hdr_multiplier = 10'000.0f / 80.0f;
 
-        auto const value_range = _bit_depth == 8 ? 256 : 65536;
-        auto const value_range_f = narrow_cast<float>(value_range);
+        auto const value_range = _bit_depth == 16 ? 65536 : 256;
+        auto const max_value_f = narrow_cast<float>(value_range - 1);
+        _transfer_function.clear();
         for (int i = 0; i != value_range; ++i) {
-            auto u = narrow_cast<float>(i) / value_range_f;
+            auto u = narrow_cast<float>(i) / max_value_f;
             _transfer_function.push_back(Rec2100_gamma_to_linear(u) * hdr_multiplier);
         }
     }
 
     void generate_gamma_transfer_function(float gamma) noexcept
     {
-        auto const value_range = _bit_depth == 8 ? 256 : 65536;
-        auto const value_range_f = narrow_cast<float>(value_range);
+        auto const value_range = _bit_depth == 16 ? 65536 : 256;
+        auto const max_value_f = narrow_cast<float>(value_range - 1);
+        _transfer_function.clear();
         for (int i = 0; i != value_range; ++i) {
-            auto u = narrow_cast<float>(i) / value_range_f;
+            auto u = narrow_cast<float>(i) / max_value_f;
             _transfer_function.push_back(powf(u, gamma));
         }
     }
 
-    [[nodiscard]] bstring decompress_IDATs(std::size_t image_data_size) const
+    /** Decompress image data directly from the IDAT chunks.
+     *
+     * The compressed data is split over multiple IDAT chunks; each chunk is passed
+     * in turn to the zlib decoder without merging them first.
+     *
+     * @param decoder The zlib decoder.
+     * @param[in,out] chunk_index The index of the next IDAT chunk.
+     * @param[in,out] input The rest of the current IDAT chunk.
+     * @param[in,out] output The buffer to fill with image data, on return the part
+     *                that was not written.
+     * @return True when the end of the zlib stream was reached.
+     */
+    [[nodiscard]] bool decompress_IDATs(
+        zlib_decoder& decoder,
+        std::size_t& chunk_index,
+        std::span<std::byte const>& input,
+        std::span<std::byte>& output) const
     {
-        if (ssize(_idat_chunk_data) == 1) {
-            return zlib_decompress(_idat_chunk_data[0], image_data_size);
-        } else {
-            // Merge all idat chunks together.
-            auto const compressed_data_size =
-                std::accumulate(_idat_chunk_data.cbegin(), _idat_chunk_data.cend(), ssize_t{0}, [](auto const& a, auto const& b) {
-                    return a + ssize(b);
-                });
-
-            bstring compressed_data;
-            compressed_data.reserve(compressed_data_size);
-            for (auto const chunk_data : _idat_chunk_data) {
-                std::copy(chunk_data.begin(), chunk_data.end(), std::back_inserter(compressed_data));
+        while (true) {
+            if (decoder.decode(input, output)) {
+                return true;
+            } else if (output.empty()) {
+                return false;
             }
 
-            return zlib_decompress(compressed_data, image_data_size);
+            // The decoder needs more input.
+            hi_check(chunk_index != _idat_chunk_data.size(), "Compressed image data is truncated.");
+            input = _idat_chunk_data[chunk_index++];
         }
     }
 
-    void unfilter_lines(bstring& image_data) const
+    /** Decompress and unfilter the next line of image data.
+     *
+     * @param decoder The zlib decoder.
+     * @param[in,out] chunk_index The index of the next IDAT chunk.
+     * @param[in,out] input The rest of the current IDAT chunk.
+     * @param line The line to decode, including the filter-type byte in front.
+     * @param prev_line The previous decoded line, of the same size as @a line.
+     * @return True when the end of the zlib stream was reached.
+     */
+    [[nodiscard]] bool decode_line(
+        zlib_decoder& decoder,
+        std::size_t& chunk_index,
+        std::span<std::byte const>& input,
+        std::span<std::byte> line,
+        std::span<std::byte const> prev_line) const
     {
-        auto const image_bytes = std::span(reinterpret_cast<uint8_t *>(image_data.data()), image_data.size());
-        auto zero_line = std::vector<uint8_t>(_bytes_per_line, uint8_t{0});
+        hi_axiom(line.size() == prev_line.size());
+
+        auto output = line;
+        auto const done = decompress_IDATs(decoder, chunk_index, input, output);
+        hi_check(output.empty(), "Uncompressed image data has incorrect size.");
 
-        auto prev_line = std::span(zero_line.data(), zero_line.size());
-        for (auto y = 0_uz; y != _height; ++y) {
-            auto const line = image_bytes.subspan(y * _stride, _stride);
-            unfilter_line(line, prev_line);
-            prev_line = line.subspan(1, _bytes_per_line);
+        auto const line_bytes = std::span{reinterpret_cast<uint8_t *>(line.data()), line.size()};
+        auto const prev_line_bytes = std::span{reinterpret_cast<uint8_t const *>(prev_line.data()), prev_line.size()};
+        unfilter_line(line_bytes, prev_line_bytes.subspan(1));
+        return done;
+    }
+
+    void unfilter_line(std::span<uint8_t> line, std::span<uint8_t const> prev_line) const
+    {
+        // Select a filter specialized for the pixel size, so that a whole pixel is handled at once.
+        switch (_bytes_per_pixel) {
+        case 1:
+            return unfilter_line<1>(line, prev_line);
+        case 2:
+            return unfilter_line<2>(line, prev_line);
+        case 3:
+            return unfilter_line<3>(line, prev_line);
+        case 4:
+            return unfilter_line<4>(line, prev_line);
+        case 6:
+            return unfilter_line<6>(line, prev_line);
+        case 8:
+            return unfilter_line<8>(line, prev_line);
+        default:
+            hi_no_default();
         }
     }
 
+    template<std::size_t BytesPerPixel>
     void unfilter_line(std::span<uint8_t> line, std::span<uint8_t const> prev_line) const
     {
+        hi_axiom(line.size() == prev_line.size() + 1);
+
         switch (line[0]) {
         case 0:
             return;
         case 1:
-            return unfilter_line_sub(line.subspan(1, _bytes_per_line), prev_line);
+            return unfilter_line_sub<BytesPerPixel>(line.subspan(1), prev_line);
         case 2:
-            return unfilter_line_up(line.subspan(1, _bytes_per_line), prev_line);
+            return unfilter_line_up(line.subspan(1), prev_line);
         case 3:
-            return unfilter_line_average(line.subspan(1, _bytes_per_line), prev_line);
+            return unfilter_line_average<BytesPerPixel>(line.subspan(1), prev_line);
         case 4:
-            return unfilter_line_paeth(line.subspan(1, _bytes_per_line), prev_line);
+            return unfilter_line_paeth<BytesPerPixel>(line.subspan(1), prev_line);
         default:
             throw parse_error("Unknown line-filter type");
         }
     }
 
+    /** Load the bytes of a single pixel.
+     *
+     * @tparam BytesPerPixel The number of bytes to load, at most 8.
+     * @param ptr Pointer to the first byte of the pixel.
+     * @return The bytes of the pixel, the rest of the lanes are zero.
+     */
+    template<std::size_t BytesPerPixel>
+    [[nodiscard]] hi_force_inline static std::array<uint8_t, 8> load_pixel(uint8_t const *ptr) noexcept
+    {
+        static_assert(BytesPerPixel <= 8);
+
+        auto r = std::array<uint8_t, 8>{};
+        std::memcpy(r.data(), ptr, BytesPerPixel);
+        return r;
+    }
+
+    /** Store the bytes of a single pixel.
+     *
+     * @tparam BytesPerPixel The number of bytes to store, at most 8.
+     * @param ptr Pointer to the first byte of the pixel.
+     * @param pixel The bytes of the pixel, only the first @a BytesPerPixel lanes are stored.
+     */
+    template<std::size_t BytesPerPixel>
+    hi_force_inline static void store_pixel(uint8_t *ptr, u8x8 pixel) noexcept
+    {
+        static_assert(BytesPerPixel <= 8);
+
+        std::memcpy(ptr, pixel.data(), BytesPerPixel);
+    }
+
+    template<std::size_t BytesPerPixel>
     void unfilter_line_sub(std::span<uint8_t> line, std::span<uint8_t const> prev_line) const noexcept
     {
-        for (int i = 0; i != _bytes_per_line; ++i) {
-            auto const j = i - _bytes_per_pixel;
+        if constexpr (BytesPerPixel >= 3) {
+            // Each pixel depends on the pixel before it, so the bytes of a whole pixel are handled in parallel.
+            auto *hi_restrict ptr = line.data();
+            auto const last = ptr + line.size();
+
+            auto left = u8x8{};
+            for (; ptr != last; ptr += BytesPerPixel) {
+                left += u8x8{load_pixel<BytesPerPixel>(ptr)};
+                store_pixel<BytesPerPixel>(ptr, left);
+            }
 
-            uint8_t prev_raw = j >= 0 ? line[j] : 0;
-            line[i] += prev_raw;
+        } else {
+            for (auto i = BytesPerPixel; i < line.size(); ++i) {
+                line[i] += line[i - BytesPerPixel];
+            }
         }
     }
 
     void unfilter_line_up(std::span<uint8_t> line, std::span<uint8_t const> prev_line) const noexcept
     {
-        for (int i = 0; i != _bytes_per_line; ++i) {
-            line[i] += prev_line[i];
+        auto *hi_restrict ptr = line.data();
+        auto const *hi_restrict prev_ptr = prev_line.data();
+
+        // The up-filter has no dependency between bytes, handle 8 bytes at a time.
+        auto const last = ptr + (line.size() & ~7_uz);
+        for (; ptr != last; ptr += 8, prev_ptr += 8) {
+            auto const up = u8x8{load_pixel<8>(prev_ptr)};
+            store_pixel<8>(ptr, u8x8{load_pixel<8>(ptr)} + up);
+        }
+
+        for (; ptr != line.data() + line.size(); ++ptr, ++prev_ptr) {
+            *ptr += *prev_ptr;
         }
     }
 
+    template<std::size_t BytesPerPixel>
     void unfilter_line_average(std::span<uint8_t> line, std::span<uint8_t const> prev_line) const noexcept
     {
-        for (int i = 0; i != _bytes_per_line; ++i) {
-            auto const j = i - _bytes_per_pixel;
+        if constexpr (BytesPerPixel >= 3) {
+            auto *hi_restrict ptr = line.data();
+            auto const *hi_restrict prev_ptr = prev_line.data();
+            auto const last = ptr + line.size();
+
+            // The average is calculated with 16 bit precision, the sum of two bytes does not fit in a byte.
+            auto const byte_mask = i16x8::broadcast(0xff);
+            auto left = i16x8{};
+            for (; ptr != last; ptr += BytesPerPixel, prev_ptr += BytesPerPixel) {
+                auto const up = i16x8{load_pixel<BytesPerPixel>(prev_ptr)};
+                auto const raw = i16x8{load_pixel<BytesPerPixel>(ptr)};
+
+                left = (raw + srl(left + up, 1)) & byte_mask;
+                store_pixel<BytesPerPixel>(ptr, u8x8{left});
+            }
 
-            uint8_t prev_raw = j >= 0 ? line[j] : 0;
-            line[i] += (prev_raw + prev_line[i]) / 2;
+        } else {
+            for (auto i = 0_uz; i != line.size(); ++i) {
+                auto const left = i >= BytesPerPixel ? line[i - BytesPerPixel] : uint8_t{0};
+                line[i] += narrow_cast<uint8_t>((left + prev_line[i]) / 2);
+            }
         }
     }
 
+    template<std::size_t BytesPerPixel>
     void unfilter_line_paeth(std::span<uint8_t> line, std::span<uint8_t const> prev_line) const noexcept
     {
-        for (int i = 0; i != _bytes_per_line; ++i) {
-            auto const j = i - _bytes_per_pixel;
+        if constexpr (BytesPerPixel >= 3) {
+            auto *hi_restrict ptr = line.data();
+            auto const *hi_restrict prev_ptr = prev_line.data();
+            auto const last = ptr + line.size();
+
+            auto const byte_mask = i16x8::broadcast(0xff);
+            auto left = i16x8{};
+            auto left_up = i16x8{};
+            for (; ptr != last; ptr += BytesPerPixel, prev_ptr += BytesPerPixel) {
+                auto const up = i16x8{load_pixel<BytesPerPixel>(prev_ptr)};
+                auto const raw = i16x8{load_pixel<BytesPerPixel>(ptr)};
+
+                // Same as paeth_predictor(), with p = left + up - left_up.
+                auto const up_diff = up - left_up;
+                auto const left_diff = left - left_up;
+                auto const pa = abs(up_diff);
+                auto const pb = abs(left_diff);
+                auto const pc = abs(up_diff + left_diff);
+                auto const smallest = min(min(pa, pb), pc);
+
+                // The order of selection handles ties the same way as the scalar predictor.
+                auto predictor = left_up;
+                auto const use_up = pb == smallest;
+                predictor = (use_up & up) | andnot(use_up, predictor);
+                auto const use_left = pa == smallest;
+                predictor = (use_left & left) | andnot(use_left, predictor);
+
+                left_up = up;
+                left = (raw + predictor) & byte_mask;
+                store_pixel<BytesPerPixel>(ptr, u8x8{left});
+            }
 
-            uint8_t const up = prev_line[i];
-            uint8_t const left = j >= 0 ? line[j] : 0;
-            uint8_t const left_up = j >= 0 ? prev_line[j] : 0;
-            line[i] += paeth_predictor(left, up, left_up);
+        } else {
+            for (auto i = 0_uz; i != line.size(); ++i) {
+                auto const up = prev_line[i];
+                auto const left = i >= BytesPerPixel ? line[i - BytesPerPixel] : uint8_t{0};
+                auto const left_up = i >= BytesPerPixel ? prev_line[i - BytesPerPixel] : uint8_t{0};
+                line[i] += paeth_predictor(left, up, left_up);
+            }
         }
     }
 
-    void data_to_image(bstring bytes, pixmap_span<sfloat_rgba16> image) const noexcept
+    /** Convert a line of image data to linear-sRGB pixels with pre-multiplied alpha.
+     *
+     * @param bytes The unfiltered line of image data.
+     * @param line The line of pixels to write, its size is the number of pixels to convert.
+     */
+    void data_to_image_line(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
     {
-        auto bytes_span = std::span(bytes);
+        if (_is_palletted) {
+            return palette_to_image_line(bytes, line);
+        }
 
-        for (int y = 0; y != _height; ++y) {
-            int inv_y = _height - y - 1;
+        if (_bit_depth < 8) {
+            gray_to_image_line(bytes, line);
+        } else {
+            samples_to_image_line(bytes, line);
+        }
 
-            auto bytes_line = bytes_span.subspan(inv_y * _stride + 1, _bytes_per_line);
-            auto pixel_line = image[y];
-            data_to_image_line(bytes_line, pixel_line);
+        if (_has_transparent_color) {
+            apply_transparent_color(bytes, line);
         }
     }
 
-    void data_to_image_line(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
+    /** Get a sample from a line of image data.
+     *
+     * @param bytes The unfiltered line of image data.
+     * @param index The index of the sample in the line.
+     * @return The value of the sample.
+     */
+    [[nodiscard]] std::size_t get_sample(std::span<std::byte const> bytes, std::size_t index) const noexcept
     {
-        auto const alpha_mul = _bit_depth == 16 ? 1.0f / 65535.0f : 1.0f / 255.0f;
-        for (int x = 0; x != _width; ++x) {
-            auto const value = extract_pixel_from_line(bytes, x);
+        if (_bit_depth == 16) {
+            return load_be<uint16_t>(bytes.data() + index * 2);
+        }
 
-            auto const linear_RGB =
-                f32x4{_transfer_function[value.x()], _transfer_function[value.y()], _transfer_function[value.z()], 1.0f};
+        // Samples smaller than a byte are packed starting at the most significant bit.
+        auto const bit_offset = index * _bit_depth;
+        auto const byte = std::to_integer<std::size_t>(bytes[bit_offset / 8]);
+        auto const shift = 8 - _bit_depth - bit_offset % 8;
+        return (byte >> shift) & ((1_uz << _bit_depth) - 1);
+    }
 
-            auto const linear_sRGB_color = _color_to_sRGB * linear_RGB;
-            auto const alpha = static_cast<float>(value.w()) * alpha_mul;
+    void palette_to_image_line(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
+    {
+        hi_axiom(_palette.size() == 256);
 
-            // pre-multiply the alpha for use in texture-maps.
-            line[x] = linear_sRGB_color * f32x4::broadcast(alpha);
+        for (auto x = 0_uz; x != line.size(); ++x) {
+            line[x] = _palette[get_sample(bytes, x)];
+        }
+    }
+
+    void gray_to_image_line(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
+    {
+        hi_axiom(_bit_depth < 8);
+
+        // Scale the sample to 8 bits, this is the same as replicating the bits.
+        auto const scale = 255_uz / ((1_uz << _bit_depth) - 1);
+        auto const is_sRGB = _color_to_sRGB == matrix3{};
+
+        for (auto x = 0_uz; x != line.size(); ++x) {
+            auto linear_RGB = f32x4::broadcast(_transfer_function[get_sample(bytes, x) * scale]);
+            linear_RGB.w() = 1.0f;
+
+            line[x] = is_sRGB ? linear_RGB : _color_to_sRGB * linear_RGB;
+        }
+    }
+
+    /** Make the pixels that match the tRNS color fully transparent.
+     */
+    void apply_transparent_color(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
+    {
+        auto const num_samples = narrow_cast<std::size_t>(_samples_per_pixel);
+
+        for (auto x = 0_uz; x != line.size(); ++x) {
+            auto is_transparent = true;
+            for (auto i = 0_uz; i != num_samples; ++i) {
+                is_transparent &= get_sample(bytes, x * num_samples + i) == _transparent_color[i];
+            }
+
+            if (is_transparent) {
+                line[x] = f32x4{};
+            }
         }
     }
 
-    u16x4 extract_pixel_from_line(std::span<std::byte const> bytes, int x) const noexcept
+    void samples_to_image_line(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
     {
         hi_axiom(_bit_depth == 8 or _bit_depth == 16);
         hi_axiom(not _is_palletted);
 
-        uint16_t r = 0;
-        uint16_t g = 0;
-        uint16_t b = 0;
-        uint16_t a = 0;
+        // Select a conversion specialized for the sample format, so that the inner loop has no branches.
+        switch (_bit_depth * 8 + _samples_per_pixel) {
+        case 8 * 8 + 1:
+            return samples_to_image_line<8, 1>(bytes, line);
+        case 8 * 8 + 2:
+            return samples_to_image_line<8, 2>(bytes, line);
+        case 8 * 8 + 3:
+            return samples_to_image_line<8, 3>(bytes, line);
+        case 8 * 8 + 4:
+            return samples_to_image_line<8, 4>(bytes, line);
+        case 16 * 8 + 1:
+            return samples_to_image_line<16, 1>(bytes, line);
+        case 16 * 8 + 2:
+            return samples_to_image_line<16, 2>(bytes, line);
+        case 16 * 8 + 3:
+            return samples_to_image_line<16, 3>(bytes, line);
+        case 16 * 8 + 4:
+            return samples_to_image_line<16, 4>(bytes, line);
+        default:
+            hi_no_default();
+        }
+    }
 
-        ssize_t offset = x * _bytes_per_pixel;
-        if (_is_color) {
-            r = get_sample(bytes, offset, _bit_depth == 16);
-            g = get_sample(bytes, offset, _bit_depth == 16);
-            b = get_sample(bytes, offset, _bit_depth == 16);
-        } else {
-            r = g = b = get_sample(bytes, offset, _bit_depth == 16);
+    /** Convert a line of samples to linear-sRGB pixels with pre-multiplied alpha.
+     *
+     * @tparam BitDepth The number of bits per sample: 8 or 16.
+     * @tparam NrSamples The number of samples per pixel: 1 for gray, 2 for gray-alpha,
+     *                   3 for RGB, 4 for RGBA.
+     * @param bytes The unfiltered line of samples.
+     * @param line The line of pixels to write.
+     */
+    template<int BitDepth, int NrSamples>
+    void samples_to_image_line(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
+    {
+        constexpr auto has_alpha = NrSamples == 2 or NrSamples == 4;
+        constexpr auto is_color = NrSamples >= 3;
+        constexpr auto bytes_per_pixel = NrSamples * BitDepth / 8;
+        constexpr auto alpha_mul = BitDepth == 16 ? 1.0f / 65535.0f : 1.0f / 255.0f;
+
+        hi_axiom(bytes.size() >= line.size() * bytes_per_pixel);
+
+        auto const *hi_restrict transfer_function = _transfer_function.data();
+        auto const color_to_sRGB = _color_to_sRGB;
+        // Images in the sRGB color space do not need a color conversion.
+        auto const is_sRGB = color_to_sRGB == matrix3{};
+
+        auto const sample = [&](std::size_t offset) {
+            return load_sample<BitDepth>(bytes, offset);
+        };
+
+        // A color conversion is cheaper on four pixels at a time, with one register per channel.
+        auto x = 0_uz;
+        if (not is_sRGB) {
+            x = samples_to_image_line_by_four<BitDepth, NrSamples>(bytes, line);
         }
-        if (_has_alpha) {
-            a = get_sample(bytes, offset, _bit_depth == 16);
+
+        for (; x != line.size(); ++x) {
+            auto const offset = x * bytes_per_pixel;
+
+            auto linear_RGB = f32x4{};
+            if constexpr (is_color) {
+                linear_RGB = f32x4{
+                    transfer_function[sample(offset)],
+                    transfer_function[sample(offset + BitDepth / 8)],
+                    transfer_function[sample(offset + 2 * BitDepth / 8)],
+                    1.0f};
+            } else {
+                linear_RGB = f32x4::broadcast(transfer_function[sample(offset)]);
+                linear_RGB.w() = 1.0f;
+            }
+
+            auto linear_sRGB_color = is_sRGB ? linear_RGB : color_to_sRGB * linear_RGB;
+
+            if constexpr (has_alpha) {
+                // pre-multiply the alpha for use in texture-maps.
+                auto const alpha = static_cast<float>(sample(offset + (NrSamples - 1) * BitDepth / 8)) * alpha_mul;
+                linear_sRGB_color *= f32x4::broadcast(alpha);
+            }
+
+            line[x] = linear_sRGB_color;
+        }
+    }
+
+    /** Convert groups of four pixels of a line, applying the color conversion matrix.
+     *
+     * The samples of four pixels are held in structure-of-arrays form, so that the
+     * color matrix and alpha multiplication are done on one register per channel.
+     * The transfer function is a table lookup, which remains a scalar load per sample.
+     *
+     * @tparam BitDepth The number of bits per sample: 8 or 16.
+     * @tparam NrSamples The number of samples per pixel: 1 for gray, 2 for gray-alpha,
+     *                   3 for RGB, 4 for RGBA.
+     * @param bytes The unfiltered line of samples.
+     * @param line The line of pixels to write.
+     * @return The number of pixels converted, a multiple of four.
+     */
+    template<int BitDepth, int NrSamples>
+    [[nodiscard]] std::size_t
+    samples_to_image_line_by_four(std::span<std::byte const> bytes, std::span<sfloat_rgba16> line) const noexcept
+    {
+        constexpr auto has_alpha = NrSamples == 2 or NrSamples == 4;
+        constexpr auto is_color = NrSamples >= 3;
+        constexpr auto bytes_per_pixel = NrSamples * BitDepth / 8;
+        constexpr auto alpha_mul = BitDepth == 16 ? 1.0f / 65535.0f : 1.0f / 255.0f;
+
+        auto const *hi_restrict transfer_function = _transfer_function.data();
+
+        // Each row of the matrix converts one channel of four pixels.
+        auto const rows =
+            transpose(get<0>(_color_to_sRGB), get<1>(_color_to_sRGB), get<2>(_color_to_sRGB), get<3>(_color_to_sRGB));
+
+        auto x = 0_uz;
+        for (; x + 4 <= line.size(); x += 4) {
+            auto const offset = x * bytes_per_pixel;
+
+            auto const lookup = [&](std::size_t sample_offset) {
+                return f32x4{
+                    transfer_function[load_sample<BitDepth>(bytes, sample_offset)],
+                    transfer_function[load_sample<BitDepth>(bytes, sample_offset + bytes_per_pixel)],
+                    transfer_function[load_sample<BitDepth>(bytes, sample_offset + 2 * bytes_per_pixel)],
+                    transfer_function[load_sample<BitDepth>(bytes, sample_offset + 3 * bytes_per_pixel)]};
+            };
+
+            auto const linear_r = lookup(offset);
+            auto const linear_g = is_color ? lookup(offset + BitDepth / 8) : linear_r;
+            auto const linear_b = is_color ? lookup(offset + 2 * BitDepth / 8) : linear_r;
+            auto const one = f32x4::broadcast(1.0f);
+
+            // The same operations, in the same order, as `matrix3 * f32x4` on a single pixel.
+            auto const row = [&](f32x4 const& m) {
+                return m.xxxx() * linear_r + m.yyyy() * linear_g + m.zzzz() * linear_b + m.wwww() * one;
+            };
+
+            auto r = row(rows[0]);
+            auto g = row(rows[1]);
+            auto b = row(rows[2]);
+            auto a = row(rows[3]);
+
+            if constexpr (has_alpha) {
+                // pre-multiply the alpha for use in texture-maps.
+                constexpr auto alpha_offset = (NrSamples - 1) * BitDepth / 8;
+                auto const alpha_samples = i32x4{
+                    load_sample<BitDepth>(bytes, offset + alpha_offset),
+                    load_sample<BitDepth>(bytes, offset + alpha_offset + bytes_per_pixel),
+                    load_sample<BitDepth>(bytes, offset + alpha_offset + 2 * bytes_per_pixel),
+                    load_sample<BitDepth>(bytes, offset + alpha_offset + 3 * bytes_per_pixel)};
+                auto const alpha = f32x4{alpha_samples} * f32x4::broadcast(alpha_mul);
+
+                r *= alpha;
+                g *= alpha;
+                b *= alpha;
+                a *= alpha;
+            }
+
+            auto const pixels = transpose(r, g, b, a);
+            line[x] = pixels[0];
+            line[x + 1] = pixels[1];
+            line[x + 2] = pixels[2];
+            line[x + 3] = pixels[3];
+        }
+        return x;
+    }
+
+    /** Load a big-endian sample.
+     *
+     * @tparam BitDepth The number of bits per sample: 8 or 16.
+     * @param bytes The unfiltered line of samples.
+     * @param offset The byte offset of the sample.
+     * @return The sample value.
+     */
+    template<int BitDepth>
+    [[nodiscard]] hi_force_inline static std::size_t load_sample(std::span<std::byte const> bytes, std::size_t offset) noexcept
+    {
+        if constexpr (BitDepth == 16) {
+            return load_be<uint16_t>(bytes.data() + offset);
         } else {
-            a = (_bit_depth == 16) ? 65535 : 255;
+            return std::to_integer<std::size_t>(bytes[offset]);
+        }
+    }
+
+    /** A table to convert linear float-16 values to 16 bit sRGB gamma encoded samples.
+     *
+     * Values outside the range 0.0 - 1.0 are clamped, NaN is converted to zero.
+     */
+    [[nodiscard]] static std::array<uint16_t, 65536> const& linear16_to_gamma16_table() noexcept
+    {
+        static auto const table = [] {
+            auto r = std::array<uint16_t, 65536>{};
+            for (auto i = 0_uz; i != r.size(); ++i) {
+                auto const u = static_cast<float>(half{std::in_place, narrow_cast<uint16_t>(i)});
+                auto const clamped_u = u > 0.0f ? std::min(u, 1.0f) : 0.0f;
+                r[i] = round_cast<uint16_t>(std::clamp(sRGB_linear_to_gamma(clamped_u), 0.0f, 1.0f) * 65535.0f);
+            }
+            return r;
+        }();
+
+        return table;
+    }
+
+    /** Encode an image as a non-interlaced PNG file.
+     *
+     * @param image The image to encode, the first row is the bottom of the image.
+     * @param bit_depth The number of bits per sample: 8 or 16.
+     * @param color_type The PNG color type: 0 for gray, 6 for RGBA.
+     * @param level The deflate compression level 0-9.
+     * @param pixels_to_bytes A function `void(std::span<T const> pixels, std::span<std::byte> bytes)`
+     *                        which converts a row of pixels to samples.
+     * @return The PNG file data.
+     */
+    template<typename T, typename PixelsToBytes>
+    [[nodiscard]] static bstring
+    encode_image(pixmap_span<T const> image, int bit_depth, int color_type, int level, PixelsToBytes const& pixels_to_bytes)
+    {
+        hi_axiom(image.width() > 0 and image.height() > 0);
+        hi_axiom(image.width() <= std::numeric_limits<int32_t>::max() and image.height() <= std::numeric_limits<int32_t>::max());
+
+        auto const samples_per_pixel = color_type == 6 ? 4_uz : 1_uz;
+        auto const bytes_per_pixel = samples_per_pixel * narrow_cast<std::size_t>(bit_depth) / 8;
+        auto const bytes_per_line = image.width() * bytes_per_pixel;
+
+        auto line = std::vector<uint8_t>(bytes_per_line);
+        // The line above the first line is all zeros.
+        auto prev_line = std::vector<uint8_t>(bytes_per_line);
+        auto filtered_line = std::vector<uint8_t>(bytes_per_line);
+        auto best_line = std::vector<uint8_t>(bytes_per_line);
+
+        // Each filtered line is prefixed with its filter-type.
+        auto image_data = bstring{};
+        image_data.reserve(image.height() * (bytes_per_line + 1));
+
+        for (auto y = 0_uz; y != image.height(); ++y) {
+            // Images are stored bottom-up, PNG files top-down.
+            pixels_to_bytes(image[image.height() - y - 1], std::as_writable_bytes(std::span{line}));
+
+            // Select the filter with the smallest sum of absolute differences, as recommended by the PNG
+            // specification. Small values give the deflate compressor shorter Huffman codes and more matches.
+            auto best_filter_type = uint8_t{0};
+            auto best_score = std::numeric_limits<std::size_t>::max();
+            for (auto filter_type = uint8_t{0}; filter_type != 5; ++filter_type) {
+                auto const score = filter_line(filter_type, bytes_per_pixel, line, prev_line, filtered_line);
+                if (score < best_score) {
+                    best_score = score;
+                    best_filter_type = filter_type;
+                    std::swap(filtered_line, best_line);
+                }
+            }
+
+            image_data.push_back(static_cast<std::byte>(best_filter_type));
+            image_data.append(reinterpret_cast<std::byte const *>(best_line.data()), best_line.size());
+            std::swap(line, prev_line);
+        }
+
+        auto r = bstring{};
+        r.append({std::byte{137}, std::byte{80}, std::byte{78}, std::byte{71}, std::byte{13}, std::byte{10}, std::byte{26}, std::byte{10}});
+
+        auto ihdr = std::array<std::byte, 13>{};
+        store_be(narrow_cast<uint32_t>(image.width()), ihdr.data());
+        store_be(narrow_cast<uint32_t>(image.height()), ihdr.data() + 4);
+        ihdr[8] = static_cast<std::byte>(bit_depth);
+        ihdr[9] = static_cast<std::byte>(color_type);
+        // compression method, filter method and interlace method are all zero.
+        write_chunk(r, fourcc("IHDR"), ihdr);
+
+        // Rendering intent: perceptual.
+        auto const srgb = std::array<std::byte, 1>{std::byte{0}};
+        write_chunk(r, fourcc("sRGB"), srgb);
+
+        auto const compressed = zlib_compress(image_data, level);
+        auto const compressed_bytes = std::span<std::byte const>{compressed};
+        for (auto offset = 0_uz; offset < compressed_bytes.size(); offset += max_IDAT_size) {
+            write_chunk(r, fourcc("IDAT"), compressed_bytes.subspan(offset, std::min(max_IDAT_size, compressed_bytes.size() - offset)));
+        }
+
+        write_chunk(r, fourcc("IEND"), {});
+        return r;
+    }
+
+    /** The maximum amount of compressed data written in a single IDAT chunk.
+     */
+    constexpr static auto max_IDAT_size = 0x1'0000_uz;
+
+    static void write_chunk(bstring& r, uint32_t type, std::span<std::byte const> data)
+    {
+        auto header = std::array<std::byte, 8>{};
+        store_be(narrow_cast<uint32_t>(data.size()), header.data());
+        store_be(type, header.data() + 4);
+        r.append(header.data(), header.size());
+        r.append(data.data(), data.size());
+
+        // The CRC is calculated over the chunk-type and chunk-data.
+        auto crc = std::array<std::byte, 4>{};
+        store_be(crc32(data, crc32(std::span{header}.subspan(4))), crc.data());
+        r.append(crc.data(), crc.size());
+    }
+
+    /** Filter a line and score how well the result will compress.
+     *
+     * @param filter_type The PNG filter type 0-4.
+     * @param bytes_per_pixel The distance in bytes to the pixel on the left.
+     * @param line The line to filter.
+     * @param prev_line The unfiltered line above @a line.
+     * @param[out] r The filtered line.
+     * @return The sum of the filtered bytes interpreted as absolute signed values.
+     */
+    [[nodiscard]] static std::size_t filter_line(
+        uint8_t filter_type,
+        std::size_t bytes_per_pixel,
+        std::span<uint8_t const> line,
+        std::span<uint8_t const> prev_line,
+        std::span<uint8_t> r) noexcept
+    {
+        switch (filter_type) {
+        case 0:
+            return filter_line<0>(bytes_per_pixel, line, prev_line, r);
+        case 1:
+            return filter_line<1>(bytes_per_pixel, line, prev_line, r);
+        case 2:
+            return filter_line<2>(bytes_per_pixel, line, prev_line, r);
+        case 3:
+            return filter_line<3>(bytes_per_pixel, line, prev_line, r);
+        case 4:
+            return filter_line<4>(bytes_per_pixel, line, prev_line, r);
+        default:
+            hi_no_default();
         }
+    }
+
+    template<uint8_t FilterType>
+    [[nodiscard]] static std::size_t filter_line(
+        std::size_t bytes_per_pixel,
+        std::span<uint8_t const> line,
+        std::span<uint8_t const> prev_line,
+        std::span<uint8_t> r) noexcept
+    {
+        hi_axiom(line.size() == prev_line.size());
+        hi_axiom(line.size() == r.size());
+
+        auto const *hi_restrict line_ptr = line.data();
+        auto const *hi_restrict prev_line_ptr = prev_line.data();
+        auto *hi_restrict r_ptr = r.data();
+
+        auto score = 0_uz;
+        for (auto i = 0_uz; i != line.size(); ++i) {
+            // The pixel on the left of the first pixel is all zeros.
+            auto const left = i >= bytes_per_pixel ? line_ptr[i - bytes_per_pixel] : uint8_t{0};
+            auto const up = prev_line_ptr[i];
+            auto const left_up = i >= bytes_per_pixel ? prev_line_ptr[i - bytes_per_pixel] : uint8_t{0};
+
+            auto prediction = uint8_t{0};
+            if constexpr (FilterType == 1) {
+                prediction = left;
+            } else if constexpr (FilterType == 2) {
+                prediction = up;
+            } else if constexpr (FilterType == 3) {
+                prediction = narrow_cast<uint8_t>((left + up) / 2);
+            } else if constexpr (FilterType == 4) {
+                prediction = paeth_predictor(left, up, left_up);
+            }
 
-        return u16x4{r, g, b, a};
+            auto const filtered = static_cast<uint8_t>(line_ptr[i] - prediction);
+            r_ptr[i] = filtered;
+            score += narrow_cast<std::size_t>(std::abs(static_cast<int>(static_cast<int8_t>(filtered))));
+        }
+        return score;
     }
 };
 
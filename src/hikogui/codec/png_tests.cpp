@@ -0,0 +1,203 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "png.hpp"
+#include "../image/image.hpp"
+#include "../file/file.hpp"
+#include "../container/container.hpp"
+#include "../path/path.hpp"
+#include <hikotest/hikotest.hpp>
+#include <filesystem>
+#include <cmath>
+
+TEST_SUITE(png_suite) {
+
+TEST_CASE(adam7_rgba8)
+{
+    auto const expected = hi::png::load(hi::library_test_data_dir() / "png_rgba8.png");
+    auto const image = hi::png::load(hi::library_test_data_dir() / "png_rgba8_adam7.png");
+    REQUIRE(expected.width() == 13);
+    REQUIRE(expected.height() == 11);
+    REQUIRE(image == expected);
+}
+
+TEST_CASE(adam7_rgb16)
+{
+    auto const expected = hi::png::load(hi::library_test_data_dir() / "png_rgb16.png");
+    auto const image = hi::png::load(hi::library_test_data_dir() / "png_rgb16_adam7.png");
+    REQUIRE(image == expected);
+}
+
+TEST_CASE(palette)
+{
+    auto const expected = hi::png::load(hi::library_test_data_dir() / "png_palette2_rgba8.png");
+    auto const image = hi::png::load(hi::library_test_data_dir() / "png_palette2.png");
+    REQUIRE(image == expected);
+
+    auto const interlaced_image = hi::png::load(hi::library_test_data_dir() / "png_palette2_adam7.png");
+    REQUIRE(interlaced_image == expected);
+}
+
+TEST_CASE(gray_low_bit_depth)
+{
+    auto const expected4 = hi::png::load(hi::library_test_data_dir() / "png_gray4_gray8.png");
+    auto const image4 = hi::png::load(hi::library_test_data_dir() / "png_gray4.png");
+    REQUIRE(image4 == expected4);
+
+    auto const expected1 = hi::png::load(hi::library_test_data_dir() / "png_gray1_gray8.png");
+    auto const image1 = hi::png::load(hi::library_test_data_dir() / "png_gray1_adam7.png");
+    REQUIRE(image1 == expected1);
+}
+
+TEST_CASE(transparent_color)
+{
+    auto const image = hi::png::load(hi::library_test_data_dir() / "png_gray4.png");
+
+    auto num_transparent = 0;
+    for (auto const& row : image.rows()) {
+        for (auto const& pixel : row) {
+            if (pixel == hi::sfloat_rgba16{}) {
+                ++num_transparent;
+            }
+        }
+    }
+    REQUIRE(num_transparent > 0);
+}
+
+TEST_CASE(progressive)
+{
+    auto const png_data = hi::png(hi::library_test_data_dir() / "png_rgba8.png");
+    auto image = hi::pixmap<hi::sfloat_rgba16>{png_data.width(), png_data.height()};
+
+    auto num_rows = size_t{0};
+    png_data.decode_image(image, [&](hi::pixmap_span<hi::sfloat_rgba16 const> rows) {
+        REQUIRE(rows.width() == 13);
+        REQUIRE(rows.height() == 1);
+        ++num_rows;
+    });
+    REQUIRE(num_rows == 11);
+
+    auto const interlaced_png_data = hi::png(hi::library_test_data_dir() / "png_rgba8_adam7.png");
+    auto interlaced_image = hi::pixmap<hi::sfloat_rgba16>{png_data.width(), png_data.height()};
+
+    auto num_passes = size_t{0};
+    interlaced_png_data.decode_image(interlaced_image, [&](hi::pixmap_span<hi::sfloat_rgba16 const> rows) {
+        REQUIRE(rows.width() == 13);
+        REQUIRE(rows.height() == 11);
+        ++num_passes;
+    });
+    REQUIRE(num_passes == 7);
+    REQUIRE(interlaced_image == image);
+}
+
+
+TEST_CASE(corrupt_chunk_crc)
+{
+    auto const original = hi::file_view{hi::library_test_data_dir() / "png_rgba8.png"};
+    auto corrupt = hi::bstring{as_bstring_view(original)};
+    // Corrupt the CRC of the IHDR chunk, after the signature, chunk header and 13 bytes of data.
+    corrupt[8 + 8 + 13] ^= std::byte{1};
+
+    auto const path = std::filesystem::temp_directory_path() / "hikogui_png_corrupt_chunk_crc.png";
+    {
+        auto f = hi::file(path, hi::access_mode::truncate_or_create_for_write);
+        f.write(corrupt);
+    }
+
+    REQUIRE_THROWS(hi::png::load(path), hi::parse_error);
+    auto const image = hi::png::load(path, false);
+    std::filesystem::remove(path);
+
+    REQUIRE(image == hi::png::load(hi::library_test_data_dir() / "png_rgba8.png"));
+}
+
+TEST_CASE(save_rgba8)
+{
+    auto image = hi::pixmap<hi::srgb_abgr8_pack>{17, 9};
+    for (auto y = size_t{0}; y != image.height(); ++y) {
+        for (auto x = size_t{0}; x != image.width(); ++x) {
+            auto const r = static_cast<uint32_t>(x * 15);
+            auto const g = static_cast<uint32_t>(y * 28);
+            auto const b = static_cast<uint32_t>((x * y) % 256);
+            auto const a = x == 0 ? uint32_t{0} : uint32_t{255};
+            image[y][x] = (a << 24) | (b << 16) | (g << 8) | r;
+        }
+    }
+
+    auto const path = std::filesystem::temp_directory_path() / "hikogui_png_save_rgba8.png";
+    hi::png::save(image, path);
+    auto const loaded = hi::png::load(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(loaded.width() == 17);
+    REQUIRE(loaded.height() == 9);
+    for (auto y = size_t{0}; y != image.height(); ++y) {
+        for (auto x = size_t{0}; x != image.width(); ++x) {
+            auto const alpha = x == 0 ? 0.0f : 1.0f;
+            auto const expected = hi::f32x4{
+                hi::sRGB_gamma_to_linear((x * 15) / 255.0f) * alpha,
+                hi::sRGB_gamma_to_linear((y * 28) / 255.0f) * alpha,
+                hi::sRGB_gamma_to_linear(((x * y) % 256) / 255.0f) * alpha,
+                alpha};
+            auto const pixel = static_cast<hi::f32x4>(static_cast<hi::f16x4>(loaded[y][x]));
+            for (auto i = size_t{0}; i != 4; ++i) {
+                REQUIRE(pixel[i] == expected[i], 0.005);
+            }
+        }
+    }
+}
+
+TEST_CASE(save_gray8)
+{
+    auto image = hi::pixmap<uint8_t>{5, 51};
+    for (auto y = size_t{0}; y != image.height(); ++y) {
+        for (auto x = size_t{0}; x != image.width(); ++x) {
+            image[y][x] = static_cast<uint8_t>(y * 5 + x);
+        }
+    }
+
+    auto const path = std::filesystem::temp_directory_path() / "hikogui_png_save_gray8.png";
+    hi::png::save(image, path);
+    auto const loaded = hi::png::load(path);
+    std::filesystem::remove(path);
+
+    REQUIRE(loaded.width() == 5);
+    REQUIRE(loaded.height() == 51);
+    for (auto y = size_t{0}; y != image.height(); ++y) {
+        for (auto x = size_t{0}; x != image.width(); ++x) {
+            auto const gray = hi::sRGB_gamma_to_linear((y * 5 + x) / 255.0f);
+            auto const pixel = static_cast<hi::f32x4>(static_cast<hi::f16x4>(loaded[y][x]));
+            REQUIRE(pixel.x() == gray, 0.005);
+            REQUIRE(pixel.y() == gray, 0.005);
+            REQUIRE(pixel.z() == gray, 0.005);
+            REQUIRE(pixel.w() == 1.0f);
+        }
+    }
+}
+
+TEST_CASE(save_round_trip)
+{
+    auto const image = hi::png::load(hi::library_test_data_dir() / "png_rgba8.png");
+
+    for (auto level : {0, 1, 9}) {
+        auto const path = std::filesystem::temp_directory_path() / "hikogui_png_save_round_trip.png";
+        hi::png::save(image, path, level);
+        auto const loaded = hi::png::load(path);
+        std::filesystem::remove(path);
+
+        REQUIRE(loaded.width() == image.width());
+        REQUIRE(loaded.height() == image.height());
+        for (auto y = size_t{0}; y != image.height(); ++y) {
+            for (auto x = size_t{0}; x != image.width(); ++x) {
+                auto const expected = static_cast<hi::f32x4>(static_cast<hi::f16x4>(image[y][x]));
+                auto const pixel = static_cast<hi::f32x4>(static_cast<hi::f16x4>(loaded[y][x]));
+                for (auto i = size_t{0}; i != 4; ++i) {
+                REQUIRE(pixel[i] == expected[i], 0.005);
+            }
+            }
+        }
+    }
+}
+
+};
@@ -9,45 +9,264 @@
 #include "../parser/parser.hpp"
 #include "../macros.hpp"
 #include "inflate.hpp"
+#include "deflate.hpp"
+#include "adler32.hpp"
 #include <cstddef>
+#include <array>
 #include <filesystem>
+#include <concepts>
 
 hi_export_module(hikogui.codec.zlib);
 
 hi_export namespace hi { inline namespace v1 {
+namespace detail {
 
-[[nodiscard]] inline bstring zlib_decompress(std::span<std::byte const> bytes, std::size_t max_size)
+struct zlib_header {
+    uint8_t CMF;
+    uint8_t FLG;
+};
+
+inline void zlib_check_header(zlib_header const& header)
 {
-    struct zlib_header {
-        uint8_t CMF;
-        uint8_t FLG;
-    };
+    auto const header_chksum = header.CMF * 256 + header.FLG;
+    hi_check(header_chksum % 31 == 0, "zlib header checksum failed.");
+
+    hi_check((header.CMF & 0xf) == 8, "zlib compression method must be 8");
+    hi_check(((header.CMF >> 4) & 0xf) <= 7, "zlib LZ77 window too large");
+    hi_check((header.FLG & 0x20) == 0, "zlib must not use a preset dictionary");
+}
+
+} // namespace detail
 
+/** Decompress a zlib stream.
+ *
+ * @param bytes The zlib stream.
+ * @param max_size The maximum size of the decompressed data.
+ * @param verify_checksum Check the Adler-32 checksum of the decompressed data.
+ * @return The decompressed data.
+ * @throw parse_error When the zlib data is invalid, or the checksum does not match.
+ */
+[[nodiscard]] inline bstring zlib_decompress(std::span<std::byte const> bytes, std::size_t max_size, bool verify_checksum = true)
+{
     auto offset = 0_uz;
 
-    auto const header = make_placement_ptr<zlib_header>(bytes, offset);
+    auto const header = make_placement_ptr<detail::zlib_header>(bytes, offset);
+    detail::zlib_check_header(*header);
 
-    auto const header_chksum = header->CMF * 256 + header->FLG;
-    hi_check(header_chksum % 31 == 0, "zlib header checksum failed.");
+    auto r = inflate(bytes, offset, max_size);
 
-    hi_check((header->CMF & 0xf) == 8, "zlib compression method must be 8");
-    hi_check(((header->CMF >> 4) & 0xf) <= 7, "zlib LZ77 window too large");
-    hi_check((header->FLG & 0x20) == 0, "zlib must not use a preset dictionary");
+    auto const ADLER32 = **make_placement_ptr<big_uint32_buf_t>(bytes, offset);
+    hi_check(not verify_checksum or ADLER32 == adler32(r), "zlib Adler-32 checksum failed.");
 
-    if (header->FLG & 0x20) {
-        [[maybe_unused]] auto FDICT = make_placement_ptr<big_uint32_buf_t>(bytes, offset);
-    }
+    return r;
+}
 
-    auto r = inflate(bytes, offset, max_size);
+[[nodiscard]] inline bstring
+zlib_decompress(std::filesystem::path const& path, std::size_t max_size = 0x01000000, bool verify_checksum = true)
+{
+    return zlib_decompress(as_span<std::byte const>(file_view(path)), max_size, verify_checksum);
+}
+
+/** Compress data into a zlib stream.
+ *
+ * @param bytes The data to compress.
+ * @param level The compression level: 0 stores the data uncompressed, 1 is the
+ *              fastest compression, up to 9 for the best compression.
+ * @return The zlib stream.
+ */
+hi_export [[nodiscard]] inline bstring zlib_compress(std::span<std::byte const> bytes, int level = 6)
+{
+    hi_axiom(level >= 0 and level <= 9);
+
+    // The compression level is only informative.
+    auto const FLEVEL = level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3;
+
+    auto const CMF = 0x78;
+    auto FLG = FLEVEL << 6;
+    FLG |= 31 - (CMF * 256 + FLG) % 31;
 
-    [[maybe_unused]] auto ADLER32 = make_placement_ptr<big_uint32_buf_t>(bytes, offset);
+    auto r = bstring{};
+    r.push_back(static_cast<std::byte>(CMF));
+    r.push_back(static_cast<std::byte>(FLG));
 
+    deflate(bytes, level, r);
+
+    auto ADLER32 = std::array<std::byte, 4>{};
+    store_be(adler32(bytes), ADLER32.data());
+    r.append(ADLER32.data(), ADLER32.size());
     return r;
 }
 
-[[nodiscard]] inline bstring zlib_decompress(std::filesystem::path const& path, std::size_t max_size = 0x01000000)
+/** Compress data into a zlib file.
+ *
+ * @param path The path of the file to write.
+ * @param bytes The data to compress.
+ * @param level The compression level.
+ */
+hi_export inline void zlib_compress(std::filesystem::path const& path, std::span<std::byte const> bytes, int level = 6)
 {
-    return zlib_decompress(as_span<std::byte const>(file_view(path)), max_size);
+    auto f = file(path, access_mode::truncate_or_create_for_write);
+    f.write(zlib_compress(bytes, level));
+}
+
+/** A resumable zlib decoder.
+ *
+ * The decoder is fed with chunks of zlib data and writes the
+ * decompressed data into buffers supplied by the caller.
+ *
+ * @see inflate_decoder
+ */
+hi_export class zlib_decoder {
+public:
+    /** Create a zlib decoder.
+     *
+     * @param verify_checksum Check the Adler-32 checksum of the decompressed data.
+     */
+    explicit zlib_decoder(bool verify_checksum = true) noexcept : _verify_checksum(verify_checksum) {}
+
+    /** Check if the end of the zlib stream has been reached.
+     */
+    [[nodiscard]] bool done() const noexcept
+    {
+        return _state == state_type::done;
+    }
+
+    /** Bytes that were read beyond the end of the zlib stream.
+     *
+     * When the decoder is done, it may have read a few bytes from the input
+     * beyond the end of the zlib stream. These bytes come before the data that
+     * was returned in `input` by `decode()`.
+     */
+    [[nodiscard]] std::span<std::byte const> unused() const noexcept
+    {
+        if (not done()) {
+            return {};
+        }
+
+        auto const unused = _inflate.unused();
+        return unused.subspan(std::min(unused.size(), sizeof(big_uint32_buf_t)));
+    }
+
+    /** Decode a chunk of zlib data.
+     *
+     * @param[in,out] input The zlib data, on return the data that was not consumed.
+     * @param[in,out] output The buffer to write decompressed data to, on return the part
+     *                of the buffer that was not written.
+     * @return true when the end of the zlib stream is reached.
+     * @throw parse_error When the zlib data is invalid.
+     */
+    [[nodiscard]] bool decode(std::span<std::byte const>& input, std::span<std::byte>& output)
+    {
+        switch (_state) {
+        case state_type::header:
+            if (not fill(input, sizeof(detail::zlib_header))) {
+                return false;
+            }
+
+            detail::zlib_check_header(*make_placement_ptr<detail::zlib_header>(std::span<std::byte const>{_buffer}));
+            _buffer.clear();
+            _state = state_type::data;
+            [[fallthrough]];
+
+        case state_type::data:
+            {
+                auto const output_first = output.data();
+                auto const done = _inflate.decode(input, output);
+                if (_verify_checksum) {
+                    _adler32 = adler32({output_first, output.data()}, _adler32);
+                }
+                if (not done) {
+                    return false;
+                }
+            }
+
+            {
+                // The inflate decoder may have read beyond the trailer, those bytes are returned by `unused()`.
+                auto const unused = _inflate.unused();
+                _buffer.append(unused.data(), std::min(unused.size(), sizeof(big_uint32_buf_t)));
+            }
+            _state = state_type::trailer;
+            [[fallthrough]];
+
+        case state_type::trailer:
+            if (not fill(input, sizeof(big_uint32_buf_t))) {
+                return false;
+            }
+
+            hi_check(
+                not _verify_checksum or load_be<uint32_t>(_buffer.data()) == _adler32, "zlib Adler-32 checksum failed.");
+            _state = state_type::done;
+            [[fallthrough]];
+
+        case state_type::done:
+            return true;
+
+        default:
+            hi_no_default();
+        }
+    }
+
+private:
+    enum class state_type : uint8_t { header, data, trailer, done };
+
+    state_type _state = state_type::header;
+    bool _verify_checksum = true;
+    uint32_t _adler32 = 1;
+    inflate_decoder _inflate;
+
+    /** Buffer to collect the header and trailer from multiple chunks.
+     */
+    bstring _buffer;
+
+    [[nodiscard]] bool fill(std::span<std::byte const>& input, std::size_t size)
+    {
+        hi_axiom(_buffer.size() <= size);
+        auto const n = std::min(size - _buffer.size(), input.size());
+        _buffer.append(input.data(), n);
+        input = input.subspan(n);
+        return _buffer.size() == size;
+    }
+};
+
+/** Decompress a zlib file in chunks.
+ *
+ * The file is read in chunks and the decompressed data is passed
+ * in chunks to @a sink, the complete decompressed data is never held in memory.
+ *
+ * @param path The path to the zlib file.
+ * @param sink A function `void(std::span<std::byte const>)` which is called with each chunk of decompressed data.
+ * @param verify_checksum Check the Adler-32 checksum of the decompressed data.
+ * @throw parse_error When the zlib data is invalid, or the checksum does not match.
+ * @throw io_error When the file could not be read.
+ */
+hi_export template<std::invocable<std::span<std::byte const>> Sink>
+void zlib_decompress(std::filesystem::path const& path, Sink&& sink, bool verify_checksum = true)
+{
+    constexpr auto chunk_size = 0x1'0000_uz;
+
+    auto f = file{path};
+    auto decoder = zlib_decoder{verify_checksum};
+    auto input_buffer = bstring(chunk_size, std::byte{0});
+    auto output_buffer = bstring(chunk_size, std::byte{0});
+
+    auto input = std::span<std::byte const>{};
+    while (true) {
+        auto output = std::span{output_buffer};
+        auto const done = decoder.decode(input, output);
+        if (auto const n = output_buffer.size() - output.size()) {
+            sink(std::span<std::byte const>{output_buffer.data(), n});
+        }
+
+        if (done) {
+            return;
+
+        } else if (not output.empty()) {
+            // The decoder stopped because it needs more input.
+            auto const n = f.read(input_buffer.data(), input_buffer.size());
+            hi_check(n != 0, "zlib data is truncated");
+            input = std::span{input_buffer.data(), n};
+        }
+    }
 }
 
 }} // namespace hi::v1
@@ -3,6 +3,11 @@
 #pragma once
 
 #include "thread_intf.hpp" // export
+#include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
 #include "thread_win32_impl.hpp" // export
+#else
+#include "thread_posix_impl.hpp" // export
+#endif
 
 hi_export_module(hikogui.concurrency.thread);
@@ -16,6 +16,7 @@
 #include <string_view>
 #include <format>
 #include <functional>
+#include <iterator>
 #include <atomic>
 #include <chrono>
 #include <unordered_map>
@@ -70,6 +71,26 @@ void set_thread_name(std::string_view name) noexcept;
     }
 }
 
+/** Append the thread name of a thread id to a string.
+ *
+ * Unlike `get_thread_name()` this does not allocate a new string, so that the
+ * logger thread can reuse its buffer.
+ *
+ * @ingroup concurrency
+ * @param[out] r The string to append the name to.
+ * @param id The thread id.
+ */
+inline void append_thread_name(std::string& r, thread_id id) noexcept
+{
+    auto const lock = std::scoped_lock(detail::thread_names_mutex);
+    auto const it = detail::thread_names.find(id);
+    if (it != detail::thread_names.end()) {
+        r += it->second;
+    } else {
+        std::format_to(std::back_inserter(r), "{}", id);
+    }
+}
+
 /** Get the current process CPU affinity mask.
  *
  * @ingroup concurrency
@@ -0,0 +1,105 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "thread_intf.hpp"
+#include "unfair_mutex.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <format>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+hi_export_module(hikogui.concurrency.thread : impl);
+
+hi_export namespace hi::inline v1 {
+
+[[nodiscard]] inline thread_id current_thread_id() noexcept
+{
+    // Thread IDs on Linux are guaranteed to be not zero.
+    // gettid() is a system call, so the id is cached for each thread.
+    thread_local auto const id = narrow_cast<thread_id>(::gettid());
+    return id;
+}
+
+inline void set_thread_name(std::string_view name) noexcept
+{
+    // The kernel limits the name to 15 characters, don't cut a UTF-8 code-point in half.
+    auto size = std::min(name.size(), 15_uz);
+    while (size != 0 and size != name.size() and (name[size] & 0xc0) == 0x80) {
+        --size;
+    }
+    auto const short_name = std::string{name.substr(0, size)};
+    ::pthread_setname_np(::pthread_self(), short_name.c_str());
+
+    auto const lock = std::scoped_lock(detail::thread_names_mutex);
+    detail::thread_names.emplace(current_thread_id(), std::string{name});
+}
+
+inline std::vector<bool> mask_cpu_set_to_vec(cpu_set_t const& rhs) noexcept
+{
+    auto r = std::vector<bool>{};
+
+    r.resize(CPU_SETSIZE);
+    for (std::size_t i = 0; i != r.size(); ++i) {
+        r[i] = CPU_ISSET(i, &rhs);
+    }
+
+    return r;
+}
+
+inline cpu_set_t mask_vec_to_cpu_set(std::vector<bool> const& rhs) noexcept
+{
+    cpu_set_t r;
+    CPU_ZERO(&r);
+    for (std::size_t i = 0; i != rhs.size() and i != CPU_SETSIZE; ++i) {
+        if (rhs[i]) {
+            CPU_SET(i, &r);
+        }
+    }
+    return r;
+}
+
+[[nodiscard]] inline std::vector<bool> process_affinity_mask()
+{
+    cpu_set_t process_mask;
+    if (::sched_getaffinity(0, sizeof(process_mask), &process_mask) != 0) {
+        throw os_error(std::format("Could not get process affinity mask. '{}'", get_last_error_message()));
+    }
+
+    return mask_cpu_set_to_vec(process_mask);
+}
+
+inline std::vector<bool> set_thread_affinity_mask(std::vector<bool> const& mask)
+{
+    auto const thread_handle = ::pthread_self();
+
+    cpu_set_t old_mask;
+    if (auto const error = ::pthread_getaffinity_np(thread_handle, sizeof(old_mask), &old_mask); error != 0) {
+        throw os_error(std::format("Could not get the thread affinity. '{}'", get_last_error_message(error)));
+    }
+
+    auto const mask_ = mask_vec_to_cpu_set(mask);
+    if (auto const error = ::pthread_setaffinity_np(thread_handle, sizeof(mask_), &mask_); error != 0) {
+        throw os_error(std::format("Could not set the thread affinity. '{}'", get_last_error_message(error)));
+    }
+
+    return mask_cpu_set_to_vec(old_mask);
+}
+
+[[nodiscard]] inline std::size_t current_cpu_id() noexcept
+{
+    auto const index = ::sched_getcpu();
+    hi_assert(index >= 0);
+    return narrow_cast<std::size_t>(index);
+}
+
+} // namespace hi::inline v1
@@ -7,6 +7,7 @@
 #include "lean_vector.hpp" // export
 #include "polymorphic_optional.hpp" // export
 #include "secure_vector.hpp" // export
+#include "spsc_fifo.hpp" // export
 #include "stable_set.hpp" // export
 #include "stack.hpp" // export
 #include "undo_stack.hpp" // export
@@ -347,7 +347,7 @@ private:
             // If we get here, that would suck, but nothing to do about it.
             //++global_counter<"polymorphic_optional:contended">;
             std::this_thread::sleep_for(16ms);
-        } while (_pointer.load(std::memory_order::relaxed) != nullptr);
+        } while (_pointer.load(std::memory_order::acquire) != nullptr);
     }
 };
 
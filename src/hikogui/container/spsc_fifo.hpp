@@ -0,0 +1,185 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "polymorphic_optional.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <type_traits>
+#include <concepts>
+#include <atomic>
+#include <memory>
+#include <array>
+#include <bit>
+#include <new>
+
+hi_export_module(hikogui.container.spsc_fifo);
+
+hi_export namespace hi::inline v1 {
+
+/** A wait-free single-producer/single-consumer fifo.
+ *
+ * Like `wfree_fifo` each slot in the ring buffer consists of a pointer and a
+ * byte buffer for storage. But since there is only a single producer the
+ * head is a plain index owned by the producer thread; there is no atomic
+ * read-modify-write on the write path, and the producer can check if the fifo
+ * is full without claiming a slot.
+ *
+ * @tparam T Base class of the value type stored in the ring buffer.
+ * @tparam SlotSize Size of each slot, must be power-of-two.
+ * @tparam FifoSize Size of the ring buffer in bytes, must be power-of-two.
+ */
+template<typename T, std::size_t SlotSize, std::size_t FifoSize = 65536>
+class alignas(SlotSize) spsc_fifo {
+public:
+    static_assert(std::has_single_bit(SlotSize), "Only power-of-two number of messages size allowed.");
+    static_assert(std::has_single_bit(FifoSize), "Only power-of-two fifo size allowed.");
+    static_assert(FifoSize > SlotSize);
+
+    using value_type = T;
+    using slot_type = polymorphic_optional<value_type, SlotSize, SlotSize>;
+
+    constexpr static std::size_t fifo_size = FifoSize;
+    constexpr static std::size_t slot_size = SlotSize;
+    constexpr static std::size_t num_slots = fifo_size / slot_size;
+
+    constexpr spsc_fifo() noexcept = default;
+    spsc_fifo(spsc_fifo const&) = delete;
+    spsc_fifo(spsc_fifo&&) = delete;
+    spsc_fifo& operator=(spsc_fifo const&) = delete;
+    spsc_fifo& operator=(spsc_fifo&&) = delete;
+
+    /** Check if fifo is empty.
+     *
+     * @note Must be called on the reader-thread.
+     */
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return _slots[_tail].empty(std::memory_order::acquire);
+    }
+
+    /** Check if the fifo is full.
+     *
+     * @note Must be called on the writer-thread.
+     */
+    [[nodiscard]] bool full() const noexcept
+    {
+        return not _slots[_head].empty(std::memory_order::acquire);
+    }
+
+    /** Get the oldest message in the fifo, without taking it.
+     *
+     * @note Must be called on the reader-thread.
+     * @return A pointer to the message, or nullptr if the fifo is empty.
+     */
+    [[nodiscard]] value_type *front() noexcept
+    {
+        auto& slot = _slots[_tail];
+        if (slot.empty(std::memory_order::acquire)) {
+            return nullptr;
+        }
+        return std::addressof(*slot);
+    }
+
+    /** Take one message from the fifo slot.
+     * Reads one message from the ring buffer and passes it to a call of operation.
+     * If no message is available this function returns without calling operation.
+     *
+     * @note Must be called on the reader-thread.
+     * @param func The function to call with the value as argument if it exists.
+     * @return If empty/false the this was empty, otherwise it contains the return value of the function if any.
+     */
+    template<typename Func>
+    auto take_one(Func&& func) noexcept
+    {
+        auto result = _slots[_tail].invoke_and_reset(std::forward<Func>(func));
+        if (result) {
+            _tail = (_tail + 1) % num_slots;
+        }
+        return result;
+    }
+
+    /** Take a batch of messages from the fifo.
+     *
+     * @note Must be called on the reader-thread.
+     * @param func The function to call with each value as argument.
+     * @param n The maximum number of messages to take.
+     * @return The number of messages taken.
+     */
+    template<typename Func>
+    std::size_t take_n(Func&& func, std::size_t n) noexcept
+    {
+        auto i = 0_uz;
+        for (; i != n; ++i) {
+            if (not _slots[_tail].invoke_and_reset(func)) {
+                break;
+            }
+            _tail = (_tail + 1) % num_slots;
+        }
+        return i;
+    }
+
+    /** Create a message in-place on the fifo.
+     * If the fifo is full, wait until the reader has taken a message.
+     *
+     * @note Must be called on the writer-thread.
+     * @tparam Message The message type derived from value_type to be stored in a free slot.
+     * @param func The function to invoke on the message created on the fifo.
+     * @param args The arguments passed to the constructor of Message.
+     * @return The result of the invoked function.
+     */
+    template<typename Message, typename Func, typename... Args>
+    hi_force_inline auto emplace_and_invoke(Func&& func, Args&&...args) noexcept
+    {
+        auto& slot = _slots[_head];
+        _head = (_head + 1) % num_slots;
+        return slot.template wait_emplace_and_invoke<Message>(std::forward<Func>(func), std::forward<Args>(args)...);
+    }
+
+    template<typename Message, typename... Args>
+    hi_force_inline void emplace(Args&&...args) noexcept
+    {
+        return emplace_and_invoke<Message>([](Message&) -> void {}, std::forward<Args>(args)...);
+    }
+
+    /** Create a message in-place on the fifo, if there is room.
+     *
+     * @note Must be called on the writer-thread.
+     * @tparam Message The message type derived from value_type to be stored in a free slot.
+     * @param args The arguments passed to the constructor of Message.
+     * @retval true The message was added.
+     * @retval false The fifo was full, the message was not constructed.
+     */
+    template<typename Message, typename... Args>
+    hi_force_inline bool try_emplace(Args&&...args) noexcept
+    {
+        if (full()) [[unlikely]] {
+            return false;
+        }
+
+        // Only the reader can empty a slot, so this will not wait.
+        emplace<Message>(std::forward<Args>(args)...);
+        return true;
+    }
+
+private:
+#if defined(__cpp_lib_hardware_interference_size)
+    constexpr static size_t destructive_interference_size = std::hardware_destructive_interference_size;
+#else
+    constexpr static size_t destructive_interference_size = 128;
+#endif
+
+    std::array<slot_type, num_slots> _slots = {};
+
+    /** The index of the next slot to write, owned by the writer-thread.
+     */
+    alignas(destructive_interference_size) std::size_t _head = 0;
+
+    /** The index of the next slot to read, owned by the reader-thread.
+     */
+    alignas(destructive_interference_size) std::size_t _tail = 0;
+};
+
+} // namespace hi::inline v1
@@ -0,0 +1,104 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "spsc_fifo.hpp"
+#include <hikotest/hikotest.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_SUITE(spsc_fifo_suite) {
+
+struct message_base {
+    virtual ~message_base() = default;
+
+    [[nodiscard]] virtual int value() const noexcept = 0;
+};
+
+struct message : message_base {
+    int _value;
+
+    message(int value) noexcept : _value(value) {}
+
+    [[nodiscard]] int value() const noexcept override
+    {
+        return _value;
+    }
+};
+
+TEST_CASE(front_and_take)
+{
+    auto fifo = std::make_unique<hi::spsc_fifo<message_base, 64>>();
+    REQUIRE(fifo->empty());
+    REQUIRE(fifo->front() == nullptr);
+
+    fifo->emplace<message>(1);
+    fifo->emplace<message>(2);
+    REQUIRE(not fifo->empty());
+    REQUIRE(fifo->front()->value() == 1);
+
+    auto values = std::vector<int>{};
+    auto const take = [&values](message_base& item) {
+        values.push_back(item.value());
+    };
+
+    REQUIRE(fifo->take_one(take));
+    REQUIRE(fifo->front()->value() == 2);
+    REQUIRE(fifo->take_n(take, 10) == 1);
+    REQUIRE(fifo->empty());
+    REQUIRE(fifo->front() == nullptr);
+
+    auto const expected = std::vector<int>{1, 2};
+    REQUIRE(values == expected);
+}
+
+TEST_CASE(try_emplace_full)
+{
+    // A fifo with 4 slots.
+    auto fifo = std::make_unique<hi::spsc_fifo<message_base, 64, 256>>();
+
+    for (auto i = 0; i != 4; ++i) {
+        REQUIRE(fifo->try_emplace<message>(i));
+    }
+    REQUIRE(fifo->full());
+    REQUIRE(not fifo->try_emplace<message>(4));
+
+    auto sum = 0;
+    auto const take = [&sum](message_base& item) {
+        sum += item.value();
+    };
+
+    REQUIRE(fifo->take_one(take));
+    REQUIRE(not fifo->full());
+    REQUIRE(fifo->try_emplace<message>(5));
+    REQUIRE(fifo->take_n(take, 10) == 4);
+    REQUIRE(sum == 0 + 1 + 2 + 3 + 5);
+}
+
+TEST_CASE(threads)
+{
+    auto fifo = std::make_unique<hi::spsc_fifo<message_base, 64>>();
+
+    auto producer = std::thread([&fifo] {
+        for (auto i = 0; i != 10'000; ++i) {
+            fifo->emplace<message>(i);
+        }
+    });
+
+    auto next = 0;
+    auto in_order = true;
+    while (next != 10'000) {
+        fifo->take_n(
+            [&](message_base& item) {
+                in_order &= item.value() == next++;
+            },
+            16);
+    }
+    producer.join();
+
+    REQUIRE(in_order);
+    REQUIRE(fifo->empty());
+}
+
+};
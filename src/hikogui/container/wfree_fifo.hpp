@@ -80,6 +80,28 @@ public:
         return result;
     }
 
+    /** Take a batch of messages from the fifo.
+     * Reads up to @a n messages from the ring buffer and passes each to a call of func.
+     * The reader stops at the first slot that is empty, or which is still being
+     * written to by a producer.
+     *
+     * @param func The function to call with each value as argument.
+     * @param n The maximum number of messages to take.
+     * @return The number of messages taken.
+     */
+    template<typename Func>
+    std::size_t take_n(Func&& func, std::size_t n) noexcept
+    {
+        auto i = 0_uz;
+        for (; i != n; ++i) {
+            if (not get_slot(_tail).invoke_and_reset(func)) {
+                break;
+            }
+            _tail += slot_size;
+        }
+        return i;
+    }
+
     /** Take all message from the queue.
      * Reads each message from the ring buffer and passes it to a call of operation.
      * If no message are available this function returns without calling operation.
@@ -89,7 +111,7 @@ public:
     template<typename Operation>
     void take_all(Operation const& operation) noexcept
     {
-        while (take_one(operation)) {}
+        while (take_n(operation, num_slots)) {}
     }
 
     /** Create an message in-place on the fifo.
@@ -0,0 +1,96 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "wfree_fifo.hpp"
+#include <hikotest/hikotest.hpp>
+#include <memory>
+#include <vector>
+
+TEST_SUITE(wfree_fifo_suite) {
+
+struct message_base {
+    virtual ~message_base() = default;
+
+    [[nodiscard]] virtual int value() const noexcept = 0;
+};
+
+struct message : message_base {
+    int _value;
+
+    message(int value) noexcept : _value(value) {}
+
+    [[nodiscard]] int value() const noexcept override
+    {
+        return _value;
+    }
+};
+
+using fifo_type = hi::wfree_fifo<message_base, 64>;
+
+TEST_CASE(take_one)
+{
+    auto fifo = std::make_unique<fifo_type>();
+    REQUIRE(fifo->empty());
+
+    fifo->emplace<message>(1);
+    fifo->emplace<message>(2);
+    REQUIRE(not fifo->empty());
+
+    auto values = std::vector<int>{};
+    auto const take = [&values](message_base& item) {
+        values.push_back(item.value());
+    };
+
+    REQUIRE(fifo->take_one(take));
+    REQUIRE(fifo->take_one(take));
+    REQUIRE(not fifo->take_one(take));
+    REQUIRE(fifo->empty());
+
+    auto const expected = std::vector<int>{1, 2};
+    REQUIRE(values == expected);
+}
+
+TEST_CASE(take_n)
+{
+    auto fifo = std::make_unique<fifo_type>();
+
+    auto values = std::vector<int>{};
+    auto const take = [&values](message_base& item) {
+        values.push_back(item.value());
+    };
+
+    // Wrap around the end of the ring buffer a few times.
+    auto expected = std::vector<int>{};
+    for (auto i = 0; i != 3000; ++i) {
+        fifo->emplace<message>(i);
+        expected.push_back(i);
+
+        if (i % 100 == 99) {
+            REQUIRE(fifo->take_n(take, 64) == 64);
+            REQUIRE(fifo->take_n(take, 64) == 36);
+            REQUIRE(fifo->take_n(take, 64) == 0);
+        }
+    }
+
+    REQUIRE(fifo->empty());
+    REQUIRE(values == expected);
+}
+
+TEST_CASE(take_all)
+{
+    auto fifo = std::make_unique<fifo_type>();
+    for (auto i = 0; i != 500; ++i) {
+        fifo->emplace<message>(i);
+    }
+
+    auto sum = 0;
+    fifo->take_all([&sum](message_base& item) {
+        sum += item.value();
+    });
+
+    REQUIRE(fifo->empty());
+    REQUIRE(sum == 124750);
+}
+
+};
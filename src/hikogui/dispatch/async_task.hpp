@@ -8,13 +8,118 @@
 #include "progress.hpp"
 #include "task.hpp"
 #include "awaitable.hpp"
-#include "awaitable_timer_intf.hpp"
-#include <future>
+#include "thread_pool.hpp"
+#include <atomic>
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stop_token>
+#include <type_traits>
+#include <variant>
 
 hi_export_module(hikogui.dispatch.async_task);
 
 hi_export namespace hi {
 inline namespace v1 {
+class loop;
+
+namespace detail {
+
+/** The completion of a function running on the thread pool, which can be awaited.
+ *
+ * The co-routine that awaits is resumed on the loop of the thread that awaited.
+ */
+class async_task_signal {
+public:
+    class awaiter_type {
+    public:
+        constexpr awaiter_type(async_task_signal& signal) noexcept : _signal(&signal) {}
+
+        [[nodiscard]] bool await_ready() const noexcept
+        {
+            return _signal->_state.load(std::memory_order::acquire) == state_type::done;
+        }
+
+        /** Suspend the co-routine until the function has completed.
+         *
+         * @retval true The co-routine is suspended, it will be resumed by `complete()`.
+         * @retval false The function already completed, the co-routine continues directly.
+         */
+        [[nodiscard]] bool await_suspend(std::coroutine_handle<> handle) noexcept;
+
+        void await_resume() const noexcept {}
+
+    private:
+        async_task_signal *_signal;
+    };
+
+    async_task_signal() noexcept = default;
+    async_task_signal(async_task_signal const&) = delete;
+    async_task_signal(async_task_signal&&) = delete;
+    async_task_signal& operator=(async_task_signal const&) = delete;
+    async_task_signal& operator=(async_task_signal&&) = delete;
+
+    awaiter_type operator co_await() noexcept
+    {
+        return awaiter_type{*this};
+    }
+
+    /** Signal that the function has completed.
+     *
+     * @note This is called from the thread-pool.
+     */
+    void complete() noexcept;
+
+private:
+    enum class state_type : uint8_t { running, waiting, done };
+
+    std::atomic<state_type> _state = state_type::running;
+    loop *_await_loop = nullptr;
+    std::coroutine_handle<> _handle = {};
+};
+
+/** The state shared between a function running on the thread-pool and the task awaiting its result.
+ */
+template<typename T>
+class async_task_state : public async_task_signal {
+public:
+    template<typename Func, typename... Args>
+    void run(Func const& func, Args const&...args) noexcept
+    {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                func(args...);
+            } else {
+                _value.emplace(func(args...));
+            }
+        } catch (...) {
+            _exception = std::current_exception();
+        }
+        complete();
+    }
+
+    /** Get the result of the function.
+     *
+     * @throws The exception that was thrown by the function.
+     */
+    T get()
+    {
+        if (_exception) {
+            std::rethrow_exception(_exception);
+        }
+
+        if constexpr (not std::is_void_v<T>) {
+            return std::move(*_value);
+        }
+    }
+
+private:
+    std::conditional_t<std::is_void_v<T>, std::monostate, std::optional<T>> _value = {};
+    std::exception_ptr _exception = nullptr;
+};
+
+} // namespace detail
 
 /** Run a function asynchronously as a co-routine task.
  *
@@ -29,7 +134,9 @@ template<typename Func, typename... Args>
 
 /** Run a function asynchronously as a co-routine task.
  *
- * @note This will check every 15ms if the function is completed.
+ * The function is run on the global `thread_pool`; the task is resumed on
+ * the loop of the current thread when the function completes.
+ *
  * @param func The function to be called.
  * @param args... The arguments forwarded to @a func.
  */
@@ -37,33 +144,14 @@ template<typename Func, typename... Args>
 [[nodiscard]] task<std::invoke_result_t<Func, Args...>> async_task(Func func, Args... args)
     requires(not is_invocable_task_v<Func, Args...>)
 {
-    using namespace std::literals;
+    auto state = std::make_shared<detail::async_task_state<std::invoke_result_t<Func, Args...>>>();
 
-    auto future = std::async(std::launch::async, [func = std::move(func), ... args = std::move(args)] {
-        return func(args...);
+    thread_pool::global().post_function([state, func = std::move(func), ... args = std::move(args)] {
+        state->run(func, args...);
     });
 
-    if (not future.valid()) {
-        throw std::future_error(std::future_errc::no_state);
-    }
-
-    while (true) {
-        switch (future.wait_for(0s)) {
-        case std::future_status::deferred:
-            // This shouldn't really happen, this will cause the GUI to block.
-            co_return future.get();
-
-        case std::future_status::ready:
-            co_return future.get();
-
-        case std::future_status::timeout:
-            co_await 15ms;
-            break;
-
-        default:
-            hi_no_default();
-        }
-    }
+    co_await *state;
+    co_return state->get();
 }
 
 /** Features of an invocable.
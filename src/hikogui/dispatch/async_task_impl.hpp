@@ -0,0 +1,42 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "async_task.hpp"
+#include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
+#include "loop_win32_intf.hpp"
+#else
+#include "loop_posix_intf.hpp"
+#endif
+#include <atomic>
+#include <coroutine>
+
+hi_export_module(hikogui.dispatch : async_task_impl);
+
+hi_export namespace hi::inline v1 {
+
+inline bool detail::async_task_signal::awaiter_type::await_suspend(std::coroutine_handle<> handle) noexcept
+{
+    _signal->_await_loop = &loop::local();
+    _signal->_handle = handle;
+
+    auto expected = state_type::running;
+    return _signal->_state.compare_exchange_strong(
+        expected, state_type::waiting, std::memory_order::acq_rel, std::memory_order::acquire);
+}
+
+inline void detail::async_task_signal::complete() noexcept
+{
+    if (_state.exchange(state_type::done, std::memory_order::acq_rel) == state_type::waiting) {
+        // The function was run on the thread-pool, so we will post the resume
+        // to the same thread as the co_await.
+        _await_loop->post_function([handle = _handle] {
+            handle.resume();
+        });
+    }
+}
+
+} // namespace hi::inline v1
@@ -5,8 +5,12 @@
 #pragma once
 
 #include "awaitable_timer_intf.hpp"
-#include "loop_win32_intf.hpp"
 #include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
+#include "loop_win32_intf.hpp"
+#else
+#include "loop_posix_intf.hpp"
+#endif
 #include <utility>
 #include <coroutine>
 #include <chrono>
@@ -6,18 +6,25 @@
 #include <memory> // XXX #619
 #include <chrono> // XXX #619
 #include "async_task.hpp" // export
+#include "async_task_impl.hpp" // export
 #include "awaitable_stop_token_intf.hpp" // export
 #include "awaitable_stop_token_impl.hpp" // export
 #include "awaitable_timer_intf.hpp" // export
 #include "awaitable_timer_impl.hpp" // export
 #include "awaitable.hpp" // export
 #include "function_timer.hpp" // export
+#include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
 #include "loop_win32_intf.hpp" // export
+#else
+#include "loop_posix_intf.hpp" // export
+#endif
 #include "notifier.hpp" // export
 #include "progress.hpp" // export
 #include "socket_event.hpp" // export
 #include "task_controller.hpp" // export
 #include "task.hpp" // export
+#include "thread_pool.hpp" // export
 #include "when_any.hpp" // export
 
 /** @module hikogui.dispatch
@@ -71,10 +78,10 @@
  *
  * Async task
  * ----------
- * The `hi::async_task()` function will call a given function and run it
- * using `std::async()` and control it using a co-routine which loops
- * until the function as completed. If the function passed to `hi::async_task()`
- * is a `hi::task` co-routine, then that function is called directly.
+ * The `hi::async_task()` function will call a given function on the global
+ * `hi::thread_pool` and returns a co-routine which is resumed on the calling
+ * thread's loop when the function has completed. If the function passed to
+ * `hi::async_task()` is a `hi::task` co-routine, then that function is called directly.
  *
  * `hi::cancelable_async_task()` is simular to `hi::async_task()` but it will
  * take a `std::stop_token` and `hi::progress_token` to cancel and track progress
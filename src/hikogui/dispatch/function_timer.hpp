@@ -9,23 +9,82 @@
 #include "../concurrency/concurrency.hpp"
 #include "../macros.hpp"
 #include <vector>
+#include <array>
 #include <algorithm>
+#include <bit>
 #include <chrono>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <optional>
 
 hi_export_module(hikogui.dispatch.function_timer);
 
 hi_export namespace hi::inline v1 {
 
 /** A timer that calls functions.
+ *
+ * The functions are kept on a hierarchical timing wheel. Time is divided in
+ * ticks of `resolution`; each level of the wheel has 64 slots and a slot
+ * on level `n` spans 64^n ticks. A function is added to the slot of its
+ * deadline on the lowest level that still contains the deadline, which is
+ * O(1). When the wheel reaches a slot on a higher level the functions in
+ * that slot are redistributed over the lower levels. All functions in a slot
+ * on the lowest level have the same deadline and are called as a batch.
+ *
+ * Functions are never called before their deadline, and at most one tick
+ * after their deadline. With a coalescing window deadlines are rounded up
+ * further, so that functions with nearby deadlines are called together.
+ *
+ * A function is canceled by destroying the callback token that was returned
+ * when it was added. Canceled functions are removed from the wheel
+ * incrementally while other functions are added, or when their slot is reached.
  */
 class function_timer {
 public:
+    constexpr static std::size_t slot_bits = 6;
+    constexpr static std::size_t num_slots = std::size_t{1} << slot_bits;
+
+    /** The number of levels of the wheel.
+     * With a resolution of 1 ms the wheel spans more than 2 years, functions
+     * further in the future are kept on an overflow list.
+     */
+    constexpr static std::size_t num_levels = 6;
+
     constexpr function_timer() noexcept = default;
 
+    /** Create a timer.
+     *
+     * @param resolution The duration of a tick.
+     */
+    explicit function_timer(std::chrono::nanoseconds resolution) noexcept : _resolution(resolution)
+    {
+        hi_axiom(resolution > std::chrono::nanoseconds{0});
+    }
+
     [[nodiscard]] constexpr bool empty() const noexcept
     {
-        return _functions.empty();
+        return _size == 0;
+    }
+
+    /** The number of functions on the timer, including canceled functions that were not yet removed.
+     */
+    [[nodiscard]] constexpr std::size_t size() const noexcept
+    {
+        return _size;
+    }
+
+    /** Set the coalescing window.
+     *
+     * The deadlines of functions that are added after this call are rounded
+     * up to a multiple of the window.
+     *
+     * @param window The duration of the window, zero to only round up to the resolution.
+     */
+    void set_coalescing_window(std::chrono::nanoseconds window) noexcept
+    {
+        hi_axiom(window >= std::chrono::nanoseconds{0});
+        _coalescing_ticks = std::max(int64_t{1}, (window.count() + _resolution.count() - 1) / _resolution.count());
     }
 
     /** Add a function to be called at a certain time.
@@ -37,15 +96,7 @@ public:
     template<forward_of<void()> Func>
     [[nodiscard]] std::pair<callback<void()>, bool> delay_function(utc_nanoseconds time_point, Func &&func) noexcept
     {
-        auto const it = std::lower_bound(_functions.begin(), _functions.end(), time_point, [](auto const& x, auto const& time_point) {
-            return x.time_point > time_point;
-        });
-
-        auto const next_to_call = it == _functions.end();
-
-        auto token = callback<void()>{std::forward<Func>(func)};
-        _functions.emplace(it, time_point, std::chrono::nanoseconds::max(), token);
-        return {std::move(token), next_to_call};
+        return add(time_point, std::chrono::nanoseconds::max(), std::forward<Func>(func));
     }
 
     /** Add a function to be called repeatedly.
@@ -61,13 +112,7 @@ public:
         utc_nanoseconds time_point,
         Func &&func) noexcept
     {
-        auto it = std::lower_bound(_functions.begin(), _functions.end(), time_point, [](auto const& x, auto const& time_point) {
-            return x.time_point > time_point;
-        });
-
-        auto token = callback<void()>{std::forward<Func>(func)};
-        it = _functions.emplace(it, time_point, period, token);
-        return {std::move(token), it + 1 == _functions.end()};
+        return add(time_point, period, std::forward<Func>(func));
     }
 
     /** Add a function to be called repeatedly.
@@ -88,51 +133,62 @@ public:
      */
     [[nodiscard]] utc_nanoseconds current_deadline() const noexcept
     {
-        if (_functions.empty()) {
-            return utc_nanoseconds::max();
+        if (auto const event = next_event()) {
+            return time_from_tick(_lists[event->list].min_tick);
         } else {
-            return _functions.back().time_point;
+            return utc_nanoseconds::max();
         }
     }
 
     /** Run all the function that should have run by the current_time.
      *
      * @param current_time The current time.
-     * @param args The arguments to pass to the function.
      */
-    void run_all(utc_nanoseconds current_time, auto const&...args) noexcept
+    void run_all(utc_nanoseconds current_time) noexcept
     {
-        while (current_deadline() <= current_time) {
-            run_one(current_time, args...);
+        auto const last_tick = current_time.time_since_epoch().count() / _resolution.count();
+
+        while (auto const event = next_event()) {
+            if (event->tick > last_tick) {
+                break;
+            }
+
+            _current_tick = event->tick;
+            if (event->list < num_slots) {
+                run_list(event->list, current_time);
+            } else {
+                cascade_list(event->list);
+            }
         }
+
+        // There are no functions with a deadline up to and including last_tick.
+        _current_tick = std::max(_current_tick, last_tick + 1);
     }
 
 private:
+    constexpr static uint32_t nil = std::numeric_limits<uint32_t>::max();
+    constexpr static std::size_t overflow_list = num_levels * num_slots;
+    constexpr static std::size_t num_lists = overflow_list + 1;
+
+    /** The number of functions checked for cancellation on each add.
+     */
+    constexpr static std::size_t sweep_count = 2;
+
     struct timer_type {
         utc_nanoseconds time_point;
         std::chrono::nanoseconds period;
         weak_callback<void()> callback;
 
-        timer_type() noexcept = default;
-        timer_type(timer_type const&) noexcept = default;
-        timer_type(timer_type&&) noexcept = default;
-        timer_type& operator=(timer_type const&) noexcept = default;
-        timer_type& operator=(timer_type&&) noexcept = default;
-
-        timer_type(utc_nanoseconds time_point, std::chrono::nanoseconds period, weak_callback<void()> callback) noexcept :
-            time_point(time_point), period(period), callback(std::move(callback))
-        {
-        }
+        /** The tick when the function is called.
+         */
+        int64_t tick = 0;
 
-        timer_type(utc_nanoseconds time_point, weak_callback<void()> callback) noexcept :
-            timer_type(time_point, std::chrono::nanoseconds::max(), std::move(callback))
-        {
-        }
+        uint32_t prev = nil;
+        uint32_t next = nil;
 
-        timer_type(std::chrono::nanoseconds period, weak_callback<void()> callback) noexcept :
-            timer_type(std::chrono::utc_clock::now(), period, std::move(callback))
-        {
-        }
+        /** The index of the list this timer is on, or nil.
+         */
+        uint32_t list = nil;
 
         [[nodiscard]] constexpr bool repeats() const noexcept
         {
@@ -140,53 +196,286 @@ private:
         }
     };
 
-    void remove_or_reinsert(utc_nanoseconds current_time) noexcept
+    struct list_type {
+        uint32_t head = nil;
+        uint32_t tail = nil;
+
+        /** The lowest tick of the timers on the list.
+         * This may be too low after timers are removed, until the list is empty.
+         */
+        int64_t min_tick = std::numeric_limits<int64_t>::max();
+    };
+
+    struct event_type {
+        /** The tick when the list needs to be handled.
+         */
+        int64_t tick;
+        std::size_t list;
+    };
+
+    std::chrono::nanoseconds _resolution = std::chrono::milliseconds(1);
+    int64_t _coalescing_ticks = 1;
+
+    /** The first tick that has not been handled.
+     */
+    int64_t _current_tick = 0;
+
+    std::size_t _size = 0;
+
+    /** The storage of the timers, linked into the lists by index.
+     */
+    std::vector<timer_type> _timers;
+    std::vector<uint32_t> _free_timers;
+    std::size_t _sweep_index = 0;
+
+    /** The slots of each level, followed by the overflow list.
+     */
+    std::array<list_type, num_lists> _lists = {};
+
+    /** A bit for each slot that is not empty, for each level.
+     */
+    std::array<uint64_t, num_levels> _occupied = {};
+
+    /** The timers of a list, while they are being handled.
+     */
+    std::vector<uint32_t> _batch;
+
+    [[nodiscard]] int64_t tick_from_time(utc_nanoseconds time_point) const noexcept
+    {
+        if (time_point == utc_nanoseconds::max()) {
+            return std::numeric_limits<int64_t>::max();
+        }
+
+        // Round up, so that a function is never called before its deadline.
+        auto const ns = time_point.time_since_epoch().count();
+        auto const tick = ns / _resolution.count() + (ns % _resolution.count() > 0 ? 1 : 0);
+        auto const window = tick / _coalescing_ticks + (tick % _coalescing_ticks > 0 ? 1 : 0);
+        return window * _coalescing_ticks;
+    }
+
+    [[nodiscard]] utc_nanoseconds time_from_tick(int64_t tick) const noexcept
+    {
+        if (tick > std::numeric_limits<int64_t>::max() / _resolution.count()) {
+            return utc_nanoseconds::max();
+        }
+        return utc_nanoseconds{std::chrono::nanoseconds{tick * _resolution.count()}};
+    }
+
+    /** Get the list for a tick, relative to the current tick.
+     */
+    [[nodiscard]] std::size_t list_from_tick(int64_t tick) const noexcept
     {
-        hi_assert(not _functions.empty());
+        hi_axiom(tick >= _current_tick);
 
-        if (_functions.back().repeats() and not _functions.back().callback.expired()) {
-            // When the function is repeating, calculate the new.
-            auto item = std::move(_functions.back());
-            _functions.pop_back();
+        // The level is the most significant group of slot-bits in which the tick differs from the current tick.
+        auto const difference = static_cast<uint64_t>(tick ^ _current_tick);
+        auto const level =
+            difference == 0 ? 0_uz : narrow_cast<std::size_t>(std::bit_width(difference) - 1) / slot_bits;
+        if (level >= num_levels) {
+            return overflow_list;
+        }
+
+        auto const slot = narrow_cast<std::size_t>(tick >> (level * slot_bits)) % num_slots;
+        return level * num_slots + slot;
+    }
 
-            // Delay the function to be called on the next period.
-            // However if the current_time already is passed the deadline, delay it even further.
-            item.time_point += item.period;
-            if (item.time_point > current_time) {
-                item.time_point = current_time + item.period;
+    /** Find the first list that needs to be handled.
+     */
+    [[nodiscard]] std::optional<event_type> next_event() const noexcept
+    {
+        // Slots behind the current position are empty; and all slots on a
+        // level come before the slots on the next level.
+        for (auto level = 0_uz; level != num_levels; ++level) {
+            auto const shift = level * slot_bits;
+            auto const position = narrow_cast<std::size_t>(_current_tick >> shift) % num_slots;
+            if (auto const occupied = _occupied[level] >> position) {
+                auto const slot = position + std::countr_zero(occupied);
+                auto const block = (_current_tick >> (shift + slot_bits)) << (shift + slot_bits);
+                auto const start = block | (static_cast<int64_t>(slot) << shift);
+                return event_type{std::max(_current_tick, start), level * num_slots + slot};
             }
+        }
 
-            // Reinsert the function in the sorted list of functions.
-            auto const it = std::lower_bound(_functions.begin(), _functions.end(), item.time_point, [](auto const& x, auto const& time_point) {
-                return x.time_point > time_point;
-            });
+        if (_lists[overflow_list].head != nil) {
+            auto const shift = num_levels * slot_bits;
+            auto const start = (_lists[overflow_list].min_tick >> shift) << shift;
+            return event_type{std::max(_current_tick, start), overflow_list};
+        }
 
-            _functions.insert(it, std::move(item));
+        return std::nullopt;
+    }
 
+    template<forward_of<void()> Func>
+    [[nodiscard]] std::pair<callback<void()>, bool>
+    add(utc_nanoseconds time_point, std::chrono::nanoseconds period, Func&& func) noexcept
+    {
+        auto const previous_deadline = current_deadline();
+
+        auto token = callback<void()>{std::forward<Func>(func)};
+
+        auto index = nil;
+        if (_free_timers.empty()) {
+            index = narrow_cast<uint32_t>(_timers.size());
+            _timers.emplace_back();
         } else {
-            _functions.pop_back();
+            index = _free_timers.back();
+            _free_timers.pop_back();
         }
+        ++_size;
+
+        auto& timer = _timers[index];
+        timer.time_point = time_point;
+        timer.period = period;
+        timer.callback = token;
+        timer.tick = tick_from_time(time_point);
+        insert(index);
+
+        sweep();
+
+        return {std::move(token), current_deadline() < previous_deadline};
     }
 
-    /** Call the next function on the list.
-     *
-     * @note it is undefined behavior to call this function if the current_deadline() has not passed.
-     * @param current_time The current time, this is used when reinserting periodic function to handle starvation issues.
+    void insert(uint32_t index) noexcept
+    {
+        auto& timer = _timers[index];
+
+        // A function that was added with a deadline in the past is called on the next tick.
+        timer.tick = std::max(timer.tick, _current_tick);
+
+        auto const list_index = list_from_tick(timer.tick);
+        auto& list = _lists[list_index];
+
+        timer.list = narrow_cast<uint32_t>(list_index);
+        timer.next = nil;
+        timer.prev = list.tail;
+        if (list.tail != nil) {
+            _timers[list.tail].next = index;
+        } else {
+            list.head = index;
+        }
+        list.tail = index;
+        list.min_tick = std::min(list.min_tick, timer.tick);
+
+        if (list_index != overflow_list) {
+            _occupied[list_index / num_slots] |= uint64_t{1} << (list_index % num_slots);
+        }
+    }
+
+    void remove(uint32_t index) noexcept
+    {
+        auto& timer = _timers[index];
+        hi_axiom(timer.list != nil);
+
+        auto& list = _lists[timer.list];
+        if (timer.prev != nil) {
+            _timers[timer.prev].next = timer.next;
+        } else {
+            list.head = timer.next;
+        }
+        if (timer.next != nil) {
+            _timers[timer.next].prev = timer.prev;
+        } else {
+            list.tail = timer.prev;
+        }
+
+        if (list.head == nil) {
+            clear_list(timer.list);
+        }
+        timer.list = nil;
+    }
+
+    void clear_list(std::size_t list_index) noexcept
+    {
+        _lists[list_index] = list_type{};
+        if (list_index != overflow_list) {
+            _occupied[list_index / num_slots] &= ~(uint64_t{1} << (list_index % num_slots));
+        }
+    }
+
+    void free(uint32_t index) noexcept
+    {
+        auto& timer = _timers[index];
+        timer.list = nil;
+        timer.callback = {};
+        _free_timers.push_back(index);
+        --_size;
+    }
+
+    /** Remove a few canceled functions, so that memory is reclaimed in constant time per add.
+     */
+    void sweep() noexcept
+    {
+        for (auto i = 0_uz; i != sweep_count; ++i) {
+            _sweep_index = (_sweep_index + 1) % _timers.size();
+
+            auto const index = narrow_cast<uint32_t>(_sweep_index);
+            if (_timers[index].list != nil and _timers[index].callback.expired()) {
+                remove(index);
+                free(index);
+            }
+        }
+    }
+
+    /** Move all timers of a list into _batch.
      */
-    void run_one(utc_nanoseconds current_time)
+    void take_list(std::size_t list_index) noexcept
     {
-        hi_assert(not _functions.empty());
+        _batch.clear();
+        for (auto index = _lists[list_index].head; index != nil; index = _timers[index].next) {
+            _timers[index].list = nil;
+            _batch.push_back(index);
+        }
+        clear_list(list_index);
+    }
 
-        auto &callback = _functions.back().callback;
-        if (auto cb = callback.lock()) {
-            cb();
+    /** Redistribute the timers of a slot of a higher level over the lower levels.
+     */
+    void cascade_list(std::size_t list_index) noexcept
+    {
+        take_list(list_index);
+        for (auto const index : _batch) {
+            if (_timers[index].callback.expired()) {
+                free(index);
+            } else {
+                insert(index);
+            }
         }
-        remove_or_reinsert(current_time);
     }
 
-    /** Functions, sorted by descending time.
+    /** Call the functions of a slot on the lowest level.
+     *
+     * @param current_time The current time, this is used when reinserting periodic function to handle starvation issues.
      */
-    std::vector<timer_type> _functions;
+    void run_list(std::size_t list_index, utc_nanoseconds current_time) noexcept
+    {
+        take_list(list_index);
+
+        // A function may add new functions, which may use _batch.
+        auto batch = std::move(_batch);
+        for (auto const index : batch) {
+            if (auto cb = _timers[index].callback.lock()) {
+                cb();
+            }
+
+            auto& timer = _timers[index];
+            if (timer.repeats() and not timer.callback.expired()) {
+                // Delay the function to be called on the next period.
+                // However if the current_time already is passed the deadline, delay it even further.
+                timer.time_point += timer.period;
+                if (timer.time_point <= current_time) {
+                    timer.time_point = current_time + timer.period;
+                }
+                timer.tick = tick_from_time(timer.time_point);
+                insert(index);
+
+            } else {
+                free(index);
+            }
+        }
+
+        batch.clear();
+        _batch = std::move(batch);
+    }
 };
 
 } // namespace hi::inline v1
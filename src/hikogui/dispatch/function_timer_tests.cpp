@@ -0,0 +1,224 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "function_timer.hpp"
+#include <hikotest/hikotest.hpp>
+#include <chrono>
+#include <random>
+#include <vector>
+
+TEST_SUITE(function_timer_suite)
+{
+    static hi::utc_nanoseconds at(std::chrono::nanoseconds t)
+    {
+        // A time far away from the epoch, so that all levels of the wheel are used.
+        return hi::utc_nanoseconds{std::chrono::hours(24 * 365 * 50)} + t;
+    }
+
+    TEST_CASE(delay)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        auto count = 0;
+
+        auto [token, first_to_call] = timer.delay_function(at(5ms), [&] {
+            ++count;
+        });
+        REQUIRE(first_to_call);
+        REQUIRE(timer.current_deadline() == at(5ms));
+
+        timer.run_all(at(4ms));
+        REQUIRE(count == 0);
+
+        timer.run_all(at(5ms));
+        REQUIRE(count == 1);
+        REQUIRE(timer.empty());
+        REQUIRE(timer.current_deadline() == hi::utc_nanoseconds::max());
+
+        timer.run_all(at(100ms));
+        REQUIRE(count == 1);
+    }
+
+    TEST_CASE(first_to_call)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        auto [a, a_first] = timer.delay_function(at(10ms), [] {});
+        auto [b, b_first] = timer.delay_function(at(20ms), [] {});
+        auto [c, c_first] = timer.delay_function(at(5ms), [] {});
+
+        REQUIRE(a_first);
+        REQUIRE(not b_first);
+        REQUIRE(c_first);
+        REQUIRE(timer.current_deadline() == at(5ms));
+        REQUIRE(timer.size() == 3);
+    }
+
+    TEST_CASE(order)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        auto engine = std::mt19937{42};
+        auto distribution = std::uniform_int_distribution<int64_t>{0, 100'000'000'000};
+
+        auto const num_timers = std::size_t{10'000};
+        auto deadlines = std::vector<hi::utc_nanoseconds>{};
+        auto called = std::vector<hi::utc_nanoseconds>(num_timers, hi::utc_nanoseconds::max());
+        auto tokens = std::vector<hi::callback<void()>>{};
+
+        auto now = at(0ns);
+        for (auto i = std::size_t{0}; i != num_timers; ++i) {
+            deadlines.push_back(at(std::chrono::nanoseconds{distribution(engine)}));
+            auto [token, first_to_call] = timer.delay_function(deadlines.back(), [&, i] {
+                called[i] = now;
+            });
+            tokens.push_back(std::move(token));
+        }
+
+        // Follow the deadlines, like a loop would.
+        while (not timer.empty()) {
+            auto const deadline = timer.current_deadline();
+            REQUIRE(deadline >= now);
+            now = deadline;
+            timer.run_all(now);
+        }
+
+        for (auto i = std::size_t{0}; i != num_timers; ++i) {
+            // Never early, at most one tick late.
+            REQUIRE(called[i] >= deadlines[i]);
+            REQUIRE(called[i] - deadlines[i] < 1ms);
+        }
+    }
+
+    TEST_CASE(cancel)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        auto count = 0;
+
+        auto tokens = std::vector<hi::callback<void()>>{};
+        for (auto i = 0; i != 1000; ++i) {
+            auto [token, first_to_call] = timer.delay_function(at(std::chrono::seconds(i)), [&] {
+                ++count;
+            });
+            tokens.push_back(std::move(token));
+        }
+
+        // Cancel every other function.
+        for (auto i = std::size_t{0}; i < tokens.size(); i += 2) {
+            tokens[i] = {};
+        }
+
+        // Canceled functions are removed while other functions are added.
+        auto other_tokens = std::vector<hi::callback<void()>>{};
+        for (auto i = 0; i != 1000; ++i) {
+            other_tokens.push_back(timer.delay_function(at(1h), [] {}).first);
+        }
+        REQUIRE(timer.size() == 1500);
+
+        timer.run_all(at(2h));
+        REQUIRE(count == 500);
+        REQUIRE(timer.empty());
+    }
+
+    TEST_CASE(repeat)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        auto count = 0;
+
+        auto [token, first_to_call] = timer.repeat_function(10ms, at(0ms), [&] {
+            ++count;
+        });
+
+        for (auto t = 0ms; t <= 95ms; t += 1ms) {
+            timer.run_all(at(t));
+        }
+        REQUIRE(count == 10);
+
+        // When the loop was blocked the missed calls are skipped.
+        timer.run_all(at(1s));
+        REQUIRE(count == 11);
+        REQUIRE(timer.current_deadline() == at(1s + 10ms));
+
+        token = {};
+        timer.run_all(at(2s));
+        REQUIRE(count == 11);
+        REQUIRE(timer.empty());
+    }
+
+    TEST_CASE(far_future)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        auto count = 0;
+
+        // Beyond the range of the wheel.
+        auto const deadline = at(std::chrono::hours(24 * 365 * 5) + 1ms);
+        auto [token, first_to_call] = timer.delay_function(deadline, [&] {
+            ++count;
+        });
+        REQUIRE(timer.current_deadline() == deadline);
+
+        timer.run_all(at(0ns));
+        REQUIRE(timer.current_deadline() == deadline);
+
+        timer.run_all(deadline - 1ms);
+        REQUIRE(count == 0);
+
+        timer.run_all(deadline);
+        REQUIRE(count == 1);
+    }
+
+    TEST_CASE(coalescing)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        timer.set_coalescing_window(10ms);
+        auto count = 0;
+
+        auto tokens = std::vector<hi::callback<void()>>{};
+        for (auto t = 1ms; t != 10ms; t += 1ms) {
+            auto [token, first_to_call] = timer.delay_function(at(t), [&] {
+                ++count;
+            });
+            tokens.push_back(std::move(token));
+        }
+
+        // All deadlines are rounded up to the end of the window.
+        REQUIRE(timer.current_deadline() == at(10ms));
+        timer.run_all(at(9ms));
+        REQUIRE(count == 0);
+        timer.run_all(at(10ms));
+        REQUIRE(count == 9);
+    }
+
+    TEST_CASE(add_from_function)
+    {
+        using namespace std::chrono_literals;
+
+        auto timer = hi::function_timer{};
+        auto count = 0;
+
+        auto inner = hi::callback<void()>{};
+        auto [outer, first_to_call] = timer.delay_function(at(1ms), [&] {
+            ++count;
+            // A deadline in the past is called during the same run.
+            inner = timer.delay_function(at(0ms), [&] {
+                ++count;
+            }).first;
+        });
+
+        timer.run_all(at(1ms));
+        REQUIRE(count == 2);
+        REQUIRE(timer.empty());
+    }
+};
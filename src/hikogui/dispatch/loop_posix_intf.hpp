@@ -0,0 +1,674 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file dispatch/loop_posix_intf.hpp The event loop for Linux, based on epoll.
+ */
+
+#pragma once
+
+#include "function_timer.hpp"
+#include "socket_event.hpp"
+#include "notifier.hpp"
+#include "../container/container.hpp"
+#include "../telemetry/telemetry.hpp"
+#include "../concurrency/concurrency.hpp"
+#include "../concurrency/unfair_mutex.hpp" // XXX #616
+#include "../concurrency/thread.hpp" // XXX #616
+#include "../time/time.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <functional>
+#include <type_traits>
+#include <concepts>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <thread>
+#include <atomic>
+
+hi_export_module(hikogui.dispatch : loop_intf);
+
+hi_export namespace hi::inline v1 {
+
+/** The event loop.
+ *
+ * This is the Linux implementation of the loop; it blocks in `epoll_wait()`
+ * on:
+ *  - an eventfd that is signalled when a function is posted,
+ *  - a timerfd that is armed with the deadline of the next timer function,
+ *  - an eventfd that is signalled by the vsync thread,
+ *  - the sockets added with `add_socket()`.
+ */
+class loop {
+public:
+    loop(loop const&) = delete;
+    loop(loop&&) noexcept = delete;
+    loop& operator=(loop const&) = delete;
+    loop& operator=(loop&&) noexcept = delete;
+
+    ~loop()
+    {
+        if (_vsync_thread.joinable()) {
+            _vsync_thread.request_stop();
+            _vsync_thread.join();
+        }
+
+        for (auto const fd : {_vsync_fd, _function_fd, _timer_fd, _epoll_fd}) {
+            if (fd != -1 and ::close(fd) != 0) {
+                hi_log_error("Could not close loop file descriptor {}. {}", fd, get_last_error_message());
+            }
+        }
+    }
+
+    loop() noexcept : _thread_id(current_thread_id())
+    {
+        _epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (_epoll_fd == -1) {
+            hi_log_fatal("Could not create an epoll file descriptor. {}", get_last_error_message());
+        }
+
+        _vsync_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_vsync_fd == -1) {
+            hi_log_fatal("Could not create an vsync-event file descriptor. {}", get_last_error_message());
+        }
+        epoll_add(_vsync_fd, EPOLLIN);
+
+        _function_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (_function_fd == -1) {
+            hi_log_fatal("Could not create an async-event file descriptor. {}", get_last_error_message());
+        }
+        epoll_add(_function_fd, EPOLLIN);
+
+        // The deadlines of the function_timer are in UTC, which is kept by CLOCK_REALTIME.
+        _timer_fd = ::timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (_timer_fd == -1) {
+            hi_log_fatal("Could not create an timer file descriptor. {}", get_last_error_message());
+        }
+        epoll_add(_timer_fd, EPOLLIN);
+    }
+
+    /** Get or create the thread-local loop.
+     */
+    [[nodiscard]] static loop& local() noexcept;
+
+    /** Get or create the main-loop.
+     *
+     * @note The first time main() is called must be from the main-thread.
+     *       In this case there is no race condition on the first time main() is called.
+     */
+    [[nodiscard]] hi_no_inline static loop& main() noexcept
+    {
+        if (auto ptr = _main.load(std::memory_order::acquire)) {
+            return *ptr;
+        }
+
+        hi_axiom(_timer.load(std::memory_order::relaxed) == nullptr, "loop::main() must be called before loop::timer()");
+
+        // This is the first time loop::main() is called so we must be on the main-thread
+        // So name the thread "main" so we can find it during debugging.
+        set_thread_name("main");
+
+        auto ptr = std::addressof(local());
+        _main.store(ptr, std::memory_order::release);
+        return *ptr;
+    }
+
+    /** Get or create the timer event-loop.
+     *
+     * @note The first time this is called a thread is started to handle the timer events.
+     */
+    [[nodiscard]] hi_no_inline static loop& timer() noexcept
+    {
+        // The first time timer() is called, make sure that the main-loop exists,
+        // or even create the main-loop on the current thread.
+        [[maybe_unused]] auto const& tmp = loop::main();
+
+        return *start_subsystem_or_terminate(_timer, nullptr, timer_init, timer_deinit);
+    }
+
+    /** Set maximum frame rate.
+     *
+     * There is no vertical-sync on Linux servers, the vsync thread wakes the
+     * loop at this frame rate while there are render functions.
+     *
+     * @param frame_rate The maximum frame rate that a window will be updated.
+     */
+    void set_maximum_frame_rate(double frame_rate) noexcept
+    {
+        hi_axiom(on_thread());
+        hi_axiom(frame_rate > 0.0);
+
+        _maximum_frame_rate = frame_rate;
+        _minimum_frame_time.store(
+            std::chrono::nanoseconds(narrow_cast<std::chrono::nanoseconds::rep>(1'000'000'000.0 / frame_rate)),
+            std::memory_order::relaxed);
+    }
+
+    /** Set the window in which the deadlines of timers are coalesced.
+     *
+     * The deadlines of functions added with `delay_function()` and
+     * `repeat_function()` are rounded up to a multiple of the window, so that
+     * functions with nearby deadlines are called together on a single wake-up.
+     */
+    void set_timer_coalescing_window(std::chrono::nanoseconds window) noexcept
+    {
+        hi_axiom(on_thread());
+        _function_timer.set_coalescing_window(window);
+    }
+
+    /** Set the monitor id for vertical sync.
+     */
+    void set_vsync_monitor_id(uintptr_t id) noexcept
+    {
+        _selected_monitor_id.store(id, std::memory_order::relaxed);
+    }
+
+    /** Wait-free post a function to be called from the loop.
+     *
+     * @note It is safe to call this function from another thread.
+     * @note The event loop is not directly notified that a new function exists
+     *       and will be delayed until after the loop has woken for other work.
+     * @note The post is only wait-free if the function fifo is not full,
+     *       and the function is small enough to fit in a slot on the fifo.
+     * @param func The function to call from the loop. The function must not take any arguments and return void.
+     */
+    template<forward_of<void()> Func>
+    void wfree_post_function(Func&& func) noexcept
+    {
+        _function_fifo.add_function(std::forward<Func>(func));
+    }
+
+    /** Post a function to be called from the loop.
+     *
+     * @note It is safe to call this function from another thread.
+     * @param func The function to call from the loop. The function must not take any arguments and return void.
+     */
+    template<forward_of<void()> Func>
+    void post_function(Func&& func) noexcept
+    {
+        _function_fifo.add_function(std::forward<Func>(func));
+        notify_has_send();
+    }
+
+    /** Call a function from the loop.
+     *
+     * @note It is safe to call this function from another thread.
+     * @param func The function to call from the loop. The function must not take any argument,
+     *             but may return a value.
+     * @return A `std::future` for the return value.
+     */
+    template<typename Func>
+    [[nodiscard]] auto async_function(Func&& func) noexcept
+    {
+        auto future = _function_fifo.add_async_function(std::forward<Func>(func));
+        notify_has_send();
+        return future;
+    }
+
+    /** Call a function at a certain time.
+     *
+     * @param time_point The time at which to call the function.
+     * @param func The function to be called.
+     */
+    template<forward_of<void()> Func>
+    [[nodiscard]] callback<void()> delay_function(utc_nanoseconds time_point, Func&& func) noexcept
+    {
+        auto [callback, first_to_call] = _function_timer.delay_function(time_point, std::forward<Func>(func));
+        if (first_to_call) {
+            // Rearm the timer if the added function is the next function to call.
+            update_timer();
+        }
+        return std::move(callback);
+    }
+
+    /** Call a function repeatedly.
+     *
+     * @param period The period between calls to the function.
+     * @param time_point The time at which to call the function.
+     * @param func The function to be called.
+     */
+    template<forward_of<void()> Func>
+    [[nodiscard]] callback<void()>
+    repeat_function(std::chrono::nanoseconds period, utc_nanoseconds time_point, Func&& func) noexcept
+    {
+        auto [callback, first_to_call] = _function_timer.repeat_function(period, time_point, std::forward<Func>(func));
+        if (first_to_call) {
+            // Rearm the timer if the added function is the next function to call.
+            update_timer();
+        }
+        return callback;
+    }
+
+    /** Call a function repeatedly.
+     *
+     * @param period The period between calls to the function.
+     * @param func The function to be called.
+     */
+    template<forward_of<void()> Func>
+    [[nodiscard]] callback<void()> repeat_function(std::chrono::nanoseconds period, Func&& func) noexcept
+    {
+        auto [callback, first_to_call] = _function_timer.repeat_function(period, std::forward<Func>(func));
+        if (first_to_call) {
+            // Rearm the timer if the added function is the next function to call.
+            update_timer();
+        }
+        return std::move(callback);
+    }
+
+    /** Subscribe a render function to be called on vsync.
+     *
+     * @param f A function to be called when vsync occurs.
+     */
+    template<forward_of<void(utc_nanoseconds)> Func>
+    callback<void(utc_nanoseconds)> subscribe_render(Func&& func) noexcept
+    {
+        hi_axiom(on_thread());
+
+        auto cb = callback<void(utc_nanoseconds)>{std::forward<Func>(func)};
+
+        _render_functions.push_back(cb);
+
+        // Startup the vsync thread once there is a window.
+        if (not _vsync_thread.joinable()) {
+            _vsync_thread = std::jthread{[this](std::stop_token token) {
+                return vsync_thread_proc(std::move(token));
+            }};
+        }
+
+        return cb;
+    }
+
+    /** Add a callback that reacts on a socket.
+     *
+     * In most cases @a mode is set to one of the following values:
+     * - error | read: Unblock when there is data available for read.
+     * - error | write: Unblock when there is buffer space available for write.
+     * - error | read | write: Unblock when there is data available for read of when there is buffer space available for write.
+     *
+     * @note Only one callback can be associated with a socket.
+     * @param fd File descriptor of the socket.
+     * @param event_mask The socket events to wait for.
+     * @param f The callback to call when the file descriptor unblocks.
+     */
+    void add_socket(int fd, socket_event event_mask, std::function<void(int, socket_events const&)> f)
+    {
+        hi_axiom(on_thread());
+        hi_assert(std::ranges::find(_sockets, fd, &socket_type::fd) == _sockets.end());
+
+        epoll_add(fd, epoll_events_from_socket_event(event_mask));
+        _sockets.emplace_back(fd, event_mask, std::move(f));
+    }
+
+    /** Remove the callback associated with a socket.
+     *
+     * @param fd The file descriptor of the socket.
+     */
+    void remove_socket(int fd)
+    {
+        hi_axiom(on_thread());
+
+        auto const it = std::ranges::find(_sockets, fd, &socket_type::fd);
+        if (it == _sockets.end()) {
+            return;
+        }
+
+        if (::epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, nullptr) != 0) {
+            hi_log_error("Could not remove socket {} from epoll. {}", fd, get_last_error_message());
+        }
+        _sockets.erase(it);
+    }
+
+    /** Resume the loop on the current thread.
+     *
+     * @param stop_token The thread's stop token to use to determine when to stop.
+     *                   If not stop token is given, then resume will automatically stop when there
+     *                   are no more windows, sockets, functions or timers.
+     * @return Exit code when the loop is exited.
+     */
+    int resume(std::stop_token stop_token = {}) noexcept
+    {
+        _exit_code = {};
+        while (not _exit_code) {
+            resume_once(true);
+
+            if (stop_token.stop_possible()) {
+                if (stop_token.stop_requested()) {
+                    // Stop immediately when stop is requested.
+                    _exit_code = 0;
+                }
+            } else {
+                if (_render_functions.empty() and _function_fifo.empty() and _function_timer.empty() and _sockets.empty()) {
+                    // If there is not stop token, then exit when there are no more resources to wait on.
+                    _exit_code = 0;
+                }
+            }
+        }
+
+        return *_exit_code;
+    }
+
+    /** Resume for a single iteration.
+     *
+     * It should be called often, as it will be used to process network messages and
+     * latency of network processing will be increased based on the amount of times
+     * this function is called.
+     *
+     * @note This function must be called from the same thread as `resume()`.
+     * @param block Allow processing to block, this is normally done only inside `resume()`.
+     */
+    void resume_once(bool block = false) noexcept
+    {
+        using namespace std::chrono_literals;
+
+        hi_axiom(on_thread());
+
+        // The timerfd and eventfds wake the loop, the timeout is only used
+        // to check the stop token of `resume()` regularly.
+        auto const timeout_ms = block ? 100 : 0;
+
+        auto events = std::array<epoll_event, 64>{};
+        auto const num_events = ::epoll_wait(_epoll_fd, events.data(), narrow_cast<int>(events.size()), timeout_ms);
+        if (num_events == -1 and errno != EINTR) {
+            hi_log_fatal("Failed on epoll_wait(), {}", get_last_error_message());
+        }
+
+        for (auto i = 0; i < num_events; ++i) {
+            auto const& event = events[i];
+
+            if (event.data.fd == _function_fd or event.data.fd == _timer_fd) {
+                // handle_functions() and handle_timers() is called after every wake-up of epoll_wait().
+                drain(event.data.fd);
+
+            } else if (event.data.fd == _vsync_fd) {
+                drain(event.data.fd);
+                handle_vsync();
+
+            } else {
+                handle_socket(event.data.fd, event.events);
+            }
+        }
+
+        // Make sure timers are handled first, possibly they are time critical.
+        handle_timers();
+
+        // When functions are added wait-free, the function-event is never triggered.
+        // So handle messages after any kind of wake up.
+        handle_functions();
+    }
+
+    /** Check if the current thread is the same as the loop's thread.
+     *
+     * The loop's thread is the thread that calls resume().
+     */
+    [[nodiscard]] bool on_thread() const noexcept
+    {
+        return current_thread_id() == _thread_id;
+    }
+
+private:
+    struct socket_type {
+        int fd;
+        socket_event mode;
+        std::function<void(int, socket_events const&)> callback;
+    };
+
+    /** Pointer to the main-loop.
+     */
+    inline static std::atomic<loop *> _main;
+
+    /** Pointer to the timer-loop.
+     */
+    inline static std::atomic<loop *> _timer;
+
+    inline static std::jthread _timer_thread;
+
+    function_fifo<> _function_fifo;
+    function_timer _function_timer;
+
+    std::optional<int> _exit_code = {};
+    double _maximum_frame_rate = 30.0;
+    /** The time between frames, written by the loop thread and read by the vsync thread.
+     */
+    std::atomic<std::chrono::nanoseconds> _minimum_frame_time = std::chrono::nanoseconds(33'333'333);
+    thread_id _thread_id;
+    std::vector<weak_callback<void(utc_nanoseconds)>> _render_functions;
+
+    /** The epoll instance that the loop blocks on.
+     */
+    int _epoll_fd = -1;
+
+    /** eventfd signalled by the vsync thread.
+     */
+    int _vsync_fd = -1;
+
+    /** eventfd signalled when a function is posted.
+     */
+    int _function_fd = -1;
+
+    /** timerfd armed with the deadline of the next timer function.
+     */
+    int _timer_fd = -1;
+
+    /** The deadline to which the timerfd is armed.
+     */
+    utc_nanoseconds _timer_deadline = utc_nanoseconds::max();
+
+    /** The sockets and the functions to call on an event to a socket.
+     */
+    std::vector<socket_type> _sockets;
+
+    /** Time when the last vertical blank happened.
+     */
+    std::atomic<utc_nanoseconds> _vsync_time;
+
+    /** The vsync thread.
+     */
+    std::jthread _vsync_thread;
+
+    /** The monitor id that is selected for vsync.
+     */
+    std::atomic<std::uintptr_t> _selected_monitor_id = 0;
+
+    static loop *timer_init() noexcept
+    {
+        hi_assert(not _timer_thread.joinable());
+
+        _timer_thread = std::jthread{[](std::stop_token stop_token) {
+            _timer.store(std::addressof(loop::local()), std::memory_order::release);
+
+            set_thread_name("timer");
+            loop::local().resume(stop_token);
+        }};
+
+        while (true) {
+            if (auto ptr = _timer.load(std::memory_order::relaxed)) {
+                return ptr;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        }
+    }
+
+    static void timer_deinit() noexcept
+    {
+        if (auto const *const ptr = _timer.exchange(nullptr, std::memory_order::acquire)) {
+            hi_assert(_timer_thread.joinable());
+            _timer_thread.request_stop();
+            _timer_thread.join();
+        }
+    }
+
+    void epoll_add(int fd, uint32_t events) noexcept
+    {
+        auto event = epoll_event{};
+        event.events = events;
+        event.data.fd = fd;
+        if (::epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+            hi_log_fatal("Could not add file descriptor {} to epoll. {}", fd, get_last_error_message());
+        }
+    }
+
+    /** Reset an eventfd or timerfd after it woke up the loop.
+     */
+    static void drain(int fd) noexcept
+    {
+        uint64_t count;
+        [[maybe_unused]] auto const r = ::read(fd, &count, sizeof(count));
+    }
+
+    /** Signal an eventfd.
+     *
+     * @note It is safe to call this function from another thread.
+     */
+    static void signal(int fd) noexcept
+    {
+        uint64_t const count = 1;
+        if (::write(fd, &count, sizeof(count)) != sizeof(count) and errno != EAGAIN) {
+            hi_log_error("Could not trigger event {}. {}", fd, get_last_error_message());
+        }
+    }
+
+    /** Notify the event loop that a function was added to the _function_fifo.
+     */
+    void notify_has_send() noexcept
+    {
+        signal(_function_fd);
+    }
+
+    /** Arm the timerfd with the deadline of the next timer function.
+     *
+     * @note This function is cheap when the deadline did not change.
+     */
+    void update_timer() noexcept
+    {
+        auto const deadline = _function_timer.current_deadline();
+        if (std::exchange(_timer_deadline, deadline) == deadline) {
+            return;
+        }
+
+        // A zero it_value disarms the timer.
+        auto spec = itimerspec{};
+        if (deadline != utc_nanoseconds::max()) {
+            auto const sys_deadline = std::chrono::clock_cast<std::chrono::system_clock>(deadline);
+            auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(sys_deadline.time_since_epoch()).count();
+
+            // Deadlines in the past are triggered directly; zero would disarm the timer.
+            spec.it_value.tv_sec = std::max(ns / 1'000'000'000, decltype(ns){0});
+            spec.it_value.tv_nsec = ns > 0 ? ns % 1'000'000'000 : 1;
+        }
+
+        if (::timerfd_settime(_timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) != 0) {
+            hi_log_error("Could not set the timer deadline. {}", get_last_error_message());
+        }
+    }
+
+    /** Call the callback of a socket that has an event.
+     */
+    void handle_socket(int fd, uint32_t events) noexcept
+    {
+        auto const it = std::ranges::find(_sockets, fd, &socket_type::fd);
+        if (it == _sockets.end()) {
+            // The socket was removed by a callback during this iteration.
+            return;
+        }
+
+        // Copy the callback, so that it may remove its own socket.
+        auto const callback = it->callback;
+        callback(fd, socket_events_from_epoll(fd, events, it->mode));
+    }
+
+    void handle_vsync() noexcept
+    {
+        auto const display_time = _vsync_time.load(std::memory_order::relaxed) + std::chrono::milliseconds(30);
+
+        for (auto& render_function : _render_functions) {
+            if (auto rf = render_function.lock()) {
+                rf(display_time);
+            }
+        }
+
+        std::erase_if(_render_functions, [](auto& render_function) {
+            return render_function.expired();
+        });
+
+        if (_render_functions.empty()) {
+            // Stop the vsync thread when there are no more windows.
+            if (_vsync_thread.joinable()) {
+                _vsync_thread.request_stop();
+            }
+        }
+    }
+
+    /** Handle all function calls.
+     */
+    void handle_functions() noexcept
+    {
+        _function_fifo.run_all();
+    }
+
+    void handle_timers() noexcept
+    {
+        _function_timer.run_all(std::chrono::utc_clock::now());
+        update_timer();
+    }
+
+    void vsync_thread_proc(std::stop_token stop_token) noexcept
+    {
+        set_thread_name("vsync");
+
+        auto next_frame = std::chrono::steady_clock::now();
+        while (not stop_token.stop_requested()) {
+            // Without a vertical-blank to wait on, wake the loop at the maximum frame rate.
+            next_frame += _minimum_frame_time.load(std::memory_order::relaxed);
+            std::this_thread::sleep_until(next_frame);
+
+            _vsync_time.store(std::chrono::utc_clock::now(), std::memory_order::relaxed);
+            ++global_counter<"vsync:frame">;
+            signal(_vsync_fd);
+        }
+    }
+};
+
+namespace detail {
+inline thread_local std::unique_ptr<loop> thread_local_loop;
+}
+
+/** Get or create the thread-local loop.
+ */
+[[nodiscard]] hi_no_inline inline loop& loop::local() noexcept
+{
+    if (not detail::thread_local_loop) {
+        detail::thread_local_loop = std::make_unique<loop>();
+    }
+    return *detail::thread_local_loop;
+}
+
+template<typename R, typename... Args>
+template<forward_of<void()> Func>
+void notifier<R(Args...)>::loop_local_post_function(Func&& func) const noexcept
+{
+    return loop::local().post_function(std::forward<Func>(func));
+}
+
+template<typename R, typename... Args>
+template<forward_of<void()> Func>
+void notifier<R(Args...)>::loop_main_post_function(Func&& func) const noexcept
+{
+    return loop::main().post_function(std::forward<Func>(func));
+}
+
+template<typename R, typename... Args>
+template<forward_of<void()> Func>
+void notifier<R(Args...)>::loop_timer_post_function(Func&& func) const noexcept
+{
+    return loop::timer().post_function(std::forward<Func>(func));
+}
+
+} // namespace hi::inline v1
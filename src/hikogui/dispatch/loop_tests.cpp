@@ -0,0 +1,107 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
+#include "loop_win32_intf.hpp"
+#else
+#include "loop_posix_intf.hpp"
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#include <hikotest/hikotest.hpp>
+#include <array>
+#include <chrono>
+#include <thread>
+
+TEST_SUITE(loop_suite)
+{
+    TEST_CASE(post_function)
+    {
+        auto& loop = hi::loop::local();
+
+        auto count = 0;
+        loop.post_function([&] {
+            ++count;
+        });
+        REQUIRE(count == 0);
+
+        loop.resume_once(false);
+        REQUIRE(count == 1);
+    }
+
+    TEST_CASE(post_function_from_other_thread)
+    {
+        using namespace std::chrono_literals;
+
+        auto& loop = hi::loop::local();
+
+        // The post wakes up the blocked loop.
+        auto called = false;
+        auto thread = std::jthread([&] {
+            std::this_thread::sleep_for(10ms);
+            loop.post_function([&] {
+                called = true;
+            });
+        });
+
+        while (not called) {
+            loop.resume_once(true);
+        }
+        REQUIRE(called);
+    }
+
+    TEST_CASE(delay_function)
+    {
+        using namespace std::chrono_literals;
+
+        auto& loop = hi::loop::local();
+
+        auto const start = std::chrono::utc_clock::now();
+        auto called_at = hi::utc_nanoseconds{};
+        auto const token = loop.delay_function(start + 20ms, [&] {
+            called_at = std::chrono::utc_clock::now();
+        });
+
+        while (called_at == hi::utc_nanoseconds{}) {
+            loop.resume_once(true);
+        }
+        REQUIRE(called_at >= start + 20ms);
+    }
+
+#if HI_OPERATING_SYSTEM == HI_OS_LINUX
+    TEST_CASE(socket_readiness)
+    {
+        auto& loop = hi::loop::local();
+
+        auto fds = std::array<int, 2>{};
+        auto const pair_result = ::socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data());
+        REQUIRE(pair_result == 0);
+
+        auto count = 0;
+        auto events = hi::socket_events{};
+        loop.add_socket(fds[0], hi::socket_event::read | hi::socket_event::close, [&](int fd, hi::socket_events const& e) {
+            ++count;
+            events = e;
+
+            auto buffer = std::array<char, 16>{};
+            [[maybe_unused]] auto const r = ::read(fd, buffer.data(), buffer.size());
+        });
+
+        auto const write_result = ::write(fds[1], "x", 1);
+        REQUIRE(write_result == 1);
+        loop.resume_once(true);
+        REQUIRE(count == 1);
+        REQUIRE(hi::to_bool(events.events & hi::socket_event::read));
+
+        ::close(fds[1]);
+        loop.resume_once(true);
+        REQUIRE(count == 2);
+        REQUIRE(hi::to_bool(events.events & hi::socket_event::close));
+
+        loop.remove_socket(fds[0]);
+        ::close(fds[0]);
+    }
+#endif
+};
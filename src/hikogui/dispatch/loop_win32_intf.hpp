@@ -142,6 +142,18 @@ public:
         hi_axiom(on_thread());
     }
 
+    /** Set the window in which the deadlines of timers are coalesced.
+     *
+     * The deadlines of functions added with `delay_function()` and
+     * `repeat_function()` are rounded up to a multiple of the window, so that
+     * functions with nearby deadlines are called together on a single wake-up.
+     */
+    void set_timer_coalescing_window(std::chrono::nanoseconds window) noexcept
+    {
+        hi_axiom(on_thread());
+        _function_timer.set_coalescing_window(window);
+    }
+
     /** Set the monitor id for vertical sync.
      */
     void set_vsync_monitor_id(uintptr_t id) noexcept
@@ -12,12 +12,28 @@
 #include <functional>
 #include <coroutine>
 #include <mutex>
+#include <memory>
+#include <atomic>
+#include <array>
+#include <algorithm>
+#include <cstdint>
 
 hi_export_module(hikogui.dispatch : notifier);
 
 hi_export namespace hi::inline v1 {
 
 /** A notifier which can be used to call a set of registered callbacks.
+ *
+ * The subscribers are kept in an immutable array, which is replaced by a new
+ * array when subscribing or when expired subscribers are removed. Notifying
+ * reads a snapshot of the array without taking a lock, so that callbacks may
+ * subscribe to the notifier, and the notifier may be called from multiple
+ * threads at the same time.
+ *
+ * Replaced arrays are reclaimed using epochs: a reader registers itself in the
+ * reader-count of the current epoch, and an array that was replaced is deleted
+ * after the epoch was advanced twice, which is only done when the reader-count
+ * of the previous epoch is zero.
  *
  * @tparam Result The result of calling the callback.
  * @tparam Args The argument types of the callback function.
@@ -148,11 +164,23 @@ public:
     [[nodiscard]] callback_type subscribe(Func&& func, callback_flags flags = callback_flags::synchronous) noexcept
     {
         auto callback = callback_type{std::forward<Func>(func)};
+        auto subscriber = std::make_shared<subscriber_type>(callback, flags);
+
         auto const lock = std::scoped_lock(_mutex);
-        _callbacks.emplace_back(callback, flags);
+        auto list = copy_subscribers();
+        list->items.push_back(std::move(subscriber));
+        publish(std::move(list));
         return callback;
     }
 
+    ~notifier()
+    {
+        delete _subscribers.load(std::memory_order::relaxed);
+        for (auto list : _retired) {
+            delete list;
+        }
+    }
+
     template<forward_of<void()> F>
     void loop_local_post_function(F&&) const noexcept;
     template<forward_of<void()> F>
@@ -162,89 +190,226 @@ public:
 
     /** Call the subscribed callbacks with the given arguments.
      *
-     * @note This function is not reentrant.
+     * This function is reentrant; callbacks that subscribe during the call
+     * are called on the next notification.
+     *
      * @param args The arguments to pass with the invocation of the callback
      */
     void operator()(Args... args) const noexcept
     {
-        auto const lock = std::scoped_lock(_mutex);
+        auto num_items = 0_uz;
+        auto num_expired = 0_uz;
+        {
+            auto const epoch = _epoch.load();
+            auto& readers = _readers[epoch % 2];
+            ++readers;
+
+            if (auto const list = _subscribers.load()) {
+                num_items = list->items.size();
+                for (auto const& subscriber : list->items) {
+                    if (not notify(*subscriber, args...)) {
+                        ++num_expired;
+                    }
+                }
+            }
+
+            --readers;
+        }
+
+        // Remove expired subscribers in batches, skip this when another thread is modifying the list.
+        if ((num_expired != 0 and num_expired * 4 >= num_items) or _has_retired.load(std::memory_order::relaxed)) {
+            if (_mutex.try_lock()) {
+                clean_up();
+                _mutex.unlock();
+            }
+        }
+    }
+
+private:
+    struct subscriber_type {
+        weak_callback_type callback;
+        callback_flags flags;
+
+        /** Set when a callback with the `callback_flags::once` flag was called.
+         * This is shared between the arrays, so that the callback is only called once.
+         */
+        std::atomic<bool> called = false;
+
+        subscriber_type(weak_callback_type callback, callback_flags flags) noexcept :
+            callback(std::move(callback)), flags(flags)
+        {
+        }
+
+        [[nodiscard]] bool expired() const noexcept
+        {
+            return callback.expired() or called.load(std::memory_order::relaxed);
+        }
+    };
+
+    struct subscribers_type {
+        std::vector<std::shared_ptr<subscriber_type>> items;
+
+        /** The epoch when this array was replaced.
+         */
+        uint64_t retire_epoch = 0;
+    };
+
+    mutable unfair_mutex _mutex;
 
-        for (auto& [callback, flags] : _callbacks) {
-            if (is_synchronous(flags)) {
+    /** The current array of subscribers, nullptr when there are no subscribers.
+     */
+    mutable std::atomic<subscribers_type *> _subscribers = nullptr;
+
+    mutable std::atomic<uint64_t> _epoch = 0;
+
+    /** The number of readers in the even and odd epochs.
+     */
+    mutable std::array<std::atomic<std::size_t>, 2> _readers = {};
+
+    /** Arrays that were replaced, but may still be read.
+     */
+    mutable std::vector<subscribers_type *> _retired;
+    mutable std::atomic<bool> _has_retired = false;
+
+    /** Call or post a single subscriber.
+     *
+     * @return false if the subscriber has expired.
+     */
+    bool notify(subscriber_type& subscriber, Args const&...args) const noexcept
+    {
+        if (subscriber.callback.expired()) {
+            return false;
+        }
+
+        // If the callback should only be triggered once, like inside an awaitable.
+        // Then mark it as called so that it will be cleaned up. Another thread
+        // may be notifying at the same time, so only one of them may call it.
+        if (is_once(subscriber.flags) and subscriber.called.exchange(true)) {
+            return false;
+        }
+
+        auto const flags = subscriber.flags;
+        auto const& callback = subscriber.callback;
+        if (is_synchronous(flags)) {
+            if (auto cb = callback.lock()) {
+                cb(args...);
+            }
+
+        } else if (is_local(flags)) {
+            loop_local_post_function([=] {
+                // The callback object here is captured by-copy, so that
+                // the loop can check if it was expired.
                 if (auto cb = callback.lock()) {
-                    cb(std::forward<Args>(args)...);
+                    // The captured arguments are now plain copies so we do
+                    // not forward them in the call.
+                    cb(args...);
                 }
+            });
 
-            } else if (is_local(flags)) {
-                loop_local_post_function([=] {
-                    // The callback object here is captured by-copy, so that
-                    // the loop can check if it was expired.
-                    if (auto cb = callback.lock()) {
-                        // The captured arguments are now plain copies so we do
-                        // not forward them in the call.
-                        cb(args...);
-                    }
-                });
-
-            } else if (is_main(flags)) {
-                loop_main_post_function([=] {
-                    // The callback object here is captured by-copy, so that
-                    // the loop can check if it was expired.
-                    if (auto cb = callback.lock()) {
-                        // The captured arguments are now plain copies so we do
-                        // not forward them in the call.
-                        cb(args...);
-                    }
-                });
-
-            } else if (is_timer(flags)) {
-                loop_timer_post_function([=] {
-                    // The callback object here is captured by-copy, so that
-                    // the loop can check if it was expired.
-                    if (auto cb = callback.lock()) {
-                        // The captured arguments are now plain copies so we do
-                        // not forward them in the call.
-                        cb(args...);
-                    }
-                });
+        } else if (is_main(flags)) {
+            loop_main_post_function([=] {
+                // The callback object here is captured by-copy, so that
+                // the loop can check if it was expired.
+                if (auto cb = callback.lock()) {
+                    // The captured arguments are now plain copies so we do
+                    // not forward them in the call.
+                    cb(args...);
+                }
+            });
 
-            } else {
-                hi_no_default();
-            }
+        } else if (is_timer(flags)) {
+            loop_timer_post_function([=] {
+                // The callback object here is captured by-copy, so that
+                // the loop can check if it was expired.
+                if (auto cb = callback.lock()) {
+                    // The captured arguments are now plain copies so we do
+                    // not forward them in the call.
+                    cb(args...);
+                }
+            });
+
+        } else {
+            hi_no_default();
+        }
+
+        return not is_once(flags);
+    }
+
+    /** Make a copy of the current subscribers, without the expired subscribers.
+     */
+    [[nodiscard]] std::unique_ptr<subscribers_type> copy_subscribers() const noexcept
+    {
+        hi_axiom(_mutex.is_locked());
 
-            // If the callback should only be triggered once, like inside an awaitable.
-            // Then reset the weak_ptr in _callbacks so that it will be cleaned up.
-            // In the lambda above the weak_ptr is copied first so that it callback will get executed
-            // as long as the shared_ptr's use count does not go to zero.
-            if (is_once(flags)) {
-                callback.reset();
+        auto r = std::make_unique<subscribers_type>();
+        if (auto const list = _subscribers.load(std::memory_order::relaxed)) {
+            r->items.reserve(list->items.size() + 1);
+            for (auto const& subscriber : list->items) {
+                if (not subscriber->expired()) {
+                    r->items.push_back(subscriber);
+                }
             }
         }
-        clean_up();
+        return r;
     }
 
-private:
-    mutable unfair_mutex _mutex;
+    /** Replace the current subscribers.
+     */
+    void publish(std::unique_ptr<subscribers_type> list) const noexcept
+    {
+        hi_axiom(_mutex.is_locked());
+
+        if (list->items.empty()) {
+            list = nullptr;
+        }
+
+        if (auto const old_list = _subscribers.exchange(list.release())) {
+            old_list->retire_epoch = _epoch.load();
+            _retired.push_back(old_list);
+            _has_retired.store(true, std::memory_order::relaxed);
+        }
+        reclaim();
+    }
 
-    /** A list of callbacks and it's associated token.
+    /** Advance the epoch and delete the arrays that can no longer be read.
      */
-    mutable std::vector<std::pair<weak_callback_type, callback_flags>> _callbacks;
+    void reclaim() const noexcept
+    {
+        hi_axiom(_mutex.is_locked());
+
+        // Readers may still be in the previous epoch; and a reader that loaded the
+        // epoch just before it was advanced may still register in the previous epoch.
+        // Therefor an array may be deleted after the epoch was advanced twice.
+        auto epoch = _epoch.load();
+        for (auto i = 0; i != 2 and _readers[(epoch + 1) % 2].load() == 0; ++i) {
+            _epoch.store(++epoch);
+        }
+
+        std::erase_if(_retired, [epoch](auto list) {
+            if (list->retire_epoch + 2 <= epoch) {
+                delete list;
+                return true;
+            } else {
+                return false;
+            }
+        });
+        _has_retired.store(not _retired.empty(), std::memory_order::relaxed);
+    }
 
     void clean_up() const noexcept
     {
         hi_axiom(_mutex.is_locked());
 
         // Cleanup all callbacks that have expired, or when they may only be triggered once.
-        std::erase_if(_callbacks, [](auto const& item) {
-            return item.first.expired();
-        });
+        auto const list = _subscribers.load(std::memory_order::relaxed);
+        if (list != nullptr and std::ranges::any_of(list->items, [](auto const& item) {
+                return item->expired();
+            })) {
+            publish(copy_subscribers());
+        } else {
+            reclaim();
+        }
     }
-
-#ifndef NDEBUG
-    /** The notifier is currently calling all the callbacks.
-     */
-    mutable bool _notifying = false;
-#endif
 };
 
 } // namespace hi::inline v1
@@ -4,9 +4,17 @@
 
 #include "notifier.hpp"
 #include "task.hpp"
+#include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
 #include "loop_win32_intf.hpp"
+#else
+#include "loop_posix_intf.hpp"
+#endif
 #include <hikotest/hikotest.hpp>
+#include <atomic>
 #include <coroutine>
+#include <thread>
+#include <vector>
 
 TEST_SUITE(notifier) {
 
@@ -73,6 +81,102 @@ TEST_CASE(local_unsubscribe)
     REQUIRE(b == 1);
 }
 
+TEST_CASE(synchronous)
+{
+    auto a = 0;
+
+    auto n = hi::notifier<void(int)>{};
+
+    auto a_cbt = n.subscribe([&](int value) {
+        a += value;
+    });
+
+    n(2);
+    REQUIRE(a == 2);
+
+    a_cbt = {};
+    n(3);
+    REQUIRE(a == 2);
+}
+
+TEST_CASE(reentrant_subscribe)
+{
+    auto a = 0;
+    auto b = 0;
+
+    auto n = hi::notifier{};
+
+    auto b_cbt = hi::callback<void()>{};
+    auto a_cbt = n.subscribe([&] {
+        ++a;
+        if (not b_cbt) {
+            // Subscribing from a callback is allowed; the new callback is called on the next notification.
+            b_cbt = n.subscribe([&] {
+                ++b;
+            });
+        }
+    });
+
+    n();
+    REQUIRE(a == 1);
+    REQUIRE(b == 0);
+
+    n();
+    REQUIRE(a == 2);
+    REQUIRE(b == 1);
+}
+
+TEST_CASE(once)
+{
+    auto a = 0;
+
+    auto n = hi::notifier{};
+
+    auto a_cbt = n.subscribe(
+        [&] {
+            ++a;
+        },
+        hi::callback_flags::synchronous | hi::callback_flags::once);
+
+    n();
+    n();
+    REQUIRE(a == 1);
+}
+
+TEST_CASE(concurrent)
+{
+    auto n = hi::notifier<void(int)>{};
+
+    auto total = std::atomic<int>{0};
+    auto stop = std::atomic<bool>{false};
+    auto a_cbt = n.subscribe([&](int value) {
+        total.fetch_add(value, std::memory_order::relaxed);
+    });
+
+    // Notify from multiple threads, while subscribing and unsubscribing from another.
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i != 4; ++i) {
+        threads.emplace_back([&] {
+            for (auto j = 0; j != 10'000; ++j) {
+                n(1);
+            }
+        });
+    }
+    threads.emplace_back([&] {
+        while (not stop.load()) {
+            auto tmp = n.subscribe([](int) {});
+        }
+    });
+
+    for (auto i = 0; i != 4; ++i) {
+        threads[i].join();
+    }
+    stop.store(true);
+    threads.back().join();
+
+    REQUIRE(total.load() == 40'000);
+}
+
 static hi::scoped_task<> local_coroutine_func(int& a, int& b, hi::notifier<>& n)
 {
     ++a;
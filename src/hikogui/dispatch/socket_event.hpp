@@ -4,4 +4,9 @@
 
 hi_export_module(hikogui.dispatch.socket_event);
 #include "socket_event_intf.hpp" // export
+#include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
 #include "socket_event_win32_impl.hpp" // export
+#else
+#include "socket_event_posix_impl.hpp" // export
+#endif
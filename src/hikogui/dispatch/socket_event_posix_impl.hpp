@@ -0,0 +1,116 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "socket_event_intf.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <cerrno>
+#include <cstdint>
+
+hi_export_module(hikogui.dispatch.socket_event : impl);
+
+hi_export namespace hi::inline v1 {
+
+/** Get the epoll events to wait for.
+ *
+ * @param rhs The socket events to wait for.
+ * @return The epoll event mask to pass to `epoll_ctl()`.
+ */
+[[nodiscard]] constexpr uint32_t epoll_events_from_socket_event(socket_event rhs) noexcept
+{
+    auto r = uint32_t{0};
+
+    // A listening socket is readable when a connection can be accepted.
+    r |= to_bool(rhs & (socket_event::read | socket_event::accept)) ? EPOLLIN : 0;
+    // A connecting socket is writable when the connection completed.
+    r |= to_bool(rhs & (socket_event::write | socket_event::connect)) ? EPOLLOUT : 0;
+    r |= to_bool(rhs & socket_event::close) ? EPOLLRDHUP : 0;
+    r |= to_bool(rhs & socket_event::out_of_band) ? EPOLLPRI : 0;
+
+    return r;
+}
+
+/** Get the socket events from the epoll events.
+ *
+ * @param rhs The events returned by `epoll_wait()`.
+ * @param mask The socket events that were waited for.
+ * @return The socket events that happened.
+ */
+[[nodiscard]] constexpr socket_event socket_event_from_epoll(uint32_t rhs, socket_event mask) noexcept
+{
+    auto r = socket_event::none;
+
+    if (rhs & EPOLLIN) {
+        r |= socket_event::read | socket_event::accept;
+    }
+    if (rhs & EPOLLOUT) {
+        r |= socket_event::write | socket_event::connect;
+    }
+    if (rhs & (EPOLLRDHUP | EPOLLHUP)) {
+        r |= socket_event::close;
+    }
+    if (rhs & EPOLLPRI) {
+        r |= socket_event::out_of_band;
+    }
+
+    // An error is reported on all the events that were waited for.
+    if (rhs & EPOLLERR) {
+        r |= mask;
+    }
+
+    return r & mask;
+}
+
+[[nodiscard]] constexpr socket_error socket_error_from_posix(int rhs) noexcept
+{
+    switch (rhs) {
+    case 0: return socket_error::success;
+    case EAFNOSUPPORT: return socket_error::af_not_supported;
+    case ECONNREFUSED: return socket_error::connection_refused;
+    case ENETUNREACH: return socket_error::network_unreachable;
+    case ENOBUFS: return socket_error::no_buffers;
+    case ETIMEDOUT: return socket_error::timeout;
+    case ENETDOWN: return socket_error::network_down;
+    case ECONNRESET: return socket_error::connection_reset;
+    case ECONNABORTED: return socket_error::connection_aborted;
+    // POSIX has many more error codes than Winsock reports on a socket event.
+    default: return socket_error::network_down;
+    }
+}
+
+/** Get the socket events and errors of a socket that was reported by epoll.
+ *
+ * @param fd The file descriptor of the socket.
+ * @param rhs The events returned by `epoll_wait()`.
+ * @param mask The socket events that were waited for.
+ */
+[[nodiscard]] inline socket_events socket_events_from_epoll(int fd, uint32_t rhs, socket_event mask) noexcept
+{
+    auto r = socket_events{};
+    r.events = socket_event_from_epoll(rhs, mask);
+
+    if (rhs & EPOLLERR) {
+        // Retrieving the error also clears it.
+        auto error = 0;
+        auto error_size = socklen_t{sizeof(error)};
+        if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &error_size) != 0) {
+            error = errno;
+        }
+
+        auto const error_code = socket_error_from_posix(error);
+        for (auto i = 0_uz; i != socket_event_max; ++i) {
+            if (to_bool(r.events & static_cast<socket_event>(1 << i))) {
+                r.errors[i] = error_code;
+            }
+        }
+    }
+
+    return r;
+}
+
+} // namespace hi::inline v1
@@ -0,0 +1,363 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file dispatch/thread_pool.hpp A work-stealing thread pool.
+ */
+
+#pragma once
+
+#include "../utility/utility.hpp"
+#include "../concurrency/concurrency.hpp"
+#include "../concurrency/unfair_mutex.hpp" // XXX #616
+#include "../concurrency/thread.hpp" // XXX #616
+#include "../macros.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+hi_export_module(hikogui.dispatch.thread_pool);
+
+hi_export namespace hi::inline v1 {
+namespace detail {
+
+/** A job that is run on a thread pool.
+ */
+class thread_pool_job {
+public:
+    virtual ~thread_pool_job() = default;
+
+    virtual void run() noexcept = 0;
+};
+
+template<typename Func>
+class thread_pool_job_impl final : public thread_pool_job {
+public:
+    template<typename F>
+    explicit thread_pool_job_impl(F&& func) noexcept : _func(std::forward<F>(func))
+    {
+    }
+
+    void run() noexcept override
+    {
+        _func();
+    }
+
+private:
+    Func _func;
+};
+
+/** A work-stealing deque.
+ *
+ * This is the fixed-size Chase-Lev deque, with the memory orderings from
+ * "Correct and Efficient Work-Stealing for Weak Memory Models" by Lê et al.
+ *
+ * The owner pushes and pops jobs at the bottom of the deque, so that it runs
+ * the job it created last while its data is still in the cache. Other threads
+ * steal jobs from the top.
+ *
+ * @tparam Capacity The maximum number of jobs in the deque, must be power-of-two.
+ */
+template<std::size_t Capacity>
+class work_stealing_deque {
+public:
+    static_assert(std::has_single_bit(Capacity), "Only power-of-two capacity allowed.");
+
+    constexpr static std::size_t capacity = Capacity;
+
+    constexpr work_stealing_deque() noexcept = default;
+    work_stealing_deque(work_stealing_deque const&) = delete;
+    work_stealing_deque(work_stealing_deque&&) = delete;
+    work_stealing_deque& operator=(work_stealing_deque const&) = delete;
+    work_stealing_deque& operator=(work_stealing_deque&&) = delete;
+
+    /** Push a job on the bottom of the deque.
+     *
+     * @note Must be called by the owner of the deque.
+     * @retval true The job was added.
+     * @retval false The deque was full.
+     */
+    [[nodiscard]] bool push(thread_pool_job *job) noexcept
+    {
+        auto const b = _bottom.load(std::memory_order::relaxed);
+        auto const t = _top.load(std::memory_order::acquire);
+        if (b - t >= static_cast<int64_t>(capacity)) {
+            return false;
+        }
+
+        _jobs[b % capacity].store(job, std::memory_order::relaxed);
+        _bottom.store(b + 1, std::memory_order::release);
+        return true;
+    }
+
+    /** Pop a job from the bottom of the deque.
+     *
+     * @note Must be called by the owner of the deque.
+     * @return The job, or nullptr if the deque was empty.
+     */
+    [[nodiscard]] thread_pool_job *pop() noexcept
+    {
+        auto const b = _bottom.load(std::memory_order::relaxed) - 1;
+        _bottom.store(b, std::memory_order::relaxed);
+        std::atomic_thread_fence(std::memory_order::seq_cst);
+        auto t = _top.load(std::memory_order::relaxed);
+
+        if (t > b) {
+            // The deque was empty.
+            _bottom.store(b + 1, std::memory_order::relaxed);
+            return nullptr;
+        }
+
+        auto job = _jobs[b % capacity].load(std::memory_order::relaxed);
+        if (t == b) {
+            // This was the last job, race against the thieves for it.
+            if (not _top.compare_exchange_strong(t, t + 1, std::memory_order::seq_cst, std::memory_order::relaxed)) {
+                job = nullptr;
+            }
+            _bottom.store(b + 1, std::memory_order::relaxed);
+        }
+        return job;
+    }
+
+    /** Steal a job from the top of the deque.
+     *
+     * @note May be called from any thread.
+     * @return The job, or nullptr if the deque was empty or another thread won the race.
+     */
+    [[nodiscard]] thread_pool_job *steal() noexcept
+    {
+        auto t = _top.load(std::memory_order::acquire);
+        std::atomic_thread_fence(std::memory_order::seq_cst);
+        auto const b = _bottom.load(std::memory_order::acquire);
+
+        if (t >= b) {
+            return nullptr;
+        }
+
+        auto const job = _jobs[t % capacity].load(std::memory_order::relaxed);
+        if (not _top.compare_exchange_strong(t, t + 1, std::memory_order::seq_cst, std::memory_order::relaxed)) {
+            return nullptr;
+        }
+        return job;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return _bottom.load(std::memory_order::relaxed) <= _top.load(std::memory_order::relaxed);
+    }
+
+private:
+    std::array<std::atomic<thread_pool_job *>, capacity> _jobs = {};
+
+    /** The index of the next job to steal, shared by all threads.
+     */
+    alignas(64) std::atomic<int64_t> _top = 0;
+
+    /** The index of the next job to push, owned by the owner-thread.
+     */
+    alignas(64) std::atomic<int64_t> _bottom = 0;
+};
+
+} // namespace detail
+
+/** A fixed-size pool of threads that run short jobs.
+ *
+ * Each worker thread has its own Chase-Lev deque; jobs posted from a worker
+ * are pushed on the worker's own deque, jobs posted from other threads are
+ * added to a global injection queue. An idle worker first takes from its
+ * own deque, then from the injection queue and then steals from the other
+ * workers. When no work is found the worker sleeps until a new job is posted.
+ *
+ * When the pool is destroyed the workers finish all jobs that were posted
+ * and then exit.
+ */
+hi_export class thread_pool {
+public:
+    constexpr static std::size_t deque_capacity = 1024;
+
+    /** Get the global thread pool.
+     *
+     * The global thread pool is started on first use, with one worker for
+     * each CPU.
+     */
+    [[nodiscard]] static thread_pool& global() noexcept
+    {
+        static auto pool = thread_pool{};
+        return pool;
+    }
+
+    ~thread_pool()
+    {
+        for (auto& worker : _workers) {
+            worker->thread.request_stop();
+        }
+        wake_all();
+
+        for (auto& worker : _workers) {
+            worker->thread.join();
+        }
+    }
+
+    thread_pool(thread_pool const&) = delete;
+    thread_pool(thread_pool&&) = delete;
+    thread_pool& operator=(thread_pool const&) = delete;
+    thread_pool& operator=(thread_pool&&) = delete;
+
+    /** Start a thread pool.
+     *
+     * @param num_threads The number of worker threads, or zero for one worker for each CPU.
+     */
+    explicit thread_pool(std::size_t num_threads = 0) noexcept
+    {
+        if (num_threads == 0) {
+            num_threads = std::max(std::size_t{1}, std::size_t{std::thread::hardware_concurrency()});
+        }
+
+        // All workers must exist before the first thread tries to steal from them.
+        _workers.reserve(num_threads);
+        for (auto i = 0_uz; i != num_threads; ++i) {
+            _workers.push_back(std::make_unique<worker_type>());
+        }
+
+        for (auto i = 0_uz; i != num_threads; ++i) {
+            _workers[i]->thread = std::jthread{[this, i](std::stop_token stop_token) {
+                worker_main(stop_token, i);
+            }};
+        }
+    }
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return _workers.size();
+    }
+
+    /** Post a function to be called on one of the workers.
+     *
+     * @note It is safe to call this function from any thread.
+     * @param func The function to call. The function must not take any arguments and return void.
+     */
+    template<forward_of<void()> Func>
+    void post_function(Func&& func) noexcept
+    {
+        auto job = new detail::thread_pool_job_impl<std::remove_cvref_t<Func>>(std::forward<Func>(func));
+
+        auto worker = _current_worker;
+        if (worker == nullptr or worker->pool != this or not worker->deque.push(job)) {
+            auto const lock = std::scoped_lock(_injection_mutex);
+            _injection_queue.push_back(job);
+        }
+
+        wake_one();
+    }
+
+private:
+    struct worker_type {
+        detail::work_stealing_deque<deque_capacity> deque;
+        thread_pool *pool = nullptr;
+        std::jthread thread;
+    };
+
+    std::vector<std::unique_ptr<worker_type>> _workers;
+
+    /** Jobs posted from threads outside of the pool.
+     */
+    unfair_mutex _injection_mutex;
+    std::deque<detail::thread_pool_job *> _injection_queue;
+
+    /** Incremented on each post, workers sleep while it does not change.
+     */
+    std::atomic<uint64_t> _epoch = 0;
+    std::atomic<std::size_t> _num_sleeping = 0;
+
+    /** The worker of the current thread, or nullptr when not a worker.
+     */
+    static inline thread_local worker_type *_current_worker = nullptr;
+
+    void wake_one() noexcept
+    {
+        _epoch.fetch_add(1, std::memory_order::seq_cst);
+        if (_num_sleeping.load(std::memory_order::seq_cst) != 0) {
+            _epoch.notify_one();
+        }
+    }
+
+    void wake_all() noexcept
+    {
+        _epoch.fetch_add(1, std::memory_order::seq_cst);
+        _epoch.notify_all();
+    }
+
+    [[nodiscard]] detail::thread_pool_job *take_injected() noexcept
+    {
+        auto const lock = std::scoped_lock(_injection_mutex);
+        if (_injection_queue.empty()) {
+            return nullptr;
+        }
+
+        auto const job = _injection_queue.front();
+        _injection_queue.pop_front();
+        return job;
+    }
+
+    [[nodiscard]] detail::thread_pool_job *find_job(std::size_t index) noexcept
+    {
+        if (auto job = _workers[index]->deque.pop()) {
+            return job;
+        }
+
+        if (auto job = take_injected()) {
+            return job;
+        }
+
+        for (auto i = 1_uz; i != _workers.size(); ++i) {
+            if (auto job = _workers[(index + i) % _workers.size()]->deque.steal()) {
+                return job;
+            }
+        }
+        return nullptr;
+    }
+
+    void worker_main(std::stop_token stop_token, std::size_t index) noexcept
+    {
+        set_thread_name(std::format("pool {}", index));
+
+        auto& worker = *_workers[index];
+        worker.pool = this;
+        _current_worker = std::addressof(worker);
+
+        while (true) {
+            // Read the epoch before looking for work, so that a job posted
+            // after the search wakes this worker.
+            auto const epoch = _epoch.load(std::memory_order::seq_cst);
+
+            if (auto job = find_job(index)) {
+                job->run();
+                delete job;
+                continue;
+            }
+
+            if (stop_token.stop_requested()) {
+                break;
+            }
+
+            _num_sleeping.fetch_add(1, std::memory_order::seq_cst);
+            _epoch.wait(epoch, std::memory_order::seq_cst);
+            _num_sleeping.fetch_sub(1, std::memory_order::seq_cst);
+        }
+
+        _current_worker = nullptr;
+    }
+};
+
+} // namespace hi::inline v1
@@ -0,0 +1,130 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "thread_pool.hpp"
+#include <hikotest/hikotest.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_SUITE(thread_pool_suite) {
+
+struct test_job : hi::detail::thread_pool_job {
+    int value;
+
+    test_job(int value) noexcept : value(value) {}
+
+    void run() noexcept override {}
+};
+
+TEST_CASE(deque_push_pop_steal)
+{
+    auto deque = std::make_unique<hi::detail::work_stealing_deque<4>>();
+    auto jobs = std::vector<test_job>{1, 2, 3, 4, 5};
+
+    REQUIRE(deque->empty());
+    REQUIRE(deque->pop() == nullptr);
+    REQUIRE(deque->steal() == nullptr);
+
+    for (auto i = 0; i != 4; ++i) {
+        REQUIRE(deque->push(&jobs[i]));
+    }
+    REQUIRE(not deque->push(&jobs[4]));
+
+    // The owner takes the newest job, thieves take the oldest.
+    REQUIRE(deque->pop() == &jobs[3]);
+    REQUIRE(deque->steal() == &jobs[0]);
+    REQUIRE(deque->steal() == &jobs[1]);
+    REQUIRE(deque->pop() == &jobs[2]);
+    REQUIRE(deque->empty());
+    REQUIRE(deque->pop() == nullptr);
+    REQUIRE(deque->steal() == nullptr);
+}
+
+TEST_CASE(deque_threads)
+{
+    auto deque = std::make_unique<hi::detail::work_stealing_deque<64>>();
+    auto jobs = std::vector<test_job>{};
+    for (auto i = 0; i != 100'000; ++i) {
+        jobs.emplace_back(i);
+    }
+
+    auto stop = std::atomic<bool>{false};
+    auto stolen = std::atomic<long long>{0};
+    auto thieves = std::vector<std::thread>{};
+    for (auto i = 0; i != 3; ++i) {
+        thieves.emplace_back([&] {
+            while (not stop.load() or not deque->empty()) {
+                if (auto job = deque->steal()) {
+                    stolen.fetch_add(static_cast<test_job *>(job)->value);
+                }
+            }
+        });
+    }
+
+    auto popped = 0LL;
+    for (auto& job : jobs) {
+        while (not deque->push(&job)) {
+            if (auto other = deque->pop()) {
+                popped += static_cast<test_job *>(other)->value;
+            }
+        }
+    }
+    while (auto job = deque->pop()) {
+        popped += static_cast<test_job *>(job)->value;
+    }
+
+    stop.store(true);
+    for (auto& thief : thieves) {
+        thief.join();
+    }
+
+    // Each job was taken exactly once.
+    REQUIRE(popped + stolen.load() == 4'999'950'000LL);
+}
+
+TEST_CASE(post_function)
+{
+    auto pool = std::make_unique<hi::thread_pool>(4);
+    REQUIRE(pool->size() == 4);
+
+    auto count = std::atomic<int>{0};
+    for (auto i = 0; i != 10'000; ++i) {
+        pool->post_function([&count] {
+            count.fetch_add(1);
+        });
+    }
+
+    // The destructor finishes all jobs that were posted.
+    pool = nullptr;
+    REQUIRE(count.load() == 10'000);
+}
+
+TEST_CASE(post_from_worker)
+{
+    using namespace std::literals;
+
+    auto pool = std::make_unique<hi::thread_pool>(4);
+
+    auto count = std::atomic<int>{0};
+    for (auto i = 0; i != 10; ++i) {
+        pool->post_function([&count, &pool] {
+            // Jobs posted from a worker are stolen by the other workers.
+            for (auto j = 0; j != 1'000; ++j) {
+                pool->post_function([&count] {
+                    count.fetch_add(1);
+                });
+            }
+        });
+    }
+
+    while (count.load() != 10'000) {
+        std::this_thread::sleep_for(1ms);
+    }
+    REQUIRE(count.load() == 10'000);
+}
+
+};
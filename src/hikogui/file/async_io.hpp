@@ -0,0 +1,606 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file file/async_io.hpp Asynchronous file I/O for co-routines.
+ * @ingroup file
+ */
+
+#pragma once
+
+#include "../macros.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
+#include "file_win32_impl.hpp"
+#else
+#include "file_posix_impl.hpp"
+#include "io_uring_posix.hpp"
+#endif
+#include "../dispatch/dispatch.hpp"
+#include "../telemetry/telemetry.hpp"
+#include "../utility/utility.hpp"
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <format>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+hi_export_module(hikogui.file.async_io);
+
+hi_export namespace hi::inline v1 {
+namespace detail {
+
+/** The state of an asynchronous file operation.
+ */
+struct async_io_operation {
+    enum class opcode_type : uint8_t { read, write, flush };
+
+    std::shared_ptr<file_impl> file;
+    opcode_type opcode;
+
+    /** The offset, data and size of the part that still needs to be read or written.
+     */
+    std::size_t offset;
+    std::byte *data;
+    std::size_t size;
+
+    /** Flush the file after a write, submitted as a linked operation.
+     */
+    bool flush_after;
+
+    /** The number of bytes read or written.
+     */
+    std::size_t result = 0;
+    std::exception_ptr exception;
+
+    std::coroutine_handle<> handle;
+    loop *await_loop = nullptr;
+
+    /** Keeps the operation alive while it is owned by the kernel.
+     */
+    std::shared_ptr<async_io_operation> self;
+
+    /** The number of bytes that was submitted in the last read or write.
+     */
+    uint32_t submitted_size = 0;
+
+    /** The number of completions that are still expected.
+     */
+    uint8_t num_pending = 0;
+
+    /** The read or write was short and the rest is submitted again.
+     */
+    bool resubmit = false;
+
+    /** The kernel took the write, but its linked flush was taken back from the ring.
+     * The flush is submitted on its own after the write completes.
+     */
+    bool unlinked_flush = false;
+
+    async_io_operation(
+        std::shared_ptr<file_impl> file,
+        opcode_type opcode,
+        std::size_t offset,
+        std::byte *data,
+        std::size_t size,
+        bool flush_after = false) noexcept :
+        file(std::move(file)), opcode(opcode), offset(offset), data(data), size(size), flush_after(flush_after)
+    {
+    }
+
+    /** Run the operation synchronously on the current thread.
+     *
+     * This may continue an operation that was partially completed by io_uring.
+     */
+    void run() noexcept
+    {
+        try {
+            switch (opcode) {
+            case opcode_type::read:
+                result += file->read_at(offset, data, size);
+                break;
+            case opcode_type::write:
+                file->write_at(offset, data, size);
+                result += size;
+                if (flush_after) {
+                    file->flush();
+                }
+                break;
+            case opcode_type::flush:
+                file->flush();
+                break;
+            default:
+                hi_no_default();
+            }
+        } catch (...) {
+            exception = std::current_exception();
+        }
+    }
+};
+
+} // namespace detail
+
+/** Asynchronous file I/O for the current thread.
+ *
+ * On Linux the operations are submitted to an io_uring owned by the thread.
+ * All operations that are started during a single iteration of the thread's
+ * loop are submitted together with one system call. The loop polls the ring
+ * for completions and resumes the co-routines directly, so no threads are
+ * blocked on reads or writes.
+ *
+ * When io_uring is not available, on other operating systems, when it is
+ * blocked by the system or when the kernel does not support the operations,
+ * each operation is run on the global `thread_pool` and the co-routine is
+ * resumed on the loop of the thread that awaited it. This is also used when
+ * the ring fails while the application is running.
+ *
+ * The operations are started with the `async_read()` and `async_write()`
+ * functions of `file`.
+ */
+class async_io {
+public:
+    /** The number of entries in the submission queue of the ring.
+     */
+    constexpr static unsigned int ring_size = 256;
+
+    async_io(async_io const&) = delete;
+    async_io(async_io&&) = delete;
+    async_io& operator=(async_io const&) = delete;
+    async_io& operator=(async_io&&) = delete;
+
+    /** Wait for the operations that the kernel owns, and stop polling the ring.
+     *
+     * The co-routines of operations that did not complete are not resumed.
+     */
+    ~async_io()
+    {
+#if HI_OPERATING_SYSTEM == HI_OS_LINUX
+        if (_ring == nullptr) {
+            return;
+        }
+
+        // The operations that were not yet handed to the kernel are not started.
+        take_back_unsubmitted();
+        _queue.clear();
+
+        // The kernel may still read from or write into the buffers of the operations in flight.
+        while (_num_in_flight != 0) {
+            try {
+                _ring->wait();
+            } catch (os_error const& e) {
+                hi_log_error("Abandoned {} file operations. {}", _num_in_flight, e.what());
+                break;
+            }
+
+            _ring->reap([&](io_uring_cqe const& cqe) {
+                auto const op = std::bit_cast<detail::async_io_operation *>(
+                    narrow_cast<uintptr_t>(cqe.user_data & ~linked_flush_tag));
+
+                --_num_in_flight;
+                if (--op->num_pending == 0) {
+                    // Release the operation, which was kept alive for the kernel.
+                    op->self.reset();
+                }
+            });
+        }
+
+        if (_polling) {
+            _loop->remove_socket(_ring->fd());
+        }
+#endif
+    }
+
+    async_io() noexcept : _loop(std::addressof(loop::local()))
+    {
+#if HI_OPERATING_SYSTEM == HI_OS_LINUX
+        try {
+            auto ring = std::make_unique<detail::io_uring_ring>(ring_size);
+            for (uint8_t const opcode : {
+                     IORING_OP_READ, IORING_OP_WRITE, IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC}) {
+                if (not ring->supports(opcode)) {
+                    throw os_error(std::format("io_uring does not support operation {}.", opcode));
+                }
+            }
+            _ring = std::move(ring);
+        } catch (os_error const& e) {
+            hi_log_info("File I/O is run on the thread pool. {}", e.what());
+        }
+#endif
+    }
+
+    /** Get or create the asynchronous I/O of the current thread.
+     */
+    [[nodiscard]] static async_io& local() noexcept;
+
+    /** Check if operations are submitted to an io_uring.
+     */
+    [[nodiscard]] bool uses_io_uring() const noexcept
+    {
+#if HI_OPERATING_SYSTEM == HI_OS_LINUX
+        return _ring != nullptr and not _ring_failed;
+#else
+        return false;
+#endif
+    }
+
+    /** Register buffers that are used for many reads and writes.
+     *
+     * Reads and writes into a part of a registered buffer use the fixed-buffer
+     * operations of io_uring; the kernel maps the pages of a registered buffer
+     * once, instead of on each operation. This replaces the buffers that were
+     * registered earlier.
+     *
+     * @note Without io_uring the buffers are not used.
+     * @param buffers The buffers to register. The buffers must remain valid
+     *                until other buffers are registered.
+     * @throws os_error When the buffers could not be registered.
+     */
+    void register_buffers(std::vector<std::span<std::byte>> buffers)
+    {
+        _buffers.clear();
+
+#if HI_OPERATING_SYSTEM == HI_OS_LINUX
+        if (uses_io_uring()) {
+            auto iovecs = std::vector<iovec>{};
+            iovecs.reserve(buffers.size());
+            for (auto const& buffer : buffers) {
+                iovecs.push_back(iovec{buffer.data(), buffer.size()});
+            }
+            _ring->register_buffers(iovecs);
+        }
+#endif
+
+        _buffers = std::move(buffers);
+    }
+
+    /** Start an operation.
+     *
+     * @note The co-routine handle must be set on the operation.
+     * @param op The operation to start.
+     */
+    void submit(std::shared_ptr<detail::async_io_operation> op) noexcept
+    {
+        op->await_loop = _loop;
+
+#if HI_OPERATING_SYSTEM == HI_OS_LINUX
+        if (uses_io_uring()) {
+            _queue.push_back(std::move(op));
+            if (not std::exchange(_flush_posted, true)) {
+                // Operations started during this iteration of the loop are submitted together.
+                _loop->post_function([this, alive = std::weak_ptr{_alive}] {
+                    if (not alive.expired()) {
+                        flush();
+                    }
+                });
+            }
+            return;
+        }
+#endif
+
+        run_on_thread_pool(std::move(op));
+    }
+
+private:
+    loop *_loop;
+
+    std::vector<std::span<std::byte>> _buffers;
+
+#if HI_OPERATING_SYSTEM == HI_OS_LINUX
+    std::unique_ptr<detail::io_uring_ring> _ring;
+
+    /** Operations that are not yet in the submission queue.
+     */
+    std::deque<std::shared_ptr<detail::async_io_operation>> _queue;
+
+    /** The number of completions the kernel still needs to post.
+     * This is kept below the size of the completion queue, so that it never overflows.
+     */
+    std::size_t _num_in_flight = 0;
+
+    bool _flush_posted = false;
+
+    /** Destroyed together with this object, so that a flush that is still posted on the loop is ignored.
+     */
+    std::shared_ptr<bool> _alive = std::make_shared<bool>(true);
+
+    /** Submitting to the ring failed, new operations are run on the thread pool.
+     */
+    bool _ring_failed = false;
+
+    /** The ring's file descriptor is added to the loop.
+     */
+    bool _polling = false;
+
+    /** Marks the completion of the flush that is linked to a write.
+     */
+    constexpr static uint64_t linked_flush_tag = 1;
+
+    [[nodiscard]] std::optional<uint16_t> buffer_index(std::byte const *data, std::size_t size) const noexcept
+    {
+        for (auto i = 0_uz; i != _buffers.size(); ++i) {
+            auto const& buffer = _buffers[i];
+            if (data >= buffer.data() and data + size <= buffer.data() + buffer.size()) {
+                return narrow_cast<uint16_t>(i);
+            }
+        }
+        return std::nullopt;
+    }
+
+    /** Add an operation to the submission queue.
+     *
+     * @retval false There is no room in the submission or completion queue.
+     */
+    [[nodiscard]] bool prepare(std::shared_ptr<detail::async_io_operation>& op) noexcept
+    {
+        using enum detail::async_io_operation::opcode_type;
+
+        auto const linked = op->opcode == write and op->flush_after;
+        auto const num_entries = linked ? 2_uz : 1_uz;
+        if (_ring->space() < num_entries or _num_in_flight + num_entries > _ring->completion_capacity()) {
+            return false;
+        }
+
+        auto const user_data = std::bit_cast<uintptr_t>(op.get());
+        auto const fd = op->file->file_handle();
+
+        auto sqe = _ring->get_sqe();
+        sqe->fd = fd;
+        sqe->user_data = user_data;
+
+        if (op->opcode == flush) {
+            sqe->opcode = IORING_OP_FSYNC;
+
+        } else {
+            // The length of a single operation is 32 bits; the rest is submitted after completion.
+            op->submitted_size = narrow_cast<uint32_t>(std::min(op->size, std::size_t{0x7fff'f000}));
+
+            auto const index = buffer_index(op->data, op->submitted_size);
+            if (op->opcode == read) {
+                sqe->opcode = index ? IORING_OP_READ_FIXED : IORING_OP_READ;
+            } else {
+                sqe->opcode = index ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+            }
+            sqe->off = op->offset;
+            sqe->addr = std::bit_cast<uintptr_t>(op->data);
+            sqe->len = op->submitted_size;
+            sqe->buf_index = index.value_or(0);
+        }
+
+        if (linked) {
+            // The flush is only started when the write completed fully.
+            sqe->flags |= IOSQE_IO_LINK;
+
+            auto flush_sqe = _ring->get_sqe();
+            flush_sqe->opcode = IORING_OP_FSYNC;
+            flush_sqe->fd = fd;
+            flush_sqe->user_data = user_data | linked_flush_tag;
+        }
+
+        op->num_pending = narrow_cast<uint8_t>(num_entries);
+        _num_in_flight += num_entries;
+        op->self = op;
+        return true;
+    }
+
+    /** Submit the queued operations to the kernel.
+     */
+    void flush() noexcept
+    {
+        _flush_posted = false;
+
+        auto use_thread_pool = _ring_failed;
+        if (not _ring_failed) {
+            while (not _queue.empty() and prepare(_queue.front())) {
+                _queue.pop_front();
+            }
+
+            try {
+                auto const num_unsubmitted = _ring->submit();
+                if (num_unsubmitted != 0 and num_unsubmitted == _num_in_flight) {
+                    // The kernel is out of resources. Without operations in flight there is no completion
+                    // on which to submit again, so these operations are run on the thread pool instead.
+                    take_back_unsubmitted();
+                    use_thread_pool = true;
+                }
+            } catch (os_error const& e) {
+                hi_log_error("File I/O is run on the thread pool from now on. {}", e.what());
+                _ring_failed = true;
+                take_back_unsubmitted();
+                use_thread_pool = true;
+            }
+        }
+
+        if (use_thread_pool) {
+            while (not _queue.empty()) {
+                run_on_thread_pool(std::move(_queue.front()));
+                _queue.pop_front();
+            }
+        }
+
+        update_polling();
+    }
+
+    /** Take back the entries that the kernel did not consume.
+     *
+     * The operations of which all entries were taken back are added to the queue.
+     * When the kernel did take a write, but not its linked flush, the flush is
+     * submitted after the write completes; this keeps the write and the flush
+     * together as one operation.
+     */
+    void take_back_unsubmitted() noexcept
+    {
+        _ring->cancel_unsubmitted([&](io_uring_sqe const& sqe) {
+            auto const is_linked_flush = (sqe.user_data & linked_flush_tag) != 0;
+            auto const op = std::bit_cast<detail::async_io_operation *>(
+                narrow_cast<uintptr_t>(sqe.user_data & ~linked_flush_tag));
+
+            --_num_in_flight;
+            if (--op->num_pending == 0) {
+                _queue.push_back(std::move(op->self));
+            } else if (is_linked_flush) {
+                op->unlinked_flush = true;
+            }
+        });
+    }
+
+    /** Only poll the ring while operations are in flight, so that the loop can exit.
+     */
+    void update_polling() noexcept
+    {
+        if (_num_in_flight != 0 and not _polling) {
+            _loop->add_socket(_ring->fd(), socket_event::read, [this](int, socket_events const&) {
+                handle_completions();
+            });
+            _polling = true;
+
+        } else if (_num_in_flight == 0 and _polling) {
+            _loop->remove_socket(_ring->fd());
+            _polling = false;
+        }
+    }
+
+    void handle_completion(io_uring_cqe const& cqe, std::vector<std::shared_ptr<detail::async_io_operation>>& done) noexcept
+    {
+        using enum detail::async_io_operation::opcode_type;
+
+        auto const is_linked_flush = (cqe.user_data & linked_flush_tag) != 0;
+        auto const op = std::bit_cast<detail::async_io_operation *>(
+            narrow_cast<uintptr_t>(cqe.user_data & ~linked_flush_tag));
+
+        --_num_in_flight;
+
+        if (cqe.res < 0) {
+            // A linked flush is canceled when the write was short or failed.
+            if (not (is_linked_flush and cqe.res == -ECANCELED) and not op->exception) {
+                auto const verb = op->opcode == read ? "read from" : op->opcode == write ? "write to" : "flush";
+                op->exception = std::make_exception_ptr(io_error(std::format(
+                    "{}: Could not {} file.", get_last_error_message(narrow_cast<uint32_t>(-cqe.res)), verb)));
+            }
+
+        } else if (not is_linked_flush and op->opcode != flush) {
+            auto const n = narrow_cast<std::size_t>(cqe.res);
+            op->result += n;
+            op->offset += n;
+            op->data += n;
+            op->size -= n;
+
+            if (op->opcode == read) {
+                // A read shorter than requested is the end-of-file.
+                op->resubmit = op->size != 0 and n == op->submitted_size;
+
+            } else if (op->size != 0) {
+                if (n == 0) {
+                    op->exception = std::make_exception_ptr(io_error("Could not write to file. Reached end-of-file."));
+                } else {
+                    op->resubmit = true;
+                }
+            }
+        }
+
+        if (--op->num_pending == 0) {
+            auto const unlinked_flush = std::exchange(op->unlinked_flush, false);
+            if (op->exception) {
+                done.push_back(std::move(op->self));
+
+            } else if (std::exchange(op->resubmit, false)) {
+                // A write is submitted again together with its flush.
+                _queue.push_back(std::move(op->self));
+
+            } else if (unlinked_flush) {
+                op->opcode = flush;
+                _queue.push_back(std::move(op->self));
+
+            } else {
+                done.push_back(std::move(op->self));
+            }
+        }
+    }
+
+    void handle_completions() noexcept
+    {
+        auto done = std::vector<std::shared_ptr<detail::async_io_operation>>{};
+        _ring->reap([&](io_uring_cqe const& cqe) {
+            handle_completion(cqe, done);
+        });
+
+        // Submit the operations that did not fit, the entries the kernel did not take,
+        // and the rest of the short reads and writes.
+        if (not _queue.empty() or _ring->unsubmitted() != 0) {
+            flush();
+        } else {
+            update_polling();
+        }
+
+        // The co-routines are resumed last, they may start new operations.
+        for (auto const& op : done) {
+            op->handle.resume();
+        }
+    }
+#endif
+
+    static void run_on_thread_pool(std::shared_ptr<detail::async_io_operation> op) noexcept
+    {
+        thread_pool::global().post_function([op = std::move(op)] {
+            op->run();
+            op->await_loop->post_function([op] {
+                op->handle.resume();
+            });
+        });
+    }
+};
+
+namespace detail {
+inline thread_local std::unique_ptr<async_io> thread_local_async_io;
+}
+
+[[nodiscard]] hi_no_inline inline async_io& async_io::local() noexcept
+{
+    if (not detail::thread_local_async_io) {
+        detail::thread_local_async_io = std::make_unique<async_io>();
+    }
+    return *detail::thread_local_async_io;
+}
+
+/** An awaitable for an asynchronous file operation.
+ *
+ * The operation is started when the co-routine is suspended. The co-routine
+ * is resumed on the thread that awaited the operation.
+ */
+class async_io_awaiter {
+public:
+    explicit async_io_awaiter(std::shared_ptr<detail::async_io_operation> op) noexcept : _op(std::move(op)) {}
+
+    [[nodiscard]] bool await_ready() const noexcept
+    {
+        return false;
+    }
+
+    void await_suspend(std::coroutine_handle<> handle) noexcept
+    {
+        _op->handle = handle;
+        async_io::local().submit(_op);
+    }
+
+    /** Get the result of the operation.
+     *
+     * @return The number of bytes read or written.
+     * @throws io_error When the operation failed.
+     */
+    std::size_t await_resume() const
+    {
+        if (_op->exception) {
+            std::rethrow_exception(_op->exception);
+        }
+        return _op->result;
+    }
+
+private:
+    std::shared_ptr<detail::async_io_operation> _op;
+};
+
+} // namespace hi::inline v1
@@ -0,0 +1,163 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "file.hpp"
+#include "../dispatch/dispatch.hpp"
+#include <hikotest/hikotest.hpp>
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <vector>
+
+TEST_SUITE(async_io_suite)
+{
+    static std::filesystem::path temp_path(char const *name)
+    {
+        return std::filesystem::temp_directory_path() / name;
+    }
+
+    static hi::task<std::size_t> write_then_read(hi::file f, std::span<std::byte const> data, std::span<std::byte> buffer)
+    {
+        co_await f.async_write_and_flush(0, data);
+        co_return co_await f.async_read(0, buffer);
+    }
+
+    static hi::task<std::size_t> read_block(hi::file f, std::size_t offset, std::span<std::byte> buffer)
+    {
+        co_return co_await f.async_read(offset, buffer);
+    }
+
+    TEST_CASE(write_read)
+    {
+        auto const path = temp_path("hikogui_async_io_write_read.bin");
+        auto f = hi::file{path, hi::access_mode::truncate_or_create_for_write | hi::access_mode::read};
+
+        auto data = std::vector<std::byte>(100'000);
+        for (auto i = std::size_t{0}; i != data.size(); ++i) {
+            data[i] = static_cast<std::byte>(i * 7);
+        }
+        auto buffer = std::vector<std::byte>(data.size() + 100);
+
+        auto t = write_then_read(f, data, buffer);
+        while (not t.done()) {
+            hi::loop::local().resume_once(true);
+        }
+
+        // The read stops at end-of-file.
+        REQUIRE(t.value() == data.size());
+        auto const equal = std::equal(data.begin(), data.end(), buffer.begin());
+        REQUIRE(equal);
+
+        f.close();
+        std::filesystem::remove(path);
+    }
+
+    TEST_CASE(many_reads)
+    {
+        auto const path = temp_path("hikogui_async_io_many_reads.bin");
+        auto f = hi::file{path, hi::access_mode::truncate_or_create_for_write | hi::access_mode::read};
+
+        auto const num_blocks = std::size_t{1000};
+        for (auto i = std::size_t{0}; i != num_blocks; ++i) {
+            auto const block = std::array{
+                static_cast<std::byte>(i), static_cast<std::byte>(i >> 8), std::byte{0x55}, std::byte{0xaa}};
+            f.write(std::span{block});
+        }
+
+        // Each task starts its read directly; the reads are submitted together,
+        // and there are more reads than fit in the submission queue.
+        auto buffers = std::vector<std::array<std::byte, 4>>(num_blocks);
+        auto tasks = std::vector<hi::task<std::size_t>>{};
+        for (auto i = std::size_t{0}; i != num_blocks; ++i) {
+            tasks.push_back(read_block(f, i * 4, buffers[i]));
+        }
+
+        auto total = std::size_t{0};
+        for (auto& t : tasks) {
+            while (not t.done()) {
+                hi::loop::local().resume_once(true);
+            }
+            total += t.value();
+        }
+
+        REQUIRE(total == num_blocks * 4);
+        for (auto i = std::size_t{0}; i != num_blocks; ++i) {
+            REQUIRE(buffers[i][0] == static_cast<std::byte>(i));
+            REQUIRE(buffers[i][1] == static_cast<std::byte>(i >> 8));
+            REQUIRE(buffers[i][3] == std::byte{0xaa});
+        }
+
+        f.close();
+        std::filesystem::remove(path);
+    }
+
+    TEST_CASE(registered_buffer)
+    {
+        auto const path = temp_path("hikogui_async_io_registered_buffer.bin");
+        auto f = hi::file{path, hi::access_mode::truncate_or_create_for_write | hi::access_mode::read};
+        f.write(std::string_view{"The quick brown fox jumps over the lazy dog."});
+
+        auto buffer = std::vector<std::byte>(4096);
+        hi::async_io::local().register_buffers({std::span{buffer}});
+
+        auto t = write_then_read(f, std::as_bytes(std::span{std::string_view{"THE QUICK"}}), std::span{buffer}.subspan(100));
+        while (not t.done()) {
+            hi::loop::local().resume_once(true);
+        }
+
+        REQUIRE(t.value() == 44);
+        auto const text = std::string_view{reinterpret_cast<char const *>(buffer.data() + 100), 44};
+        REQUIRE(text == "THE QUICK brown fox jumps over the lazy dog.");
+
+        hi::async_io::local().register_buffers({});
+        f.close();
+        std::filesystem::remove(path);
+    }
+
+    TEST_CASE(seek_and_async_read)
+    {
+        auto const path = temp_path("hikogui_async_io_seek_and_async_read.bin");
+        auto f = hi::file{path, hi::access_mode::truncate_or_create_for_write | hi::access_mode::read};
+
+        auto data = std::vector<std::byte>(10'000);
+        for (auto i = std::size_t{0}; i != data.size(); ++i) {
+            data[i] = static_cast<std::byte>(i * 7);
+        }
+        f.write(std::span{data});
+
+        // Asynchronous reads near the end of the file, while blocking reads continue from the seek location.
+        auto buffers = std::vector<std::array<std::byte, 100>>(10);
+        auto tasks = std::vector<hi::task<std::size_t>>{};
+        for (auto i = std::size_t{0}; i != buffers.size(); ++i) {
+            tasks.push_back(read_block(f, 9'000 + i * 100, buffers[i]));
+        }
+
+        REQUIRE(f.seek(1'000) == 1'000);
+        auto blocking_buffer = std::vector<std::byte>(100);
+        for (auto i = std::size_t{0}; i != 20; ++i) {
+            REQUIRE(f.read(blocking_buffer.data(), blocking_buffer.size()) == 100);
+            auto const equal = std::equal(blocking_buffer.begin(), blocking_buffer.end(), data.begin() + 1'000 + i * 100);
+            REQUIRE(equal);
+
+            hi::loop::local().resume_once(false);
+        }
+
+        for (auto& t : tasks) {
+            while (not t.done()) {
+                hi::loop::local().resume_once(true);
+            }
+            REQUIRE(t.value() == 100);
+        }
+
+        // The asynchronous reads did not move the seek location.
+        REQUIRE(f.get_seek() == 3'000);
+        for (auto i = std::size_t{0}; i != buffers.size(); ++i) {
+            auto const equal = std::equal(buffers[i].begin(), buffers[i].end(), data.begin() + 9'000 + i * 100);
+            REQUIRE(equal);
+        }
+
+        f.close();
+        std::filesystem::remove(path);
+    }
+};
@@ -0,0 +1,55 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file file/binary_log_file.hpp Defines make_binary_log_file().
+ * @ingroup file
+ */
+
+#pragma once
+
+#include "file_intf.hpp"
+#include "file_view.hpp"
+#include "access_mode.hpp"
+#include "../telemetry/telemetry.hpp"
+#include "../macros.hpp"
+#include <filesystem>
+#include <memory>
+#include <cstddef>
+
+hi_export_module(hikogui.file.binary_log_file);
+
+hi_export namespace hi { inline namespace v1 {
+
+/** Create a binary log file.
+ * @ingroup file
+ *
+ * The file is memory-mapped and used as the ring buffer of a `binary_log_sink`.
+ * The file can be decoded with `read_binary_log()` even after the application crashed.
+ *
+ * Example:
+ * ```
+ * log_global.set_binary_sink(make_binary_log_file("application.hilog"));
+ * ```
+ *
+ * @param path The path to the file to create, an existing file is overwritten.
+ * @param capacity The size of the ring buffer in bytes.
+ * @return A binary log sink which keeps the file mapped.
+ */
+[[nodiscard]] inline std::shared_ptr<binary_log_sink>
+make_binary_log_file(std::filesystem::path const& path, std::size_t capacity = 16 * 1024 * 1024)
+{
+    hi_assert(capacity >= binary_log_sink::minimum_capacity);
+
+    auto f = file{path, access_mode::truncate_or_create_for_write | access_mode::read};
+
+    // Extend the file to its full size before mapping.
+    auto const size = binary_log_sink::header_size + capacity;
+    f.seek(narrow_cast<std::ptrdiff_t>(size - 1));
+    f.write(std::string_view{"", 1});
+
+    auto view = std::make_shared<file_view>(f);
+    return std::make_shared<binary_log_sink>(as_span<std::byte>(*view), std::move(view));
+}
+
+}} // namespace hi::v1
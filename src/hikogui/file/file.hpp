@@ -5,6 +5,8 @@
 #pragma once
 
 #include "access_mode.hpp" // export
+#include "async_io.hpp" // export
+#include "binary_log_file.hpp" // export
 #include "file_intf.hpp" // export
 #include "file_view.hpp" // export
 #include "resource_view.hpp" // export
@@ -20,6 +22,7 @@ inline namespace v1 {
 
 This module contains file handling utilities:
  - `file` and `file_view` class to read, write and rename files.
+ - `make_binary_log_file()` to write log messages to a memory-mapped file.
 
 File and file-views
 -------------------
@@ -35,6 +38,13 @@ A `file_view` is a RAII object holding a memory-mapping of the file.
 This object allows easy and fast access to the data in a file, as-if
 the file was a `std::span<>` or `std::string_view`.
 
+Asynchronous I/O
+----------------
+A co-routine can read and write at an offset in a `file` using `co_await` on
+`file::async_read()` and `file::async_write()`. On Linux the operations are
+batched and submitted to an io_uring, on other systems they are run on the
+global thread pool; see `async_io`.
+
 */
 
 }}
@@ -13,7 +13,12 @@
 #include "../macros.hpp"
 #include "access_mode.hpp"
 #include "seek_whence.hpp"
+#if HI_OPERATING_SYSTEM == HI_OS_WINDOWS
 #include "file_win32_impl.hpp"
+#else
+#include "file_posix_impl.hpp"
+#endif
+#include "async_io.hpp"
 #include <mutex>
 #include <cstdint>
 #include <map>
@@ -172,6 +177,74 @@ public:
         return write(text.data(), ssize(text));
     }
 
+    /** Read data from the file asynchronously.
+     *
+     * The read does not use or change the seek location.
+     *
+     * ```
+     * auto const size = co_await f.async_read(0, buffer);
+     * ```
+     *
+     * @param offset The offset in the file to read from.
+     * @param buffer The buffer to read into, must remain valid until the read has finished.
+     * @return An awaitable that returns the number of bytes read, which is less
+     *         than the size of the buffer at end-of-file.
+     * @throws io_error On IO error, from the co_await.
+     */
+    [[nodiscard]] async_io_awaiter async_read(std::size_t offset, std::span<std::byte> buffer) const noexcept
+    {
+        using enum detail::async_io_operation::opcode_type;
+        return async_io_awaiter{
+            std::make_shared<detail::async_io_operation>(_pimpl, read, offset, buffer.data(), buffer.size())};
+    }
+
+    /** Write data to the file asynchronously.
+     *
+     * The write does not use or change the seek location.
+     *
+     * @param offset The offset in the file to write to.
+     * @param bytes The data to write, must remain valid until the write has finished.
+     * @return An awaitable that returns the number of bytes written.
+     * @throws io_error On IO error, from the co_await.
+     */
+    [[nodiscard]] async_io_awaiter async_write(std::size_t offset, std::span<std::byte const> bytes) const noexcept
+    {
+        using enum detail::async_io_operation::opcode_type;
+        // The data is only read by a write operation.
+        auto const data = const_cast<std::byte *>(bytes.data());
+        return async_io_awaiter{std::make_shared<detail::async_io_operation>(_pimpl, write, offset, data, bytes.size())};
+    }
+
+    /** Write data to the file and flush it asynchronously.
+     *
+     * The flush is linked to the write, it is started by the kernel directly
+     * after the write has finished, without returning to the loop.
+     *
+     * @param offset The offset in the file to write to.
+     * @param bytes The data to write, must remain valid until the write has finished.
+     * @return An awaitable that returns the number of bytes written.
+     * @throws io_error On IO error, from the co_await.
+     */
+    [[nodiscard]] async_io_awaiter async_write_and_flush(std::size_t offset, std::span<std::byte const> bytes) const noexcept
+    {
+        using enum detail::async_io_operation::opcode_type;
+        // The data is only read by a write operation.
+        auto const data = const_cast<std::byte *>(bytes.data());
+        return async_io_awaiter{
+            std::make_shared<detail::async_io_operation>(_pimpl, write, offset, data, bytes.size(), true)};
+    }
+
+    /** Flush the file asynchronously.
+     *
+     * @return An awaitable that returns zero.
+     * @throws io_error On IO error, from the co_await.
+     */
+    [[nodiscard]] async_io_awaiter async_flush() const noexcept
+    {
+        using enum detail::async_io_operation::opcode_type;
+        return async_io_awaiter{std::make_shared<detail::async_io_operation>(_pimpl, flush, 0, nullptr, 0)};
+    }
+
     /** Read bytes from the file.
      *
      * @param max_size The maximum number of bytes to read.
@@ -4,105 +4,301 @@
 
 #pragma once
 
-#include "../telemetry/telemetry.hpp"
+#include "access_mode.hpp"
+#include "seek_whence.hpp"
 #include "../utility/utility.hpp"
 #include "../macros.hpp"
 #include <fcntl.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/file.h>
 #include <unistd.h>
+#include <stdio.h>
+#include <cerrno>
+#include <filesystem>
+#include <format>
 
 hi_export_module(hikogui.file.file_impl);
 
-hi_export namespace hi::inline v1 {
-
-File::File(std::filesystem::path const &path, AccessMode accessMode) : accessMode(accessMode), location(location)
-{
-    int openFlags = 0;
-
-    if (accessMode >= (AccessMode::Read | AccessMode::Write)) {
-        openFlags = O_RDWR;
-    } else if (accessMode >= AccessMode::Read) {
-        openFlags = O_RDONLY;
-        ;
-    } else if (accessMode >= AccessMode::Write) {
-        openFlags = O_WRONLY;
-        ;
-    } else {
-        throw io_error("{}: Invalid AccessMode; expecting Readable and/or Writeable.", location());
+hi_export namespace hi { inline namespace v1 { namespace detail {
+
+hi_export class file_impl {
+public:
+    file_impl(file_impl const&) = delete;
+    file_impl(file_impl&&) = delete;
+    file_impl& operator=(file_impl const&) = delete;
+    file_impl& operator=(file_impl&&) = delete;
+
+    ~file_impl()
+    {
+        close();
+    }
+
+    file_impl(std::filesystem::path const& path, hi::access_mode access_mode) : _access_mode(access_mode), _path(path)
+    {
+        int open_flags = O_CLOEXEC;
+        if (to_bool(access_mode & access_mode::read) and to_bool(access_mode & access_mode::write)) {
+            open_flags |= O_RDWR;
+        } else if (to_bool(access_mode & access_mode::read)) {
+            open_flags |= O_RDONLY;
+        } else if (to_bool(access_mode & access_mode::write)) {
+            open_flags |= O_WRONLY;
+        } else {
+            throw io_error(std::format("{}: Invalid AccessMode; expecting Readable and/or Writeable.", path.string()));
+        }
+
+        if (to_bool(access_mode & access_mode::create) and to_bool(access_mode & access_mode::open)) {
+            open_flags |= O_CREAT;
+            if (to_bool(access_mode & access_mode::truncate)) {
+                open_flags |= O_TRUNC;
+            }
+
+        } else if (to_bool(access_mode & access_mode::create)) {
+            open_flags |= O_CREAT | O_EXCL;
+
+        } else if (to_bool(access_mode & access_mode::open)) {
+            if (to_bool(access_mode & access_mode::truncate)) {
+                open_flags |= O_TRUNC;
+            }
+
+        } else {
+            throw io_error(std::format("{}: Invalid AccessMode; expecting CreateFile and/or OpenFile.", path.string()));
+        }
+
+        if (to_bool(access_mode & access_mode::write_through)) {
+            open_flags |= O_DSYNC;
+        }
+
+        auto const permissions = 0666;
+        if ((_file_handle = ::open(path.c_str(), open_flags, permissions)) == -1) {
+            if (to_bool(access_mode & access_mode::create_directories) and errno == ENOENT and
+                to_bool(open_flags & O_CREAT)) {
+                // Retry opening the file, by first creating the directory hierarchy.
+                auto directory = path;
+                directory.remove_filename();
+                std::filesystem::create_directories(directory);
+
+                _file_handle = ::open(path.c_str(), open_flags, permissions);
+            }
+        }
+
+        if (_file_handle == -1) {
+            throw io_error(std::format("{}: Could not open file, '{}'", path.string(), get_last_error_message()));
+        }
+
+        // On POSIX locks are advisory, they only work between processes that use them.
+        auto lock_operation = 0;
+        if (to_bool(access_mode & access_mode::write_lock)) {
+            lock_operation = LOCK_EX | LOCK_NB;
+        } else if (to_bool(access_mode & access_mode::read_lock)) {
+            lock_operation = LOCK_SH | LOCK_NB;
+        }
+        if (lock_operation != 0 and ::flock(_file_handle, lock_operation) != 0) {
+            auto const message = get_last_error_message();
+            ::close(_file_handle);
+            _file_handle = -1;
+            throw io_error(std::format("{}: Could not lock file, '{}'", path.string(), message));
+        }
+
+        // The hints are optional, failures are ignored.
+        if (to_bool(access_mode & access_mode::random)) {
+            ::posix_fadvise(_file_handle, 0, 0, POSIX_FADV_RANDOM);
+        }
+        if (to_bool(access_mode & access_mode::sequential)) {
+            ::posix_fadvise(_file_handle, 0, 0, POSIX_FADV_SEQUENTIAL);
+        }
+        if (to_bool(access_mode & access_mode::no_reuse)) {
+            ::posix_fadvise(_file_handle, 0, 0, POSIX_FADV_NOREUSE);
+        }
+    }
+
+    [[nodiscard]] bool closed() noexcept
+    {
+        return _file_handle == -1;
     }
 
-    if (accessMode >= AccessMode::WriteLock) {
-        openFlags |= O_EXLOCK;
-    } else if (accessMode >= AccessMode::ReadLock) {
-        openFlags |= O_SHLOCK;
+    [[nodiscard]] hi::access_mode access_mode() const
+    {
+        return _access_mode;
     }
 
-    if (accessMode >= (AccessMode::Create | AccessMode::Open)) {
-        openFlags |= O_CREAT;
-        if (accessMode >= AccessMode::Truncate) {
-            openFlags |= O_TRUNC;
+    [[nodiscard]] int file_handle() const noexcept
+    {
+        return _file_handle;
+    }
+
+    void flush()
+    {
+        hi_assert(_file_handle != -1);
+
+        if (::fsync(_file_handle) != 0) {
+            throw io_error(std::format("{}: Could not flush file.", get_last_error_message()));
         }
+    }
 
-    } else if (accessMode >= AccessMode::Create) {
-        openFlags |= (O_CREAT | O_EXCL);
+    void close()
+    {
+        if (_file_handle != -1) {
+            if (::close(_file_handle) != 0) {
+                throw io_error(std::format("{}: Could not close file.", get_last_error_message()));
+            }
+            _file_handle = -1;
+        }
+    }
 
-    } else if (accessMode >= AccessMode::Open) {
-        if (accessMode >= AccessMode::Truncate) {
-            openFlags |= O_TRUNC;
+    [[nodiscard]] std::size_t size() const
+    {
+        struct ::stat stat_buffer;
+
+        if (::fstat(_file_handle, &stat_buffer) != 0) {
+            throw io_error(std::format("{}: Could not get file information.", get_last_error_message()));
         }
 
-    } else {
-        throw io_error("{}: Invalid AccessMode; expecting CreateFile and/or OpenFile.", location());
+        return narrow_cast<std::size_t>(stat_buffer.st_size);
     }
 
-    // int advise = 0;
-    // if (accessMode >= AccessMode::Random) {
-    //    advise = POSIX_FADV_RANDOM;
-    //} if (accessMode >= AccessMode::Sequential) {
-    //    advise = POSIX_FADV_SEQUENTIAL;
-    //} else {
-    //    advise = 0;
-    //}
-    //
-    // if (accessMode >= AccessMode::NoReuse) {
-    //    advise |= POSIX_FADV_NOREUSE;
-    //}
-
-    int permissions = 0666;
-
-    auto const fileName = location.nativePath();
-    if ((fileHandle = ::open(fileName.data(), openFlags, permissions)) == -1) {
-        throw io_error("{}: Could not open file. '{}'", location(), get_last_error_message());
+    std::size_t seek(ssize_t offset, seek_whence whence)
+    {
+        hi_assert(_file_handle != -1);
+
+        int whence_;
+        switch (whence) {
+            using enum seek_whence;
+        case begin:
+            whence_ = SEEK_SET;
+            break;
+        case current:
+            whence_ = SEEK_CUR;
+            break;
+        case end:
+            whence_ = SEEK_END;
+            break;
+        default:
+            hi_no_default();
+        }
+
+        auto const new_offset = ::lseek(_file_handle, narrow_cast<off_t>(offset), whence_);
+        if (new_offset == -1) {
+            throw io_error(std::format("{}: Could not seek in file.", get_last_error_message()));
+        }
+
+        return narrow_cast<std::size_t>(new_offset);
     }
-}
 
-File::~File() noexcept
-{
-    close();
-}
+    void rename(std::filesystem::path const& destination, bool overwrite_existing)
+    {
+        // POSIX renames by name, the file descriptor remains valid.
+        auto const flags = overwrite_existing ? 0U : RENAME_NOREPLACE;
+        if (::renameat2(AT_FDCWD, _path.c_str(), AT_FDCWD, destination.c_str(), flags) != 0) {
+            throw io_error(std::format("Could not rename file to '{}': {}", destination.string(), get_last_error_message()));
+        }
+        _path = destination;
+    }
+
+    void write(void const *data, std::size_t size)
+    {
+        hi_assert(_file_handle != -1);
+
+        while (size != 0) {
+            auto const written = ::write(_file_handle, data, size);
+            if (written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw io_error(std::format("{}: Could not write to file.", get_last_error_message()));
 
-void File::close()
-{
-    if (fileHandle != -1) {
-        if (::close(fileHandle) != 0) {
-            throw io_error("{}: Could not close file. '{}'", location(), get_last_error_message());
+            } else if (written == 0) {
+                throw io_error("Could not write to file. Reached end-of-file.");
+            }
+
+            data = advance_bytes(data, written);
+            size -= written;
         }
-        fileHandle = -1;
     }
-}
 
-std::size_t File::fileSize(std::filesystem::path const &path)
-{
-    auto const name = url.nativePath();
+    [[nodiscard]] std::size_t read(void *data, std::size_t size)
+    {
+        hi_assert(_file_handle != -1);
+
+        auto total_read = 0_uz;
+        while (size) {
+            auto const has_read = ::read(_file_handle, data, size);
+            if (has_read == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw io_error(std::format("{}: Could not read from file.", get_last_error_message()));
+
+            } else if (has_read == 0) {
+                // Read to end-of-file.
+                break;
+            }
 
-    struct ::stat statbuf;
+            data = advance_bytes(data, has_read);
+            size -= has_read;
+            total_read += has_read;
+        }
+
+        return total_read;
+    }
+
+    /** Write data at an offset, without using the seek location.
+     */
+    void write_at(std::size_t offset, void const *data, std::size_t size)
+    {
+        hi_assert(_file_handle != -1);
+
+        while (size != 0) {
+            auto const written = ::pwrite(_file_handle, data, size, narrow_cast<off_t>(offset));
+            if (written == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw io_error(std::format("{}: Could not write to file.", get_last_error_message()));
+
+            } else if (written == 0) {
+                throw io_error("Could not write to file. Reached end-of-file.");
+            }
+
+            data = advance_bytes(data, written);
+            size -= written;
+            offset += written;
+        }
+    }
+
+    /** Read data at an offset, without using the seek location.
+     */
+    [[nodiscard]] std::size_t read_at(std::size_t offset, void *data, std::size_t size)
+    {
+        hi_assert(_file_handle != -1);
+
+        auto total_read = 0_uz;
+        while (size) {
+            auto const has_read = ::pread(_file_handle, data, size, narrow_cast<off_t>(offset));
+            if (has_read == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw io_error(std::format("{}: Could not read from file.", get_last_error_message()));
+
+            } else if (has_read == 0) {
+                // Read to end-of-file.
+                break;
+            }
+
+            data = advance_bytes(data, has_read);
+            size -= has_read;
+            offset += has_read;
+            total_read += has_read;
+        }
 
-    if (::stat(name.data(), &statbuf) == -1) {
-        throw io_error("{}: Could not retrieve file attributes. '{}'", location(), get_last_error_message());
+        return total_read;
     }
 
-    return narrow_cast<std::size_t>(statbuf.st_size);
-}
+private:
+    hi::access_mode _access_mode;
+    std::filesystem::path _path;
+    int _file_handle = -1;
+};
 
-} // namespace hi::inline v1
+}}} // namespace hi::v1::detail
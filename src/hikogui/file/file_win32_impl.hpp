@@ -11,6 +11,7 @@
 #include "../utility/utility.hpp"
 #include "../macros.hpp"
 #include <filesystem>
+#include <mutex>
 
 hi_export_module(hikogui.file.file_impl);
 
@@ -161,6 +162,7 @@ public:
     std::size_t seek(ssize_t offset, seek_whence whence)
     {
         hi_assert_not_null(_file_handle);
+        auto const lock = std::scoped_lock(_mutex);
 
         DWORD whence_;
         switch (whence) {
@@ -213,6 +215,7 @@ public:
     void write(void const *data, std::size_t size)
     {
         hi_assert(_file_handle != INVALID_HANDLE_VALUE);
+        auto const lock = std::scoped_lock(_mutex);
 
         while (size != 0) {
             // Copy in blocks of 32 kByte
@@ -233,6 +236,7 @@ public:
     [[nodiscard]] std::size_t read(void *data, std::size_t size)
     {
         hi_assert(_file_handle != INVALID_HANDLE_VALUE);
+        auto const lock = std::scoped_lock(_mutex);
 
         ssize_t total_read = 0;
         while (size) {
@@ -255,9 +259,101 @@ public:
         return total_read;
     }
 
+    /** Write data at an offset, without using the seek location.
+     *
+     * This function may be called from another thread than the blocking
+     * read, write and seek functions.
+     */
+    void write_at(std::size_t offset, void const *data, std::size_t size)
+    {
+        hi_assert(_file_handle != INVALID_HANDLE_VALUE);
+        auto const lock = std::scoped_lock(_mutex);
+        auto const restore = restore_file_pointer();
+
+        while (size != 0) {
+            auto to_write = size < 0x8000 ? narrow_cast<DWORD>(size) : DWORD{0x8000};
+            auto written = DWORD{};
+            auto overlapped = OVERLAPPED{};
+            overlapped.Offset = truncate<DWORD>(offset);
+            overlapped.OffsetHigh = truncate<DWORD>(offset >> 32);
+            if (not WriteFile(_file_handle, data, to_write, &written, &overlapped)) {
+                throw io_error(std::format("{}: Could not write to file.", get_last_error_message()));
+
+            } else if (written == 0) {
+                throw io_error("Could not write to file. Reached end-of-file.");
+            }
+
+            data = advance_bytes(data, written);
+            size -= written;
+            offset += written;
+        }
+    }
+
+    /** Read data at an offset, without using the seek location.
+     *
+     * This function may be called from another thread than the blocking
+     * read, write and seek functions.
+     */
+    [[nodiscard]] std::size_t read_at(std::size_t offset, void *data, std::size_t size)
+    {
+        hi_assert(_file_handle != INVALID_HANDLE_VALUE);
+        auto const lock = std::scoped_lock(_mutex);
+        auto const restore = restore_file_pointer();
+
+        auto total_read = 0_uz;
+        while (size) {
+            auto to_read = size < 0x8000 ? narrow_cast<DWORD>(size) : DWORD{0x8000};
+            auto has_read = DWORD{};
+            auto overlapped = OVERLAPPED{};
+            overlapped.Offset = truncate<DWORD>(offset);
+            overlapped.OffsetHigh = truncate<DWORD>(offset >> 32);
+            if (not ReadFile(_file_handle, data, to_read, &has_read, &overlapped)) {
+                if (GetLastError() == ERROR_HANDLE_EOF) {
+                    break;
+                }
+                throw io_error(std::format("{}: Could not read from file.", get_last_error_message()));
+
+            } else if (has_read == 0) {
+                // Read to end-of-file.
+                break;
+            }
+
+            data = advance_bytes(data, has_read);
+            size -= has_read;
+            offset += has_read;
+            total_read += has_read;
+        }
+
+        return total_read;
+    }
+
 private:
     hi::access_mode _access_mode;
     HANDLE _file_handle = nullptr;
+
+    /** Serializes the use of the file pointer.
+     *
+     * The handle is synchronous, so ReadFile() and WriteFile() with an
+     * OVERLAPPED offset still move the file pointer.
+     */
+    std::mutex _mutex;
+
+    /** Restore the file pointer at the end of the scope.
+     *
+     * @pre `_mutex` must be locked.
+     */
+    [[nodiscard]] defer restore_file_pointer()
+    {
+        auto position = LARGE_INTEGER{};
+        if (not SetFilePointerEx(_file_handle, LARGE_INTEGER{}, &position, FILE_CURRENT)) {
+            throw io_error(std::format("{}: Could not get the file pointer.", get_last_error_message()));
+        }
+
+        return defer([this, position] {
+            // The file pointer can always be moved back to a location that it was at before.
+            SetFilePointerEx(_file_handle, position, nullptr, FILE_BEGIN);
+        });
+    }
 };
 
 }}} // namespace hi::v1::detail
@@ -0,0 +1,368 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file file/io_uring_posix.hpp A minimal wrapper around a Linux io_uring.
+ */
+
+#pragma once
+
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <format>
+#include <span>
+
+hi_export_module(hikogui.file.io_uring);
+
+hi_export namespace hi::inline v1 {
+namespace detail {
+
+/** An io_uring instance.
+ *
+ * The ring is accessed through the system calls and the memory-mapped queues
+ * directly, so that liburing is not needed.
+ *
+ * Submission queue entries are filled in with `get_sqe()` and are handed to the
+ * kernel in a batch by `submit()`. Completions are read from the memory-mapped
+ * completion queue by `reap()` without a system call.
+ *
+ * @note A ring is not thread-safe, it is owned by a single thread.
+ */
+class io_uring_ring {
+public:
+    ~io_uring_ring()
+    {
+        close();
+    }
+
+    io_uring_ring(io_uring_ring const&) = delete;
+    io_uring_ring(io_uring_ring&&) = delete;
+    io_uring_ring& operator=(io_uring_ring const&) = delete;
+    io_uring_ring& operator=(io_uring_ring&&) = delete;
+
+    /** Create a ring.
+     *
+     * @param num_entries The number of entries in the submission queue.
+     * @throws os_error When io_uring is not available, for example on an old
+     *                  kernel or when it is blocked by a seccomp filter.
+     */
+    explicit io_uring_ring(unsigned int num_entries = 256)
+    {
+        auto params = io_uring_params{};
+        _fd = narrow_cast<int>(::syscall(__NR_io_uring_setup, num_entries, &params));
+        if (_fd == -1) {
+            throw os_error(std::format("Could not setup io_uring. {}", get_last_error_message()));
+        }
+
+        _sq_size = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+        _cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        if (params.features & IORING_FEAT_SINGLE_MMAP) {
+            _sq_size = _cq_size = std::max(_sq_size, _cq_size);
+        }
+
+        try {
+            _sq_ptr = map(_sq_size, IORING_OFF_SQ_RING);
+            if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                _cq_ptr = _sq_ptr;
+            } else {
+                _cq_ptr = map(_cq_size, IORING_OFF_CQ_RING);
+            }
+
+            _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+            _sqes = static_cast<io_uring_sqe *>(map(_sqes_size, IORING_OFF_SQES));
+        } catch (...) {
+            close();
+            throw;
+        }
+
+        _sq_head = ring_member(_sq_ptr, params.sq_off.head);
+        _sq_tail = ring_member(_sq_ptr, params.sq_off.tail);
+        _sq_mask = *ring_member(_sq_ptr, params.sq_off.ring_mask);
+        _sq_array = ring_member(_sq_ptr, params.sq_off.array);
+        _sq_entries = params.sq_entries;
+
+        _cq_head = ring_member(_cq_ptr, params.cq_off.head);
+        _cq_tail = ring_member(_cq_ptr, params.cq_off.tail);
+        _cq_mask = *ring_member(_cq_ptr, params.cq_off.ring_mask);
+        _cqes = reinterpret_cast<io_uring_cqe *>(static_cast<char *>(_cq_ptr) + params.cq_off.cqes);
+        _cq_entries = params.cq_entries;
+
+        _sq_local_tail = *_sq_tail;
+
+        probe();
+    }
+
+    /** The file descriptor of the ring.
+     *
+     * The file descriptor can be polled; it is readable when there are completions.
+     */
+    [[nodiscard]] int fd() const noexcept
+    {
+        return _fd;
+    }
+
+    /** Check if an operation is supported by the kernel.
+     *
+     * Older kernels accept the setup of a ring, but fail each submitted
+     * operation that they do not know with -EINVAL.
+     *
+     * @param opcode The IORING_OP_* operation.
+     * @return True when the kernel supports the operation.
+     */
+    [[nodiscard]] bool supports(uint8_t opcode) const noexcept
+    {
+        return _supported[opcode];
+    }
+
+    /** The number of entries in the completion queue.
+     */
+    [[nodiscard]] std::size_t completion_capacity() const noexcept
+    {
+        return _cq_entries;
+    }
+
+    /** The number of free entries in the submission queue.
+     */
+    [[nodiscard]] std::size_t space() const noexcept
+    {
+        return _sq_entries - (_sq_local_tail - std::atomic_ref{*_sq_head}.load(std::memory_order::acquire));
+    }
+
+    /** Get a cleared submission queue entry.
+     *
+     * @return The entry, or nullptr when the submission queue is full.
+     */
+    [[nodiscard]] io_uring_sqe *get_sqe() noexcept
+    {
+        if (space() == 0) {
+            return nullptr;
+        }
+
+        auto const index = _sq_local_tail & _sq_mask;
+        _sq_array[index] = index;
+        ++_sq_local_tail;
+
+        auto const r = &_sqes[index];
+        std::memset(r, 0, sizeof(io_uring_sqe));
+        return r;
+    }
+
+    /** The number of entries from `get_sqe()` that the kernel did not consume yet.
+     */
+    [[nodiscard]] std::size_t unsubmitted() const noexcept
+    {
+        return _sq_local_tail - std::atomic_ref{*_sq_head}.load(std::memory_order::acquire);
+    }
+
+    /** Hand all the entries from `get_sqe()` to the kernel with a single system call.
+     *
+     * When the kernel is out of resources, or the completion queue is full, it
+     * may not consume all the entries. Those entries are submitted by the next
+     * call, or can be taken back with `cancel_unsubmitted()`.
+     *
+     * @return The number of entries that the kernel did not consume.
+     * @throws os_error When the entries could not be submitted.
+     */
+    std::size_t submit()
+    {
+        std::atomic_ref{*_sq_tail}.store(_sq_local_tail, std::memory_order::release);
+
+        while (auto const to_submit = unsubmitted()) {
+            auto const r = ::syscall(__NR_io_uring_enter, _fd, to_submit, 0, 0, nullptr, 0);
+            if (r == -1) {
+                if (errno == EINTR) {
+                    continue;
+                } else if (errno == EAGAIN or errno == EBUSY) {
+                    return to_submit;
+                }
+                throw os_error(std::format("Could not submit to io_uring. {}", get_last_error_message()));
+
+            } else if (r == 0) {
+                return to_submit;
+            }
+        }
+        return 0;
+    }
+
+    /** Block until there is at least one completion.
+     *
+     * @throws os_error When waiting on the ring failed.
+     */
+    void wait()
+    {
+        while (::syscall(__NR_io_uring_enter, _fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) == -1) {
+            if (errno != EINTR) {
+                throw os_error(std::format("Could not wait on io_uring. {}", get_last_error_message()));
+            }
+        }
+    }
+
+    /** Take back the entries that were not yet consumed by the kernel.
+     *
+     * This is used when the ring can no longer be used, so that the entries
+     * can be handled in another way.
+     *
+     * @param func The function called with each `io_uring_sqe const&`.
+     */
+    template<typename Func>
+    void cancel_unsubmitted(Func const& func) noexcept
+    {
+        auto const head = std::atomic_ref{*_sq_head}.load(std::memory_order::acquire);
+        for (auto i = head; i != _sq_local_tail; ++i) {
+            func(_sqes[_sq_array[i & _sq_mask]]);
+        }
+
+        _sq_local_tail = head;
+        std::atomic_ref{*_sq_tail}.store(_sq_local_tail, std::memory_order::release);
+    }
+
+    /** Take all completions from the completion queue.
+     *
+     * @param func The function called with each `io_uring_cqe const&`.
+     * @return The number of completions.
+     */
+    template<typename Func>
+    std::size_t reap(Func const& func) noexcept
+    {
+        auto head = *_cq_head;
+        auto const tail = std::atomic_ref{*_cq_tail}.load(std::memory_order::acquire);
+        auto const r = narrow_cast<std::size_t>(tail - head);
+
+        for (; head != tail; ++head) {
+            func(_cqes[head & _cq_mask]);
+        }
+        std::atomic_ref{*_cq_head}.store(head, std::memory_order::release);
+        return r;
+    }
+
+    /** Register buffers for fixed-buffer reads and writes.
+     *
+     * Registered buffers are pinned by the kernel once, instead of on each
+     * operation. Earlier registered buffers are unregistered.
+     *
+     * @param buffers The buffers to register, the index in this list is used
+     *                in the `buf_index` of a submission queue entry.
+     * @throws os_error When the buffers could not be registered.
+     */
+    void register_buffers(std::span<iovec const> buffers)
+    {
+        unregister_buffers();
+        if (buffers.empty()) {
+            return;
+        }
+
+        if (::syscall(__NR_io_uring_register, _fd, IORING_REGISTER_BUFFERS, buffers.data(), buffers.size()) != 0) {
+            throw os_error(std::format("Could not register buffers with io_uring. {}", get_last_error_message()));
+        }
+        _has_buffers = true;
+    }
+
+    void unregister_buffers() noexcept
+    {
+        if (std::exchange(_has_buffers, false)) {
+            ::syscall(__NR_io_uring_register, _fd, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        }
+    }
+
+private:
+    int _fd = -1;
+    bool _has_buffers = false;
+
+    void *_sq_ptr = nullptr;
+    std::size_t _sq_size = 0;
+    void *_cq_ptr = nullptr;
+    std::size_t _cq_size = 0;
+    io_uring_sqe *_sqes = nullptr;
+    std::size_t _sqes_size = 0;
+
+    uint32_t *_sq_head = nullptr;
+    uint32_t *_sq_tail = nullptr;
+    uint32_t *_sq_array = nullptr;
+    uint32_t _sq_mask = 0;
+    uint32_t _sq_entries = 0;
+
+    /** The tail including the entries that were not yet submitted.
+     */
+    uint32_t _sq_local_tail = 0;
+
+    uint32_t *_cq_head = nullptr;
+    uint32_t *_cq_tail = nullptr;
+    io_uring_cqe *_cqes = nullptr;
+    uint32_t _cq_mask = 0;
+    uint32_t _cq_entries = 0;
+
+    /** The operations that are supported by the kernel, indexed by opcode.
+     */
+    std::bitset<256> _supported;
+
+    void close() noexcept
+    {
+        if (_sqes != nullptr) {
+            ::munmap(_sqes, _sqes_size);
+        }
+        if (_cq_ptr != nullptr and _cq_ptr != _sq_ptr) {
+            ::munmap(_cq_ptr, _cq_size);
+        }
+        if (_sq_ptr != nullptr) {
+            ::munmap(_sq_ptr, _sq_size);
+        }
+        if (_fd != -1) {
+            ::close(_fd);
+        }
+    }
+
+    /** Ask the kernel which operations it supports.
+     *
+     * The probe was added in Linux 5.6, together with IORING_OP_READ and IORING_OP_WRITE.
+     * On older kernels no operations are marked as supported.
+     */
+    void probe() noexcept
+    {
+        constexpr auto num_ops = 256_uz;
+        constexpr auto buffer_size = sizeof(io_uring_probe) + num_ops * sizeof(io_uring_probe_op);
+
+        // io_uring_probe ends in a flexible array member. The kernel requires it to be zeroed.
+        alignas(io_uring_probe) auto buffer = std::array<std::byte, buffer_size>{};
+        auto const probe = reinterpret_cast<io_uring_probe *>(buffer.data());
+
+        if (::syscall(__NR_io_uring_register, _fd, IORING_REGISTER_PROBE, probe, num_ops) != 0) {
+            return;
+        }
+
+        for (auto i = 0_uz; i != probe->ops_len; ++i) {
+            if (probe->ops[i].flags & IO_URING_OP_SUPPORTED) {
+                _supported.set(probe->ops[i].op);
+            }
+        }
+    }
+
+    [[nodiscard]] void *map(std::size_t size, off_t offset)
+    {
+        auto const r = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _fd, offset);
+        if (r == MAP_FAILED) {
+            throw os_error(std::format("Could not map the io_uring queues. {}", get_last_error_message()));
+        }
+        return r;
+    }
+
+    [[nodiscard]] static uint32_t *ring_member(void *ring, uint32_t offset) noexcept
+    {
+        return reinterpret_cast<uint32_t *>(static_cast<char *>(ring) + offset);
+    }
+};
+
+} // namespace detail
+} // namespace hi::inline v1
@@ -0,0 +1,84 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "sip_hash.hpp"
+#include "wy_hash.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+hi_export_module(hikogui.security.key_hash);
+
+hi_export namespace hi::inline v1 {
+
+/** The hash algorithm used for the keys of a hash table.
+ */
+enum class hash_policy {
+    /** SipHash-2-4, for keys that may come from an attacker.
+     */
+    secure,
+
+    /** wyhash, for trusted internal keys.
+     */
+    fast
+};
+
+namespace detail {
+
+template<hash_policy Policy>
+using key_hash_type = std::conditional_t<Policy == hash_policy::secure, _sip_hash24, wy_hash>;
+
+}
+
+/** A hash function object for the keys of hash tables.
+ *
+ * Both algorithms are seeded with a random value at startup, the hash of a
+ * key is different for each run of the application.
+ *
+ * @tparam T The type of the key.
+ * @tparam Policy The hash algorithm to use, selected at compile time.
+ */
+template<typename T, hash_policy Policy = hash_policy::secure>
+struct key_hash {
+    [[nodiscard]] uint64_t operator()(T const& rhs) const noexcept
+    {
+        hi_static_not_implemented();
+    }
+
+    [[nodiscard]] uint64_t operator()(T const& rhs) const noexcept
+        requires(std::has_unique_object_representations_v<T> and not std::is_pointer_v<T>)
+    {
+        return detail::key_hash_type<Policy>{}(&rhs, sizeof(rhs));
+    }
+};
+
+template<typename CharT, typename CharTrait, hash_policy Policy>
+struct key_hash<std::basic_string_view<CharT, CharTrait>, Policy> {
+    using is_transparent = void;
+
+    [[nodiscard]] uint64_t operator()(std::basic_string_view<CharT, CharTrait> const& rhs) const noexcept
+    {
+        return detail::key_hash_type<Policy>{}(rhs.data(), rhs.size() * sizeof(CharT));
+    }
+};
+
+template<typename CharT, typename CharTrait, typename Allocator, hash_policy Policy>
+struct key_hash<std::basic_string<CharT, CharTrait, Allocator>, Policy> : key_hash<std::basic_string_view<CharT, CharTrait>, Policy> {};
+
+template<typename T, std::size_t Extent, hash_policy Policy>
+struct key_hash<std::span<T, Extent>, Policy> {
+    [[nodiscard]] uint64_t operator()(std::span<T, Extent> const& rhs) const noexcept
+    {
+        return detail::key_hash_type<Policy>{}(rhs.data(), rhs.size_bytes());
+    }
+};
+
+} // namespace hi::inline v1
@@ -1,7 +1,10 @@
 
 #pragma once
 
+#include "key_hash.hpp" // export
 #include "security_intf.hpp" // export
 #include "security_win32_impl.hpp" // export
+#include "sip_hash.hpp" // export
+#include "wy_hash.hpp" // export
 
 hi_export_module(hikogui.security);
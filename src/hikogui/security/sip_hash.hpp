@@ -7,10 +7,18 @@
 #include "../random/random.hpp"
 #include "../utility/utility.hpp"
 #include "../macros.hpp"
+#include <hikocpu/hikocpu.hpp>
 #include <string_view>
 #include <string>
 #include <span>
 #include <bit>
+#include <array>
+#include <algorithm>
+#include <ranges>
+
+#if HI_HAS_X86
+#include <immintrin.h>
+#endif
 
 hi_export_module(hikogui.security.sip_hash);
 
@@ -30,6 +38,146 @@ inline auto sip_hash_seed = sip_hash_seed_type();
 
 struct sip_hash_seed_tag {};
 
+/** The last word of a SipHash message: the length modulo 256 and the last 0 to 7 bytes.
+ */
+[[nodiscard]] inline uint64_t sip_hash_last_word(char const *src, size_t size) noexcept
+{
+    auto m = wide_cast<uint64_t>(size & 0xff) << 56;
+    src += size & ~size_t{7};
+    for (auto i = 0_uz; i != (size & 7); ++i) {
+        m |= char_cast<uint64_t>(src[i]) << (i * CHAR_BIT);
+    }
+    return m;
+}
+
+#if HI_HAS_X86
+template<int N>
+hi_target("avx,avx2")
+[[nodiscard]] hi_force_inline inline __m256i sip_hash_rotl_avx2(__m256i x) noexcept
+{
+    if constexpr (N == 32) {
+        return _mm256_shuffle_epi32(x, 0b10'11'00'01);
+    } else if constexpr (N == 16) {
+        return _mm256_shuffle_epi8(
+            x, _mm256_setr_epi8(6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13, 6, 7, 0, 1, 2, 3, 4, 5, 14, 15, 8, 9, 10, 11, 12, 13));
+    } else {
+        return _mm256_or_si256(_mm256_slli_epi64(x, N), _mm256_srli_epi64(x, 64 - N));
+    }
+}
+
+hi_target("avx,avx2")
+hi_force_inline inline void sip_hash_round_avx2(__m256i& v0, __m256i& v1, __m256i& v2, __m256i& v3) noexcept
+{
+    v0 = _mm256_add_epi64(v0, v1);
+    v2 = _mm256_add_epi64(v2, v3);
+    v1 = sip_hash_rotl_avx2<13>(v1);
+    v3 = sip_hash_rotl_avx2<16>(v3);
+    v1 = _mm256_xor_si256(v1, v0);
+    v3 = _mm256_xor_si256(v3, v2);
+    v0 = sip_hash_rotl_avx2<32>(v0);
+
+    v0 = _mm256_add_epi64(v0, v3);
+    v2 = _mm256_add_epi64(v2, v1);
+    v1 = sip_hash_rotl_avx2<17>(v1);
+    v3 = sip_hash_rotl_avx2<21>(v3);
+    v1 = _mm256_xor_si256(v1, v2);
+    v3 = _mm256_xor_si256(v3, v0);
+    v2 = sip_hash_rotl_avx2<32>(v2);
+}
+
+/** Hash 4 complete messages in parallel, one message in each 64 bit lane.
+ *
+ * Messages of different length are handled by masking out the lanes of
+ * messages that are already complete.
+ *
+ * @param v The initial state v0, v1, v2, v3 of the hash.
+ * @param data Pointers to the 4 messages.
+ * @param sizes The size of each message in bytes.
+ * @param[out] r The hash of each message.
+ */
+template<size_t C, size_t D>
+hi_target("avx,avx2")
+inline void sip_hash_x4_avx2(
+    std::array<uint64_t, 4> const& v,
+    std::array<char const *, 4> const& data,
+    std::array<size_t, 4> const& sizes,
+    uint64_t *r) noexcept
+{
+    auto v0 = _mm256_set1_epi64x(static_cast<long long>(v[0]));
+    auto v1 = _mm256_set1_epi64x(static_cast<long long>(v[1]));
+    auto v2 = _mm256_set1_epi64x(static_cast<long long>(v[2]));
+    auto v3 = _mm256_set1_epi64x(static_cast<long long>(v[3]));
+
+    auto nr_common_words = sizes[0] / 8;
+    auto nr_words = sizes[0] / 8 + 1;
+    for (auto i = 1_uz; i != 4; ++i) {
+        nr_common_words = std::min(nr_common_words, sizes[i] / 8);
+        nr_words = std::max(nr_words, sizes[i] / 8 + 1);
+    }
+
+    // The full words that all messages have in common.
+    auto j = 0_uz;
+    for (; j != nr_common_words; ++j) {
+        auto const m = _mm256_setr_epi64x(
+            load_le<int64_t>(data[0] + j * 8),
+            load_le<int64_t>(data[1] + j * 8),
+            load_le<int64_t>(data[2] + j * 8),
+            load_le<int64_t>(data[3] + j * 8));
+
+        v3 = _mm256_xor_si256(v3, m);
+        for (auto i = 0_uz; i != C; ++i) {
+            sip_hash_round_avx2(v0, v1, v2, v3);
+        }
+        v0 = _mm256_xor_si256(v0, m);
+    }
+
+    // The rest of the words, lanes of messages that are complete are masked out.
+    auto const word = [&](size_t i) {
+        auto const nr_full_words = sizes[i] / 8;
+        if (j < nr_full_words) {
+            return load_le<int64_t>(data[i] + j * 8);
+        } else if (j == nr_full_words) {
+            return static_cast<int64_t>(sip_hash_last_word(data[i], sizes[i]));
+        } else {
+            return int64_t{0};
+        }
+    };
+
+    auto const nr_words_ = _mm256_setr_epi64x(
+        static_cast<long long>(sizes[0] / 8 + 1),
+        static_cast<long long>(sizes[1] / 8 + 1),
+        static_cast<long long>(sizes[2] / 8 + 1),
+        static_cast<long long>(sizes[3] / 8 + 1));
+
+    for (; j != nr_words; ++j) {
+        auto const m = _mm256_setr_epi64x(word(0), word(1), word(2), word(3));
+        auto const mask = _mm256_cmpgt_epi64(nr_words_, _mm256_set1_epi64x(static_cast<long long>(j)));
+
+        auto n0 = v0;
+        auto n1 = v1;
+        auto n2 = v2;
+        auto n3 = _mm256_xor_si256(v3, m);
+        for (auto i = 0_uz; i != C; ++i) {
+            sip_hash_round_avx2(n0, n1, n2, n3);
+        }
+        n0 = _mm256_xor_si256(n0, m);
+
+        v0 = _mm256_blendv_epi8(v0, n0, mask);
+        v1 = _mm256_blendv_epi8(v1, n1, mask);
+        v2 = _mm256_blendv_epi8(v2, n2, mask);
+        v3 = _mm256_blendv_epi8(v3, n3, mask);
+    }
+
+    v2 = _mm256_xor_si256(v2, _mm256_set1_epi64x(0xff));
+    for (auto i = 0_uz; i != D; ++i) {
+        sip_hash_round_avx2(v0, v1, v2, v3);
+    }
+
+    auto const h = _mm256_xor_si256(_mm256_xor_si256(v0, v1), _mm256_xor_si256(v2, v3));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(r), h);
+}
+#endif
+
 } // namespace detail
 
 template<size_t C, size_t D>
@@ -185,6 +333,53 @@ public:
         return complete_message(data, size);
     }
 
+    /** Hash a batch of complete messages.
+     *
+     * With AVX2 four messages are hashed in parallel, one in each 64 bit lane.
+     * This works best when the messages have similar lengths, like the keys
+     * of a hash table.
+     *
+     * @param messages A range of contiguous ranges, such as a vector of strings.
+     * @param[out] r The hash of each message.
+     * @note The `sip_hash` instance can be reused when using this function
+     */
+    template<std::ranges::random_access_range Messages>
+    void complete_messages(Messages const& messages, std::span<uint64_t> r) const noexcept
+        requires std::ranges::contiguous_range<std::ranges::range_value_t<Messages>>
+    {
+        using value_type = std::ranges::range_value_t<std::ranges::range_value_t<Messages>>;
+
+        hi_axiom(std::ranges::size(messages) == r.size());
+#ifndef NDEBUG
+        hi_assert(_debug_state == debug_state_type::idle);
+#endif
+
+        auto const first = std::ranges::begin(messages);
+        auto const data = [&](size_t i) {
+            return reinterpret_cast<char const *>(std::ranges::data(first[i]));
+        };
+        auto const size = [&](size_t i) {
+            return std::ranges::size(first[i]) * sizeof(value_type);
+        };
+
+        auto i = 0_uz;
+#if HI_HAS_X86
+        if (has_avx2()) {
+            for (; i + 4 <= r.size(); i += 4) {
+                detail::sip_hash_x4_avx2<C, D>(
+                    {_v0, _v1, _v2, _v3},
+                    {data(i), data(i + 1), data(i + 2), data(i + 3)},
+                    {size(i), size(i + 1), size(i + 2), size(i + 3)},
+                    r.data() + i);
+            }
+        }
+#endif
+
+        for (; i != r.size(); ++i) {
+            r[i] = complete_message(data(i), size(i));
+        }
+    }
+
 private:
     uint64_t _v0;
     uint64_t _v1;
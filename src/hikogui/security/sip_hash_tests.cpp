@@ -6,6 +6,8 @@
 #include<hikotest/hikotest.hpp>
 #include <array>
 #include <string_view>
+#include <vector>
+#include <format>
 
 TEST_SUITE(sip_hash) {
 
@@ -112,6 +114,30 @@ TEST_CASE(standard_vectors_complete_message)
     }
 }
 
+TEST_CASE(standard_vectors_complete_messages)
+{
+    std::array<char, 64> message;
+
+    for (char i = 0; i != 64; ++i) {
+        message[i] = i;
+    }
+
+    // Messages of different lengths in the same batch, the last 3 messages
+    // do not fill a batch of 4.
+    auto messages = std::vector<std::string_view>{};
+    for (size_t i = 0; i != 67; ++i) {
+        messages.emplace_back(message.data(), (i * 7) % 64);
+    }
+
+    auto r = std::vector<uint64_t>(messages.size());
+    auto sh = hi::_sip_hash24{0x0706050403020100, 0x0f0e0d0c0b0a0908};
+    sh.complete_messages(messages, r);
+
+    for (size_t i = 0; i != messages.size(); ++i) {
+        REQUIRE(r[i] == results[(i * 7) % 64], std::format("test vector: {}", (i * 7) % 64));
+    }
+}
+
 TEST_CASE(global)
 {
     std::array<char, 64> message;
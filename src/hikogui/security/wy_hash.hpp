@@ -0,0 +1,137 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#pragma once
+
+#include "../random/random.hpp"
+#include "../numeric/int_carry.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <tuple>
+
+hi_export_module(hikogui.security.wy_hash);
+
+hi_export namespace hi::inline v1 {
+namespace detail {
+
+inline auto wy_hash_seed = seed<uint64_t>{}();
+
+struct wy_hash_seed_tag {};
+
+} // namespace detail
+
+/** A fast non-cryptographic hash.
+ *
+ * Based on wyhash (final version 4), it hashes a message with a handful of
+ * 64x64->128 bit multiplies. It has excellent distribution and is several times
+ * faster than SipHash on short keys.
+ *
+ * Unlike `sip_hash` it gives no protection against an attacker that crafts
+ * keys that collide on purpose, use it only for trusted internal keys.
+ * @see key_hash, hash_policy
+ */
+class wy_hash {
+public:
+    constexpr wy_hash(wy_hash const&) noexcept = default;
+    constexpr wy_hash(wy_hash&&) noexcept = default;
+    constexpr wy_hash& operator=(wy_hash const&) noexcept = default;
+    constexpr wy_hash& operator=(wy_hash&&) noexcept = default;
+
+    wy_hash(detail::wy_hash_seed_tag) noexcept : wy_hash(detail::wy_hash_seed) {}
+
+    /** Create a wy_hash initialized with the global random seed.
+     */
+    wy_hash() noexcept;
+
+    constexpr explicit wy_hash(uint64_t seed) noexcept : _seed(seed ^ _mix(seed ^ _secret0, _secret1)) {}
+
+    /** Hash a complete message.
+     *
+     * @param data The data to hash.
+     * @param size The size of the data in bytes.
+     * @return The value of the hash.
+     */
+    [[nodiscard]] uint64_t complete_message(void const *data, size_t size) const noexcept
+    {
+        auto const *p = static_cast<char const *>(data);
+        hi_axiom(p != nullptr or size == 0);
+
+        auto seed = _seed;
+        auto a = uint64_t{};
+        auto b = uint64_t{};
+        if (size <= 16) [[likely]] {
+            if (size >= 4) [[likely]] {
+                // Two overlapping pairs of 32 bit words cover 4 to 16 bytes.
+                auto const offset = (size >> 3) << 2;
+                a = (wide_cast<uint64_t>(load_le<uint32_t>(p)) << 32) | load_le<uint32_t>(p + offset);
+                b = (wide_cast<uint64_t>(load_le<uint32_t>(p + size - 4)) << 32) | load_le<uint32_t>(p + size - 4 - offset);
+            } else if (size > 0) {
+                a = (char_cast<uint64_t>(p[0]) << 16) | (char_cast<uint64_t>(p[size >> 1]) << 8) | char_cast<uint64_t>(p[size - 1]);
+            }
+
+        } else {
+            auto todo = size;
+            if (todo >= 48) [[unlikely]] {
+                auto seed1 = seed;
+                auto seed2 = seed;
+                do {
+                    seed = _mix(load_le<uint64_t>(p) ^ _secret1, load_le<uint64_t>(p + 8) ^ seed);
+                    seed1 = _mix(load_le<uint64_t>(p + 16) ^ _secret2, load_le<uint64_t>(p + 24) ^ seed1);
+                    seed2 = _mix(load_le<uint64_t>(p + 32) ^ _secret3, load_le<uint64_t>(p + 40) ^ seed2);
+                    p += 48;
+                    todo -= 48;
+                } while (todo >= 48);
+                seed ^= seed1 ^ seed2;
+            }
+
+            while (todo > 16) {
+                seed = _mix(load_le<uint64_t>(p) ^ _secret1, load_le<uint64_t>(p + 8) ^ seed);
+                p += 16;
+                todo -= 16;
+            }
+
+            // The last 16 bytes, which may overlap with bytes already hashed.
+            a = load_le<uint64_t>(p + todo - 16);
+            b = load_le<uint64_t>(p + todo - 8);
+        }
+
+        std::tie(a, b) = mul_carry(a ^ _secret1, b ^ seed);
+        return _mix(a ^ _secret0 ^ size, b ^ _secret1);
+    }
+
+    /** Hash a complete message.
+     *
+     * @see complete_message()
+     */
+    [[nodiscard]] uint64_t operator()(void const *data, size_t size) const noexcept
+    {
+        return complete_message(data, size);
+    }
+
+private:
+    constexpr static uint64_t _secret0 = 0x2d35'8dcc'aa6c'78a5;
+    constexpr static uint64_t _secret1 = 0x8bb8'4b93'962e'acc9;
+    constexpr static uint64_t _secret2 = 0x4b33'a62e'd433'd4a3;
+    constexpr static uint64_t _secret3 = 0x4d5a'2da5'1de1'aa47;
+
+    uint64_t _seed;
+
+    /** Multiply to 128 bits and fold the result back to 64 bits.
+     */
+    [[nodiscard]] hi_force_inline constexpr static uint64_t _mix(uint64_t a, uint64_t b) noexcept
+    {
+        auto const [lo, hi] = mul_carry(a, b);
+        return lo ^ hi;
+    }
+};
+
+namespace detail {
+inline wy_hash wy_hash_prototype = wy_hash(wy_hash_seed_tag{});
+}
+
+inline wy_hash::wy_hash() noexcept : wy_hash(detail::wy_hash_prototype) {}
+
+} // namespace hi::inline v1
@@ -0,0 +1,91 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "wy_hash.hpp"
+#include "key_hash.hpp"
+#include <hikotest/hikotest.hpp>
+#include <array>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <format>
+
+TEST_SUITE(wy_hash_suite) {
+
+TEST_CASE(complete_message)
+{
+    auto message = std::array<char, 200>{};
+    for (auto i = 0; i != 200; ++i) {
+        message[i] = static_cast<char>(i);
+    }
+
+    auto const h = hi::wy_hash{42};
+    REQUIRE(h(message.data(), 10) == hi::wy_hash{42}(message.data(), 10));
+    REQUIRE(h(message.data(), 10) != hi::wy_hash{43}(message.data(), 10));
+
+    // Every length goes through a different combination of overlapping loads.
+    auto values = std::unordered_set<uint64_t>{};
+    for (std::size_t size = 0; size != message.size(); ++size) {
+        values.insert(h(message.data(), size));
+    }
+    REQUIRE(values.size() == message.size());
+
+    // Every byte of the message contributes to the hash.
+    for (std::size_t size = 1; size != 100; ++size) {
+        auto const expected = h(message.data(), size);
+        for (std::size_t i = 0; i != size; ++i) {
+            auto copy = message;
+            copy[i] ^= 1;
+            REQUIRE(h(copy.data(), size) != expected, std::format("size {}, byte {}", size, i));
+        }
+    }
+}
+
+TEST_CASE(known_answer)
+{
+    // Computed with the upstream `wyhash(message, size, seed, _wyp)` of wyhash final version 4.
+    REQUIRE(hi::wy_hash{0}("", 0) == 0x9322'8a4d'e0ee'c5a2);
+    REQUIRE(hi::wy_hash{1}("a", 1) == 0xc5ba'c3db'1787'13c4);
+    REQUIRE(hi::wy_hash{2}("abc", 3) == 0xa97f'2f7b'1d9b'3314);
+    REQUIRE(hi::wy_hash{3}("message digest", 14) == 0x786d'1f1d'f380'1df4);
+    REQUIRE(hi::wy_hash{4}("abcdefghijklmnopqrstuvwxyz", 26) == 0xdca5'a813'8ad3'7c87);
+
+    // The message is the bytes 0, 1, 2, ...; the sizes are at the edges of each code path.
+    auto message = std::array<char, 100>{};
+    for (auto i = 0; i != 100; ++i) {
+        message[i] = static_cast<char>(i);
+    }
+
+    auto const h = hi::wy_hash{42};
+    REQUIRE(h(message.data(), 0) == 0x2ac4'4db3'deb0'5300);
+    REQUIRE(h(message.data(), 3) == 0xce9d'66a7'9730'7f94);
+    REQUIRE(h(message.data(), 4) == 0xd97d'61b5'206c'8513);
+    REQUIRE(h(message.data(), 16) == 0x9dbc'2356'533b'4014);
+    REQUIRE(h(message.data(), 17) == 0x56e4'6ac1'a917'5c52);
+    REQUIRE(h(message.data(), 48) == 0x8277'17ed'2564'ebb4);
+    REQUIRE(h(message.data(), 49) == 0x7815'fc5b'6d4b'56bc);
+    REQUIRE(h(message.data(), 100) == 0x8ad7'f73a'1668'6981);
+}
+
+TEST_CASE(key_hash)
+{
+    using namespace std::literals;
+
+    auto const secure = hi::key_hash<std::string>{};
+    auto const fast = hi::key_hash<std::string, hi::hash_policy::fast>{};
+    auto const fast_view = hi::key_hash<std::string_view, hi::hash_policy::fast>{};
+
+    REQUIRE(secure("hello world"s) == hi::_sip_hash24{}("hello world", 11));
+    REQUIRE(fast("hello world"s) == hi::wy_hash{}("hello world", 11));
+    REQUIRE(fast("hello world"s) == fast_view("hello world"sv));
+
+    // Strings of wide characters are hashed completely.
+    auto const fast32 = hi::key_hash<std::u32string, hi::hash_policy::fast>{};
+    REQUIRE(fast32(U"abcd"s) != fast32(U"abce"s));
+
+    auto const fast64 = hi::key_hash<uint64_t, hi::hash_policy::fast>{};
+    REQUIRE(fast64(1) != fast64(2));
+}
+
+};
@@ -40,7 +40,7 @@ public:
 
 protected:
     preferences& _parent;
-    jsonpath _path;
+    jsonpath_plan _path;
 
     /** Encode the value into a datum.
      *
@@ -237,8 +237,11 @@ private:
     std::filesystem::path _location;
 
     /** The data from the preferences file.
+     *
+     * The same paths are read each time a preference is changed; the paths
+     * are compiled once by each item and the lookups are indexed.
      */
-    datum _data;
+    indexed_datum _data;
 
     /** The data was modified.
      * When this flag is true the preferences should be saved.
@@ -275,7 +278,7 @@ private:
     void _save() const noexcept
     {
         try {
-            auto text = format_JSON(_data);
+            auto text = format_JSON(*_data);
 
             auto tmp_location = _location;
             tmp_location += ".tmp";
@@ -305,23 +308,21 @@ private:
 
     /** Write a value to the data.
      */
-    void write(jsonpath const& path, datum const value) noexcept
+    void write(jsonpath_plan const& path, datum value) noexcept
     {
         auto const lock = std::scoped_lock(mutex);
-        auto *v = _data.find_one_or_create(path);
-        if (v == nullptr) {
+        try {
+            if (_data.write(path, std::move(value))) {
+                _modified = true;
+            }
+        } catch (std::domain_error const&) {
             hi_log_fatal("Could not write '{}' to preference file '{}'", path, _location.string());
         }
-
-        if (*v != value) {
-            *v = value;
-            _modified = true;
-        }
     }
 
     /** Read a value from the data.
      */
-    datum read(jsonpath const& path) noexcept
+    datum read(jsonpath_plan const& path) noexcept
     {
         auto const lock = std::scoped_lock(mutex);
         if (auto const *const r = _data.find_one(path)) {
@@ -333,7 +334,7 @@ private:
 
     /** Remove a value from the data.
      */
-    void remove(jsonpath const& path) noexcept
+    void remove(jsonpath_plan const& path) noexcept
     {
         auto const lock = std::scoped_lock(mutex);
         if (_data.remove(path)) {
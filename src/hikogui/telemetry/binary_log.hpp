@@ -0,0 +1,640 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file telemetry/binary_log.hpp A binary sink for log messages.
+ */
+
+#pragma once
+
+#include "../container/container.hpp"
+#include "../concurrency/concurrency.hpp"
+#include "../time/time.hpp"
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+hi_export_module(hikogui.telemetry.binary_log);
+
+hi_export namespace hi { inline namespace v1 {
+namespace detail {
+
+/** The type of an argument as stored in a binary log.
+ */
+enum class binary_log_arg : uint8_t {
+    /** The type can not be stored, the message is formatted before it is stored.
+     */
+    none,
+
+    boolean,
+    character,
+    signed_integer,
+    unsigned_integer,
+    floating_point,
+    string,
+    pointer
+};
+
+template<typename T>
+[[nodiscard]] constexpr binary_log_arg binary_log_arg_of() noexcept
+{
+    if constexpr (std::is_same_v<T, bool>) {
+        return binary_log_arg::boolean;
+    } else if constexpr (std::is_same_v<T, char>) {
+        return binary_log_arg::character;
+    } else if constexpr (
+        std::is_same_v<T, wchar_t> or std::is_same_v<T, char8_t> or std::is_same_v<T, char16_t> or
+        std::is_same_v<T, char32_t>) {
+        return binary_log_arg::none;
+    } else if constexpr (std::is_integral_v<T> and std::is_signed_v<T>) {
+        return binary_log_arg::signed_integer;
+    } else if constexpr (std::is_integral_v<T>) {
+        return binary_log_arg::unsigned_integer;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        return binary_log_arg::floating_point;
+    } else if constexpr (
+        std::is_same_v<T, std::string> or std::is_same_v<T, std::string_view> or std::is_same_v<T, char const *> or
+        std::is_same_v<T, char *>) {
+        return binary_log_arg::string;
+    } else if constexpr (std::is_pointer_v<T>) {
+        return binary_log_arg::pointer;
+    } else {
+        return binary_log_arg::none;
+    }
+}
+
+/** The static information of a log statement.
+ *
+ * This information is written once into the binary log, each message
+ * after that refers to it by id.
+ */
+struct binary_log_definition {
+    std::string_view format;
+    std::string_view source_path;
+    int source_line;
+    std::string_view level_name;
+    bool statistics;
+    std::span<binary_log_arg const> args;
+};
+
+enum class binary_log_record : uint16_t { padding, definition, thread, message };
+
+} // namespace detail
+
+/** A binary sink for log messages.
+ *
+ * Instead of formatting a message, the logger thread stores the id of the
+ * log statement, the time stamp and the raw values of the arguments in a
+ * ring buffer; normally a memory-mapped file, see `make_binary_log_file()`.
+ * The messages are formatted later, by `read_binary_log()`.
+ *
+ * The format string, source location and level of each log statement are
+ * stored once in a definition record, and the name of each thread in a thread
+ * record. When the ring buffer is full the oldest records are overwritten;
+ * definition and thread records are written again when they are needed after
+ * being overwritten.
+ *
+ * The header is updated after each record, so that a log file is
+ * readable even when the application crashed.
+ *
+ * The layout of the ring buffer, all values are little endian:
+ *  - header (64 bytes): magic "hikolog1", capacity, head and tail positions.
+ *  - data (capacity bytes): records aligned to 8 bytes, each record starts with
+ *    a 32 bit size and a 16 bit record type.
+ */
+class binary_log_sink {
+public:
+    constexpr static std::size_t header_size = 64;
+    constexpr static std::size_t minimum_capacity = 65536;
+
+    binary_log_sink(binary_log_sink const&) = delete;
+    binary_log_sink(binary_log_sink&&) = delete;
+    binary_log_sink& operator=(binary_log_sink const&) = delete;
+    binary_log_sink& operator=(binary_log_sink&&) = delete;
+
+    /** Create a binary log sink in memory.
+     *
+     * @param buffer The memory to write the ring buffer into, including the header.
+     * @param owner An optional object that keeps @a buffer alive, like a memory-mapping.
+     */
+    binary_log_sink(std::span<std::byte> buffer, std::shared_ptr<void> owner = nullptr) noexcept :
+        _buffer(buffer), _owner(std::move(owner)), _capacity(floor(buffer.size() - header_size, std::size_t{8}))
+    {
+        hi_assert(buffer.size() >= header_size + minimum_capacity);
+
+        std::memcpy(_buffer.data(), magic.data(), magic.size());
+        store_le(uint64_t{_capacity}, _buffer.data() + 8);
+        store_header();
+    }
+
+    /** The number of bytes in the ring buffer.
+     */
+    [[nodiscard]] std::size_t capacity() const noexcept
+    {
+        return _capacity;
+    }
+
+    /** Write a log message.
+     *
+     * @param definition The static information of the log statement.
+     * @param time_stamp The time stamp, including the thread id, of the message.
+     * @param args The values of the arguments of the format string.
+     */
+    template<typename... Args>
+    void write(detail::binary_log_definition const& definition, time_stamp_count const& time_stamp, Args const&...args) noexcept
+    {
+        hi_axiom(sizeof...(Args) == definition.args.size());
+
+        auto const id = definition_id(definition);
+        write_thread(time_stamp.thread_id());
+
+        // Limit strings so that a message always fits in a quarter of the ring buffer.
+        auto const max_string_size = _capacity / (8 * (sizeof...(Args) + 1));
+
+        auto const size = 32 + (arg_size(args, max_string_size) + ... + 0);
+        auto *ptr = reserve(detail::binary_log_record::message, size);
+        store_le(id, ptr + 8);
+        store_le(uint32_t{time_stamp.thread_id()}, ptr + 12);
+        store_le(narrow_cast<int64_t>(time_stamp_utc::make(time_stamp).time_since_epoch().count()), ptr + 16);
+        store_le(truncate<int32_t>(time_stamp.cpu_id()), ptr + 24);
+
+        ptr += 32;
+        ((ptr = store_arg(ptr, args, max_string_size)), ...);
+        commit(size);
+    }
+
+private:
+    constexpr static auto magic = std::array<char, 8>{'h', 'i', 'k', 'o', 'l', 'o', 'g', '1'};
+
+    struct definition_state {
+        uint32_t id;
+        uint64_t position;
+    };
+
+    std::span<std::byte> _buffer;
+    std::shared_ptr<void> _owner;
+    std::size_t _capacity;
+
+    /** The position, since the start of the log, where the next record is written.
+     */
+    uint64_t _head = 0;
+
+    /** The position, since the start of the log, of the oldest record.
+     */
+    uint64_t _tail = 0;
+
+    std::unordered_map<detail::binary_log_definition const *, definition_state> _definitions;
+    std::unordered_map<thread_id, uint64_t> _threads;
+
+    void store_header() noexcept
+    {
+        store_le(_head, _buffer.data() + 16);
+        store_le(_tail, _buffer.data() + 24);
+    }
+
+    [[nodiscard]] std::byte *at(uint64_t position) noexcept
+    {
+        return _buffer.data() + header_size + position % _capacity;
+    }
+
+    /** Reserve a contiguous record in the ring buffer.
+     *
+     * Old records are removed to make room.
+     *
+     * @param type The type of record.
+     * @param size The size of the record, excluding alignment.
+     * @return A pointer to the record.
+     */
+    [[nodiscard]] std::byte *reserve(detail::binary_log_record type, std::size_t size) noexcept
+    {
+        size = ceil(size, std::size_t{8});
+        hi_axiom(size <= _capacity / 4);
+
+        if (auto const todo = _capacity - _head % _capacity; todo < size) {
+            // Records do not wrap around the end of the ring buffer.
+            make_room(todo);
+            store_record_header(at(_head), detail::binary_log_record::padding, todo);
+            _head += todo;
+            store_header();
+        }
+
+        make_room(size);
+        auto *const ptr = at(_head);
+        store_record_header(ptr, type, size);
+        return ptr;
+    }
+
+    /** Finish writing the record that was reserved.
+     */
+    void commit(std::size_t size) noexcept
+    {
+        _head += ceil(size, std::size_t{8});
+        store_header();
+    }
+
+    void make_room(std::size_t size) noexcept
+    {
+        while (_head + size - _tail > _capacity) {
+            _tail += load_le<uint32_t>(at(_tail));
+        }
+    }
+
+    static void store_record_header(std::byte *ptr, detail::binary_log_record type, std::size_t size) noexcept
+    {
+        store_le(narrow_cast<uint32_t>(size), ptr);
+        store_le(std::to_underlying(type), ptr + 4);
+        store_le(uint16_t{0}, ptr + 6);
+    }
+
+    [[nodiscard]] static std::byte *store_string(std::byte *ptr, std::string_view str) noexcept
+    {
+        store_le(narrow_cast<uint32_t>(str.size()), ptr);
+        std::memcpy(ptr + 4, str.data(), str.size());
+        return ptr + 4 + str.size();
+    }
+
+    /** Check if a definition or thread record needs to be written again.
+     *
+     * Records are written again when they are more than a quarter of the ring
+     * buffer behind the head. The records written for a single message are much
+     * smaller than a quarter of the ring buffer, so a message can not overwrite the
+     * records it refers to.
+     *
+     * @param position The position of the record.
+     */
+    [[nodiscard]] bool is_stale(uint64_t position) const noexcept
+    {
+        return position + _capacity / 4 < _head;
+    }
+
+    /** Get the id of a definition, writing the definition record when needed.
+     */
+    [[nodiscard]] uint32_t definition_id(detail::binary_log_definition const& definition) noexcept
+    {
+        auto [it, inserted] = _definitions.try_emplace(&definition, narrow_cast<uint32_t>(_definitions.size()), 0);
+        if (not inserted and not is_stale(it->second.position)) {
+            return it->second.id;
+        }
+
+        auto const size = 18 + definition.args.size() + 4 + definition.format.size() + 4 + definition.source_path.size() +
+            4 + definition.level_name.size();
+
+        auto *ptr = reserve(detail::binary_log_record::definition, size);
+        it->second.position = _head;
+        store_le(it->second.id, ptr + 8);
+        store_le(narrow_cast<int32_t>(definition.source_line), ptr + 12);
+        ptr[16] = static_cast<std::byte>(definition.statistics);
+        ptr[17] = static_cast<std::byte>(definition.args.size());
+        ptr += 18;
+        for (auto const arg : definition.args) {
+            *ptr++ = static_cast<std::byte>(arg);
+        }
+        ptr = store_string(ptr, definition.format);
+        ptr = store_string(ptr, definition.source_path);
+        ptr = store_string(ptr, definition.level_name);
+        commit(size);
+        return it->second.id;
+    }
+
+    /** Write the name of a thread, when needed.
+     */
+    void write_thread(thread_id id) noexcept
+    {
+        auto [it, inserted] = _threads.try_emplace(id, 0);
+        if (not inserted and not is_stale(it->second)) {
+            return;
+        }
+
+        auto const name = get_thread_name(id);
+        auto const size = 12 + 4 + name.size();
+
+        auto *ptr = reserve(detail::binary_log_record::thread, size);
+        it->second = _head;
+        store_le(uint32_t{id}, ptr + 8);
+        ptr = store_string(ptr + 12, name);
+        commit(size);
+    }
+
+    template<typename T>
+    [[nodiscard]] static std::size_t arg_size(T const& arg, std::size_t max_string_size) noexcept
+    {
+        constexpr auto type = detail::binary_log_arg_of<T>();
+        static_assert(type != detail::binary_log_arg::none);
+
+        if constexpr (type == detail::binary_log_arg::boolean or type == detail::binary_log_arg::character) {
+            return 1;
+        } else if constexpr (type == detail::binary_log_arg::string) {
+            return 4 + std::min(std::string_view{arg}.size(), max_string_size);
+        } else {
+            return 8;
+        }
+    }
+
+    template<typename T>
+    [[nodiscard]] static std::byte *store_arg(std::byte *ptr, T const& arg, std::size_t max_string_size) noexcept
+    {
+        constexpr auto type = detail::binary_log_arg_of<T>();
+
+        if constexpr (type == detail::binary_log_arg::boolean) {
+            *ptr = static_cast<std::byte>(arg);
+            return ptr + 1;
+        } else if constexpr (type == detail::binary_log_arg::character) {
+            *ptr = static_cast<std::byte>(arg);
+            return ptr + 1;
+        } else if constexpr (type == detail::binary_log_arg::signed_integer) {
+            store_le(static_cast<int64_t>(arg), ptr);
+            return ptr + 8;
+        } else if constexpr (type == detail::binary_log_arg::unsigned_integer) {
+            store_le(static_cast<uint64_t>(arg), ptr);
+            return ptr + 8;
+        } else if constexpr (type == detail::binary_log_arg::floating_point) {
+            store_le(std::bit_cast<uint64_t>(static_cast<double>(arg)), ptr);
+            return ptr + 8;
+        } else if constexpr (type == detail::binary_log_arg::string) {
+            auto const str = std::string_view{arg};
+            return store_string(ptr, str.substr(0, std::min(str.size(), max_string_size)));
+        } else if constexpr (type == detail::binary_log_arg::pointer) {
+            store_le(static_cast<uint64_t>(std::bit_cast<uintptr_t>(arg)), ptr);
+            return ptr + 8;
+        } else {
+            hi_static_no_default();
+        }
+    }
+};
+
+/** A log message read back from a binary log.
+ */
+struct binary_log_entry {
+    utc_nanoseconds time_point;
+    hi::thread_id thread;
+    std::string thread_name;
+    int cpu_id;
+    std::string level_name;
+    std::string source_path;
+    int source_line;
+    bool statistics;
+
+    /** The formatted message.
+     */
+    std::string text;
+
+    /** Format the entry in the same way as the console logger.
+     */
+    [[nodiscard]] friend std::string to_string(binary_log_entry const& rhs) noexcept
+    {
+        auto const sys_time_point = std::chrono::clock_cast<std::chrono::system_clock>(rhs.time_point);
+        auto const local_time_point = cached_current_zone().to_local(sys_time_point);
+
+        if (rhs.statistics) {
+            return std::format("{} {}({}) {:5} {}", local_time_point, rhs.thread_name, rhs.cpu_id, rhs.level_name, rhs.text);
+        } else {
+            auto const source_filename = std::filesystem::path{rhs.source_path}.filename().generic_string();
+            return std::format(
+                "{} {}({}) {:5} {} ({}:{})",
+                local_time_point,
+                rhs.thread_name,
+                rhs.cpu_id,
+                rhs.level_name,
+                rhs.text,
+                source_filename,
+                rhs.source_line);
+        }
+    }
+};
+
+namespace detail {
+
+using binary_log_value = std::variant<bool, char, int64_t, uint64_t, double, std::string_view, void const *>;
+
+/** Format a message from the values read from a binary log.
+ *
+ * Each replacement field is formatted on its own, with its format-spec.
+ *
+ * @param fmt The format string.
+ * @param args The values of the arguments.
+ * @return The formatted message.
+ * @throws parse_error When the format string does not match the arguments.
+ */
+[[nodiscard]] inline std::string binary_log_format(std::string_view fmt, std::span<binary_log_value const> args)
+{
+    auto r = std::string{};
+    auto next_index = 0_uz;
+
+    for (auto i = 0_uz; i != fmt.size(); ++i) {
+        auto const c = fmt[i];
+        if ((c == '{' or c == '}') and i + 1 != fmt.size() and fmt[i + 1] == c) {
+            // Escaped brace.
+            r += c;
+            ++i;
+
+        } else if (c == '{') {
+            auto const last = fmt.find('}', i);
+            hi_check(last != fmt.npos, "Missing '}' in format string.");
+
+            auto const field = fmt.substr(i + 1, last - i - 1);
+            auto const colon = std::min(field.find(':'), field.size());
+
+            auto index = next_index++;
+            if (colon != 0) {
+                auto const [ptr, ec] = std::from_chars(field.data(), field.data() + colon, index);
+                hi_check(ec == std::errc{} and ptr == field.data() + colon, "Invalid argument index in format string.");
+            }
+            hi_check(index < args.size(), "Argument index out of range in format string.");
+
+            auto const spec = std::format("{{{}}}", field.substr(colon));
+            std::visit(
+                [&](auto const& value) {
+                    r += std::vformat(spec, std::make_format_args(value));
+                },
+                args[index]);
+            i = last;
+
+        } else {
+            r += c;
+        }
+    }
+    return r;
+}
+
+class binary_log_parser {
+public:
+    binary_log_parser(bstring_view bytes) noexcept : _bytes(bytes) {}
+
+    [[nodiscard]] std::size_t size() const noexcept
+    {
+        return _bytes.size();
+    }
+
+    template<typename T>
+    [[nodiscard]] T read()
+    {
+        hi_check(_bytes.size() >= sizeof(T), "Binary log record is truncated.");
+        auto const r = load_le<T>(_bytes.data());
+        _bytes = _bytes.substr(sizeof(T));
+        return r;
+    }
+
+    [[nodiscard]] std::string_view read_string()
+    {
+        auto const size = read<uint32_t>();
+        hi_check(_bytes.size() >= size, "Binary log string is truncated.");
+        auto const r = std::string_view{reinterpret_cast<char const *>(_bytes.data()), size};
+        _bytes = _bytes.substr(size);
+        return r;
+    }
+
+    [[nodiscard]] binary_log_value read_value(binary_log_arg type)
+    {
+        switch (type) {
+        case binary_log_arg::boolean:
+            return read<uint8_t>() != 0;
+        case binary_log_arg::character:
+            return char_cast<char>(read<uint8_t>());
+        case binary_log_arg::signed_integer:
+            return read<int64_t>();
+        case binary_log_arg::unsigned_integer:
+            return read<uint64_t>();
+        case binary_log_arg::floating_point:
+            return std::bit_cast<double>(read<uint64_t>());
+        case binary_log_arg::string:
+            return read_string();
+        case binary_log_arg::pointer:
+            return std::bit_cast<void const *>(static_cast<uintptr_t>(read<uint64_t>()));
+        default:
+            throw parse_error("Unknown argument type in binary log.");
+        }
+    }
+
+private:
+    bstring_view _bytes;
+};
+
+} // namespace detail
+
+/** Read the messages from a binary log.
+ *
+ * Messages at the start of the log whose definition was already overwritten
+ * are skipped.
+ *
+ * @param bytes The contents of the binary log; for example from a `file_view`.
+ * @return The messages, from oldest to newest.
+ * @throws parse_error When the binary log is corrupt.
+ */
+[[nodiscard]] inline std::vector<binary_log_entry> read_binary_log(bstring_view bytes)
+{
+    struct definition_type {
+        std::string_view format;
+        std::string_view source_path;
+        int source_line;
+        std::string_view level_name;
+        bool statistics;
+        std::vector<detail::binary_log_arg> args;
+    };
+
+    hi_check(bytes.size() >= binary_log_sink::header_size, "Binary log is too small.");
+    hi_check(std::memcmp(bytes.data(), "hikolog1", 8) == 0, "Not a binary log.");
+
+    auto const capacity = load_le<uint64_t>(bytes.data() + 8);
+    auto const head = load_le<uint64_t>(bytes.data() + 16);
+    auto const tail = load_le<uint64_t>(bytes.data() + 24);
+    hi_check(capacity != 0 and capacity % 8 == 0, "Invalid capacity in binary log.");
+    hi_check(bytes.size() >= binary_log_sink::header_size + capacity, "Binary log is truncated.");
+    hi_check(tail <= head and head - tail <= capacity, "Invalid head and tail in binary log.");
+
+    auto const data = bytes.substr(binary_log_sink::header_size, capacity);
+
+    auto definitions = std::unordered_map<uint32_t, definition_type>{};
+    auto threads = std::unordered_map<thread_id, std::string_view>{};
+    auto values = std::vector<detail::binary_log_value>{};
+    auto r = std::vector<binary_log_entry>{};
+
+    for (auto position = tail; position != head;) {
+        auto const offset = position % capacity;
+        hi_check(capacity - offset >= 8, "Binary log record is truncated.");
+
+        auto const size = load_le<uint32_t>(data.data() + offset);
+        auto const type = static_cast<detail::binary_log_record>(load_le<uint16_t>(data.data() + offset + 4));
+        hi_check(
+            size >= 8 and size % 8 == 0 and size <= capacity - offset and size <= head - position,
+            "Invalid record size in binary log.");
+
+        auto record = detail::binary_log_parser{data.substr(offset + 8, size - 8)};
+        position += size;
+
+        if (type == detail::binary_log_record::definition) {
+            auto const id = record.read<uint32_t>();
+            auto& definition = definitions[id];
+            definition.source_line = record.read<int32_t>();
+            definition.statistics = record.read<uint8_t>() != 0;
+            definition.args.resize(record.read<uint8_t>());
+            for (auto& arg : definition.args) {
+                arg = static_cast<detail::binary_log_arg>(record.read<uint8_t>());
+            }
+            definition.format = record.read_string();
+            definition.source_path = record.read_string();
+            definition.level_name = record.read_string();
+
+        } else if (type == detail::binary_log_record::thread) {
+            auto const id = record.read<uint32_t>();
+            threads[id] = record.read_string();
+
+        } else if (type == detail::binary_log_record::message) {
+            auto const id = record.read<uint32_t>();
+            auto const thread = record.read<uint32_t>();
+            auto const time_since_epoch = record.read<int64_t>();
+            auto const cpu_id = record.read<int32_t>();
+            static_cast<void>(record.read<uint32_t>());
+
+            auto const it = definitions.find(id);
+            if (it == definitions.end()) {
+                continue;
+            }
+            auto const& definition = it->second;
+
+            values.clear();
+            for (auto const arg : definition.args) {
+                values.push_back(record.read_value(arg));
+            }
+
+            auto& entry = r.emplace_back();
+            entry.time_point = utc_nanoseconds{std::chrono::nanoseconds{time_since_epoch}};
+            entry.thread = thread;
+            if (auto const jt = threads.find(thread); jt != threads.end()) {
+                entry.thread_name = jt->second;
+            } else {
+                entry.thread_name = std::format("{}", thread);
+            }
+            entry.cpu_id = cpu_id;
+            entry.level_name = definition.level_name;
+            entry.source_path = definition.source_path;
+            entry.source_line = definition.source_line;
+            entry.statistics = definition.statistics;
+            try {
+                entry.text = detail::binary_log_format(definition.format, values);
+            } catch (std::format_error const&) {
+                // Should not happen, as format strings are checked at compile time.
+                entry.text = definition.format;
+            }
+        }
+    }
+
+    return r;
+}
+
+}} // namespace hi::v1
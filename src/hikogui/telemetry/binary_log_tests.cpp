@@ -0,0 +1,125 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "binary_log.hpp"
+#include "log.hpp"
+#include <hikotest/hikotest.hpp>
+#include <chrono>
+#include <format>
+#include <string>
+
+TEST_SUITE(binary_log_suite) {
+
+using info_message = hi::detail::log_message<
+    hi::global_state_type::log_info,
+    "foo/bar.cpp",
+    42,
+    "hello {} {:.2f} {} {:>4}|{} {:#x}",
+    int,
+    double,
+    std::string,
+    char,
+    bool,
+    unsigned int>;
+
+using counter_message =
+    hi::detail::log_message<hi::global_state_type::log_debug, "foo/bar.cpp", 50, "message {} {}", int, std::string>;
+
+using chrono_message =
+    hi::detail::log_message<hi::global_state_type::log_error, "foo/baz.cpp", 60, "took {}", std::chrono::seconds>;
+
+TEST_CASE(round_trip)
+{
+    auto buffer = hi::bstring(hi::binary_log_sink::header_size + hi::binary_log_sink::minimum_capacity, std::byte{});
+    auto sink = hi::binary_log_sink{buffer};
+
+    auto const message = info_message{5, 2.5, std::string{"world"}, 'x', true, 255u};
+    message.serialize(sink);
+    message.serialize(sink);
+
+    auto const entries = hi::read_binary_log(buffer);
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].text == "hello 5 2.50 world    x|true 0xff");
+    REQUIRE(entries[0].level_name == "info");
+    REQUIRE(entries[0].source_path == "foo/bar.cpp");
+    REQUIRE(entries[0].source_line == 42);
+    REQUIRE(not entries[0].statistics);
+    REQUIRE(entries[1].text == entries[0].text);
+    REQUIRE(entries[0].time_point <= entries[1].time_point);
+
+    // The same layout as the console logger.
+    REQUIRE(to_string(entries[0]).ends_with(" info  hello 5 2.50 world    x|true 0xff (bar.cpp:42)"));
+}
+
+TEST_CASE(formatted_before_storing)
+{
+    auto buffer = hi::bstring(hi::binary_log_sink::header_size + hi::binary_log_sink::minimum_capacity, std::byte{});
+    auto sink = hi::binary_log_sink{buffer};
+
+    // std::chrono::seconds can not be stored in binary form.
+    auto const message = chrono_message{std::chrono::seconds{5}};
+    message.serialize(sink);
+
+    auto const entries = hi::read_binary_log(buffer);
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].text == "took 5s");
+    REQUIRE(entries[0].level_name == "error");
+}
+
+TEST_CASE(wrap_around)
+{
+    auto buffer = hi::bstring(hi::binary_log_sink::header_size + hi::binary_log_sink::minimum_capacity, std::byte{});
+    auto sink = hi::binary_log_sink{buffer};
+
+    auto const info = info_message{5, 2.5, std::string{"world"}, 'x', false, 1u};
+    info.serialize(sink);
+    for (auto i = 0; i != 10'000; ++i) {
+        auto const message = counter_message{i, std::string(i % 100, 'a')};
+        message.serialize(sink);
+    }
+
+    // The oldest messages are overwritten, the rest is in order.
+    auto const entries = hi::read_binary_log(buffer);
+    REQUIRE(entries.size() > 100);
+    REQUIRE(entries.size() < 10'000);
+
+    auto const first = 10'000 - static_cast<int>(entries.size());
+    for (auto i = size_t{0}; i != entries.size(); ++i) {
+        auto const n = first + static_cast<int>(i);
+        auto const expected = std::format("message {} {}", n, std::string(n % 100, 'a'));
+        REQUIRE(entries[i].text == expected);
+        REQUIRE(entries[i].source_line == 50);
+    }
+}
+
+TEST_CASE(long_string)
+{
+    auto buffer = hi::bstring(hi::binary_log_sink::header_size + hi::binary_log_sink::minimum_capacity, std::byte{});
+    auto sink = hi::binary_log_sink{buffer};
+
+    // Strings are truncated so that a message fits in the ring buffer.
+    auto const message = counter_message{1, std::string(100'000, 'a')};
+    message.serialize(sink);
+
+    auto const entries = hi::read_binary_log(buffer);
+    REQUIRE(entries.size() == 1);
+    REQUIRE(entries[0].text.starts_with("message 1 aaaa"));
+    REQUIRE(entries[0].text.size() < hi::binary_log_sink::minimum_capacity / 4);
+}
+
+TEST_CASE(corrupt)
+{
+    REQUIRE_THROWS(hi::read_binary_log(hi::bstring(100, std::byte{})), hi::parse_error);
+
+    auto buffer = hi::bstring(hi::binary_log_sink::header_size + hi::binary_log_sink::minimum_capacity, std::byte{});
+    auto sink = hi::binary_log_sink{buffer};
+    auto const message = counter_message{1, std::string{"a"}};
+    message.serialize(sink);
+
+    // The size of the first record is invalid.
+    buffer[hi::binary_log_sink::header_size] = std::byte{3};
+    REQUIRE_THROWS(hi::read_binary_log(buffer), hi::parse_error);
+}
+
+};
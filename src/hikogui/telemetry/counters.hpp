@@ -8,6 +8,7 @@
 #pragma once
 
 #include "log.hpp"
+#include "histogram.hpp"
 #include "../utility/utility.hpp"
 #include "../concurrency/concurrency.hpp"
 #include "../concurrency/unfair_mutex.hpp" // XXX #616
@@ -75,8 +76,19 @@ public:
     static void log_header() noexcept
     {
         hi_log_statistics("");
-        hi_log_statistics("{:>18} {:>9} {:>10} {:>10} {:>10}", "total", "delta", "min", "max", "mean");
-        hi_log_statistics("------------------ --------- ---------- ---------- ----------");
+        hi_log_statistics(
+            "{:>18} {:>9} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10}",
+            "total",
+            "delta",
+            "min",
+            "max",
+            "mean",
+            "p50",
+            "p90",
+            "p99",
+            "p99.9");
+        hi_log_statistics(
+            "------------------ --------- ---------- ---------- ---------- ---------- ---------- ---------- ----------");
     }
 
     /** Log the counter.
@@ -94,21 +106,42 @@ public:
                 _duration_min.exchange(std::numeric_limits<uint64_t>::max(), std::memory_order::relaxed));
 
             auto const duration_avg = _duration_avg.exchange(0, std::memory_order::relaxed);
-            if (duration_avg == 0) {
-                hi_log_statistics("{:>18} {:>+9} {:10} {:10} {:10} {}", total_count, delta_count, "", "", "", tag);
+            auto const durations_ptr = _durations.get(std::memory_order::acquire);
+            if (duration_avg == 0 or durations_ptr == nullptr) {
+                hi_log_statistics(
+                    "{:>18} {:>+9} {:10} {:10} {:10} {:10} {:10} {:10} {:10} {}",
+                    total_count,
+                    delta_count,
+                    "",
+                    "",
+                    "",
+                    "",
+                    "",
+                    "",
+                    "",
+                    tag);
 
             } else {
                 auto const avg_count = duration_avg & 0xffff;
                 auto const avg_sum = duration_avg >> 16;
                 auto const average = time_stamp_count::duration_from_count(avg_sum / avg_count);
 
+                auto const durations = durations_ptr->take();
+                auto const percentile = [&durations](double fraction) {
+                    return format_engineering(time_stamp_count::duration_from_count(durations.percentile(fraction)));
+                };
+
                 hi_log_statistics(
-                    "{:18d} {:+9d} {:>10} {:>10} {:>10} {}",
+                    "{:18d} {:+9d} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {:>10} {}",
                     total_count,
                     delta_count,
                     format_engineering(duration_min),
                     format_engineering(duration_max),
                     format_engineering(average),
+                    percentile(0.5),
+                    percentile(0.9),
+                    percentile(0.99),
+                    percentile(0.999),
                     tag);
             }
         }
@@ -145,10 +178,25 @@ public:
         return _total_count.fetch_sub(1, std::memory_order::relaxed);
     }
 
+    /** Get the distribution of the durations added since the last time the counter was logged.
+     *
+     * @return A histogram of durations in time-stamp-count ticks.
+     */
+    [[nodiscard]] histogram_snapshot durations() const noexcept
+    {
+        if (auto const durations_ptr = _durations.get(std::memory_order::acquire)) {
+            return durations_ptr->snapshot();
+        } else {
+            return {};
+        }
+    }
+
     /** Add a duration.
      */
     void add_duration(uint64_t duration) noexcept
     {
+        _durations.get_or_make().add(duration);
+
         _total_count.fetch_add(1, std::memory_order::relaxed);
         fetch_max(_duration_max, duration, std::memory_order::relaxed);
         fetch_min(_duration_min, duration, std::memory_order::relaxed);
@@ -180,6 +228,10 @@ protected:
      * - [63:10] Sum.
      */
     std::atomic<uint64_t> _duration_avg = 0;
+
+    /** The distribution of the durations, allocated on the first duration added.
+     */
+    atomic_unique_ptr<histogram> _durations;
 };
 
 template<fixed_string Tag>
@@ -35,4 +35,18 @@ TEST_CASE(search_and_read)
     REQUIRE(*hi::get_global_counter_if("bar_b") == 2);
 }
 
-};
\ No newline at end of file
+TEST_CASE(duration_percentiles)
+{
+    for (auto i = uint64_t{1}; i <= 100; ++i) {
+        hi::global_counter<"foo_c">.add_duration(i * 1000);
+    }
+
+    auto const durations = hi::global_counter<"foo_c">.durations();
+    REQUIRE(durations.size() == 100);
+    REQUIRE(durations.percentile(0.5) >= 50'000);
+    REQUIRE(durations.percentile(0.5) < 52'000);
+    REQUIRE(durations.percentile(0.99) >= 99'000);
+    REQUIRE(durations.percentile(0.99) < 101'000);
+}
+
+};
@@ -62,6 +62,27 @@ public:
         return std::apply(format_locale_wrapper<Values const &...>, _values);
     }
 
+    /** Format now, into an output iterator.
+     * @param out The output iterator to write the formatted text to.
+     * @return The output iterator past the formatted text.
+     */
+    template<typename OutIt>
+    OutIt format_to(OutIt out) const noexcept
+    {
+        return std::apply(
+            [&out](Values const &...args) {
+                return std::format_to(out, static_cast<std::string_view>(Fmt), args...);
+            },
+            _values);
+    }
+
+    /** The captured values.
+     */
+    [[nodiscard]] std::tuple<Values...> const &values() const noexcept
+    {
+        return _values;
+    }
+
 private:
     std::tuple<Values...> _values;
 
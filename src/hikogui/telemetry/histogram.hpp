@@ -0,0 +1,242 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file telemetry/histogram.hpp A concurrent histogram for latency percentiles.
+ */
+
+#pragma once
+
+#include "../utility/utility.hpp"
+#include "../macros.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+hi_export_module(hikogui.telemetry : histogram);
+
+hi_export namespace hi::inline v1 {
+
+/** The layout of the buckets of a histogram.
+ *
+ * The buckets are log-linear, like in a HDR-histogram: values below 32 each
+ * have their own bucket; each power-of-two above that is split into 32 linear
+ * buckets. The width of a bucket is at most 1/32 of its value, so a value read
+ * back from the histogram is within about 3% of the values that were added.
+ */
+struct histogram_buckets {
+    constexpr static std::size_t sub_bucket_bits = 5;
+    constexpr static std::size_t sub_bucket_count = std::size_t{1} << sub_bucket_bits;
+
+    /** The number of significant bits in a value.
+     * Larger values are counted in the last bucket.
+     */
+    constexpr static std::size_t value_bits = 40;
+
+    constexpr static std::size_t count = (value_bits - sub_bucket_bits + 1) * sub_bucket_count;
+
+    /** Get the index of the bucket for a value.
+     */
+    [[nodiscard]] constexpr static std::size_t index(uint64_t value) noexcept
+    {
+        if (value < sub_bucket_count) {
+            return narrow_cast<std::size_t>(value);
+        }
+
+        auto const width = narrow_cast<std::size_t>(std::bit_width(value));
+        if (width > value_bits) {
+            return count - 1;
+        }
+
+        auto const shift = width - sub_bucket_bits - 1;
+        return (shift + 1) * sub_bucket_count + narrow_cast<std::size_t>(value >> shift) - sub_bucket_count;
+    }
+
+    /** The lowest value that is counted in a bucket.
+     */
+    [[nodiscard]] constexpr static uint64_t lowest(std::size_t index) noexcept
+    {
+        hi_axiom(index < count);
+
+        if (index < sub_bucket_count) {
+            return index;
+        }
+
+        auto const shift = index / sub_bucket_count - 1;
+        return wide_cast<uint64_t>(index % sub_bucket_count + sub_bucket_count) << shift;
+    }
+
+    /** The highest value that is counted in a bucket.
+     */
+    [[nodiscard]] constexpr static uint64_t highest(std::size_t index) noexcept
+    {
+        hi_axiom(index < count);
+
+        if (index < sub_bucket_count) {
+            return index;
+        }
+
+        auto const shift = index / sub_bucket_count - 1;
+        return lowest(index) + (uint64_t{1} << shift) - 1;
+    }
+};
+
+/** A copy of the counts of a histogram.
+ */
+class histogram_snapshot {
+public:
+    constexpr histogram_snapshot() noexcept = default;
+
+    /** The number of values in the histogram.
+     */
+    [[nodiscard]] constexpr uint64_t size() const noexcept
+    {
+        return _size;
+    }
+
+    [[nodiscard]] constexpr bool empty() const noexcept
+    {
+        return _size == 0;
+    }
+
+    /** The number of values in a bucket.
+     */
+    [[nodiscard]] constexpr uint64_t operator[](std::size_t index) const noexcept
+    {
+        hi_axiom(index < histogram_buckets::count);
+        return _counts[index];
+    }
+
+    /** Get the value at a percentile.
+     *
+     * @param fraction The percentile as a fraction between 0.0 and 1.0, for
+     *                 example 0.99 for the 99th percentile.
+     * @return The highest value of the bucket that contains the percentile, or
+     *         zero when the histogram is empty.
+     */
+    [[nodiscard]] constexpr uint64_t percentile(double fraction) const noexcept
+    {
+        hi_axiom(fraction >= 0.0 and fraction <= 1.0);
+
+        auto const rank = std::max(uint64_t{1}, static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(_size))));
+
+        auto total = uint64_t{0};
+        for (auto i = 0_uz; i != histogram_buckets::count; ++i) {
+            total += _counts[i];
+            if (total >= rank) {
+                return histogram_buckets::highest(i);
+            }
+        }
+        return 0;
+    }
+
+    /** Add the counts of another snapshot.
+     */
+    constexpr histogram_snapshot& operator+=(histogram_snapshot const& rhs) noexcept
+    {
+        for (auto i = 0_uz; i != histogram_buckets::count; ++i) {
+            _counts[i] += rhs._counts[i];
+        }
+        _size += rhs._size;
+        return *this;
+    }
+
+    /** Add a number of values to a bucket.
+     */
+    constexpr void add(std::size_t index, uint64_t count) noexcept
+    {
+        hi_axiom(index < histogram_buckets::count);
+        _counts[index] += count;
+        _size += count;
+    }
+
+private:
+    std::array<uint64_t, histogram_buckets::count> _counts = {};
+    uint64_t _size = 0;
+};
+
+/** A histogram that can be updated concurrently from many threads.
+ *
+ * The counts are sharded; each thread adds its values to one of the shards
+ * with relaxed atomic increments, so that threads do not share cache-lines
+ * for the common case. The shards are merged when the histogram is read.
+ *
+ * @see histogram_buckets for the resolution of the values.
+ */
+class histogram {
+public:
+    constexpr static std::size_t num_shards = 8;
+
+    histogram(histogram const&) = delete;
+    histogram(histogram&&) = delete;
+    histogram& operator=(histogram const&) = delete;
+    histogram& operator=(histogram&&) = delete;
+
+    constexpr histogram() noexcept = default;
+
+    /** Add a value to the histogram.
+     */
+    void add(uint64_t value) noexcept
+    {
+        _shards[shard_index()].counts[histogram_buckets::index(value)].fetch_add(1, std::memory_order::relaxed);
+    }
+
+    /** Merge the shards into a snapshot.
+     */
+    [[nodiscard]] histogram_snapshot snapshot() const noexcept
+    {
+        auto r = histogram_snapshot{};
+        for (auto const& shard : _shards) {
+            for (auto i = 0_uz; i != histogram_buckets::count; ++i) {
+                if (auto const count = shard.counts[i].load(std::memory_order::relaxed)) {
+                    r.add(i, count);
+                }
+            }
+        }
+        return r;
+    }
+
+    /** Merge the shards into a snapshot, and reset the histogram.
+     *
+     * Values that are added concurrently are either in the snapshot, or
+     * remain in the histogram; none are lost.
+     */
+    [[nodiscard]] histogram_snapshot take() noexcept
+    {
+        auto r = histogram_snapshot{};
+        for (auto& shard : _shards) {
+            for (auto i = 0_uz; i != histogram_buckets::count; ++i) {
+                if (shard.counts[i].load(std::memory_order::relaxed) != 0) {
+                    r.add(i, shard.counts[i].exchange(0, std::memory_order::relaxed));
+                }
+            }
+        }
+        return r;
+    }
+
+private:
+    struct alignas(64) shard_type {
+        /** The counts for each bucket.
+         * 32 bits is enough, since the counters are taken and reset periodically.
+         */
+        std::array<std::atomic<uint32_t>, histogram_buckets::count> counts = {};
+    };
+
+    std::array<shard_type, num_shards> _shards = {};
+
+    inline static std::atomic<std::size_t> _next_shard_index = 0;
+
+    /** The shard used by the current thread, assigned round-robin on first use.
+     */
+    [[nodiscard]] static std::size_t shard_index() noexcept
+    {
+        thread_local auto const index = _next_shard_index.fetch_add(1, std::memory_order::relaxed) % num_shards;
+        return index;
+    }
+};
+
+} // namespace hi::inline v1
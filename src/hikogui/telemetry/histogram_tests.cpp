@@ -0,0 +1,102 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "histogram.hpp"
+#include <hikotest/hikotest.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST_SUITE(histogram_suite) {
+
+TEST_CASE(buckets)
+{
+    for (auto i = std::size_t{0}; i != hi::histogram_buckets::count; ++i) {
+        auto const lowest = hi::histogram_buckets::lowest(i);
+        auto const highest = hi::histogram_buckets::highest(i);
+        REQUIRE(hi::histogram_buckets::index(lowest) == i);
+        REQUIRE(hi::histogram_buckets::index(highest) == i);
+
+        if (i + 1 != hi::histogram_buckets::count) {
+            REQUIRE(hi::histogram_buckets::lowest(i + 1) == highest + 1);
+        }
+    }
+
+    REQUIRE(hi::histogram_buckets::index(0) == 0);
+    REQUIRE(hi::histogram_buckets::index(31) == 31);
+    REQUIRE(hi::histogram_buckets::index(32) == 32);
+    REQUIRE(hi::histogram_buckets::index(64) == 64);
+    REQUIRE(hi::histogram_buckets::index(66) == 65);
+    REQUIRE(hi::histogram_buckets::index(UINT64_MAX) == hi::histogram_buckets::count - 1);
+}
+
+TEST_CASE(percentile)
+{
+    auto h = std::make_unique<hi::histogram>();
+    REQUIRE(h->snapshot().empty());
+    REQUIRE(h->snapshot().percentile(0.5) == 0);
+
+    for (auto i = uint64_t{1}; i <= 10'000; ++i) {
+        h->add(i);
+    }
+
+    auto const s = h->snapshot();
+    REQUIRE(s.size() == 10'000);
+    REQUIRE(s.percentile(0.0) == 1);
+
+    // The value of a percentile is the top of its bucket, at most ~3% higher.
+    auto const near = [&s](double fraction, uint64_t expected) {
+        auto const value = s.percentile(fraction);
+        return value >= expected and value <= expected + expected / 32;
+    };
+    REQUIRE(near(0.5, 5'000));
+    REQUIRE(near(0.9, 9'000));
+    REQUIRE(near(0.99, 9'900));
+    REQUIRE(near(0.999, 9'990));
+    REQUIRE(s.percentile(1.0) >= 10'000);
+}
+
+TEST_CASE(take)
+{
+    auto h = std::make_unique<hi::histogram>();
+    h->add(10);
+    h->add(20);
+    h->add(20);
+
+    auto const s = h->take();
+    REQUIRE(s.size() == 3);
+    REQUIRE(s[hi::histogram_buckets::index(10)] == 1);
+    REQUIRE(s[hi::histogram_buckets::index(20)] == 2);
+    REQUIRE(h->snapshot().empty());
+}
+
+TEST_CASE(threads)
+{
+    auto h = std::make_unique<hi::histogram>();
+
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i != 16; ++i) {
+        threads.emplace_back([&h] {
+            for (auto j = uint64_t{0}; j != 10'000; ++j) {
+                h->add(j);
+            }
+        });
+    }
+
+    auto total = uint64_t{0};
+    for (auto i = 0; i != 100; ++i) {
+        total += h->take().size();
+    }
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    total += h->take().size();
+
+    REQUIRE(total == 160'000);
+}
+
+};
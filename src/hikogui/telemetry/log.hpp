@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include "binary_log.hpp"
 #include "delayed_format.hpp"
 #include "format_check.hpp"
 #include "../container/container.hpp"
@@ -17,11 +18,13 @@
 #include <string>
 #include <string_view>
 #include <tuple>
+#include <iterator>
 #include <mutex>
 #include <atomic>
 #include <memory>
+#include <vector>
+#include <limits>
 #include <thread>
-#include <filesystem>
 #include <cstdio>
 
 hi_export_module(hikogui.telemetry : log);
@@ -35,8 +38,26 @@ public:
     hi_force_inline log_message_base() noexcept = default;
     virtual ~log_message_base() = default;
 
-    [[nodiscard]] virtual std::string format() const noexcept = 0;
-    [[nodiscard]] virtual std::unique_ptr<log_message_base> make_unique_copy() const noexcept = 0;
+    /** Format the message.
+     *
+     * @param[out] r The string to append the formatted message to.
+     */
+    virtual void format_to(std::string& r) const noexcept = 0;
+
+    [[nodiscard]] std::string format() const noexcept
+    {
+        auto r = std::string{};
+        format_to(r);
+        return r;
+    }
+
+    /** Write the message to a binary sink, without formatting it.
+     */
+    virtual void serialize(binary_log_sink& sink) const noexcept = 0;
+
+    /** The time when the message was logged.
+     */
+    [[nodiscard]] virtual time_stamp_count const& time_stamp() const noexcept = 0;
 };
 
 template<global_state_type Level, fixed_string SourcePath, int SourceLine, fixed_string Fmt, typename... Values>
@@ -66,7 +87,7 @@ public:
     {
     }
 
-    std::string format() const noexcept override
+    void format_to(std::string& r) const noexcept override
     {
         auto const utc_time_point = time_stamp_utc::make(_time_stamp);
         auto const sys_time_point = std::chrono::clock_cast<std::chrono::system_clock>(utc_time_point);
@@ -74,36 +95,114 @@ public:
 
         auto const cpu_id = _time_stamp.cpu_id();
         auto const thread_id = _time_stamp.thread_id();
-        auto const thread_name = get_thread_name(thread_id);
 
-        if constexpr (to_bool(Level & global_state_type::log_statistics)) {
-            return std::format("{} {}({}) {:5} {}", local_time_point, thread_name, cpu_id, log_level_name, _what());
-        } else {
-            auto source_filename = std::filesystem::path{static_cast<std::string_view>(SourcePath)}.filename().generic_string();
-            return std::format(
-                "{} {}({}) {:5} {} ({}:{})",
-                local_time_point,
-                thread_name,
-                cpu_id,
-                log_level_name,
-                _what(),
-                source_filename,
-                SourceLine);
+        std::format_to(std::back_inserter(r), "{} ", local_time_point);
+        append_thread_name(r, thread_id);
+        auto out = std::format_to(std::back_inserter(r), "({}) {:5} ", cpu_id, log_level_name);
+        out = _what.format_to(out);
+
+        if constexpr (not to_bool(Level & global_state_type::log_statistics)) {
+            std::format_to(out, " ({}:{})", source_filename, SourceLine);
         }
     }
 
-    [[nodiscard]] std::unique_ptr<log_message_base> make_unique_copy() const noexcept override
+    [[nodiscard]] time_stamp_count const& time_stamp() const noexcept override
+    {
+        return _time_stamp;
+    }
+
+    void serialize(binary_log_sink& sink) const noexcept override
     {
-        return std::make_unique<log_message>(*this);
+        if constexpr (binary_is_raw) {
+            std::apply(
+                [&](auto const&...values) {
+                    sink.write(binary_definition, _time_stamp, values...);
+                },
+                _what.values());
+        } else {
+            thread_local std::string buffer;
+
+            buffer.clear();
+            _what.format_to(std::back_inserter(buffer));
+            sink.write(binary_definition, _time_stamp, std::string_view{buffer});
+        }
     }
 
 private:
+    /** The filename part of the source path, without allocating a `std::filesystem::path` for each message.
+     */
+    constexpr static std::string_view source_filename = [] {
+        auto const path = static_cast<std::string_view>(SourcePath);
+        auto const i = path.find_last_of("/\\");
+        return i == std::string_view::npos ? path : path.substr(i + 1);
+    }();
+
+    /** All argument values can be stored in a binary log, otherwise the message is formatted first.
+     */
+    constexpr static bool binary_is_raw = ((binary_log_arg_of<Values>() != binary_log_arg::none) and ...);
+
+    constexpr static auto binary_args = []() {
+        if constexpr (binary_is_raw) {
+            return std::array<binary_log_arg, sizeof...(Values)>{binary_log_arg_of<Values>()...};
+        } else {
+            return std::array<binary_log_arg, 1>{binary_log_arg::string};
+        }
+    }();
+
+    constexpr static auto binary_definition = binary_log_definition{
+        binary_is_raw ? static_cast<std::string_view>(Fmt) : std::string_view{"{}"},
+        static_cast<std::string_view>(SourcePath),
+        SourceLine,
+        log_level_name,
+        to_bool(Level & global_state_type::log_statistics),
+        binary_args};
+
     time_stamp_count _time_stamp;
     delayed_format<Fmt, Values...> _what;
 };
 
+/** The queue of log messages of a single thread.
+ */
+struct log_thread_ring {
+    spsc_fifo<log_message_base, 64> fifo;
+
+    /** The number of messages dropped because the fifo was full.
+     */
+    std::atomic<uint64_t> num_dropped = 0;
+
+    /** Set when the thread has exited, the ring is freed once it is empty.
+     */
+    std::atomic<bool> abandoned = false;
+
+    /** The log that owns this ring.
+     */
+    void const *owner;
+
+    /** The thread that writes into this ring.
+     */
+    hi::thread_id thread;
+
+    log_thread_ring(void const *owner, hi::thread_id thread) noexcept : owner(owner), thread(thread) {}
+};
+
 } // namespace detail
 
+/** What to do when a per-thread log queue is full.
+ */
+enum class log_overflow_policy : uint8_t {
+    /** Wait until the logger thread has made room.
+     */
+    block,
+
+    /** Drop the new message.
+     */
+    drop_newest,
+
+    /** Drop the new message and count it, the logger thread reports the number of dropped messages.
+     */
+    drop_with_counter
+};
+
 class log {
 public:
     /** Log a message.
@@ -129,9 +228,26 @@ public:
         // * Will make sure everything gets logged.
         // * Blocking is bad in a real time thread, so maybe count the number of times it is blocked.
 
-        // Emplace a message directly on the queue.
-        _fifo.emplace<detail::log_message<Level, SourcePath, SourceLine, Fmt, forward_value_t<Args>...>>(
-            std::forward<Args>(args)...);
+        using message_type = detail::log_message<Level, SourcePath, SourceLine, Fmt, forward_value_t<Args>...>;
+
+        if (_use_thread_rings.load(std::memory_order::relaxed)) {
+            // Emplace a message on the queue of this thread.
+            auto& ring = thread_ring();
+            auto const policy = _overflow_policy.load(std::memory_order::relaxed);
+            if (policy == log_overflow_policy::block or to_bool(Level & global_state_type::log_fatal)) {
+                ring.fifo.emplace<message_type>(std::forward<Args>(args)...);
+
+            } else if (not ring.fifo.try_emplace<message_type>(std::forward<Args>(args)...)) [[unlikely]] {
+                if (policy == log_overflow_policy::drop_with_counter) {
+                    ring.num_dropped.fetch_add(1, std::memory_order::relaxed);
+                }
+                return;
+            }
+
+        } else {
+            // Emplace a message directly on the queue.
+            _fifo.emplace<message_type>(std::forward<Args>(args)...);
+        }
 
         if (to_bool(Level & global_state_type::log_fatal) or not to_bool(state & global_state_type::log_is_running)) [[unlikely]] {
             // If the logger did not start we will log in degraded mode and log from the current thread.
@@ -143,26 +259,75 @@ public:
     /** Flush all messages from the log_queue directly from this thread.
      * Flushing includes writing the message to a log file or displaying
      * them on the console.
+     *
+     * Messages are taken from the queue in batches and formatted in place into
+     * a per-thread buffer, which keeps its capacity between calls. The buffer is
+     * written after the lock is released.
      */
     hi_no_inline void flush() noexcept
     {
-        bool wrote_message;
+        thread_local std::string buffer;
+
+        std::size_t num_messages;
         do {
-            std::unique_ptr<detail::log_message_base> copy_of_message;
+            buffer.clear();
 
             {
                 auto const lock = std::scoped_lock(_mutex);
 
-                wrote_message = _fifo.take_one([&copy_of_message](auto& message) {
-                    copy_of_message = message.make_unique_copy();
-                });
+                if (_binary_sink) {
+                    // Serialize the message in place, it is formatted later when the binary log is read.
+                    num_messages = take_batch([this](auto& message) {
+                        message.serialize(*_binary_sink);
+                    });
+
+                } else {
+                    num_messages = take_batch([](auto& message) {
+                        message.format_to(buffer);
+                        buffer += '\n';
+                    });
+                }
             }
 
-            if (wrote_message) {
-                hi_assert_not_null(copy_of_message);
-                write(copy_of_message->format());
+            if (not buffer.empty()) {
+                write(buffer);
             }
-        } while (wrote_message);
+        } while (num_messages != 0);
+    }
+
+    /** Give each thread its own queue of log messages.
+     *
+     * By default all threads share a single wait-free fifo, which is claimed
+     * with an atomic fetch-add on every message. With many threads logging
+     * at the same time the contention on this atomic becomes visible.
+     *
+     * With thread rings enabled each thread gets its own single-producer fifo
+     * on the first message it logs. The logger thread merges the messages of
+     * all the rings in order of their time stamp.
+     *
+     * @param enable Use a ring for each thread, or share a single fifo.
+     * @param overflow What to do when the ring of a thread is full. Fatal
+     *                 messages are never dropped.
+     */
+    void set_thread_rings(bool enable, log_overflow_policy overflow = log_overflow_policy::block) noexcept
+    {
+        _overflow_policy.store(overflow, std::memory_order::relaxed);
+        _use_thread_rings.store(enable, std::memory_order::relaxed);
+    }
+
+    /** Write log messages to a binary sink instead of the console.
+     *
+     * Messages already in the queue are written to the previous sink first.
+     *
+     * @param sink The binary sink, see `make_binary_log_file()`. Or nullptr to
+     *             write formatted messages to the console again.
+     */
+    void set_binary_sink(std::shared_ptr<binary_log_sink> sink) noexcept
+    {
+        flush();
+
+        auto const lock = std::scoped_lock(_mutex);
+        _binary_sink = std::move(sink);
     }
 
     /** Start the logger system.
@@ -186,15 +351,131 @@ private:
     /** The global log queue contains messages to be displayed by the logger thread.
      */
     wfree_fifo<detail::log_message_base, 64> _fifo;
+
+    /** The maximum number of messages taken from the queue for each lock of the mutex.
+     */
+    constexpr static std::size_t flush_batch_size = 64;
+
     mutable unfair_mutex _mutex;
 
+    /** When set, messages are serialized to this sink instead of written to the console.
+     */
+    std::shared_ptr<binary_log_sink> _binary_sink;
+
+    std::atomic<bool> _use_thread_rings = false;
+    std::atomic<log_overflow_policy> _overflow_policy = log_overflow_policy::block;
+
+    /** The rings of each thread that has logged a message while thread rings were enabled.
+     * @note Protected by _mutex.
+     */
+    std::vector<std::unique_ptr<detail::log_thread_ring>> _thread_rings;
+
+    /** The ring of the current thread.
+     */
+    static inline thread_local detail::log_thread_ring *_thread_ring = nullptr;
+
+    /** Get the ring of the current thread, register a new one on first use.
+     */
+    hi_force_inline detail::log_thread_ring& thread_ring() noexcept
+    {
+        if (_thread_ring != nullptr and _thread_ring->owner == this) [[likely]] {
+            return *_thread_ring;
+        }
+        return register_thread_ring();
+    }
+
+    hi_no_inline detail::log_thread_ring& register_thread_ring() noexcept
+    {
+        // Mark the ring as abandoned when the thread exits.
+        struct abandon_on_exit {
+            ~abandon_on_exit()
+            {
+                if (_thread_ring != nullptr) {
+                    _thread_ring->abandoned.store(true, std::memory_order::release);
+                    _thread_ring = nullptr;
+                }
+            }
+        };
+        thread_local abandon_on_exit abandon;
+
+        if (_thread_ring != nullptr) {
+            // The thread switched to another log object.
+            _thread_ring->abandoned.store(true, std::memory_order::release);
+        }
+
+        auto ring = std::make_unique<detail::log_thread_ring>(this, current_thread_id());
+        _thread_ring = ring.get();
+
+        auto const lock = std::scoped_lock(_mutex);
+        _thread_rings.push_back(std::move(ring));
+        return *_thread_ring;
+    }
+
+    /** Take a batch of messages from the shared fifo and the thread rings.
+     *
+     * The messages in the thread rings are merged in order of their time stamp.
+     *
+     * @pre _mutex must be locked.
+     * @param func The function to call with each message.
+     * @return The number of messages taken.
+     */
+    template<typename Func>
+    std::size_t take_batch(Func const& func) noexcept
+    {
+        auto num_messages = _fifo.take_n(func, flush_batch_size);
+        if (_thread_rings.empty()) {
+            return num_messages;
+        }
+
+        for (auto const& ring : _thread_rings) {
+            if (auto const num_dropped = ring->num_dropped.exchange(0, std::memory_order::relaxed)) [[unlikely]] {
+                auto const message = detail::log_message<
+                    global_state_type::log_warning,
+                    __FILE__,
+                    __LINE__,
+                    "Dropped {} log messages of thread {}.",
+                    uint64_t,
+                    std::string>{num_dropped, get_thread_name(ring->thread)};
+                func(message);
+                ++num_messages;
+            }
+        }
+
+        for (; num_messages < flush_batch_size; ++num_messages) {
+            detail::log_thread_ring *oldest_ring = nullptr;
+            auto oldest_count = std::numeric_limits<uint64_t>::max();
+            for (auto const& ring : _thread_rings) {
+                if (auto const *message = ring->fifo.front()) {
+                    if (auto const count = message->time_stamp().count(); count <= oldest_count) {
+                        oldest_ring = ring.get();
+                        oldest_count = count;
+                    }
+                }
+            }
+
+            if (oldest_ring == nullptr) {
+                // Free the rings of threads that have exited, after they have been drained.
+                std::erase_if(_thread_rings, [](auto const& ring) {
+                    return ring->abandoned.load(std::memory_order::acquire) and ring->fifo.empty() and
+                        ring->num_dropped.load(std::memory_order::relaxed) == 0;
+                });
+                break;
+            }
+
+            oldest_ring->fifo.take_one(func);
+        }
+        return num_messages;
+    }
+
     /** Write to a log file and console.
      * This will write to the console if one is open.
      * It will also create a log file in the application-data directory.
+     *
+     * @param str One or more lines of text, each terminated by a new-line.
      */
     void write(std::string const& str) const noexcept
     {
-        std::println(stderr, "{}", str);
+        std::fwrite(str.data(), 1, str.size(), stderr);
     }
 
     /** The global logger thread.
@@ -1,10 +1,13 @@
 
 #pragma once
 
+#include "binary_log.hpp" // export
 #include "counters.hpp" // export
 #include "delayed_format.hpp" // export
 #include "format_check.hpp" // export
+#include "histogram.hpp" // export
 #include "log.hpp" // export
 #include "trace.hpp" // export
+#include "trace_recorder.hpp" // export
 
 hi_export_module(hikogui.telemetry);
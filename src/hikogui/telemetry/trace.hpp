@@ -7,10 +7,12 @@
 #include "../utility/utility.hpp"
 #include "../time/time.hpp"
 #include "counters.hpp"
+#include "trace_recorder.hpp"
 #include "../macros.hpp"
 #include <array>
 #include <tuple>
 #include <exception>
+#include <string_view>
 
 hi_export_module(hikogui.telemetry : trace);
 
@@ -52,6 +54,10 @@ public:
 
         auto const current_time_stamp = time_stamp_count{time_stamp_count::inplace{}};
         global_counter<Tag>.add_duration(current_time_stamp.count() - _time_stamp.count());
+
+        if (trace_recorder::is_recording()) [[unlikely]] {
+            trace_recorder::record(static_cast<std::string_view>(Tag), _time_stamp.count());
+        }
     }
 
     void log() const noexcept override
@@ -0,0 +1,353 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+/** @file telemetry/trace_recorder.hpp Record trace scopes for a flame-chart.
+ */
+
+#pragma once
+
+#include "../utility/utility.hpp"
+#include "../concurrency/concurrency.hpp"
+#include "../concurrency/unfair_mutex.hpp" // XXX #616
+#include "../time/time.hpp"
+#include "log.hpp"
+#include "../macros.hpp"
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+hi_export_module(hikogui.telemetry : trace_recorder);
+
+hi_export namespace hi::inline v1 {
+namespace detail {
+
+/** A single trace scope that has finished.
+ */
+struct trace_event {
+    /** The name of the trace, a string with static storage duration.
+     */
+    std::string_view name;
+
+    /** The time stamp count at the start of the scope.
+     */
+    uint64_t begin;
+
+    /** The time stamp at the end of the scope, including the CPU id.
+     */
+    time_stamp_count end;
+};
+
+/** The events recorded by a single thread.
+ *
+ * This is a single-producer/single-consumer ring buffer; the thread is the
+ * producer, the thread that exports the trace is the consumer.
+ */
+class trace_thread_buffer {
+public:
+    constexpr static std::size_t capacity = 16384;
+
+    /** Set when the thread has exited, the buffer is freed once it is empty.
+     */
+    std::atomic<bool> abandoned = false;
+
+    /** The number of events dropped because the buffer was full.
+     */
+    std::atomic<uint64_t> num_dropped = 0;
+
+    /** The thread that writes into this buffer.
+     */
+    hi::thread_id thread;
+
+    explicit trace_thread_buffer(hi::thread_id thread) noexcept : thread(thread) {}
+
+    /** Add an event.
+     *
+     * @note Must be called on the thread that owns the buffer.
+     */
+    void push(trace_event const& event) noexcept
+    {
+        auto const head = _head.load(std::memory_order::relaxed);
+        if (head - _tail.load(std::memory_order::acquire) == capacity) [[unlikely]] {
+            num_dropped.fetch_add(1, std::memory_order::relaxed);
+            return;
+        }
+
+        _events[head % capacity] = event;
+        _head.store(head + 1, std::memory_order::release);
+    }
+
+    /** Take all events from the buffer.
+     *
+     * @note Must be called by a single consumer.
+     * @param func The function called with each event.
+     * @return The number of events taken.
+     */
+    template<typename Func>
+    std::size_t take_all(Func const& func) noexcept
+    {
+        auto const head = _head.load(std::memory_order::acquire);
+        auto tail = _tail.load(std::memory_order::relaxed);
+        auto const r = narrow_cast<std::size_t>(head - tail);
+
+        for (; tail != head; ++tail) {
+            func(_events[tail % capacity]);
+        }
+        _tail.store(tail, std::memory_order::release);
+        return r;
+    }
+
+    [[nodiscard]] bool empty() const noexcept
+    {
+        return _head.load(std::memory_order::acquire) == _tail.load(std::memory_order::relaxed);
+    }
+
+private:
+    std::array<trace_event, capacity> _events;
+    std::atomic<uint64_t> _head = 0;
+    std::atomic<uint64_t> _tail = 0;
+};
+
+} // namespace detail
+
+/** Record trace scopes so that they can be viewed as a flame-chart.
+ *
+ * Normally a `trace<Tag>` only adds its duration to `global_counter<Tag>`,
+ * which keeps the minimum, maximum and mean duration. While the recorder is
+ * running each trace scope is also recorded with its begin and end time,
+ * thread and CPU, in a buffer owned by the thread.
+ *
+ * The events are exported in the Chrome trace-event JSON format, which can be
+ * opened with `chrome://tracing` or https://ui.perfetto.dev.
+ *
+ * ```
+ * // The trace file is written by `stop()`, or at system shutdown.
+ * trace_recorder::start("trace.json");
+ * ```
+ */
+class trace_recorder {
+public:
+    /** Check if the recorder is running.
+     */
+    [[nodiscard]] hi_force_inline static bool is_recording() noexcept
+    {
+        return _recording.load(std::memory_order::relaxed);
+    }
+
+    /** Start recording trace scopes.
+     *
+     * @param path When not empty, the trace is saved to this file when `stop()`
+     *             is called, or by `shutdown_system()` if the system is running.
+     */
+    static void start(std::filesystem::path path = {}) noexcept
+    {
+        auto const save = not path.empty();
+        {
+            auto const lock = std::scoped_lock(_mutex);
+            _path = std::move(path);
+        }
+
+        if (save) {
+            hi::start_subsystem(_started, false, subsystem_init, subsystem_deinit);
+        }
+        _recording.store(true, std::memory_order::relaxed);
+    }
+
+    /** Stop recording trace scopes.
+     *
+     * If a path was given to `start()` the events recorded so far are saved
+     * to that file.
+     *
+     * @throws io_error When the trace could not be written.
+     */
+    static void stop()
+    {
+        _recording.store(false, std::memory_order::relaxed);
+
+        auto path = std::filesystem::path{};
+        {
+            auto const lock = std::scoped_lock(_mutex);
+            path = std::exchange(_path, {});
+        }
+
+        if (not path.empty()) {
+            save_chrome_trace(path);
+        }
+    }
+
+    /** Record a trace scope that has finished.
+     *
+     * @param name The name of the trace, must have static storage duration.
+     * @param begin The time stamp count at the start of the scope.
+     */
+    static void record(std::string_view name, uint64_t begin) noexcept
+    {
+        thread_buffer().push(detail::trace_event{name, begin, time_stamp_count{time_stamp_count::inplace_with_cpu_id{}}});
+    }
+
+    /** Take the events recorded so far and format them as a Chrome trace.
+     *
+     * The events are removed from the recorder, so that calling this function
+     * periodically exports each event once.
+     *
+     * @return A JSON document in the Chrome trace-event format.
+     */
+    [[nodiscard]] static std::string take_chrome_trace() noexcept
+    {
+        auto r = std::string{};
+        auto out = std::back_inserter(r);
+
+        r += "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+        auto const lock = std::scoped_lock(_mutex);
+        for (auto const& buffer : _buffers) {
+            auto const tid = buffer->thread;
+
+            // Name the thread in the viewer.
+            out = std::format_to(out, "{{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":{},\"args\":{{\"name\":", tid);
+            append_json_string(r, get_thread_name(tid));
+            r += "}},\n";
+
+            buffer->take_all([&](detail::trace_event const& event) {
+                auto const begin = time_stamp_count::duration_from_count(event.begin);
+                auto const end = event.end.time_since_epoch();
+
+                r += "{\"ph\":\"X\",\"name\":";
+                append_json_string(r, event.name);
+                out = std::format_to(
+                    out,
+                    ",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"cpu\":{}}}}},\n",
+                    tid,
+                    begin.count() / 1000.0,
+                    (end - begin).count() / 1000.0,
+                    event.end.cpu_id());
+            });
+
+            if (auto const num_dropped = buffer->num_dropped.exchange(0, std::memory_order::relaxed)) {
+                out = std::format_to(
+                    out,
+                    "{{\"ph\":\"i\",\"name\":\"dropped {} events\",\"s\":\"t\",\"pid\":1,\"tid\":{},\"ts\":{:.3f}}},\n",
+                    num_dropped,
+                    tid,
+                    time_stamp_count::now().time_since_epoch().count() / 1000.0);
+            }
+        }
+
+        // Free the buffers of threads that have exited, after they have been drained.
+        std::erase_if(_buffers, [](auto const& buffer) {
+            return buffer->abandoned.load(std::memory_order::acquire) and buffer->empty();
+        });
+
+        if (r.ends_with(",\n")) {
+            r.erase(r.size() - 2, 1);
+        }
+        r += "]}\n";
+        return r;
+    }
+
+    /** Take the events recorded so far and save them as a Chrome trace.
+     *
+     * @param path The file to write the JSON document to.
+     * @throws io_error When the trace could not be written.
+     */
+    static void save_chrome_trace(std::filesystem::path const& path)
+    {
+        auto const text = take_chrome_trace();
+
+        auto file = std::ofstream(path, std::ios::binary | std::ios::trunc);
+        file.write(text.data(), narrow_cast<std::streamsize>(text.size()));
+        if (not file) {
+            throw io_error(std::format("Could not write trace to '{}'.", path.string()));
+        }
+    }
+
+private:
+    /** Mutex for managing _buffers and _path.
+     * We disable the dead_lock_detector, so that this mutex can be used before main().
+     */
+    constinit static inline unfair_mutex_impl<false> _mutex;
+    static inline std::atomic<bool> _recording = false;
+    static inline std::vector<std::unique_ptr<detail::trace_thread_buffer>> _buffers;
+    static inline std::filesystem::path _path;
+    static inline std::atomic<bool> _started = false;
+
+    [[nodiscard]] static bool subsystem_init() noexcept
+    {
+        return true;
+    }
+
+    /** Save the trace at system shutdown.
+     */
+    static void subsystem_deinit() noexcept
+    {
+        if (_started.exchange(false)) {
+            try {
+                stop();
+            } catch (std::exception const& e) {
+                hi_log_error("Could not save the trace at shutdown. {}", e.what());
+            }
+        }
+    }
+
+    /** The buffer of the current thread.
+     */
+    static inline thread_local detail::trace_thread_buffer *_thread_buffer = nullptr;
+
+    [[nodiscard]] hi_force_inline static detail::trace_thread_buffer& thread_buffer() noexcept
+    {
+        if (_thread_buffer != nullptr) [[likely]] {
+            return *_thread_buffer;
+        }
+        return register_thread_buffer();
+    }
+
+    hi_no_inline static detail::trace_thread_buffer& register_thread_buffer() noexcept
+    {
+        // Mark the buffer as abandoned when the thread exits.
+        struct abandon_on_exit {
+            ~abandon_on_exit()
+            {
+                if (_thread_buffer != nullptr) {
+                    _thread_buffer->abandoned.store(true, std::memory_order::release);
+                    _thread_buffer = nullptr;
+                }
+            }
+        };
+        thread_local abandon_on_exit abandon;
+
+        auto buffer = std::make_unique<detail::trace_thread_buffer>(current_thread_id());
+        _thread_buffer = buffer.get();
+
+        auto const lock = std::scoped_lock(_mutex);
+        _buffers.push_back(std::move(buffer));
+        return *_thread_buffer;
+    }
+
+    static void append_json_string(std::string& r, std::string_view str) noexcept
+    {
+        r += '"';
+        for (auto const c : str) {
+            if (c == '"' or c == '\\') {
+                r += '\\';
+                r += c;
+            } else if (char_cast<uint8_t>(c) < 0x20) {
+                std::format_to(std::back_inserter(r), "\\u{:04x}", char_cast<uint8_t>(c));
+            } else {
+                r += c;
+            }
+        }
+        r += '"';
+    }
+};
+
+} // namespace hi::inline v1
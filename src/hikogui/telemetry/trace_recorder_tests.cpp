@@ -0,0 +1,101 @@
+// Copyright Take Vos 2024.
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at https://www.boost.org/LICENSE_1_0.txt)
+
+#include "trace.hpp"
+#include "trace_recorder.hpp"
+#include "../codec/JSON.hpp"
+#include <hikotest/hikotest.hpp>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+TEST_SUITE(trace_recorder_suite) {
+
+/** Count the complete events with a name in a parsed Chrome trace.
+ */
+static std::size_t count_events(hi::datum const& document, char const *name)
+{
+    auto const& events = document["traceEvents"];
+
+    auto r = std::size_t{0};
+    for (auto i = std::size_t{0}; i != events.size(); ++i) {
+        if (events[i]["ph"] == "X" and events[i]["name"] == name) {
+            ++r;
+        }
+    }
+    return r;
+}
+
+TEST_CASE(record)
+{
+    hi::trace_recorder::start();
+    {
+        auto const outer = hi::trace<"trace_recorder_outer">{};
+        {
+            auto const inner = hi::trace<"trace_recorder_inner">{};
+        }
+    }
+    hi::trace_recorder::stop();
+
+    {
+        auto const ignored = hi::trace<"trace_recorder_ignored">{};
+    }
+
+    auto const json = hi::trace_recorder::take_chrome_trace();
+    REQUIRE(json.starts_with("{\"displayTimeUnit\":\"ns\",\"traceEvents\":["));
+    REQUIRE(json.ends_with("}\n]}\n"));
+
+    auto const document = hi::parse_JSON(json);
+    REQUIRE(document["displayTimeUnit"] == "ns");
+    REQUIRE(count_events(document, "trace_recorder_outer") == 1);
+    REQUIRE(count_events(document, "trace_recorder_inner") == 1);
+
+    // The inner scope finishes first.
+    auto const inner = json.find("{\"ph\":\"X\",\"name\":\"trace_recorder_inner\",");
+    auto const outer = json.find("{\"ph\":\"X\",\"name\":\"trace_recorder_outer\",");
+    REQUIRE(inner != std::string::npos);
+    REQUIRE(outer != std::string::npos);
+    REQUIRE(inner < outer);
+    REQUIRE(json.find("trace_recorder_ignored") == std::string::npos);
+
+    // The events have been taken.
+    REQUIRE(hi::trace_recorder::take_chrome_trace().find("trace_recorder_outer") == std::string::npos);
+}
+
+TEST_CASE(threads)
+{
+    hi::trace_recorder::start();
+    auto thread = std::thread([] {
+        for (auto i = 0; i != 10; ++i) {
+            auto const t = hi::trace<"trace_recorder_thread">{};
+        }
+    });
+    thread.join();
+    hi::trace_recorder::stop();
+
+    auto const json = hi::trace_recorder::take_chrome_trace();
+    REQUIRE(count_events(hi::parse_JSON(json), "trace_recorder_thread") == 10);
+}
+
+TEST_CASE(save)
+{
+    auto const path = std::filesystem::temp_directory_path() / "hikogui_trace_recorder_save.json";
+
+    hi::trace_recorder::start(path);
+    {
+        auto const t = hi::trace<"trace_recorder_save \"quoted\"">{};
+    }
+    hi::trace_recorder::stop();
+
+    auto file = std::ifstream(path, std::ios::binary);
+    auto const json = std::string(std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{});
+    file.close();
+    std::filesystem::remove(path);
+
+    REQUIRE(count_events(hi::parse_JSON(json), "trace_recorder_save \"quoted\"") == 1);
+}
+
+};
@@ -9,6 +9,7 @@
 #include "../telemetry/telemetry.hpp"
 #include "../concurrency/concurrency.hpp"
 #include "../char_maps/char_maps.hpp"
+#include "../security/security.hpp"
 #include "grapheme_attributes.hpp"
 #include "unicode_normalization.hpp"
 #include "ucd_general_categories.hpp"
@@ -145,7 +146,7 @@ private:
      */
     std::array<char32_t, 0x0f'0000> _table = {};
 
-    std::unordered_map<std::u32string, uint32_t> _indices = {};
+    std::unordered_map<std::u32string, uint32_t, key_hash<std::u32string, hash_policy::fast>> _indices = {};
 };
 
 inline long_grapheme_table long_graphemes = {};
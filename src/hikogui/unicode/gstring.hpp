@@ -9,6 +9,7 @@
 #include "unicode_grapheme_cluster_break.hpp"
 #include "../utility/utility.hpp"
 #include "../i18n/i18n.hpp"
+#include "../security/security.hpp"
 #include "../time/time.hpp" // XXX #616
 #include "../macros.hpp"
 #include <vector>
@@ -362,11 +363,10 @@ template<>
 struct hash<hi::gstring> {
     [[nodiscard]] std::size_t operator()(hi::gstring const& rhs) noexcept
     {
-        auto r = std::hash<std::size_t>{}(rhs.size());
-        for (auto const c : rhs) {
-            r = hi::hash_mix_two(r, std::hash<hi::grapheme>{}(c));
-        }
-        return r;
+        // Like std::hash<hi::grapheme> the full value of each grapheme is hashed,
+        // so the string is hashed as a whole.
+        static_assert(std::has_unique_object_representations_v<hi::grapheme>);
+        return hi::key_hash<hi::gstring, hi::hash_policy::fast>{}(rhs);
     }
 };
 